@@ -0,0 +1,88 @@
+// Shared job queue workload: THREADS workers each push a job and pop one,
+// OPERATIONS times. Compares a mutex-guarded PriorityQueue with a
+// ConcurrentPriorityQueue in strict (one shard) and relaxed configurations.
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "cpqueue.h"
+#include "pqueue.h"
+
+#define THREADS 8
+#define OPERATIONS 1000000
+#define PREFILL 10000
+
+static int job_comparator(void *a, void *b) {
+	uint64_t x = *(uint64_t *) a, y = *(uint64_t *) b;
+	return (x > y) - (x < y);
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + ((double) ts.tv_nsec / 1e9);
+}
+
+static PriorityQueue locked_pq;
+static pthread_mutex_t locked_pq_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *locked_worker(void *arg) {
+	uint64_t job = (uint64_t) (uintptr_t) arg;
+	for (int i = 0; i < OPERATIONS; ++i) {
+		pthread_mutex_lock(&locked_pq_lock);
+		PriorityQueue_push(&locked_pq, &job);
+		PriorityQueue_pop_into(&locked_pq, &job);
+		pthread_mutex_unlock(&locked_pq_lock);
+		job += THREADS;
+	}
+	return NULL;
+}
+
+static void *concurrent_worker(void *arg) {
+	ConcurrentPriorityQueue *cpq = arg;
+	uint64_t job = 0;
+	for (int i = 0; i < OPERATIONS; ++i) {
+		job += THREADS;
+		ConcurrentPriorityQueue_push(cpq, &job);
+		ConcurrentPriorityQueue_try_pop(cpq, &job);
+	}
+	return NULL;
+}
+
+static double run(void *(*worker)(void *), void *arg) {
+	pthread_t threads[THREADS];
+	double start = now();
+	for (int i = 0; i < THREADS; ++i)
+		if (pthread_create(&threads[i], NULL, worker, arg ? arg : (void *) (uintptr_t) i)) exit(EXIT_FAILURE);
+	for (int i = 0; i < THREADS; ++i)
+		pthread_join(threads[i], NULL);
+	return now() - start;
+}
+
+static double bench_concurrent(size_t shards) {
+	ConcurrentPriorityQueue cpq;
+	if (ConcurrentPriorityQueue_create(&cpq, sizeof(uint64_t), job_comparator, shards)) exit(EXIT_FAILURE);
+	for (uint64_t i = 0; i < PREFILL; ++i)
+		ConcurrentPriorityQueue_push(&cpq, &i);
+	double seconds = run(concurrent_worker, &cpq);
+	if (ConcurrentPriorityQueue_size(&cpq) != PREFILL) exit(EXIT_FAILURE);
+	ConcurrentPriorityQueue_invalidate(&cpq);
+	return seconds;
+}
+
+int main(void) {
+	printf("%d threads, %d push+pop operations each, %d prefilled jobs\n", THREADS, OPERATIONS, PREFILL);
+
+	if (PriorityQueue_create(&locked_pq, sizeof(uint64_t), job_comparator)) return EXIT_FAILURE;
+	for (uint64_t i = 0; i < PREFILL; ++i)
+		PriorityQueue_push(&locked_pq, &i);
+	printf("mutex + PriorityQueue            %8.3f s\n", run(locked_worker, NULL));
+	PriorityQueue_invalidate(&locked_pq);
+
+	printf("ConcurrentPriorityQueue, 1 shard %8.3f s\n", bench_concurrent(1));
+	printf("ConcurrentPriorityQueue, %d shards %7.3f s\n", THREADS * CPQ_SHARDS_PER_THREAD, bench_concurrent(THREADS * CPQ_SHARDS_PER_THREAD));
+	return 0;
+}
@@ -0,0 +1,97 @@
+// Ordered index workload: insert KEYS random 64-bit keys, look up LOOKUPS
+// random keys (half present), then scan every key in order. Compares the
+// red-black TreeSet with the BTreeSet B+tree, including the bytes each
+// obtains from its allocator.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bset.h"
+#include "tset.h"
+
+#define KEYS 2000000
+#define LOOKUPS 4000000
+
+static int key_comparator(void *a, void *b) {
+	uint64_t x = *(uint64_t *) a, y = *(uint64_t *) b;
+	return (x > y) - (x < y);
+}
+
+static uint64_t next_key(uint64_t *state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static size_t live_bytes;
+
+static void *counting_alloc(void *ctx, size_t bytes) {
+	(void) ctx;
+	live_bytes += bytes;
+	return malloc(bytes);
+}
+
+static void counting_free(void *ctx, void *ptr, size_t bytes) {
+	(void) ctx;
+	live_bytes -= bytes;
+	free(ptr);
+}
+
+static double seconds_since(clock_t start) {
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+static const Allocator counting = { .alloc = counting_alloc, .free = counting_free };
+
+int main(void) {
+	printf("%d keys, %d lookups, one full scan\n", KEYS, LOOKUPS);
+
+	uint64_t rng = 88172645463325252ULL, found = 0, sum = 0;
+	TreeSet ts = TreeSet_init_with_allocator(key_comparator, NULL, sizeof(uint64_t), &counting);
+	clock_t start = clock();
+	for (int i = 0; i < KEYS; ++i) {
+		uint64_t key = next_key(&rng) >> 1;
+		TreeSet_insert(&ts, &key);
+	}
+	printf("TreeSet   insert %8.3f s, %6.1f bytes/key\n", seconds_since(start), (double) live_bytes / KEYS);
+	rng = 88172645463325252ULL;
+	start = clock();
+	for (int i = 0; i < LOOKUPS; ++i) {
+		uint64_t key = next_key(&rng) >> (i & 1); // odd lookups miss with high probability
+		found += TreeSet_contains(&ts, &key);
+	}
+	printf("TreeSet   lookup %8.3f s\n", seconds_since(start));
+	start = clock();
+	for (TreeSetIterator it = TreeSet_begin(&ts); it; it = TreeSet_next(&ts, it))
+		sum += *(uint64_t *) it->data;
+	printf("TreeSet   scan   %8.3f s\n", seconds_since(start));
+	TreeSet_invalidate(&ts);
+
+	uint64_t tree_found = found, tree_sum = sum;
+	rng = 88172645463325252ULL;
+	found = sum = 0;
+	BTreeSet bs = BTreeSet_init_with_allocator(key_comparator, NULL, sizeof(uint64_t), &counting);
+	start = clock();
+	for (int i = 0; i < KEYS; ++i) {
+		uint64_t key = next_key(&rng) >> 1;
+		BTreeSet_insert(&bs, &key);
+	}
+	printf("BTreeSet  insert %8.3f s, %6.1f bytes/key\n", seconds_since(start), (double) live_bytes / KEYS);
+	rng = 88172645463325252ULL;
+	start = clock();
+	for (int i = 0; i < LOOKUPS; ++i) {
+		uint64_t key = next_key(&rng) >> (i & 1);
+		found += BTreeSet_contains(&bs, &key);
+	}
+	printf("BTreeSet  lookup %8.3f s\n", seconds_since(start));
+	start = clock();
+	for (BTreeSetIterator it = BTreeSet_begin(&bs); BTreeSet_iterator_get(&bs, it); it = BTreeSet_next(&bs, it))
+		sum += *(uint64_t *) BTreeSet_iterator_get(&bs, it);
+	printf("BTreeSet  scan   %8.3f s\n", seconds_since(start));
+	BTreeSet_invalidate(&bs);
+
+	return found == tree_found && sum == tree_sum ? EXIT_SUCCESS : EXIT_FAILURE;
+}
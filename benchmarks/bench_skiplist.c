@@ -0,0 +1,123 @@
+// Concurrent ordered index workload: THREADS workers together insert KEYS
+// random 64-bit keys, then each runs LOOKUPS lookups and short range scans.
+// Compares a mutex-guarded TreeSet with the lock-free SkipListSet for thread
+// counts from 1 up to MAX_THREADS. The machine needs that many cores for
+// the scaling numbers to mean anything.
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "slset.h"
+#include "tset.h"
+
+#define KEYS 2000000
+#define LOOKUPS 500000
+#define SCAN_LENGTH 16
+#define MAX_THREADS 32
+
+static int key_comparator(void *a, void *b) {
+	uint64_t x = *(uint64_t *) a, y = *(uint64_t *) b;
+	return (x > y) - (x < y);
+}
+
+static uint64_t next_key(uint64_t *state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + ((double) ts.tv_nsec / 1e9);
+}
+
+typedef struct Worker {
+	SkipListSet *sls;          // NULL for the locked TreeSet
+	uint64_t rng;
+	int keys;
+	uint64_t checksum;
+} Worker;
+
+static TreeSet locked_ts;
+static pthread_mutex_t locked_ts_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *insert_worker(void *arg) {
+	Worker *w = arg;
+	for (int i = 0; i < w->keys; ++i) {
+		uint64_t key = next_key(&w->rng);
+		if (w->sls) {
+			SkipListSet_insert(w->sls, &key);
+		} else {
+			pthread_mutex_lock(&locked_ts_lock);
+			TreeSet_insert(&locked_ts, &key);
+			pthread_mutex_unlock(&locked_ts_lock);
+		}
+	}
+	return NULL;
+}
+
+static void *lookup_worker(void *arg) {
+	Worker *w = arg;
+	for (int i = 0; i < LOOKUPS; ++i) {
+		uint64_t key = next_key(&w->rng);
+		if (w->sls) {
+			SkipListSetIterator it;
+			SkipListSet_lower_bound(w->sls, &key, &it);
+			for (int n = 0; n < SCAN_LENGTH && SkipListSet_iterator_get(&it); ++n, SkipListSet_next(&it))
+				w->checksum += *(const uint64_t *) SkipListSet_iterator_get(&it);
+			SkipListSet_iterator_close(&it);
+		} else {
+			pthread_mutex_lock(&locked_ts_lock);
+			TreeSetIterator it = TreeSet_lower_bound(&locked_ts, &key);
+			for (int n = 0; n < SCAN_LENGTH && it; ++n, it = TreeSet_next(&locked_ts, it))
+				w->checksum += *(uint64_t *) it->data;
+			pthread_mutex_unlock(&locked_ts_lock);
+		}
+	}
+	return NULL;
+}
+
+static double run(void *(*worker)(void *), Worker *workers, int threads) {
+	pthread_t ids[MAX_THREADS];
+	double start = now();
+	for (int i = 0; i < threads; ++i)
+		if (pthread_create(&ids[i], NULL, worker, &workers[i])) exit(EXIT_FAILURE);
+	for (int i = 0; i < threads; ++i)
+		pthread_join(ids[i], NULL);
+	return now() - start;
+}
+
+static uint64_t bench(SkipListSet *sls, int threads) {
+	Worker workers[MAX_THREADS];
+	for (int i = 0; i < threads; ++i)
+		workers[i] = (Worker) { .sls = sls, .rng = 88172645463325252ULL + (uint64_t) i * 0x9E3779B97F4A7C15ULL, .keys = KEYS / threads };
+	double insert = run(insert_worker, workers, threads);
+	double lookup = run(lookup_worker, workers, threads);
+	uint64_t checksum = 0;
+	for (int i = 0; i < threads; ++i)
+		checksum += workers[i].checksum;
+	printf("%-14s %2d threads: insert %7.2f Mops/s, lower_bound+%d %7.2f Mops/s\n", sls ? "SkipListSet" : "locked TreeSet",
+		threads, KEYS / insert / 1e6, SCAN_LENGTH, (double) LOOKUPS * threads / lookup / 1e6);
+	return checksum;
+}
+
+int main(void) {
+	printf("%d keys inserted by all threads, then %d range scans per thread\n", KEYS, LOOKUPS);
+	for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+		TreeSet_create(&locked_ts, key_comparator, sizeof(uint64_t));
+		uint64_t locked = bench(NULL, threads);
+		TreeSet_invalidate(&locked_ts);
+
+		SkipListSet sls;
+		if (SkipListSet_create(&sls, key_comparator, sizeof(uint64_t))) return EXIT_FAILURE;
+		uint64_t lock_free = bench(&sls, threads);
+		SkipListSet_invalidate(&sls);
+		if (locked != lock_free) return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+// Timer queue workload: keep PENDING timers outstanding, repeatedly pop the
+// earliest one and schedule a replacement a pseudo-random delay after it.
+// Compares the generic PriorityQueue, a CSTL_PQUEUE_DEFINE heap and RadixHeap.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "pqueue.h"
+#include "rheap.h"
+
+#define PENDING 100000
+#define OPERATIONS 5000000
+
+typedef struct Timer {
+	uint64_t deadline;
+	uint64_t id;
+} Timer;
+
+static inline int timer_less(const Timer *a, const Timer *b) {
+	return a->deadline < b->deadline;
+}
+
+CSTL_PQUEUE_DEFINE(Timer, TimerHeap, timer_less)
+
+static int timer_comparator(void *a, void *b) {
+	uint64_t x = ((Timer *) a)->deadline, y = ((Timer *) b)->deadline;
+	return (x > y) - (x < y);
+}
+
+static uint64_t next_delay(uint64_t *state) {
+	// xorshift64: cheap, deterministic delays between 1 and 1,000,000 ticks.
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return 1 + *state % 1000000;
+}
+
+static double seconds_since(clock_t start) {
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+static uint64_t bench_priority_queue(void) {
+	PriorityQueue pq;
+	if (PriorityQueue_create(&pq, sizeof(Timer), timer_comparator)) exit(EXIT_FAILURE);
+	uint64_t rng = 88172645463325252ULL, checksum = 0;
+	for (uint64_t i = 0; i < PENDING; ++i) {
+		Timer t = { next_delay(&rng), i };
+		PriorityQueue_push(&pq, &t);
+	}
+	for (uint64_t i = 0; i < OPERATIONS; ++i) {
+		Timer t;
+		PriorityQueue_pop_into(&pq, &t);
+		checksum += t.deadline;
+		t.deadline += next_delay(&rng);
+		PriorityQueue_push(&pq, &t);
+	}
+	PriorityQueue_invalidate(&pq);
+	return checksum;
+}
+
+static uint64_t bench_typed_heap(void) {
+	TimerHeap heap;
+	if (TimerHeap_create(&heap)) exit(EXIT_FAILURE);
+	uint64_t rng = 88172645463325252ULL, checksum = 0;
+	for (uint64_t i = 0; i < PENDING; ++i)
+		TimerHeap_push(&heap, (Timer) { next_delay(&rng), i });
+	for (uint64_t i = 0; i < OPERATIONS; ++i) {
+		Timer t = *TimerHeap_top(&heap);
+		TimerHeap_pop(&heap);
+		checksum += t.deadline;
+		t.deadline += next_delay(&rng);
+		TimerHeap_push(&heap, t);
+	}
+	TimerHeap_invalidate(&heap);
+	return checksum;
+}
+
+static uint64_t bench_radix_heap(void) {
+	RadixHeap rh;
+	if (RadixHeap_create(&rh, sizeof(uint64_t))) exit(EXIT_FAILURE);
+	uint64_t rng = 88172645463325252ULL, checksum = 0;
+	for (uint64_t i = 0; i < PENDING; ++i)
+		RadixHeap_push(&rh, next_delay(&rng), &i);
+	for (uint64_t i = 0; i < OPERATIONS; ++i) {
+		uint64_t deadline, id;
+		RadixHeap_pop_into(&rh, &deadline, &id);
+		checksum += deadline;
+		RadixHeap_push(&rh, deadline + next_delay(&rng), &id);
+	}
+	RadixHeap_invalidate(&rh);
+	return checksum;
+}
+
+int main(void) {
+	printf("%d pending timers, %d pop+push operations\n", PENDING, OPERATIONS);
+
+	clock_t start = clock();
+	uint64_t expected = bench_priority_queue();
+	printf("PriorityQueue (binary, comparator) %8.3f s\n", seconds_since(start));
+
+	start = clock();
+	uint64_t checksum = bench_typed_heap();
+	printf("CSTL_PQUEUE_DEFINE heap            %8.3f s\n", seconds_since(start));
+	if (checksum != expected) return EXIT_FAILURE;
+
+	start = clock();
+	checksum = bench_radix_heap();
+	printf("RadixHeap                          %8.3f s\n", seconds_since(start));
+	if (checksum != expected) return EXIT_FAILURE;
+	return 0;
+}
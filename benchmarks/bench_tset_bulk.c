@@ -0,0 +1,63 @@
+// Index rebuild workload: load KEYS already-sorted 64-bit keys into a TreeSet
+// one insert at a time and with TreeSet_from_sorted, then merge a batch of
+// BATCH new keys in with repeated inserts and with TreeSet_union.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "tset.h"
+
+#define KEYS 5000000
+#define BATCH 10000
+
+static int key_comparator(void *a, void *b) {
+	uint64_t x = *(uint64_t *) a, y = *(uint64_t *) b;
+	return (x > y) - (x < y);
+}
+
+static double seconds_since(clock_t start) {
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(void) {
+	uint64_t *keys = malloc(KEYS * sizeof(uint64_t));
+	if (!keys) return EXIT_FAILURE;
+	for (uint64_t i = 0; i < KEYS; ++i)
+		keys[i] = 2 * i;
+	printf("%d sorted keys, batch of %d\n", KEYS, BATCH);
+
+	TreeSet inserted = TreeSet_init(key_comparator, sizeof(uint64_t));
+	clock_t start = clock();
+	for (size_t i = 0; i < KEYS; ++i)
+		TreeSet_insert(&inserted, &keys[i]);
+	printf("insert loop   %8.3f s\n", seconds_since(start));
+
+	TreeSet built = TreeSet_init(key_comparator, sizeof(uint64_t));
+	View view = View(keys, KEYS, sizeof(uint64_t));
+	start = clock();
+	if (TreeSet_from_sorted(&built, &view) != TS_ERR_SUCCESS) return EXIT_FAILURE;
+	printf("from_sorted   %8.3f s\n", seconds_since(start));
+
+	// Odd keys spread over the whole range, so every one is new.
+	TreeSet batch = TreeSet_init(key_comparator, sizeof(uint64_t));
+	for (uint64_t i = 0; i < BATCH; ++i) {
+		uint64_t key = 2 * (i * (KEYS / BATCH)) + 1;
+		TreeSet_insert(&batch, &key);
+	}
+	start = clock();
+	for (TreeSetIterator it = TreeSet_begin(&batch); it; it = TreeSet_next(&batch, it))
+		TreeSet_insert(&inserted, it->data);
+	printf("batch inserts %8.3f s\n", seconds_since(start));
+	start = clock();
+	if (TreeSet_union(&built, &batch) != TS_ERR_SUCCESS) return EXIT_FAILURE;
+	printf("union         %8.3f s\n", seconds_since(start));
+
+	int status = TreeSet_size(&built) == TreeSet_size(&inserted) ? EXIT_SUCCESS : EXIT_FAILURE;
+	TreeSet_invalidate(&inserted);
+	TreeSet_invalidate(&built);
+	TreeSet_invalidate(&batch);
+	free(keys);
+	return status;
+}
@@ -0,0 +1,101 @@
+// Record lookup workload: KEYS 200-byte records indexed by a 64-bit id, then
+// LOOKUPS random ids. Compares a whole-record comparator fed record-shaped
+// probes with TreeSet_set_key and the inline TreeSet_set_u64_key cache.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tset.h"
+
+#define KEYS 1000000
+#define LOOKUPS 4000000
+
+typedef struct {
+	char name[192];
+	uint64_t id;
+} Record;
+
+static int record_comparator(void *a, void *b) {
+	uint64_t x = ((Record *) a)->id, y = ((Record *) b)->id;
+	return (x > y) - (x < y);
+}
+
+static int id_comparator(void *a, void *b) {
+	uint64_t x = *(uint64_t *) a, y = *(uint64_t *) b;
+	return (x > y) - (x < y);
+}
+
+static void *record_id(void *record) {
+	return &((Record *) record)->id;
+}
+
+static uint64_t record_u64_id(void *record) {
+	return ((Record *) record)->id;
+}
+
+static uint64_t next_key(uint64_t *state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static double seconds_since(clock_t start) {
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void fill(TreeSet *ts) {
+	uint64_t rng = 88172645463325252ULL;
+	Record record;
+	memset(&record, 'r', sizeof(record));
+	for (int i = 0; i < KEYS; ++i) {
+		record.id = next_key(&rng) % (2 * (uint64_t) KEYS);
+		TreeSet_insert(ts, &record);
+	}
+}
+
+int main(void) {
+	printf("%d records of %zu bytes, %d lookups by id\n", KEYS, sizeof(Record), LOOKUPS);
+	size_t found[3] = { 0 };
+
+	TreeSet probe_set = TreeSet_init(record_comparator, sizeof(Record));
+	fill(&probe_set);
+	uint64_t rng = 1;
+	clock_t start = clock();
+	for (int i = 0; i < LOOKUPS; ++i) {
+		Record probe;
+		probe.id = next_key(&rng) % (2 * (uint64_t) KEYS);
+		found[0] += TreeSet_contains(&probe_set, &probe);
+	}
+	printf("record probe %8.3f s\n", seconds_since(start));
+	TreeSet_invalidate(&probe_set);
+
+	TreeSet key_set = TreeSet_init(NULL, sizeof(Record));
+	TreeSet_set_key(&key_set, record_id, id_comparator);
+	fill(&key_set);
+	rng = 1;
+	start = clock();
+	for (int i = 0; i < LOOKUPS; ++i) {
+		uint64_t id = next_key(&rng) % (2 * (uint64_t) KEYS);
+		found[1] += TreeSet_contains_key(&key_set, &id);
+	}
+	printf("set_key      %8.3f s\n", seconds_since(start));
+	TreeSet_invalidate(&key_set);
+
+	TreeSet u64_set = TreeSet_init(NULL, sizeof(Record));
+	TreeSet_set_u64_key(&u64_set, record_u64_id);
+	fill(&u64_set);
+	rng = 1;
+	start = clock();
+	for (int i = 0; i < LOOKUPS; ++i) {
+		uint64_t id = next_key(&rng) % (2 * (uint64_t) KEYS);
+		found[2] += TreeSet_contains_key(&u64_set, &id);
+	}
+	printf("set_u64_key  %8.3f s\n", seconds_since(start));
+	TreeSet_invalidate(&u64_set);
+
+	return found[0] == found[1] && found[1] == found[2] ? EXIT_SUCCESS : EXIT_FAILURE;
+}
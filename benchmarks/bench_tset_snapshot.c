@@ -0,0 +1,86 @@
+// Reader snapshot workload: a writer keeps KEYS random 64-bit keys and, every
+// UPDATES_PER_SNAPSHOT updates, publishes a consistent view for readers.
+// Compares deep-copying a TreeSet (the old way) with PersistentTreeSet's O(1)
+// snapshots, whose later updates copy only their search path.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ptset.h"
+#include "tset.h"
+
+#define KEYS 1000000
+#define SNAPSHOTS 20
+#define UPDATES_PER_SNAPSHOT 1000
+
+static int key_comparator(void *a, void *b) {
+	uint64_t x = *(uint64_t *) a, y = *(uint64_t *) b;
+	return (x > y) - (x < y);
+}
+
+static uint64_t next_key(uint64_t *state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static double seconds_since(clock_t start) {
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(void) {
+	printf("%d keys, %d snapshots, %d updates between snapshots\n", KEYS, SNAPSHOTS, UPDATES_PER_SNAPSHOT);
+
+	uint64_t rng = 88172645463325252ULL;
+	TreeSet ts = TreeSet_init(key_comparator, sizeof(uint64_t));
+	PersistentTreeSet pts = PersistentTreeSet_init(key_comparator, sizeof(uint64_t));
+	for (int i = 0; i < KEYS; ++i) {
+		uint64_t key = next_key(&rng);
+		TreeSet_insert(&ts, &key);
+		PersistentTreeSet_insert(&pts, &key);
+	}
+
+	double copy_time = 0, update_time = 0;
+	uint64_t update_rng = rng;
+	for (int s = 0; s < SNAPSHOTS; ++s) {
+		clock_t start = clock();
+		TreeSet view = TreeSet_init(key_comparator, sizeof(uint64_t));
+		TreeSet_union(&view, &ts);
+		copy_time += seconds_since(start);
+		start = clock();
+		for (int i = 0; i < UPDATES_PER_SNAPSHOT; ++i) {
+			uint64_t key = next_key(&update_rng);
+			TreeSet_insert(&ts, &key);
+		}
+		update_time += seconds_since(start);
+		TreeSet_invalidate(&view);
+	}
+	printf("TreeSet            copy %10.3f ms/snapshot, updates %8.3f us each\n",
+		copy_time * 1e3 / SNAPSHOTS, update_time * 1e6 / (SNAPSHOTS * UPDATES_PER_SNAPSHOT));
+
+	double snapshot_time = 0;
+	update_time = 0;
+	update_rng = rng;
+	for (int s = 0; s < SNAPSHOTS; ++s) {
+		clock_t start = clock();
+		PersistentTreeSet view = PersistentTreeSet_snapshot(&pts);
+		snapshot_time += seconds_since(start);
+		start = clock();
+		for (int i = 0; i < UPDATES_PER_SNAPSHOT; ++i) {
+			uint64_t key = next_key(&update_rng);
+			PersistentTreeSet_insert(&pts, &key);
+		}
+		update_time += seconds_since(start);
+		PersistentTreeSet_invalidate(&view);
+	}
+	printf("PersistentTreeSet  copy %10.3f ms/snapshot, updates %8.3f us each\n",
+		snapshot_time * 1e3 / SNAPSHOTS, update_time * 1e6 / (SNAPSHOTS * UPDATES_PER_SNAPSHOT));
+
+	int status = TreeSet_size(&ts) == PersistentTreeSet_size(&pts) ? EXIT_SUCCESS : EXIT_FAILURE;
+	TreeSet_invalidate(&ts);
+	PersistentTreeSet_invalidate(&pts);
+	return status;
+}
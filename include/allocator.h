@@ -0,0 +1,94 @@
+#pragma once
+
+#include "arena.h"
+#include "slab.h"
+#include <stddef.h>
+
+/**
+ * @brief A pluggable memory source for containers.
+ *
+ * Every container has a `*_create_with_allocator` constructor taking a
+ * pointer to an Allocator; all of its buffers are then obtained and released
+ * through these callbacks. Each callback receives `ctx` as its first argument.
+ * Containers keep only the pointer, so the Allocator must outlive them.
+ *
+ * A NULL pointer (see `Allocator_default()`) or a zero-initialized Allocator
+ * uses `malloc`, `realloc` and `free`. Individual callbacks may also be left NULL:
+ * - `realloc == NULL`: emulated with `alloc`, `memcpy` and `free`.
+ * - `free == NULL`: memory is never returned individually (e.g. an arena,
+ *   released all at once by its owner).
+ *
+ * @code
+ * ArenaAllocator arena;
+ * ArenaAllocator_create(&arena, 4096);
+ * Allocator allocator = Allocator_arena(&arena);
+ * Vector v;
+ * Vector_create_with_allocator(&v, sizeof(int), &allocator);
+ * // ... no need to invalidate v ...
+ * ArenaAllocator_invalidate(&arena);
+ * @endcode
+ */
+typedef struct Allocator {
+	void *(*alloc)(void *ctx, size_t bytes);                                       /**< Allocates `bytes` bytes, or returns NULL. */
+	void *(*realloc)(void *ctx, void *ptr, size_t old_bytes, size_t new_bytes);    /**< Resizes a block, or returns NULL leaving it intact. */
+	void (*free)(void *ctx, void *ptr, size_t bytes);                              /**< Releases a block of `bytes` bytes. */
+	void *ctx;                                                                     /**< Opaque state passed to every callback. */
+} Allocator;
+
+/**
+ * @brief Returns the libc-backed allocator used when none is specified.
+ *
+ * @return NULL, which every Allocator function treats as `malloc`, `realloc` and `free`.
+ */
+const Allocator *Allocator_default(void);
+
+/**
+ * @brief Returns an allocator drawing from an ArenaAllocator.
+ *
+ * Frees are ignored; growing the most recent allocation extends it in place
+ * when the arena's current block has room. Blocks are `MAX_ALIGN` aligned,
+ * which is enough for SSE loads.
+ *
+ * @param arena Arena to allocate from; must outlive every container using it.
+ * @return An Allocator whose context is `arena`; pass containers its address.
+ */
+Allocator Allocator_arena(ArenaAllocator *arena);
+
+/**
+ * @brief Returns an allocator drawing from a SlabAllocator.
+ *
+ * Works with both plain and concurrent slab allocators.
+ *
+ * @param sa Slab allocator to allocate from; must outlive every container using it.
+ * @return An Allocator whose context is `sa`; pass containers its address.
+ */
+Allocator Allocator_slab(SlabAllocator *sa);
+
+/**
+ * @brief Allocates memory through an allocator.
+ *
+ * @param a The allocator, or NULL for libc.
+ * @param bytes Number of bytes to allocate.
+ * @return Pointer to the memory, or NULL on failure.
+ */
+void *Allocator_alloc(const Allocator *a, size_t bytes);
+
+/**
+ * @brief Resizes memory obtained from the same allocator.
+ *
+ * @param a The allocator, or NULL for libc.
+ * @param ptr Block to resize, or NULL to allocate.
+ * @param old_bytes Current size of the block.
+ * @param new_bytes Requested size of the block.
+ * @return Pointer to the resized memory, or NULL on failure (the block is left intact).
+ */
+void *Allocator_realloc(const Allocator *a, void *ptr, size_t old_bytes, size_t new_bytes);
+
+/**
+ * @brief Releases memory obtained from the same allocator.
+ *
+ * @param a The allocator, or NULL for libc.
+ * @param ptr Block to free, or NULL.
+ * @param bytes Size of the block.
+ */
+void Allocator_free(const Allocator *a, void *ptr, size_t bytes);
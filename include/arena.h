@@ -1,6 +1,7 @@
 #pragma once
 
 #include "error.h"
+#include "utility.h"
 #include <stddef.h>
 #include <stdbool.h>
 
@@ -12,21 +13,50 @@
  * and satisfies allocation requests from the top of that block using a
  * stack-pointer-like mechanism.
  *
- * Memory can only be released all at once using `ArenaAllocator_invalidate()`,
- * making it ideal for short-lived allocations or frame-based memory management.
+ * When the current block is exhausted, a growable arena chains a new heap
+ * block (at least twice the size of the previous one) and keeps bumping from
+ * there, so allocation only fails when the system allocator does.
+ *
+ * Memory is released either all at once using `ArenaAllocator_invalidate()`,
+ * or back to a checkpoint taken with `ArenaAllocator_mark()` using
+ * `ArenaAllocator_rewind()`, making it ideal for short-lived allocations,
+ * frame-based memory management, and nested scratch phases.
  *
  * @note
- * - No individual frees: memory is freed when the entire arena is invalidated.
+ * - No individual frees: memory is freed by invalidating or rewinding.
  * - Very fast allocation with no fragmentation.
  * - Optionally supports externally provided stack buffers to avoid dynamic allocation.
  */
 typedef struct ArenaAllocator {
-	char *stack;        /**< Pointer to the arena’s memory buffer. */
-	size_t size;        /**< Total size of the arena in bytes. */
-	size_t sp;          /**< Current stack pointer (offset from start of buffer). */
-	bool external_stack;/**< True if the buffer was provided externally and should not be freed. */
+	char *stack;        /**< Pointer to the current block’s memory buffer. */
+	size_t size;        /**< Total size of the current block in bytes. */
+	size_t sp;          /**< Current stack pointer (offset from start of the current block). */
+	bool external_stack;/**< True if the initial buffer was provided externally and should not be freed. */
+	bool growable;      /**< True if exhausting the current block chains a new heap block instead of failing. */
+	struct _ArenaBlock *_blocks; /**< Chained heap blocks, newest first (NULL while in the initial buffer). */
+	struct _ArenaBlock *_spare;  /**< Most recently rewound block, kept for reuse. */
 } ArenaAllocator;
 
+/**
+ * @brief Header of a block chained onto an arena once its previous block filled up.
+ *
+ * Records the block it replaced so that rewinding can restore it.
+ */
+struct _ArenaBlock {
+	struct _ArenaBlock *prev; /**< Previously current chained block (NULL for the initial buffer). */
+	char *prev_stack;         /**< Buffer of the previously current block. */
+	size_t prev_size;         /**< Size of the previously current block. */
+	size_t size;              /**< Usable bytes following this header. */
+};
+
+/**
+ * @brief A checkpoint in an arena, returned by `ArenaAllocator_mark()`.
+ */
+typedef struct ArenaAllocatorMark {
+	struct _ArenaBlock *block; /**< Block that was current when the mark was taken. */
+	size_t sp;                 /**< Stack pointer within that block. */
+} ArenaAllocatorMark;
+
 /**
  * @brief Error codes for ArenaAllocator operations.
  */
@@ -51,7 +81,8 @@ Result(ArenaAllocator, ArenaAllocatorError);
  *
  * @note
  * This function does not allocate memory; it simply configures the arena
- * to use the provided buffer.
+ * to use the provided buffer. The arena is not growable unless `growable`
+ * is set afterwards, in which case overflow spills into heap blocks.
  */
 void ArenaAllocator_create_stack(ArenaAllocator *arena, char *stack, size_t size);
 
@@ -59,7 +90,7 @@ void ArenaAllocator_create_stack(ArenaAllocator *arena, char *stack, size_t size
  * @brief Initializes an arena allocator with an internally allocated buffer.
  *
  * Allocates a new memory region of the specified size and prepares it
- * for allocation operations.
+ * for allocation operations. The arena is growable.
  *
  * @param arena Pointer to the ArenaAllocator to initialize.
  * @param size Total size of the arena in bytes.
@@ -98,22 +129,26 @@ ArenaAllocator ArenaAllocator_init_stack(char *stack, size_t size);
 Errable(ArenaAllocator) ArenaAllocator_init(size_t size);
 
 /**
- * @brief Returns the number of bytes of free space remaining in the arena.
+ * @brief Returns the number of bytes of free space remaining in the current block.
+ *
+ * A growable arena can satisfy larger requests by chaining a new block.
  *
  * @param arena Pointer to the ArenaAllocator.
- * @return The number of unused bytes left in the arena.
+ * @return The number of unused bytes left in the current block.
  */
 size_t ArenaAllocator_space(ArenaAllocator *arena);
 
 /**
  * @brief Allocates a block of memory from the arena.
  *
- * Returns a pointer to a newly allocated block of the specified size.
- * The memory is uninitialized, similar to `malloc()`.
+ * Returns a pointer to a newly allocated block of the specified size,
+ * aligned to `MAX_ALIGN` like the result of `malloc()`. The memory is
+ * uninitialized.
  *
  * @param arena Pointer to the ArenaAllocator.
  * @param bytes Number of bytes to allocate.
- * @return Pointer to the allocated memory, or `NULL` if there is not enough space.
+ * @return Pointer to the allocated memory, or `NULL` if there is not enough
+ *         space and the arena cannot grow.
  *
  * @note
  * This allocation does not support freeing individual blocks.
@@ -128,15 +163,86 @@ void *ArenaAllocator_alloc(ArenaAllocator *arena, size_t bytes);
  *
  * @param arena Pointer to the ArenaAllocator.
  * @param bytes Number of bytes to allocate.
- * @return Pointer to the zero-initialized memory, or `NULL` if there is not enough space.
+ * @return Pointer to the zero-initialized memory, or `NULL` if there is not enough
+ *         space and the arena cannot grow.
  */
 void *ArenaAllocator_calloc(ArenaAllocator *arena, size_t bytes);
 
+/**
+ * @brief Allocates a block of memory from the arena with a specific alignment.
+ *
+ * Padding is skipped as needed so the returned address is a multiple of
+ * `align`, making the block suitable for aligned SIMD loads and stores.
+ *
+ * @param arena Pointer to the ArenaAllocator.
+ * @param bytes Number of bytes to allocate.
+ * @param align Required alignment in bytes; must be a power of two.
+ * @return Pointer to the allocated memory, or `NULL` if there is not enough
+ *         space and the arena cannot grow.
+ */
+void *ArenaAllocator_alloc_aligned(ArenaAllocator *arena, size_t bytes, size_t align);
+
+/**
+ * @brief Allocates and zero-initializes a block with a specific alignment.
+ *
+ * @param arena Pointer to the ArenaAllocator.
+ * @param bytes Number of bytes to allocate.
+ * @param align Required alignment in bytes; must be a power of two.
+ * @return Pointer to the zero-initialized memory, or `NULL` on failure.
+ */
+void *ArenaAllocator_calloc_aligned(ArenaAllocator *arena, size_t bytes, size_t align);
+
+/**
+ * @brief Allocates a block that occupies whole cache lines.
+ *
+ * The block starts on a `CACHE_LINE_SIZE` boundary and its size is rounded up
+ * to a multiple of `CACHE_LINE_SIZE`, so no other allocation shares its lines.
+ * Use this for structures written concurrently by different threads to avoid
+ * false sharing.
+ *
+ * @param arena Pointer to the ArenaAllocator.
+ * @param bytes Number of bytes to allocate.
+ * @return Pointer to the allocated memory, or `NULL` on failure.
+ */
+void *ArenaAllocator_alloc_cache_line(ArenaAllocator *arena, size_t bytes);
+
+/**
+ * @brief Records the arena’s current position.
+ *
+ * Everything allocated after the mark can be released with
+ * `ArenaAllocator_rewind()` while keeping earlier allocations intact.
+ * Marks nest: rewinding to an outer mark also releases inner ones.
+ *
+ * @param arena Pointer to the ArenaAllocator.
+ * @return A checkpoint for use with `ArenaAllocator_rewind()`.
+ *
+ * @code
+ * ArenaAllocatorMark m = ArenaAllocator_mark(&arena);
+ * char *scratch = ArenaAllocator_alloc(&arena, 4096);
+ * // ... use scratch ...
+ * ArenaAllocator_rewind(&arena, m);
+ * @endcode
+ */
+ArenaAllocatorMark ArenaAllocator_mark(ArenaAllocator *arena);
+
+/**
+ * @brief Releases every allocation made since `mark` was taken.
+ *
+ * Heap blocks chained after the mark are freed, except the most recent one,
+ * which is kept to serve the next overflow without calling the allocator.
+ *
+ * @param arena Pointer to the ArenaAllocator.
+ * @param mark A checkpoint previously returned by `ArenaAllocator_mark()`
+ *             that has not been released by an earlier rewind.
+ */
+void ArenaAllocator_rewind(ArenaAllocator *arena, ArenaAllocatorMark mark);
+
 /**
  * @brief Frees all resources associated with the ArenaAllocator.
  *
- * Resets the arena and deallocates its memory if it was dynamically allocated.
- * If the arena was using an external stack buffer, only internal state is reset.
+ * Resets the arena and deallocates its memory if it was dynamically allocated,
+ * including every chained block. If the arena started from an external stack
+ * buffer, that buffer is left untouched.
  *
  * @param arena Pointer to the ArenaAllocator to invalidate.
  *
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "allocator.h"
 #include "error.h"
 #include "view.h"
 #include "slice.h"
@@ -20,6 +21,7 @@ typedef struct Array {
 	void *data;             /**< Pointer to the array’s allocated memory block. */
 	const size_t _member_size;    /**< Size in bytes of each element (e.g., `sizeof(T)`). */
 	const size_t size;      /**< Total number of elements in the array. */
+	const Allocator *_allocator;   /**< Source of the data block. */
 } Array;
 
 /**
@@ -62,6 +64,16 @@ Result(Array, ArrayError);
  */
 Errable(Array) Array_init(size_t member_size, size_t size);
 
+/**
+ * @brief Creates and initializes a new Array whose data comes from `allocator`.
+ *
+ * @param member_size Size in bytes of each element (use `sizeof(T)`).
+ * @param size Number of elements to allocate.
+ * @param allocator Source of the data block.
+ * @return An `Errable(Array)` result containing either a valid array or an OOM error.
+ */
+Errable(Array) Array_init_with_allocator(size_t member_size, size_t size, const Allocator *allocator);
+
 /**
  * @brief Initializes an existing Array object with the specified configuration.
  *
@@ -77,6 +89,17 @@ Errable(Array) Array_init(size_t member_size, size_t size);
  */
 ArrayError Array_create(Array *arr, size_t member_size, size_t size);
 
+/**
+ * @brief Initializes an existing Array object with data from `allocator`.
+ *
+ * @param arr Pointer to an uninitialized Array structure.
+ * @param member_size Size in bytes of each element.
+ * @param size Number of elements to allocate.
+ * @param allocator Source of the data block, also used to release it.
+ * @return `ARRAY_ERR_SUCCESS` if successful, `ARRAY_ERR_OOM` if allocation fails.
+ */
+ArrayError Array_create_with_allocator(Array *arr, size_t member_size, size_t size, const Allocator *allocator);
+
 /**
  * @brief Performs a deep copy of an Array from `src` to `dest`.
  *
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "bset.h"
+#include "utility.h"
+
+/**
+ * @brief An ordered map from generic keys to generic values, stored in a B+tree.
+ *
+ * BTreeMap stores each entry as a key immediately followed by its value
+ * (padded to the value's natural alignment) in the leaves of a BTreeSet.
+ * Inner nodes hold bare keys only, so large values do not reduce fan-out.
+ * Lookups take a bare key.
+ *
+ * @note
+ * - The comparator receives pointers to keys and follows the TreeSet convention.
+ * - Value pointers and iterators are invalidated by any insertion or removal.
+ */
+typedef struct BTreeMap {
+	BTreeSet _set;              /**< Underlying tree of key+value entries. */
+	const size_t _key_size;     /**< Size (in bytes) of each key. */
+	const size_t _value_size;   /**< Size (in bytes) of each value. */
+	const size_t _value_offset; /**< Offset of the value within an entry. */
+} BTreeMap;
+
+/** @brief Position of an entry in a BTreeMap. */
+typedef BTreeSetIterator BTreeMapIterator;
+
+/**
+ * @brief Error codes for BTreeMap operations.
+ */
+typedef enum {
+	BTM_ERR_SUCCESS = 0, /**< Operation succeeded. */
+	BTM_ERR_OOM,         /**< Out of memory during allocation. */
+	BTM_ERR_EXISTS,      /**< The key is already present; nothing was inserted. */
+} BTreeMapError;
+
+/**
+ * @brief Result of an emplace: the entry's value slot and whether it was newly inserted.
+ *
+ * `value` is NULL only when the insertion failed with an out of memory error.
+ */
+typedef Pair(void *value, bool inserted) BTMEmplacePair;
+
+/**
+ * @brief Creates an empty BTreeMap using libc memory.
+ *
+ * @param key_size Size (in bytes) of each key.
+ * @param value_size Size (in bytes) of each value.
+ * @param comparator Three-way key comparator.
+ * @return The new map.
+ */
+BTreeMap BTreeMap_init(size_t key_size, size_t value_size, int (*comparator)(void *, void *));
+
+/**
+ * @brief Populates an existing BTreeMap structure.
+ *
+ * @param bm Pointer to the BTreeMap to create.
+ * @param key_size Size (in bytes) of each key.
+ * @param value_size Size (in bytes) of each value.
+ * @param comparator Three-way key comparator.
+ */
+void BTreeMap_create(BTreeMap *bm, size_t key_size, size_t value_size, int (*comparator)(void *, void *));
+
+/**
+ * @brief Creates an empty BTreeMap whose nodes come from `allocator`.
+ *
+ * @param key_size Size (in bytes) of each key.
+ * @param value_size Size (in bytes) of each value.
+ * @param comparator Three-way key comparator.
+ * @param allocator Source of every node.
+ * @return The new map.
+ */
+BTreeMap BTreeMap_init_with_allocator(size_t key_size, size_t value_size, int (*comparator)(void *, void *), const Allocator *allocator);
+
+/**
+ * @brief Populates an existing BTreeMap structure whose nodes come from `allocator`.
+ *
+ * @param bm Pointer to the BTreeMap to create.
+ * @param key_size Size (in bytes) of each key.
+ * @param value_size Size (in bytes) of each value.
+ * @param comparator Three-way key comparator.
+ * @param allocator Source of every node.
+ */
+void BTreeMap_create_with_allocator(BTreeMap *bm, size_t key_size, size_t value_size, int (*comparator)(void *, void *), const Allocator *allocator);
+
+/**
+ * @brief Frees all memory associated with the BTreeMap.
+ *
+ * @param bm Pointer to the BTreeMap to invalidate.
+ */
+void BTreeMap_invalidate(BTreeMap *bm);
+
+/**
+ * @brief Frees all memory after calling a destructor on every entry.
+ *
+ * @param bm Pointer to the BTreeMap to invalidate.
+ * @param destructor Function called with pointers to each key and its value.
+ */
+void BTreeMap_custom_invalidate(BTreeMap *bm, void (*destructor)(void *, void *));
+
+/**
+ * @brief Removes all entries.
+ *
+ * @param bm Pointer to the BTreeMap.
+ */
+void BTreeMap_clear(BTreeMap *bm);
+
+/**
+ * @brief Returns the number of entries in the BTreeMap.
+ *
+ * @param bm Pointer to the BTreeMap.
+ * @return Number of entries currently stored.
+ */
+size_t BTreeMap_size(BTreeMap *bm);
+
+/**
+ * @brief Inserts a key/value pair unless the key is already present.
+ *
+ * @param bm Pointer to the BTreeMap.
+ * @param key Pointer to the key to copy in.
+ * @param value Pointer to the value to copy in.
+ * @return BTM_ERR_SUCCESS if inserted, BTM_ERR_EXISTS if the key exists, BTM_ERR_OOM on failure.
+ */
+BTreeMapError BTreeMap_insert(BTreeMap *bm, void *key, void *value);
+
+/**
+ * @brief Inserts a key/value pair, overwriting the value if the key exists.
+ *
+ * @param bm Pointer to the BTreeMap.
+ * @param key Pointer to the key to copy in.
+ * @param value Pointer to the value to copy in.
+ * @return BTM_ERR_SUCCESS on success, BTM_ERR_OOM on failure.
+ */
+BTreeMapError BTreeMap_put(BTreeMap *bm, void *key, void *value);
+
+/**
+ * @brief Inserts a key/value pair unless the key exists, returning the value slot.
+ *
+ * When `value` is NULL a newly inserted value is zeroed, as by
+ * TreeMap_get_or_insert(), and can be filled in through the returned pointer.
+ *
+ * @param bm Pointer to the BTreeMap.
+ * @param key Pointer to the key to copy in.
+ * @param value Pointer to the value to copy in, or NULL.
+ * @return The stored value and whether it was inserted by this call.
+ */
+BTMEmplacePair BTreeMap_emplace(BTreeMap *bm, void *key, void *value);
+
+/**
+ * @brief Looks up the value stored for a key.
+ *
+ * @param bm Pointer to the BTreeMap.
+ * @param key Pointer to the key.
+ * @return Pointer to the stored value, or NULL if the key is absent.
+ */
+void *BTreeMap_get(BTreeMap *bm, void *key);
+
+/**
+ * @brief Checks whether a key is stored.
+ *
+ * @param bm Pointer to the BTreeMap.
+ * @param key Pointer to the key.
+ * @return true if present, false otherwise.
+ */
+bool BTreeMap_contains(BTreeMap *bm, void *key);
+
+/**
+ * @brief Removes the entry for a key, if any.
+ *
+ * @param bm Pointer to the BTreeMap.
+ * @param key Pointer to the key.
+ * @return true if an entry was removed, false otherwise.
+ */
+bool BTreeMap_remove(BTreeMap *bm, void *key);
+
+/**
+ * @brief Returns the first entry whose key is not less than `key`.
+ *
+ * @param bm Pointer to the BTreeMap.
+ * @param key Pointer to the key.
+ * @return Iterator to the entry, or the end iterator.
+ */
+BTreeMapIterator BTreeMap_lower_bound(BTreeMap *bm, void *key);
+
+/**
+ * @brief Returns the first entry whose key is greater than `key`.
+ *
+ * @param bm Pointer to the BTreeMap.
+ * @param key Pointer to the key.
+ * @return Iterator to the entry, or the end iterator.
+ */
+BTreeMapIterator BTreeMap_upper_bound(BTreeMap *bm, void *key);
+
+/**
+ * @brief Returns an iterator to the entry with the smallest key.
+ *
+ * @param bm Pointer to the BTreeMap.
+ * @return Iterator to the first entry, or the end iterator if empty.
+ */
+BTreeMapIterator BTreeMap_begin(BTreeMap *bm);
+
+/**
+ * @brief Returns the end iterator.
+ *
+ * @param bm Pointer to the BTreeMap.
+ * @return The end iterator.
+ */
+BTreeMapIterator BTreeMap_end(BTreeMap *bm);
+
+/**
+ * @brief Steps to the entry with the next larger key.
+ *
+ * @param bm Pointer to the BTreeMap.
+ * @param it Iterator to a stored entry.
+ * @return Iterator to the following entry, or the end iterator.
+ */
+BTreeMapIterator BTreeMap_next(BTreeMap *bm, BTreeMapIterator it);
+
+/**
+ * @brief Steps to the entry with the next smaller key.
+ *
+ * @param bm Pointer to the BTreeMap.
+ * @param it Iterator to a stored entry, or the end iterator for the largest key.
+ * @return Iterator to the preceding entry, or the end iterator before the first.
+ */
+BTreeMapIterator BTreeMap_prev(BTreeMap *bm, BTreeMapIterator it);
+
+/**
+ * @brief Returns a pointer to the key of an entry.
+ *
+ * @param bm Pointer to the BTreeMap.
+ * @param it Iterator to a stored entry.
+ * @return Pointer to the entry's key, or NULL for the end iterator.
+ */
+void *BTreeMap_entry_key(BTreeMap *bm, BTreeMapIterator it);
+
+/**
+ * @brief Returns a pointer to the value of an entry.
+ *
+ * @param bm Pointer to the BTreeMap.
+ * @param it Iterator to a stored entry.
+ * @return Pointer to the entry's value, or NULL for the end iterator.
+ */
+void *BTreeMap_entry_value(BTreeMap *bm, BTreeMapIterator it);
@@ -0,0 +1,321 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "allocator.h"
+#include "utility.h"
+
+/**
+ * @brief Target size in bytes of a BTreeSet node; a multiple of `CACHE_LINE_SIZE`.
+ *
+ * Nodes grow beyond this when it cannot hold at least `BTREE_MIN_CAPACITY`
+ * elements or children.
+ */
+#ifndef BTREE_NODE_SIZE
+#define BTREE_NODE_SIZE 512
+#endif
+
+/** @brief Smallest number of elements per leaf and children per inner node. */
+#define BTREE_MIN_CAPACITY 4
+
+/** @brief Upper bound on the height of any BTreeSet (every inner node has at least 2 children). */
+#define BTREE_MAX_HEIGHT 64
+
+struct _BTreeNode;
+struct _BTreeLeaf;
+
+/**
+ * @brief Position of an element in a BTreeSet: a leaf and an index within it.
+ *
+ * The end iterator has a NULL leaf. Any insertion or removal may move
+ * elements between leaves, so iterators are invalidated by every mutation.
+ */
+typedef struct BTreeSetIterator {
+	struct _BTreeLeaf *_leaf; /**< Leaf holding the element, NULL at the end. */
+	size_t _index;            /**< Index of the element within the leaf. */
+} BTreeSetIterator;
+
+/**
+ * @brief An ordered set stored in an in-memory B+tree.
+ *
+ * Elements are kept sorted in wide leaves of about `BTREE_NODE_SIZE` bytes,
+ * stored inline and back to back. Leaves are doubly linked for range scans.
+ * Inner nodes hold only separator keys and child pointers. A lookup on
+ * millions of small elements therefore touches a handful of nodes. The
+ * per-node RB-tree used by TreeSet needs about two dozen dependent loads.
+ * Nodes are at least half full, so small elements take a few bytes of
+ * overhead each rather than a node header apiece.
+ *
+ * @note
+ * - The comparator follows the TreeSet convention: negative, zero or
+ *   positive as the first element orders before, equal to or after the second.
+ * - Comparisons only look at the first `_key_size` bytes of an element
+ *   (the whole element for a set). Separators in inner nodes are stored at
+ *   that size, which is how BTreeMap keeps values out of the inner nodes.
+ * - Element pointers and iterators are invalidated by any insertion or removal.
+ */
+typedef struct BTreeSet {
+	struct _BTreeNode *_root;            /**< Root node, NULL when empty. */
+	struct _BTreeLeaf *_first, *_last;   /**< Ends of the leaf list. */
+	size_t size;                         /**< Number of elements. */
+	size_t _height;                      /**< Levels in the tree (1 when the root is a leaf). */
+	int (*_comparator)(void *, void *);  /**< Orders elements by their leading key bytes. */
+	void (*_deletor)(void *);            /**< Destroys an element in place, or NULL. */
+	const size_t _member_size;           /**< Size (in bytes) of each element. */
+	size_t _key_size;                    /**< Leading bytes of an element that separators store. */
+	size_t _leaf_capacity;               /**< Maximum elements per leaf. */
+	size_t _inner_capacity;              /**< Maximum separator keys per inner node. */
+	size_t _leaf_bytes, _inner_bytes;    /**< Allocation size of each kind of node. */
+	size_t _keys_offset;                 /**< Offset of the separator keys in an inner node. */
+	const Allocator *_allocator;         /**< Source of every node. */
+} BTreeSet;
+
+/**
+ * @brief Error codes returned by BTreeSet operations.
+ */
+typedef enum {
+	BTS_ERR_SUCCESS = 0,       /**< Operation completed successfully. */
+	BTS_ERR_OOM,               /**< Out of memory during allocation. */
+	BTS_ERR_INVALID_ITERATOR,  /**< The iterator does not refer to an element. */
+} BTreeSetError;
+
+/**
+ * @brief Result of an emplace: the element's position and whether it was newly inserted.
+ *
+ * The iterator is the end iterator only when insertion failed for lack of memory.
+ */
+typedef Pair(BTreeSetIterator iterator, bool inserted) BTSEmplacePair;
+
+/**
+ * @brief Creates an empty BTreeSet using libc memory.
+ *
+ * Nodes are allocated on first insertion, so this cannot fail.
+ *
+ * @param comparator Three-way element comparator.
+ * @param member_size Size (in bytes) of each element.
+ * @return The new set.
+ */
+BTreeSet BTreeSet_init(int (*comparator)(void *, void *), size_t member_size);
+
+/**
+ * @brief Populates an existing BTreeSet structure.
+ *
+ * @param bs Pointer to the BTreeSet to initialize.
+ * @param comparator Three-way element comparator.
+ * @param member_size Size (in bytes) of each element.
+ */
+void BTreeSet_create(BTreeSet *bs, int (*comparator)(void *, void *), size_t member_size);
+
+/**
+ * @brief Creates an empty BTreeSet that destroys its elements on invalidation.
+ *
+ * @param comparator Three-way element comparator.
+ * @param deletor Called on each remaining element by BTreeSet_invalidate(), or NULL.
+ * @param member_size Size (in bytes) of each element.
+ * @return The new set.
+ */
+BTreeSet BTreeSet_custom_init(int (*comparator)(void *, void *), void (*deletor)(void *), size_t member_size);
+
+/**
+ * @brief Populates an existing BTreeSet structure with a deletor.
+ *
+ * @param bs Pointer to the BTreeSet to initialize.
+ * @param comparator Three-way element comparator.
+ * @param deletor Called on each remaining element by BTreeSet_invalidate(), or NULL.
+ * @param member_size Size (in bytes) of each element.
+ */
+void BTreeSet_custom_create(BTreeSet *bs, int (*comparator)(void *, void *), void (*deletor)(void *), size_t member_size);
+
+/**
+ * @brief Creates an empty BTreeSet whose nodes come from `allocator`.
+ *
+ * @param comparator Three-way element comparator.
+ * @param deletor Called on each remaining element by BTreeSet_invalidate(), or NULL.
+ * @param member_size Size (in bytes) of each element.
+ * @param allocator Source of every node.
+ * @return The new set.
+ */
+BTreeSet BTreeSet_init_with_allocator(int (*comparator)(void *, void *), void (*deletor)(void *), size_t member_size, const Allocator *allocator);
+
+/**
+ * @brief Populates an existing BTreeSet structure whose nodes come from `allocator`.
+ *
+ * @param bs Pointer to the BTreeSet to initialize.
+ * @param comparator Three-way element comparator.
+ * @param deletor Called on each remaining element by BTreeSet_invalidate(), or NULL.
+ * @param member_size Size (in bytes) of each element.
+ * @param allocator Source of every node.
+ */
+void BTreeSet_create_with_allocator(BTreeSet *bs, int (*comparator)(void *, void *), void (*deletor)(void *), size_t member_size, const Allocator *allocator);
+
+/**
+ * @brief Restricts comparisons and separators to the first `key_size` bytes of each element.
+ *
+ * Only valid on an empty set; used by BTreeMap to keep values out of inner nodes.
+ *
+ * @param bs Pointer to the BTreeSet.
+ * @param key_size Number of leading bytes the comparator reads (at most `member_size`).
+ */
+void _BTreeSet_set_key_size(BTreeSet *bs, size_t key_size);
+
+/**
+ * @brief Releases every node, calling the deletor (if any) on each element.
+ *
+ * @param bs Pointer to the BTreeSet to invalidate.
+ */
+void BTreeSet_invalidate(BTreeSet *bs);
+
+/**
+ * @brief Releases every node after calling `deletor` (if not NULL) on each element.
+ *
+ * @param bs Pointer to the BTreeSet to invalidate.
+ * @param deletor Destroys an element in place, or NULL.
+ */
+void BTreeSet_custom_invalidate(BTreeSet *bs, void (*deletor)(void *));
+
+/**
+ * @brief Removes every element without calling the deletor.
+ *
+ * @param bs Pointer to the BTreeSet.
+ */
+void BTreeSet_clear(BTreeSet *bs);
+
+/**
+ * @brief Returns the number of elements in the set.
+ *
+ * @param bs Pointer to the BTreeSet.
+ * @return Number of elements.
+ */
+size_t BTreeSet_size(BTreeSet *bs);
+
+/**
+ * @brief Finds the slot for `key`, inserting one holding a copy of its key bytes if absent.
+ *
+ * The remaining `member_size - key_size` bytes of a new slot are left for
+ * the caller to fill.
+ *
+ * @param bs Pointer to the BTreeSet.
+ * @param key Pointer to the key to look up (at least `_key_size` bytes).
+ * @return The slot and whether it was inserted; the end iterator on OOM.
+ */
+BTSEmplacePair _BTreeSet_prepare_insert(BTreeSet *bs, void *key);
+
+/**
+ * @brief Inserts a copy of an element unless an equal one is present.
+ *
+ * @param bs Pointer to the BTreeSet.
+ * @param data Pointer to the element.
+ * @return true if inserted, false if already present or memory ran out.
+ */
+bool BTreeSet_insert(BTreeSet *bs, void *data);
+
+/**
+ * @brief Inserts a copy of an element unless an equal one is present.
+ *
+ * @param bs Pointer to the BTreeSet.
+ * @param data Pointer to the element.
+ * @return The position of the new or existing element and whether it was inserted.
+ */
+BTSEmplacePair BTreeSet_emplace(BTreeSet *bs, void *data);
+
+/**
+ * @brief Removes the element equal to `data`, if any.
+ *
+ * @param bs Pointer to the BTreeSet.
+ * @param data Pointer to the element (or key) to remove.
+ * @return true if an element was removed.
+ */
+bool BTreeSet_remove(BTreeSet *bs, void *data);
+
+/**
+ * @brief Removes the element at an iterator.
+ *
+ * @param bs Pointer to the BTreeSet.
+ * @param it Iterator to a stored element.
+ * @return `BTS_ERR_SUCCESS`, or `BTS_ERR_INVALID_ITERATOR` for the end iterator.
+ */
+BTreeSetError BTreeSet_erase(BTreeSet *bs, BTreeSetIterator it);
+
+/**
+ * @brief Finds the element equal to `data`.
+ *
+ * @param bs Pointer to the BTreeSet.
+ * @param data Pointer to the element (or key) to look up.
+ * @return Iterator to the element, or the end iterator if absent.
+ */
+BTreeSetIterator BTreeSet_find(BTreeSet *bs, void *data);
+
+/**
+ * @brief Checks whether an element equal to `data` is stored.
+ *
+ * @param bs Pointer to the BTreeSet.
+ * @param data Pointer to the element (or key) to look up.
+ * @return true if present.
+ */
+bool BTreeSet_contains(BTreeSet *bs, void *data);
+
+/**
+ * @brief Returns the first element not less than `data`.
+ *
+ * @param bs Pointer to the BTreeSet.
+ * @param data Pointer to the element (or key) to compare against.
+ * @return Iterator to that element, or the end iterator.
+ */
+BTreeSetIterator BTreeSet_lower_bound(BTreeSet *bs, void *data);
+
+/**
+ * @brief Returns the first element greater than `data`.
+ *
+ * @param bs Pointer to the BTreeSet.
+ * @param data Pointer to the element (or key) to compare against.
+ * @return Iterator to that element, or the end iterator.
+ */
+BTreeSetIterator BTreeSet_upper_bound(BTreeSet *bs, void *data);
+
+/**
+ * @brief Returns an iterator to the smallest element.
+ *
+ * @param bs Pointer to the BTreeSet.
+ * @return Iterator to the first element, or the end iterator if empty.
+ */
+BTreeSetIterator BTreeSet_begin(BTreeSet *bs);
+
+/**
+ * @brief Returns the end iterator.
+ *
+ * @param bs Pointer to the BTreeSet.
+ * @return An iterator with a NULL leaf.
+ */
+BTreeSetIterator BTreeSet_end(BTreeSet *bs);
+
+/**
+ * @brief Steps to the next element in order.
+ *
+ * @code
+ * for (BTreeSetIterator it = BTreeSet_begin(&bs); BTreeSet_iterator_get(&bs, it); it = BTreeSet_next(&bs, it)) { ... }
+ * @endcode
+ *
+ * @param bs Pointer to the BTreeSet.
+ * @param it Iterator to a stored element.
+ * @return Iterator to the following element, or the end iterator.
+ */
+BTreeSetIterator BTreeSet_next(BTreeSet *bs, BTreeSetIterator it);
+
+/**
+ * @brief Steps to the previous element in order.
+ *
+ * @param bs Pointer to the BTreeSet.
+ * @param it Iterator to a stored element, or the end iterator for the largest element.
+ * @return Iterator to the preceding element, or the end iterator before the first.
+ */
+BTreeSetIterator BTreeSet_prev(BTreeSet *bs, BTreeSetIterator it);
+
+/**
+ * @brief Returns the element an iterator refers to.
+ *
+ * @param bs Pointer to the BTreeSet.
+ * @param it An iterator.
+ * @return Pointer to the element, or NULL for the end iterator.
+ */
+void *BTreeSet_iterator_get(BTreeSet *bs, BTreeSetIterator it);
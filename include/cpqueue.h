@@ -0,0 +1,144 @@
+#pragma once
+
+#include "error.h"
+#include "pqueue.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Shards per expected thread that give a good throughput/ordering balance.
+ */
+#define CPQ_SHARDS_PER_THREAD 2
+
+/**
+ * @brief A thread-safe priority queue built as a relaxed MultiQueue.
+ *
+ * Elements are spread over `shard_count` independent PriorityQueue shards,
+ * each guarded by its own mutex. A push goes to a random shard whose lock is
+ * free. A pop samples two random shards and takes the better of their two tops,
+ * so threads rarely contend for the same lock.
+ *
+ * The shard count is the relaxation knob:
+ * - One shard gives strict priority order. It behaves like a single
+ *   mutex-guarded PriorityQueue.
+ * - With more shards, a pop returns an element close to the best one, not
+ *   necessarily the best. The expected rank error grows linearly with the
+ *   shard count.
+ * - About `CPQ_SHARDS_PER_THREAD` shards per worker thread is a good default.
+ *
+ * @note
+ * - Every function except create and invalidate may be called from any thread.
+ * - try_pop only reports an empty queue after finding every shard empty.
+ * - The comparator follows the PriorityQueue convention: negative when the
+ *   first element belongs above the second.
+ */
+typedef struct ConcurrentPriorityQueue {
+	union _CPQShard *_shards;   /**< Cache-line padded, individually locked heaps. */
+	size_t shard_count;         /**< Number of shards (1 means strict ordering). */
+	size_t member_size;         /**< Size (in bytes) of each element. */
+} ConcurrentPriorityQueue;
+
+/**
+ * @brief Error codes returned by ConcurrentPriorityQueue operations.
+ */
+typedef enum {
+	CPQ_ERR_SUCCESS = 0,       /**< Operation completed successfully. */
+	CPQ_ERR_OOM,               /**< Out of memory, or the shard locks could not be created. */
+	CPQ_ERR_EMPTY_POP_BACK,    /**< Every shard was empty. */
+} ConcurrentPriorityQueueError;
+
+/** @brief Result type for ConcurrentPriorityQueue operations that may fail. */
+Result(ConcurrentPriorityQueue, ConcurrentPriorityQueueError);
+
+/**
+ * @brief Initializes a new ConcurrentPriorityQueue.
+ *
+ * @param member_size Size in bytes of each element.
+ * @param comparator Function to determine heap ordering.
+ * @param shard_count Number of shards (0 is treated as 1, which keeps strict ordering).
+ * @return An `Errable(ConcurrentPriorityQueue)` result containing either a valid queue or an OOM error.
+ */
+Errable(ConcurrentPriorityQueue) ConcurrentPriorityQueue_init(size_t member_size, int (*comparator)(void *, void *), size_t shard_count);
+
+/**
+ * @brief Initializes a new ConcurrentPriorityQueue whose shards draw from a custom allocator.
+ *
+ * See ConcurrentPriorityQueue_create_with_allocator().
+ *
+ * @param member_size Size in bytes of each element.
+ * @param comparator Function to determine heap ordering.
+ * @param shard_count Number of shards (0 is treated as 1, which keeps strict ordering).
+ * @param allocator Source of every shard's heap buffer; must be thread-safe.
+ * @return An `Errable(ConcurrentPriorityQueue)` result containing either a valid queue or an OOM error.
+ */
+Errable(ConcurrentPriorityQueue) ConcurrentPriorityQueue_init_with_allocator(size_t member_size, int (*comparator)(void *, void *), size_t shard_count, const Allocator *allocator);
+
+/**
+ * @brief Populates an existing ConcurrentPriorityQueue structure.
+ *
+ * @param cpq Pointer to the queue to initialize.
+ * @param member_size Size of each element in bytes.
+ * @param comparator Comparator function for heap ordering.
+ * @param shard_count Number of shards (0 is treated as 1, which keeps strict ordering).
+ * @return `CPQ_ERR_SUCCESS` on success, `CPQ_ERR_OOM` if allocation or lock creation fails.
+ */
+ConcurrentPriorityQueueError ConcurrentPriorityQueue_create(ConcurrentPriorityQueue *cpq, size_t member_size, int (*comparator)(void *, void *), size_t shard_count);
+
+/**
+ * @brief Populates an existing ConcurrentPriorityQueue whose shards draw from a custom allocator.
+ *
+ * Each shard's PriorityQueue grows through `allocator`, and shards grow
+ * concurrently, so the allocator must be thread-safe (e.g. a concurrent
+ * SlabAllocator). The shard array itself is always taken from
+ * `posix_memalign`, since an Allocator only guarantees `MAX_ALIGN` and the
+ * shards must start on cache lines.
+ *
+ * @param cpq Pointer to the queue to initialize.
+ * @param member_size Size of each element in bytes.
+ * @param comparator Comparator function for heap ordering.
+ * @param shard_count Number of shards (0 is treated as 1, which keeps strict ordering).
+ * @param allocator Source of every shard's heap buffer; must be thread-safe.
+ * @return `CPQ_ERR_SUCCESS` on success, `CPQ_ERR_OOM` if allocation or lock creation fails.
+ */
+ConcurrentPriorityQueueError ConcurrentPriorityQueue_create_with_allocator(ConcurrentPriorityQueue *cpq, size_t member_size, int (*comparator)(void *, void *), size_t shard_count, const Allocator *allocator);
+
+/**
+ * @brief Releases all resources associated with the queue.
+ *
+ * No other thread may be using the queue.
+ *
+ * @param cpq Pointer to the queue to invalidate.
+ */
+void ConcurrentPriorityQueue_invalidate(ConcurrentPriorityQueue *cpq);
+
+/**
+ * @brief Returns the number of queued elements.
+ *
+ * The shards are counted one after another, so the result is only exact
+ * when no other thread is pushing or popping.
+ *
+ * @param cpq Pointer to the queue.
+ * @return Number of elements in the queue.
+ */
+size_t ConcurrentPriorityQueue_size(ConcurrentPriorityQueue *cpq);
+
+/**
+ * @brief Adds a copy of an element to a random shard.
+ *
+ * @param cpq Pointer to the queue.
+ * @param data Pointer to the element to insert.
+ * @return `CPQ_ERR_SUCCESS` on success, `CPQ_ERR_OOM` if memory allocation fails.
+ */
+ConcurrentPriorityQueueError ConcurrentPriorityQueue_push(ConcurrentPriorityQueue *cpq, void *data);
+
+/**
+ * @brief Removes a high priority element and copies it into `out`.
+ *
+ * With a single shard this is always the top element. Otherwise it is the
+ * better top of two randomly chosen shards.
+ *
+ * @param cpq Pointer to the queue.
+ * @param out Destination for the element (`member_size` bytes).
+ * @return `CPQ_ERR_SUCCESS` on success, `CPQ_ERR_EMPTY_POP_BACK` if every shard was empty.
+ */
+ConcurrentPriorityQueueError ConcurrentPriorityQueue_try_pop(ConcurrentPriorityQueue *cpq, void *out);
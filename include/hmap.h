@@ -0,0 +1,230 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "error.h"
+#include "hset.h"
+#include "utility.h"
+
+/**
+ * @brief An open-addressing hash map from generic keys to generic values.
+ *
+ * HashMap stores each entry as a key immediately followed by its value
+ * (padded to the value's natural alignment) inside a HashSet whose hash and
+ * comparator only look at the key. Lookups therefore take a bare key and get
+ * the same group-probing performance as HashSet.
+ *
+ * @note
+ * - The hash function and comparator receive pointers to keys.
+ * - Value pointers returned by lookups are invalidated by any insertion
+ *   that triggers a rehash.
+ */
+typedef struct HashMap {
+	HashSet _set;               /**< Underlying table of key+value entries. */
+	const size_t _key_size;     /**< Size (in bytes) of each key. */
+	const size_t _value_size;   /**< Size (in bytes) of each value. */
+	const size_t _value_offset; /**< Offset of the value within an entry. */
+} HashMap;
+
+/**
+ * @brief Error codes for HashMap operations.
+ */
+typedef enum {
+	HM_ERR_SUCCESS = 0, /**< Operation succeeded. */
+	HM_ERR_OOM,         /**< Out of memory during allocation. */
+	HM_ERR_EXISTS,      /**< The key is already present; nothing was inserted. */
+} HashMapError;
+
+/** @brief Result type for HashMap-returning functions. */
+Result(HashMap, HashMapError);
+
+/**
+ * @brief Result of an emplace: the entry's value slot and whether it was newly inserted.
+ *
+ * `value` is NULL only when the insertion failed with an out of memory error.
+ */
+typedef Pair(void *value, bool inserted) HMEmplacePair;
+
+/**
+ * @brief Creates and initializes a new HashMap.
+ *
+ * @param key_size Size (in bytes) of each key.
+ * @param value_size Size (in bytes) of each value.
+ * @param hash Hash function over keys.
+ * @param comparator Key equality comparator, returns 0 when equal.
+ * @return A Result containing a HashMap or an error code.
+ */
+Errable(HashMap) HashMap_init(size_t key_size, size_t value_size, size_t (*hash)(void *), int (*comparator)(void *, void *));
+
+/**
+ * @brief Creates and initializes a new HashMap whose table comes from `allocator`.
+ *
+ * @param key_size Size (in bytes) of each key.
+ * @param value_size Size (in bytes) of each value.
+ * @param hash Hash function over keys.
+ * @param comparator Key equality comparator, returns 0 when equal.
+ * @param allocator Source of the underlying table.
+ * @return A Result containing a HashMap or an error code.
+ */
+Errable(HashMap) HashMap_init_with_allocator(size_t key_size, size_t value_size, size_t (*hash)(void *), int (*comparator)(void *, void *), const Allocator *allocator);
+
+/**
+ * @brief Allocates internal memory for a HashMap.
+ *
+ * @param hm Pointer to the HashMap to create.
+ * @param key_size Size (in bytes) of each key.
+ * @param value_size Size (in bytes) of each value.
+ * @param hash Hash function over keys.
+ * @param comparator Key equality comparator, returns 0 when equal.
+ * @return HM_ERR_SUCCESS on success, HM_ERR_OOM on allocation failure.
+ */
+HashMapError HashMap_create(HashMap *hm, size_t key_size, size_t value_size, size_t (*hash)(void *), int (*comparator)(void *, void *));
+
+/**
+ * @brief Allocates internal memory for a HashMap from `allocator`.
+ *
+ * @param hm Pointer to the HashMap to create.
+ * @param key_size Size (in bytes) of each key.
+ * @param value_size Size (in bytes) of each value.
+ * @param hash Hash function over keys.
+ * @param comparator Key equality comparator, returns 0 when equal.
+ * @param allocator Source of the underlying table.
+ * @return HM_ERR_SUCCESS on success, HM_ERR_OOM on allocation failure.
+ */
+HashMapError HashMap_create_with_allocator(HashMap *hm, size_t key_size, size_t value_size, size_t (*hash)(void *), int (*comparator)(void *, void *), const Allocator *allocator);
+
+/**
+ * @brief Frees all memory associated with the HashMap.
+ *
+ * @param hm Pointer to the HashMap to invalidate.
+ */
+void HashMap_invalidate(HashMap *hm);
+
+/**
+ * @brief Frees all memory after calling a destructor on every entry.
+ *
+ * @param hm Pointer to the HashMap to invalidate.
+ * @param destructor Function called with pointers to each key and its value.
+ */
+void HashMap_custom_invalidate(HashMap *hm, void (*destructor)(void *, void *));
+
+/**
+ * @brief Removes all entries but keeps the allocated slots.
+ *
+ * @param hm Pointer to the HashMap.
+ */
+void HashMap_clear(HashMap *hm);
+
+/**
+ * @brief Returns the number of entries in the HashMap.
+ *
+ * @param hm Pointer to the HashMap.
+ * @return Number of entries currently stored.
+ */
+size_t HashMap_size(HashMap *hm);
+
+/**
+ * @brief Ensures `n` entries can be stored without a rehash.
+ *
+ * @param hm Pointer to the HashMap.
+ * @param n Total number of entries to make room for.
+ * @return HM_ERR_SUCCESS on success, HM_ERR_OOM on failure.
+ */
+HashMapError HashMap_reserve(HashMap *hm, size_t n);
+
+/**
+ * @brief Inserts a key/value pair unless the key is already present.
+ *
+ * @param hm Pointer to the HashMap.
+ * @param key Pointer to the key to copy in.
+ * @param value Pointer to the value to copy in.
+ * @return HM_ERR_SUCCESS if inserted, HM_ERR_EXISTS if the key exists, HM_ERR_OOM on failure.
+ */
+HashMapError HashMap_insert(HashMap *hm, void *key, void *value);
+
+/**
+ * @brief Inserts a key/value pair, overwriting the value if the key exists.
+ *
+ * @param hm Pointer to the HashMap.
+ * @param key Pointer to the key to copy in.
+ * @param value Pointer to the value to copy in.
+ * @return HM_ERR_SUCCESS on success, HM_ERR_OOM on failure.
+ */
+HashMapError HashMap_put(HashMap *hm, void *key, void *value);
+
+/**
+ * @brief Inserts a key/value pair unless the key exists, returning the value slot.
+ *
+ * When `value` is NULL a newly inserted value is left uninitialized for the
+ * caller to fill in through the returned pointer.
+ *
+ * @param hm Pointer to the HashMap.
+ * @param key Pointer to the key to copy in.
+ * @param value Pointer to the value to copy in, or NULL.
+ * @return The stored value and whether it was inserted by this call.
+ */
+HMEmplacePair HashMap_emplace(HashMap *hm, void *key, void *value);
+
+/**
+ * @brief Looks up the value stored for a key.
+ *
+ * @param hm Pointer to the HashMap.
+ * @param key Pointer to the key.
+ * @return Pointer to the stored value, or NULL if the key is absent.
+ */
+void *HashMap_get(HashMap *hm, void *key);
+
+/**
+ * @brief Checks whether a key is stored.
+ *
+ * @param hm Pointer to the HashMap.
+ * @param key Pointer to the key.
+ * @return true if present, false otherwise.
+ */
+bool HashMap_contains(HashMap *hm, void *key);
+
+/**
+ * @brief Removes the entry for a key, if any.
+ *
+ * @param hm Pointer to the HashMap.
+ * @param key Pointer to the key.
+ * @return true if an entry was removed, false otherwise.
+ */
+bool HashMap_remove(HashMap *hm, void *key);
+
+/**
+ * @brief Returns the first entry in slot order.
+ *
+ * Use HashMap_entry_key() and HashMap_entry_value() to access the entry.
+ *
+ * @param hm Pointer to the HashMap.
+ * @return Pointer to an entry, or NULL if the map is empty.
+ */
+void *HashMap_begin(HashMap *hm);
+
+/**
+ * @brief Returns the entry following `entry` in slot order.
+ *
+ * @param hm Pointer to the HashMap.
+ * @param entry Pointer to a stored entry.
+ * @return Pointer to the next entry, or NULL at the end.
+ */
+void *HashMap_next(HashMap *hm, void *entry);
+
+/**
+ * @brief Returns a pointer to the key of an entry.
+ *
+ * @param hm Pointer to the HashMap.
+ * @param entry Pointer to a stored entry.
+ * @return Pointer to the entry's key.
+ */
+void *HashMap_entry_key(HashMap *hm, void *entry);
+
+/**
+ * @brief Returns a pointer to the value of an entry.
+ *
+ * @param hm Pointer to the HashMap.
+ * @param entry Pointer to a stored entry.
+ * @return Pointer to the entry's value.
+ */
+void *HashMap_entry_value(HashMap *hm, void *entry);
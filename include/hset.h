@@ -0,0 +1,280 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "allocator.h"
+#include "error.h"
+#include "utility.h"
+
+/**
+ * @brief Number of control bytes examined per probe step.
+ *
+ * Slots are grouped into runs of 16 so that one SSE2 compare can test a whole
+ * group against a hash fragment. Capacities are always a power of two and at
+ * least one group wide.
+ */
+#define HS_GROUP_WIDTH 16
+
+/**
+ * @brief Control byte marking a slot that has never held an element.
+ */
+#define HS_CTRL_EMPTY ((int8_t) -128)
+
+/**
+ * @brief Control byte marking a slot whose element was removed (tombstone).
+ */
+#define HS_CTRL_DELETED ((int8_t) -2)
+
+/**
+ * @brief An open-addressing hash set of generic elements.
+ *
+ * HashSet is a Swiss-table style container: every slot has a one byte control
+ * entry holding either EMPTY, DELETED, or the low 7 bits of the element's hash.
+ * Lookups probe whole groups of 16 control bytes at a time (with SSE2 when
+ * available, a scalar loop otherwise) and only call the comparator on slots
+ * whose 7-bit fragment matches, so a successful lookup typically touches one
+ * control group and one slot.
+ *
+ * Elements are stored inline in a flat slot array, so pointers returned by
+ * lookups are invalidated by any insertion that triggers a rehash.
+ *
+ * @note
+ * - The hash function receives a pointer to an element (or probe) and may be
+ *   weak; its output is mixed internally before use.
+ * - The comparator follows the TreeSet convention and must return 0 for
+ *   equal elements. Only equality is ever tested.
+ */
+typedef struct HashSet {
+	int8_t *_ctrl;                      /**< Control bytes, one per slot. */
+	char *_slots;                       /**< Element storage, `_capacity * _member_size` bytes. */
+	size_t size;                        /**< Number of elements currently stored. */
+	size_t _capacity;                   /**< Number of slots (power of two, multiple of HS_GROUP_WIDTH). */
+	size_t _growth_left;                /**< Insertions into EMPTY slots left before a rehash. */
+	size_t (*_hash)(void *);            /**< Hash function applied to elements and probes. */
+	int (*_comparator)(void *, void *); /**< Equality comparator, returns 0 when equal. */
+	const size_t _member_size;          /**< Size (in bytes) of each element. */
+	const Allocator *_allocator;        /**< Source of the control and slot arrays. */
+} HashSet;
+
+/**
+ * @brief Error codes for HashSet operations.
+ */
+typedef enum {
+	HS_ERR_SUCCESS = 0, /**< Operation succeeded. */
+	HS_ERR_OOM,         /**< Out of memory during allocation. */
+	HS_ERR_EXISTS,      /**< An equal element is already present; nothing was inserted. */
+} HashSetError;
+
+/** @brief Result type for HashSet-returning functions. */
+Result(HashSet, HashSetError);
+
+/**
+ * @brief Result of an emplace: the element's slot and whether it was newly inserted.
+ *
+ * `element` is NULL only when the insertion failed with an out of memory error.
+ */
+typedef Pair(void *element, bool inserted) HSEmplacePair;
+
+/**
+ * @brief Creates and initializes a new HashSet.
+ *
+ * @param member_size Size (in bytes) of each element.
+ * @param hash Hash function over elements.
+ * @param comparator Equality comparator, returns 0 when two elements are equal.
+ * @return A Result containing a HashSet or an error code.
+ */
+Errable(HashSet) HashSet_init(size_t member_size, size_t (*hash)(void *), int (*comparator)(void *, void *));
+
+/**
+ * @brief Creates and initializes a new HashSet whose table comes from `allocator`.
+ *
+ * @param member_size Size (in bytes) of each element.
+ * @param hash Hash function over elements.
+ * @param comparator Equality comparator, returns 0 when two elements are equal.
+ * @param allocator Source of the control and slot arrays.
+ * @return A Result containing a HashSet or an error code.
+ */
+Errable(HashSet) HashSet_init_with_allocator(size_t member_size, size_t (*hash)(void *), int (*comparator)(void *, void *), const Allocator *allocator);
+
+/**
+ * @brief Allocates internal memory for a HashSet.
+ *
+ * @param hs Pointer to the HashSet to create.
+ * @param member_size Size (in bytes) of each element.
+ * @param hash Hash function over elements.
+ * @param comparator Equality comparator, returns 0 when two elements are equal.
+ * @return HS_ERR_SUCCESS on success, HS_ERR_OOM on allocation failure.
+ */
+HashSetError HashSet_create(HashSet *hs, size_t member_size, size_t (*hash)(void *), int (*comparator)(void *, void *));
+
+/**
+ * @brief Allocates internal memory for a HashSet from `allocator`.
+ *
+ * The allocator is kept for every later rehash and invalidation.
+ *
+ * @param hs Pointer to the HashSet to create.
+ * @param member_size Size (in bytes) of each element.
+ * @param hash Hash function over elements.
+ * @param comparator Equality comparator, returns 0 when two elements are equal.
+ * @param allocator Source of the control and slot arrays.
+ * @return HS_ERR_SUCCESS on success, HS_ERR_OOM on allocation failure.
+ */
+HashSetError HashSet_create_with_allocator(HashSet *hs, size_t member_size, size_t (*hash)(void *), int (*comparator)(void *, void *), const Allocator *allocator);
+
+/**
+ * @brief Performs a deep (bitwise) copy of one HashSet into another.
+ *
+ * Any storage owned by `dest` is released first; `dest` keeps its allocator.
+ *
+ * @param dest Destination HashSet.
+ * @param src Source HashSet.
+ * @return HS_ERR_SUCCESS on success, HS_ERR_OOM on failure.
+ */
+HashSetError HashSet_cpy(HashSet *dest, const HashSet *src);
+
+/**
+ * @brief Moves a HashSet into another, leaving the source empty and unallocated.
+ *
+ * @param dest Destination HashSet.
+ * @param src Source HashSet (must be re-created before reuse).
+ */
+void HashSet_mv(HashSet *dest, HashSet *src);
+
+/**
+ * @brief Frees all memory associated with the HashSet.
+ *
+ * @param hs Pointer to the HashSet to invalidate.
+ */
+void HashSet_invalidate(HashSet *hs);
+
+/**
+ * @brief Frees all memory after calling a destructor on every stored element.
+ *
+ * @param hs Pointer to the HashSet to invalidate.
+ * @param destructor Function called with a pointer to each element.
+ */
+void HashSet_custom_invalidate(HashSet *hs, void (*destructor)(void *));
+
+/**
+ * @brief Removes all elements but keeps the allocated slots.
+ *
+ * @param hs Pointer to the HashSet.
+ */
+void HashSet_clear(HashSet *hs);
+
+/**
+ * @brief Returns the number of elements in the HashSet.
+ *
+ * @param hs Pointer to the HashSet.
+ * @return Number of elements currently stored.
+ */
+size_t HashSet_size(HashSet *hs);
+
+/**
+ * @brief Ensures `n` elements can be stored without a rehash.
+ *
+ * @param hs Pointer to the HashSet.
+ * @param n Total number of elements to make room for.
+ * @return HS_ERR_SUCCESS on success, HS_ERR_OOM on failure.
+ */
+HashSetError HashSet_reserve(HashSet *hs, size_t n);
+
+/**
+ * @brief Finds or claims the slot for an element equal to `probe`.
+ *
+ * Building block for containers layered over HashSet (see HashMap). When no
+ * equal element exists a slot is claimed, counted in `size`, and returned
+ * uninitialized; the caller must copy an element equal to `probe` into it
+ * before the next operation on the set.
+ *
+ * @param hs Pointer to the HashSet.
+ * @param probe Pointer passed to the hash and comparator functions.
+ * @return The slot and whether it was claimed, or a NULL slot on OOM.
+ */
+HSEmplacePair _HashSet_prepare_insert(HashSet *hs, void *probe);
+
+/**
+ * @brief Inserts a copy of `data` unless an equal element exists.
+ *
+ * @param hs Pointer to the HashSet.
+ * @param data Pointer to the element to copy in.
+ * @return HS_ERR_SUCCESS if inserted, HS_ERR_EXISTS if already present, HS_ERR_OOM on failure.
+ */
+HashSetError HashSet_insert(HashSet *hs, void *data);
+
+/**
+ * @brief Inserts a copy of `data` unless an equal element exists, returning its slot.
+ *
+ * @param hs Pointer to the HashSet.
+ * @param data Pointer to the element to copy in.
+ * @return The stored element and whether it was inserted by this call.
+ */
+HSEmplacePair HashSet_emplace(HashSet *hs, void *data);
+
+/**
+ * @brief Looks up an element equal to `data`.
+ *
+ * @param hs Pointer to the HashSet.
+ * @param data Probe passed to the hash and comparator functions.
+ * @return Pointer to the stored element, or NULL if absent.
+ */
+void *HashSet_find(HashSet *hs, void *data);
+
+/**
+ * @brief Checks whether an element equal to `data` is stored.
+ *
+ * @param hs Pointer to the HashSet.
+ * @param data Probe passed to the hash and comparator functions.
+ * @return true if present, false otherwise.
+ */
+bool HashSet_contains(HashSet *hs, void *data);
+
+/**
+ * @brief Removes the element equal to `data`, if any.
+ *
+ * @param hs Pointer to the HashSet.
+ * @param data Probe passed to the hash and comparator functions.
+ * @return true if an element was removed, false otherwise.
+ */
+bool HashSet_remove(HashSet *hs, void *data);
+
+/**
+ * @brief Removes a stored element given a pointer previously returned by the set.
+ *
+ * Does not call the hash or comparator.
+ *
+ * @param hs Pointer to the HashSet.
+ * @param element Pointer to a stored element.
+ */
+void HashSet_erase(HashSet *hs, void *element);
+
+/**
+ * @brief Returns the first stored element in slot order.
+ *
+ * @param hs Pointer to the HashSet.
+ * @return Pointer to an element, or NULL if the set is empty.
+ */
+void *HashSet_begin(HashSet *hs);
+
+/**
+ * @brief Returns the stored element following `element` in slot order.
+ *
+ * @code
+ * for (void *it = HashSet_begin(&hs); it; it = HashSet_next(&hs, it)) { ... }
+ * @endcode
+ *
+ * @param hs Pointer to the HashSet.
+ * @param element Pointer to a stored element.
+ * @return Pointer to the next element, or NULL at the end.
+ */
+void *HashSet_next(HashSet *hs, void *element);
+
+/**
+ * @brief General purpose byte hash suitable for use in hash functions.
+ *
+ * @param data Pointer to the bytes to hash.
+ * @param len Number of bytes.
+ * @return A 64-bit (or size_t wide) hash of the bytes.
+ */
+size_t HashSet_hash_bytes(const void *data, size_t len);
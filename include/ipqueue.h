@@ -0,0 +1,221 @@
+#pragma once
+
+#include "error.h"
+#include "pqueue.h"
+#include "vector.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Stable reference to an element of an IndexedPriorityQueue.
+ *
+ * A handle stays valid from the push that returned it until the element is
+ * popped or removed, regardless of how the heap is reordered in between.
+ * Afterwards the handle may be reused by a later push.
+ */
+typedef size_t IPQHandle;
+
+/**
+ * @brief Position stored for handles that are not currently in the queue.
+ */
+#define IPQ_NPOS ((size_t) -1)
+
+/**
+ * @brief A d-ary heap whose elements can be reprioritised or removed by handle.
+ *
+ * Elements live in a slot array indexed by handle and never move; the heap
+ * itself orders handles. A flat position array maps each handle to its heap
+ * index, so `update_priority`, `remove` and `contains` need no search and run
+ * in O(log n), O(log n) and O(1) respectively.
+ *
+ * @note
+ * - The comparator follows the PriorityQueue convention: negative when the
+ *   first element belongs above the second.
+ * - Freed handles are recycled, so keep a handle only while its element is queued.
+ */
+typedef struct IndexedPriorityQueue {
+	Vector _elements;                     /**< Element slots, indexed by handle. */
+	Vector _heap;                         /**< Handles (IPQHandle) in heap order. */
+	Vector _positions;                    /**< Heap index per handle, or IPQ_NPOS when free. */
+	Vector _free;                         /**< Handles available for reuse. */
+	int (*comparator)(void *, void *);    /**< Function to compare two elements (determines heap order). */
+	size_t arity;                         /**< Number of children per node (at least 2). */
+} IndexedPriorityQueue;
+
+/**
+ * @brief Error codes returned by IndexedPriorityQueue operations.
+ */
+typedef enum {
+	IPQ_ERR_SUCCESS = 0,       /**< Operation completed successfully. */
+	IPQ_ERR_OOM,               /**< Out of memory during allocation. */
+	IPQ_ERR_EMPTY_POP_BACK,    /**< Attempted to pop from an empty queue. */
+	IPQ_ERR_INVALID_HANDLE,    /**< The handle does not refer to a queued element. */
+} IndexedPriorityQueueError;
+
+/** @brief Result type for IndexedPriorityQueue operations that may fail. */
+Result(IndexedPriorityQueue, IndexedPriorityQueueError);
+
+/**
+ * @brief Initializes a new IndexedPriorityQueue.
+ *
+ * @param member_size Size in bytes of each element.
+ * @param comparator Function to determine heap ordering.
+ * @return An `Errable(IndexedPriorityQueue)` result containing either a valid queue or an OOM error.
+ */
+Errable(IndexedPriorityQueue) IndexedPriorityQueue_init(size_t member_size, int (*comparator)(void *, void *));
+
+/**
+ * @brief Initializes a new IndexedPriorityQueue using a custom allocator.
+ *
+ * @param member_size Size in bytes of each element.
+ * @param comparator Function to determine heap ordering.
+ * @param allocator Source of the element, heap, position and free-handle arrays.
+ * @return An `Errable(IndexedPriorityQueue)` result containing either a valid queue or an OOM error.
+ */
+Errable(IndexedPriorityQueue) IndexedPriorityQueue_init_with_allocator(size_t member_size, int (*comparator)(void *, void *), const Allocator *allocator);
+
+/**
+ * @brief Populates an existing IndexedPriorityQueue structure.
+ *
+ * @param ipq Pointer to the queue to initialize.
+ * @param member_size Size of each element in bytes.
+ * @param comparator Comparator function for heap ordering.
+ * @return `IPQ_ERR_SUCCESS` on success, `IPQ_ERR_OOM` if allocation fails.
+ */
+IndexedPriorityQueueError IndexedPriorityQueue_create(IndexedPriorityQueue *ipq, size_t member_size, int (*comparator)(void *, void *));
+
+/**
+ * @brief Populates an existing IndexedPriorityQueue structure using a custom allocator.
+ *
+ * @param ipq Pointer to the queue to initialize.
+ * @param member_size Size of each element in bytes.
+ * @param comparator Comparator function for heap ordering.
+ * @param allocator Source of the element, heap, position and free-handle arrays.
+ * @return `IPQ_ERR_SUCCESS` on success, `IPQ_ERR_OOM` if allocation fails.
+ */
+IndexedPriorityQueueError IndexedPriorityQueue_create_with_allocator(IndexedPriorityQueue *ipq, size_t member_size, int (*comparator)(void *, void *), const Allocator *allocator);
+
+/**
+ * @brief Releases all resources associated with the queue.
+ *
+ * @param ipq Pointer to the queue to invalidate.
+ */
+void IndexedPriorityQueue_invalidate(IndexedPriorityQueue *ipq);
+
+/**
+ * @brief Removes every element, invalidating all handles but keeping the storage.
+ *
+ * @param ipq Pointer to the queue.
+ */
+void IndexedPriorityQueue_clear(IndexedPriorityQueue *ipq);
+
+/**
+ * @brief Changes the number of children per node, re-heapifying in O(n).
+ *
+ * @param ipq Pointer to the queue.
+ * @param arity Number of children per node (values below 2 are treated as 2).
+ */
+void IndexedPriorityQueue_set_arity(IndexedPriorityQueue *ipq, size_t arity);
+
+/**
+ * @brief Returns the number of queued elements.
+ *
+ * @param ipq Pointer to the queue.
+ * @return Number of elements currently in the queue.
+ */
+size_t IndexedPriorityQueue_size(IndexedPriorityQueue *ipq);
+
+/**
+ * @brief Adds a copy of an element and returns its handle.
+ *
+ * @param ipq Pointer to the queue.
+ * @param data Pointer to the element to insert.
+ * @param handle Receives the element's handle; may be NULL.
+ * @return `IPQ_ERR_SUCCESS` on success, `IPQ_ERR_OOM` if memory allocation fails.
+ */
+IndexedPriorityQueueError IndexedPriorityQueue_push(IndexedPriorityQueue *ipq, void *data, IPQHandle *handle);
+
+/**
+ * @brief Checks whether a handle refers to a queued element.
+ *
+ * @param ipq Pointer to the queue.
+ * @param handle Handle to test.
+ * @return true if the element is in the queue.
+ */
+bool IndexedPriorityQueue_contains(IndexedPriorityQueue *ipq, IPQHandle handle);
+
+/**
+ * @brief Returns a pointer to a queued element.
+ *
+ * The element may be modified in place as long as
+ * IndexedPriorityQueue_update_priority() is called afterwards.
+ *
+ * @param ipq Pointer to the queue.
+ * @param handle Handle of a queued element.
+ * @return Pointer to the element, or NULL if the handle is not queued.
+ */
+void *IndexedPriorityQueue_get(IndexedPriorityQueue *ipq, IPQHandle handle);
+
+/**
+ * @brief Replaces a queued element and restores its heap position.
+ *
+ * @param ipq Pointer to the queue.
+ * @param handle Handle of a queued element.
+ * @param data Pointer to the new element value.
+ * @return `IPQ_ERR_SUCCESS` on success, `IPQ_ERR_INVALID_HANDLE` if the handle is not queued.
+ */
+IndexedPriorityQueueError IndexedPriorityQueue_update(IndexedPriorityQueue *ipq, IPQHandle handle, void *data);
+
+/**
+ * @brief Restores the heap position of an element modified through IndexedPriorityQueue_get().
+ *
+ * Handles both increases and decreases of priority.
+ *
+ * @param ipq Pointer to the queue.
+ * @param handle Handle of a queued element.
+ * @return `IPQ_ERR_SUCCESS` on success, `IPQ_ERR_INVALID_HANDLE` if the handle is not queued.
+ */
+IndexedPriorityQueueError IndexedPriorityQueue_update_priority(IndexedPriorityQueue *ipq, IPQHandle handle);
+
+/**
+ * @brief Removes a queued element by handle.
+ *
+ * @param ipq Pointer to the queue.
+ * @param handle Handle of a queued element.
+ * @return `IPQ_ERR_SUCCESS` on success, `IPQ_ERR_INVALID_HANDLE` if the handle is not queued.
+ */
+IndexedPriorityQueueError IndexedPriorityQueue_remove(IndexedPriorityQueue *ipq, IPQHandle handle);
+
+/**
+ * @brief Returns the handle of the top element.
+ *
+ * @param ipq Pointer to the queue.
+ * @return Handle of the highest priority element, or IPQ_NPOS if the queue is empty.
+ */
+IPQHandle IndexedPriorityQueue_top_handle(IndexedPriorityQueue *ipq);
+
+/**
+ * @brief Returns the top element.
+ *
+ * @param ipq Pointer to the queue.
+ * @return Pointer to the highest priority element, or NULL if the queue is empty.
+ */
+void *IndexedPriorityQueue_top(IndexedPriorityQueue *ipq);
+
+/**
+ * @brief Removes the top element.
+ *
+ * @param ipq Pointer to the queue.
+ *
+ * @note Does nothing if the queue is empty.
+ */
+void IndexedPriorityQueue_pop(IndexedPriorityQueue *ipq);
+
+/**
+ * @brief Copies the top element into `out`, then removes it.
+ *
+ * @param ipq Pointer to the queue.
+ * @param out Destination for the element (`member_size` bytes).
+ * @return `IPQ_ERR_SUCCESS` on success, `IPQ_ERR_EMPTY_POP_BACK` if the queue is empty.
+ */
+IndexedPriorityQueueError IndexedPriorityQueue_pop_into(IndexedPriorityQueue *ipq, void *out);
@@ -5,7 +5,12 @@
 #include <stdbool.h>
 
 /**
- * @brief A priority queue implemented as a binary heap on top of a Vector.
+ * @brief Number of children per node used unless another arity is requested.
+ */
+#define PQ_DEFAULT_ARITY 2
+
+/**
+ * @brief A priority queue implemented as a d-ary heap on top of a Vector.
  *
  * This structure provides a generic, type-agnostic priority queue.
  * It relies on a user-provided comparator function to maintain heap ordering,
@@ -16,10 +21,14 @@
  *   an integer: negative if the first element is less, positive if greater,
  *   and zero if equal.
  * - The underlying data is stored in a Vector for dynamic resizing.
+ * - Each node has `arity` children (2 by default). Wider 4- or 8-ary heaps
+ *   are shallower and scan siblings that share a cache line, which favours
+ *   pop-heavy workloads.
  */
 typedef struct PriorityQueue {
 	Vector vec;                           /**< Underlying dynamic array storage. */
 	int (*comparator)(void *, void *);    /**< Function to compare two elements (determines heap order). */
+	size_t arity;                         /**< Number of children per node (at least 2). */
 } PriorityQueue;
 
 /**
@@ -46,6 +55,16 @@ Result(PriorityQueue, PriorityQueueError);
  */
 Errable(PriorityQueue) PriorityQueue_init(size_t member_size, int (*comparator)(void *, void *));
 
+/**
+ * @brief Initializes a new PriorityQueue whose storage comes from `allocator`.
+ *
+ * @param member_size Size in bytes of each element.
+ * @param comparator Function to determine heap ordering.
+ * @param allocator Source of the underlying Vector's buffer.
+ * @return An `Errable(PriorityQueue)` result containing either a valid queue or an OOM error.
+ */
+Errable(PriorityQueue) PriorityQueue_init_with_allocator(size_t member_size, int (*comparator)(void *, void *), const Allocator *allocator);
+
 /**
  * @brief Populates an existing PriorityQueue structure.
  *
@@ -56,6 +75,52 @@ Errable(PriorityQueue) PriorityQueue_init(size_t member_size, int (*comparator)(
  */
 PriorityQueueError PriorityQueue_create(PriorityQueue *pq, size_t member_size, int (*comparator)(void *, void *));
 
+/**
+ * @brief Populates an existing PriorityQueue structure with storage from `allocator`.
+ *
+ * Wrapper over `Vector_create_with_allocator`.
+ *
+ * @param pq Pointer to the PriorityQueue to initialize.
+ * @param member_size Size of each element in bytes.
+ * @param comparator Comparator function for heap ordering.
+ * @param allocator Source of the underlying Vector's buffer.
+ * @return `PQ_ERR_SUCCESS` on success, `PQ_ERR_OOM` if allocation fails.
+ */
+PriorityQueueError PriorityQueue_create_with_allocator(PriorityQueue *pq, size_t member_size, int (*comparator)(void *, void *), const Allocator *allocator);
+
+/**
+ * @brief Initializes a new d-ary PriorityQueue.
+ *
+ * @param member_size Size in bytes of each element.
+ * @param comparator Function to determine heap ordering.
+ * @param arity Number of children per node (values below 2 are treated as 2).
+ * @return An `Errable(PriorityQueue)` result containing either a valid queue or an OOM error.
+ */
+Errable(PriorityQueue) PriorityQueue_init_with_arity(size_t member_size, int (*comparator)(void *, void *), size_t arity);
+
+/**
+ * @brief Populates an existing d-ary PriorityQueue structure.
+ *
+ * @param pq Pointer to the PriorityQueue to initialize.
+ * @param member_size Size of each element in bytes.
+ * @param comparator Comparator function for heap ordering.
+ * @param arity Number of children per node (values below 2 are treated as 2).
+ * @return `PQ_ERR_SUCCESS` on success, `PQ_ERR_OOM` if allocation fails.
+ */
+PriorityQueueError PriorityQueue_create_with_arity(PriorityQueue *pq, size_t member_size, int (*comparator)(void *, void *), size_t arity);
+
+/**
+ * @brief Builds a PriorityQueue from the contents of a Vector in O(n).
+ *
+ * Takes over `v`'s buffer and allocator (leaving `v` empty, as with
+ * `Vector_mv`) and heapifies it in place with Floyd's method.
+ *
+ * @param pq Pointer to an uninitialized PriorityQueue.
+ * @param v Vector whose elements become the queue.
+ * @param comparator Comparator function for heap ordering.
+ */
+void PriorityQueue_from_vector(PriorityQueue *pq, Vector *v, int (*comparator)(void *, void *));
+
 /**
  * @brief Performs a deep copy of a PriorityQueue.
  *
@@ -115,6 +180,14 @@ void PriorityQueue_clear(PriorityQueue *pq);
  */
 PriorityQueueError PriorityQueue_shrink(PriorityQueue *pq);
 
+/**
+ * @brief Changes the number of children per node, re-heapifying in O(n).
+ *
+ * @param pq Pointer to the PriorityQueue.
+ * @param arity Number of children per node (values below 2 are treated as 2).
+ */
+void PriorityQueue_set_arity(PriorityQueue *pq, size_t arity);
+
 /**
  * @brief Returns the number of elements in the PriorityQueue.
  *
@@ -142,7 +215,41 @@ const void *PriorityQueue_raw_data(const PriorityQueue *pq);
 int _PriorityQueue_compare(PriorityQueue *pq, size_t index_a, size_t index_b);
 
 /**
- * @brief Recursively restores heap property upwards from a given index.
+ * @brief A d-ary heap stored as a flat array of slots, as seen by the shared sifts.
+ *
+ * PriorityQueue sifts its elements in place; IndexedPriorityQueue sifts
+ * handles and uses `placed` to keep its position map in step.
+ */
+typedef struct _PriorityQueueSift {
+	char *base;                                              /**< First slot of the heap array. */
+	size_t member_size;                                      /**< Size (in bytes) of each slot. */
+	size_t size;                                             /**< Number of slots in the heap. */
+	size_t arity;                                            /**< Number of children per node (at least 2). */
+	int (*compare)(void *context, void *a, void *b);         /**< Orders the contents of two slots like the queue comparator. */
+	void (*placed)(void *context, void *slot, size_t index); /**< Called whenever a slot's contents land at `index`; may be NULL. */
+	void *context;                                           /**< Passed through to `compare` and `placed`. */
+} _PriorityQueueSift;
+
+/**
+ * @brief Moves the slot at `index` up until its parent does not order after it.
+ *
+ * @param sift The heap to sift.
+ * @param index Index of the slot to move.
+ * @return The index the slot's contents ended up at.
+ */
+size_t _PriorityQueue_sift_up(const _PriorityQueueSift *sift, size_t index);
+
+/**
+ * @brief Moves the slot at `index` down until none of its children orders before it.
+ *
+ * @param sift The heap to sift.
+ * @param index Index of the slot to move.
+ * @return The index the slot's contents ended up at.
+ */
+size_t _PriorityQueue_sift_down(const _PriorityQueueSift *sift, size_t index);
+
+/**
+ * @brief Restores heap property upwards from a given index.
  *
  * @param pq Pointer to the PriorityQueue.
  * @param index Index to heapify up from.
@@ -150,13 +257,20 @@ int _PriorityQueue_compare(PriorityQueue *pq, size_t index_a, size_t index_b);
 void _PriorityQueue_heapify_up(PriorityQueue *pq, size_t index);
 
 /**
- * @brief Recursively restores heap property downwards from a given index.
+ * @brief Restores heap property downwards from a given index.
  *
  * @param pq Pointer to the PriorityQueue.
  * @param index Index to heapify down from.
  */
 void _PriorityQueue_heapify_down(PriorityQueue *pq, size_t index);
 
+/**
+ * @brief Rebuilds the heap property over the whole queue in O(n) (Floyd's method).
+ *
+ * @param pq Pointer to the PriorityQueue.
+ */
+void _PriorityQueue_heapify(PriorityQueue *pq);
+
 /**
  * @brief Adds a new element to the PriorityQueue.
  *
@@ -168,6 +282,19 @@ void _PriorityQueue_heapify_down(PriorityQueue *pq, size_t index);
  */
 PriorityQueueError PriorityQueue_push(PriorityQueue *pq, void *data);
 
+/**
+ * @brief Adds `n` contiguous elements to the PriorityQueue.
+ *
+ * Appends all elements at once, then either sifts each one up or rebuilds
+ * the whole heap in O(n), whichever is cheaper for the batch size.
+ *
+ * @param pq Pointer to the PriorityQueue.
+ * @param data Pointer to the elements to insert.
+ * @param n Number of elements.
+ * @return `PQ_ERR_SUCCESS` on success, `PQ_ERR_OOM` if memory allocation fails.
+ */
+PriorityQueueError PriorityQueue_push_bulk(PriorityQueue *pq, void *data, size_t n);
+
 /**
  * @brief Removes the top element from the PriorityQueue.
  *
@@ -179,6 +306,15 @@ PriorityQueueError PriorityQueue_push(PriorityQueue *pq, void *data);
  */
 void PriorityQueue_pop(PriorityQueue *pq);
 
+/**
+ * @brief Copies the top element into `out`, then removes it.
+ *
+ * @param pq Pointer to the PriorityQueue.
+ * @param out Destination for the element (`member_size` bytes).
+ * @return `PQ_ERR_SUCCESS` on success, `PQ_ERR_EMPTY_POP_BACK` if the queue is empty.
+ */
+PriorityQueueError PriorityQueue_pop_into(PriorityQueue *pq, void *out);
+
 /**
  * @brief Returns the top element of the PriorityQueue.
  *
@@ -187,3 +323,98 @@ void PriorityQueue_pop(PriorityQueue *pq);
  *         or NULL if the queue is empty.
  */
 void *PriorityQueue_top(PriorityQueue *pq);
+
+/**
+ * @brief Defines a typed binary heap of `T` named `Name` with an inlined comparison.
+ *
+ * `less` is called as `less(const T *a, const T *b)` and must return nonzero
+ * when `a` belongs above `b` (pass a function or function-like macro). As
+ * both `less` and the element type are known at compile time, comparisons
+ * inline and elements move with plain assignments. Sifting is iterative and
+ * moves a hole through the heap, writing the displaced element once at the
+ * end instead of swapping at every level.
+ *
+ * Generated: `Name_create`, `Name_create_with_allocator`, `Name_invalidate`,
+ * `Name_clear`, `Name_shrink`, `Name_size`, `Name_raw_data`, `Name_push`,
+ * `Name_pop`, `Name_top`.
+ *
+ * @note
+ * - Use at file scope, once per `Name`.
+ * - The heap lives in a Vector of `T` (`Name.vec`), like PriorityQueue.
+ *
+ * @code
+ * static inline int timer_less(const Timer *a, const Timer *b) { return a->deadline < b->deadline; }
+ * CSTL_PQUEUE_DEFINE(Timer, TimerHeap, timer_less)
+ *
+ * TimerHeap heap;
+ * TimerHeap_create(&heap);
+ * TimerHeap_push(&heap, timer);
+ * Timer *next = TimerHeap_top(&heap);
+ * TimerHeap_pop(&heap);
+ * TimerHeap_invalidate(&heap);
+ * @endcode
+ */
+#define CSTL_PQUEUE_DEFINE(T, Name, less) \
+	typedef struct Name { \
+		Vector vec; \
+	} Name; \
+	\
+	static inline PriorityQueueError Name##_create(Name *pq) { \
+		return (PriorityQueueError) Vector_create(&pq->vec, sizeof(T)); \
+	} \
+	static inline PriorityQueueError Name##_create_with_allocator(Name *pq, const Allocator *allocator) { \
+		return (PriorityQueueError) Vector_create_with_allocator(&pq->vec, sizeof(T), allocator); \
+	} \
+	static inline void Name##_invalidate(Name *pq) { \
+		Vector_invalidate(&pq->vec); \
+	} \
+	static inline void Name##_clear(Name *pq) { \
+		Vector_clear(&pq->vec); \
+	} \
+	static inline PriorityQueueError Name##_shrink(Name *pq) { \
+		return (PriorityQueueError) Vector_shrink(&pq->vec); \
+	} \
+	static inline size_t Name##_size(const Name *pq) { \
+		return pq->vec.size; \
+	} \
+	static inline const T *Name##_raw_data(const Name *pq) { \
+		return (const T *) pq->vec.data; \
+	} \
+	static inline void _##Name##_sift_up(T *data, size_t index, T value) { \
+		while (index > 0) { \
+			size_t parent = (index - 1) / 2; \
+			if (!less(&value, &data[parent])) break; \
+			data[index] = data[parent]; \
+			index = parent; \
+		} \
+		data[index] = value; \
+	} \
+	static inline void _##Name##_sift_down(T *data, size_t size, size_t index, T value) { \
+		for (;;) { \
+			size_t child = 2 * index + 1; \
+			if (child >= size) break; \
+			if (child + 1 < size && less(&data[child + 1], &data[child])) ++child; \
+			if (!less(&data[child], &value)) break; \
+			data[index] = data[child]; \
+			index = child; \
+		} \
+		data[index] = value; \
+	} \
+	static inline PriorityQueueError Name##_push(Name *pq, T value) { \
+		if (pq->vec.size < pq->vec._capacity) \
+			++pq->vec.size; \
+		else if (!Vector_append_uninit(&pq->vec, 1)) \
+			return PQ_ERR_OOM; \
+		_##Name##_sift_up((T *) pq->vec.data, pq->vec.size - 1, value); \
+		return PQ_ERR_SUCCESS; \
+	} \
+	static inline void Name##_pop(Name *pq) { \
+		if (pq->vec.size == 0) return; \
+		T *data = (T *) pq->vec.data; \
+		size_t size = --pq->vec.size; \
+		if (size) _##Name##_sift_down(data, size, 0, data[size]); \
+	} \
+	static inline T *Name##_top(Name *pq) { \
+		if (pq->vec.size == 0) return NULL; \
+		return (T *) pq->vec.data; \
+	}
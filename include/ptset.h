@@ -0,0 +1,211 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "allocator.h"
+#include "utility.h"
+
+/** @brief Upper bound on the height of any PersistentTreeSet (twice log2 of the largest size_t). */
+#define PTS_MAX_HEIGHT 128
+
+// Nodes hold no parent links, so one node can sit in the trees of many versions.
+struct _PTreeNode {
+	size_t refs; // parent links and version roots pointing here, updated atomically
+	bool black;  // false = red; a red node is always a left child
+	struct _PTreeNode *left, *right;
+	char data[]; // _member_size bytes, stored inline
+};
+
+/**
+ * @brief A persistent (copy-on-write) ordered set on a left-leaning red-black tree.
+ *
+ * Each PersistentTreeSet value is one version of the set. Nodes are shared
+ * between versions and reference counted in the way SharedPtr counts owners:
+ * every parent link and every version root holds one reference.
+ * PersistentTreeSet_snapshot() takes one more reference on the root, so it
+ * costs O(1) whatever the size. An update copies only the shared nodes on its
+ * O(log n) search path, plus the few siblings a rotation or recolouring
+ * touches, and modifies nodes it owns outright in place. Every other version
+ * keeps seeing exactly the elements it had.
+ *
+ * @note
+ * - Elements are copied bitwise between versions and never destroyed
+ *   individually, so they must not own resources; there is no deletor.
+ * - Reference counts are atomic. Versions that share nodes may be read,
+ *   updated and invalidated on different threads at once, e.g. a writer
+ *   publishing snapshots to readers. A single version is not thread-safe:
+ *   snapshotting a version must not race with updates to that same version.
+ * - Nodes are freed by whichever thread drops their last reference, so the
+ *   allocator must be thread-safe when versions are released elsewhere
+ *   (the default libc allocator is).
+ * - The comparator follows the TreeSet convention.
+ */
+typedef struct PersistentTreeSet {
+	struct _PTreeNode *_root;            /**< Root node, NULL when empty. */
+	size_t size;                         /**< Number of elements in this version. */
+	int (*_comparator)(void *, void *);  /**< Three-way element comparator. */
+	size_t _member_size;                 /**< Size (in bytes) of each element; not const so versions can be assigned. */
+	struct _PTreeNode *_spare;           /**< Nodes reserved for the next update, linked through `left`. */
+	size_t _spare_count;                 /**< Number of reserved nodes. */
+	const Allocator *_allocator;         /**< Source of every node. */
+} PersistentTreeSet;
+
+/**
+ * @brief Error codes returned by PersistentTreeSet operations.
+ */
+typedef enum {
+	PTS_ERR_SUCCESS = 0,  /**< Operation completed successfully. */
+	PTS_ERR_OOM,          /**< Out of memory; the version is unchanged. */
+	PTS_ERR_EXISTS,       /**< The element is already present; nothing was inserted. */
+	PTS_ERR_NOT_FOUND,    /**< The element is not present; nothing was removed. */
+} PersistentTreeSetError;
+
+/**
+ * @brief In-order position in one version of a PersistentTreeSet.
+ *
+ * Holds the path from the root, so it needs no parent links. It stays valid
+ * while its version is alive and not updated; iterating a snapshot is
+ * therefore unaffected by updates to the version it was taken from.
+ */
+typedef struct PersistentTreeSetIterator {
+	struct _PTreeNode *_path[PTS_MAX_HEIGHT]; /**< Ancestors still to visit; the top is the current node. */
+	size_t _depth;                            /**< Number of entries in `_path`; 0 at the end. */
+} PersistentTreeSetIterator;
+
+/**
+ * @brief Creates an empty PersistentTreeSet using libc memory.
+ *
+ * @param comparator Three-way element comparator.
+ * @param member_size Size (in bytes) of each element.
+ * @return The new set.
+ */
+PersistentTreeSet PersistentTreeSet_init(int (*comparator)(void *, void *), size_t member_size);
+
+/**
+ * @brief Populates an existing PersistentTreeSet structure.
+ *
+ * @param pts Pointer to the PersistentTreeSet to initialize.
+ * @param comparator Three-way element comparator.
+ * @param member_size Size (in bytes) of each element.
+ */
+void PersistentTreeSet_create(PersistentTreeSet *pts, int (*comparator)(void *, void *), size_t member_size);
+
+/**
+ * @brief Creates an empty PersistentTreeSet whose nodes come from `allocator`.
+ *
+ * @param comparator Three-way element comparator.
+ * @param member_size Size (in bytes) of each element.
+ * @param allocator Source of every node; must be thread-safe if versions are released on several threads.
+ * @return The new set.
+ */
+PersistentTreeSet PersistentTreeSet_init_with_allocator(int (*comparator)(void *, void *), size_t member_size, const Allocator *allocator);
+
+/**
+ * @brief Populates an existing PersistentTreeSet structure whose nodes come from `allocator`.
+ *
+ * @param pts Pointer to the PersistentTreeSet to initialize.
+ * @param comparator Three-way element comparator.
+ * @param member_size Size (in bytes) of each element.
+ * @param allocator Source of every node; must be thread-safe if versions are released on several threads.
+ */
+void PersistentTreeSet_create_with_allocator(PersistentTreeSet *pts, int (*comparator)(void *, void *), size_t member_size, const Allocator *allocator);
+
+/**
+ * @brief Releases this version, freeing the nodes no other version shares.
+ *
+ * @param pts Pointer to the PersistentTreeSet to invalidate.
+ */
+void PersistentTreeSet_invalidate(PersistentTreeSet *pts);
+
+/**
+ * @brief Returns the number of elements in this version.
+ *
+ * @param pts Pointer to the PersistentTreeSet.
+ * @return Number of elements.
+ */
+size_t PersistentTreeSet_size(PersistentTreeSet *pts);
+
+/**
+ * @brief Returns an O(1) snapshot sharing every node with `pts`.
+ *
+ * The snapshot is an independent version: updates to either one are not
+ * seen by the other. It must be released with PersistentTreeSet_invalidate().
+ *
+ * @code
+ * PersistentTreeSet view = PersistentTreeSet_snapshot(&routes);
+ * // hand `view` to a reader thread; keep updating `routes`
+ * @endcode
+ *
+ * @param pts Pointer to the version to snapshot.
+ * @return The new version.
+ */
+PersistentTreeSet PersistentTreeSet_snapshot(PersistentTreeSet *pts);
+
+/**
+ * @brief Inserts a copy of an element into this version.
+ *
+ * @param pts Pointer to the PersistentTreeSet.
+ * @param data Pointer to the element to copy in.
+ * @return PTS_ERR_SUCCESS, PTS_ERR_EXISTS if an equal element is present, or PTS_ERR_OOM.
+ */
+PersistentTreeSetError PersistentTreeSet_insert(PersistentTreeSet *pts, void *data);
+
+/**
+ * @brief Removes the element equal to `data` from this version.
+ *
+ * @param pts Pointer to the PersistentTreeSet.
+ * @param data Pointer to the element to remove.
+ * @return PTS_ERR_SUCCESS, PTS_ERR_NOT_FOUND if absent, or PTS_ERR_OOM.
+ */
+PersistentTreeSetError PersistentTreeSet_remove(PersistentTreeSet *pts, void *data);
+
+/**
+ * @brief Looks up the element equal to `data`.
+ *
+ * @param pts Pointer to the PersistentTreeSet.
+ * @param data Pointer to the element to look for.
+ * @return Pointer to the stored element (must not be modified; other versions may share it), or NULL.
+ */
+const void *PersistentTreeSet_find(PersistentTreeSet *pts, void *data);
+
+/**
+ * @brief Checks whether an element equal to `data` is present.
+ *
+ * @param pts Pointer to the PersistentTreeSet.
+ * @param data Pointer to the element to look for.
+ * @return true if present, false otherwise.
+ */
+bool PersistentTreeSet_contains(PersistentTreeSet *pts, void *data);
+
+/**
+ * @brief Positions `it` at the smallest element.
+ *
+ * @param pts Pointer to the PersistentTreeSet.
+ * @param it Iterator to initialize.
+ */
+void PersistentTreeSet_begin(PersistentTreeSet *pts, PersistentTreeSetIterator *it);
+
+/**
+ * @brief Positions `it` at the first element not less than `data`.
+ *
+ * @param pts Pointer to the PersistentTreeSet.
+ * @param data Pointer to the element to compare against.
+ * @param it Iterator to initialize.
+ */
+void PersistentTreeSet_lower_bound(PersistentTreeSet *pts, void *data, PersistentTreeSetIterator *it);
+
+/**
+ * @brief Steps `it` to the next larger element.
+ *
+ * @param it Iterator to an element.
+ */
+void PersistentTreeSet_next(PersistentTreeSetIterator *it);
+
+/**
+ * @brief Returns the element at `it`.
+ *
+ * @param it Iterator.
+ * @return Pointer to the element (must not be modified), or NULL at the end.
+ */
+const void *PersistentTreeSet_iterator_get(PersistentTreeSetIterator *it);
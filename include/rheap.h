@@ -0,0 +1,158 @@
+#pragma once
+
+#include "error.h"
+#include "vector.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Number of buckets in a RadixHeap: one for the last popped key, one per key bit.
+ */
+#define RADIX_HEAP_BUCKETS 65
+
+/**
+ * @brief A min-priority queue for monotone unsigned 64-bit keys.
+ *
+ * RadixHeap suits timer and event queues, where a pushed key is never
+ * smaller than the most recently popped one. Entries are bucketed by the
+ * highest bit in which their key differs from the last popped key. Popping
+ * only compares keys when bucket 0 runs dry: the smallest key of the first
+ * non-empty bucket becomes the new reference and that bucket's entries move
+ * to strictly lower buckets. Each entry moves at most 64 times in its
+ * lifetime, so push is O(1) and pop is amortised O(1) for a fixed key width,
+ * with no comparator calls.
+ *
+ * Each entry is a key plus a `value_size` byte payload, stored in per-bucket
+ * Vectors. Entries with equal keys pop in no particular order.
+ *
+ * @note
+ * - Pushing a key smaller than the last popped key fails with
+ *   `RH_ERR_NOT_MONOTONE`.
+ */
+typedef struct RadixHeap {
+	Vector _buckets[RADIX_HEAP_BUCKETS]; /**< Entries grouped by highest differing bit from `_last`. */
+	uint64_t _last;                      /**< Bucketing base: a lower bound of every key, moved up by top and pop. */
+	uint64_t _popped;                    /**< Key of the last popped entry; pushes may not go below it. */
+	size_t size;                         /**< Number of entries currently stored. */
+	const size_t _value_size;            /**< Size (in bytes) of each payload. */
+	const size_t _value_offset;          /**< Offset of the payload within an entry. */
+} RadixHeap;
+
+/**
+ * @brief Error codes returned by RadixHeap operations.
+ */
+typedef enum {
+	RH_ERR_SUCCESS = 0,       /**< Operation completed successfully. */
+	RH_ERR_OOM,               /**< Out of memory during allocation. */
+	RH_ERR_EMPTY_POP_BACK,    /**< Attempted to pop from an empty RadixHeap. */
+	RH_ERR_NOT_MONOTONE,      /**< The key is smaller than the last popped key. */
+} RadixHeapError;
+
+/** @brief Result type for RadixHeap operations that may fail. */
+Result(RadixHeap, RadixHeapError);
+
+/**
+ * @brief Initializes a new, empty RadixHeap.
+ *
+ * @param value_size Size in bytes of the payload stored with each key (may be 0).
+ * @return An `Errable(RadixHeap)` result containing a valid heap.
+ */
+Errable(RadixHeap) RadixHeap_init(size_t value_size);
+
+/**
+ * @brief Initializes a new, empty RadixHeap using a custom allocator.
+ *
+ * @param value_size Size in bytes of the payload stored with each key (may be 0).
+ * @param allocator Source of every bucket's buffer.
+ * @return An `Errable(RadixHeap)` result containing a valid heap.
+ */
+Errable(RadixHeap) RadixHeap_init_with_allocator(size_t value_size, const Allocator *allocator);
+
+/**
+ * @brief Populates an existing RadixHeap structure.
+ *
+ * Buckets are allocated lazily, so this never fails.
+ *
+ * @param rh Pointer to the RadixHeap to initialize.
+ * @param value_size Size in bytes of the payload stored with each key (may be 0).
+ * @return `RH_ERR_SUCCESS`.
+ */
+RadixHeapError RadixHeap_create(RadixHeap *rh, size_t value_size);
+
+/**
+ * @brief Populates an existing RadixHeap structure using a custom allocator.
+ *
+ * Buckets are allocated lazily, so this never fails.
+ *
+ * @param rh Pointer to the RadixHeap to initialize.
+ * @param value_size Size in bytes of the payload stored with each key (may be 0).
+ * @param allocator Source of every bucket's buffer.
+ * @return `RH_ERR_SUCCESS`.
+ */
+RadixHeapError RadixHeap_create_with_allocator(RadixHeap *rh, size_t value_size, const Allocator *allocator);
+
+/**
+ * @brief Releases all resources associated with the RadixHeap.
+ *
+ * @param rh Pointer to the RadixHeap to invalidate.
+ */
+void RadixHeap_invalidate(RadixHeap *rh);
+
+/**
+ * @brief Removes every entry and resets the key lower bound to 0.
+ *
+ * @param rh Pointer to the RadixHeap.
+ */
+void RadixHeap_clear(RadixHeap *rh);
+
+/**
+ * @brief Returns the number of entries in the RadixHeap.
+ *
+ * @param rh Pointer to the RadixHeap.
+ * @return Number of entries currently stored.
+ */
+size_t RadixHeap_size(RadixHeap *rh);
+
+/**
+ * @brief Adds an entry.
+ *
+ * @param rh Pointer to the RadixHeap.
+ * @param key Key of the entry; must not be smaller than the last popped key.
+ * @param value Pointer to the payload to copy in (ignored when `value_size` is 0).
+ * @return `RH_ERR_SUCCESS` on success, `RH_ERR_NOT_MONOTONE` if `key` is too small,
+ *         `RH_ERR_OOM` if memory allocation fails.
+ */
+RadixHeapError RadixHeap_push(RadixHeap *rh, uint64_t key, void *value);
+
+/**
+ * @brief Returns the payload of the entry with the smallest key.
+ *
+ * May redistribute a bucket, so it is not a const operation. Keys smaller
+ * than the one returned may still be pushed, down to the last popped key.
+ *
+ * @param rh Pointer to the RadixHeap.
+ * @param key Receives the smallest key; may be NULL.
+ * @return Pointer to the payload, or NULL if the heap is empty or memory ran out.
+ */
+void *RadixHeap_top(RadixHeap *rh, uint64_t *key);
+
+/**
+ * @brief Removes the entry with the smallest key.
+ *
+ * @param rh Pointer to the RadixHeap.
+ *
+ * @note Does nothing if the RadixHeap is empty.
+ */
+void RadixHeap_pop(RadixHeap *rh);
+
+/**
+ * @brief Copies out the entry with the smallest key, then removes it.
+ *
+ * @param rh Pointer to the RadixHeap.
+ * @param key Receives the key; may be NULL.
+ * @param value Receives the payload (`value_size` bytes); may be NULL.
+ * @return `RH_ERR_SUCCESS` on success, `RH_ERR_EMPTY_POP_BACK` if the heap is empty,
+ *         `RH_ERR_OOM` if memory allocation fails.
+ */
+RadixHeapError RadixHeap_pop_into(RadixHeap *rh, uint64_t *key, void *value);
@@ -1,21 +1,72 @@
 #pragma once
 
-#include "arena.h"
 #include "error.h"
-#include "pqueue.h"
+#include "utility.h"
+#include <stddef.h>
 
 /**
- * @brief A slab allocator that manages fixed-size memory blocks using a priority queue of arenas.
+ * @brief Smallest slab size; requested slab sizes are rounded up to this.
+ */
+#define SLAB_MIN_SIZE 4096
+
+/**
+ * @brief A size-class slab allocator with O(1) allocation and free.
+ *
+ * Requests are rounded up to a size class (multiples of 16 bytes up to 128,
+ * then four classes per power of two). Each class carves fixed-size objects
+ * out of `slab_size` slabs and recycles freed objects through an intrusive
+ * free list, so both `SlabAllocator_alloc()` and `SlabAllocator_free()` are a
+ * handful of pointer operations.
  *
- * The SlabAllocator allocates memory in slabs of fixed size. Each slab is an ArenaAllocator.
- * Slabs are tracked in a PriorityQueue for efficient allocation. When a slab is full, a new
- * slab is added automatically.
+ * Slabs are aligned to their own size, which lets `SlabAllocator_free()` find
+ * an object's size class from its address alone. Requests larger than an
+ * eighth of a slab get a dedicated block that is returned to the system when
+ * freed.
+ *
+ * A concurrent allocator (see `SlabAllocator_create_concurrent()`) gives each
+ * thread its own magazine of free objects per size class. Allocation and free
+ * only touch the calling thread's magazines; a magazine refills from, or drains
+ * half of itself back to, a mutex-guarded central allocator in batches of
+ * `SLAB_MAGAZINE_BATCH` objects. Objects may be freed on any thread.
+ *
+ * @note
+ * - Slabs are only released by `SlabAllocator_invalidate()`.
+ * - Allocators created with `SlabAllocator_create()` are not thread safe.
  */
 typedef struct SlabAllocator {
-	PriorityQueue slabs;   /**< PriorityQueue of ArenaAllocator slabs. */
-	size_t slab_size;      /**< Size of each slab in bytes. */
+	struct _SlabClass *_classes; /**< Per size class free lists and bump regions. */
+	size_t _class_count;         /**< Number of size classes served from slabs. */
+	struct _Slab *_slabs;        /**< Every slab carved into objects, for invalidation. */
+	struct _Slab *_large;        /**< Dedicated blocks for oversized requests (doubly linked). */
+	size_t slab_size;            /**< Size of each slab in bytes (power of two). */
+	struct _SlabShared *_shared; /**< Central pool and thread caches of a concurrent allocator, else NULL. */
 } SlabAllocator;
 
+/**
+ * @brief Header at the start of every slab and oversized block.
+ */
+struct _Slab {
+	struct _Slab *next;  /**< Next slab in `_slabs` or `_large`. */
+	struct _Slab *prev;  /**< Previous block in `_large` (unused for slabs). */
+	size_t class_index;  /**< Size class of the slab's objects, or `SLAB_LARGE`. */
+	size_t size;         /**< Object size for slabs, usable bytes for oversized blocks. */
+};
+
+/**
+ * @brief Free list and unused tail of the newest slab for one size class.
+ */
+struct _SlabClass {
+	void *free;          /**< Intrusive singly linked list of freed objects. */
+	char *bump;          /**< Next never-used object in the newest slab. */
+	char *end;           /**< End of the newest slab. */
+};
+
+/** @brief `class_index` of an oversized block. */
+#define SLAB_LARGE ((size_t) -1)
+
+/** @brief Objects moved between a thread's magazine and the central pool at once. */
+#define SLAB_MAGAZINE_BATCH 32
+
 /**
  * @brief Error codes returned by SlabAllocator operations.
  */
@@ -28,23 +79,12 @@ typedef enum {
 /** @brief Result type for SlabAllocator operations. */
 Result(SlabAllocator, SlabAllocatorError);
 
-/**
- * @brief Comparator function used internally for the slab PriorityQueue.
- *
- * Compares two ArenaAllocator slabs for heap ordering in the PriorityQueue.
- *
- * @param a Pointer to the first ArenaAllocator.
- * @param b Pointer to the second ArenaAllocator.
- * @return Negative if a < b, positive if a > b, zero if equal (based on free space or other criteria).
- */
-int _SlabAllocator_slab_comparator(ArenaAllocator *a, ArenaAllocator *b);
-
 /**
  * @brief Initializes a new SlabAllocator with a given slab size.
  *
  * Convenience inline function to create a SlabAllocator.
  *
- * @param slab_size Size in bytes for each slab.
+ * @param slab_size Size in bytes for each slab (rounded up to a power of two of at least `SLAB_MIN_SIZE`).
  * @return An `Errable(SlabAllocator)` result containing either a valid allocator or an OOM error.
  */
 Errable(SlabAllocator) SlabAllocator_init(size_t slab_size);
@@ -53,15 +93,38 @@ Errable(SlabAllocator) SlabAllocator_init(size_t slab_size);
  * @brief Populates an existing SlabAllocator structure to be stable.
  *
  * @param sa Pointer to the SlabAllocator to initialize.
- * @param slab_size Size in bytes for each slab.
+ * @param slab_size Size in bytes for each slab (rounded up to a power of two of at least `SLAB_MIN_SIZE`).
  * @return `SA_ERR_SUCCESS` on success, `SA_ERR_OOM` if memory allocation fails.
  */
 SlabAllocatorError SlabAllocator_create(SlabAllocator *sa, size_t slab_size);
 
+/**
+ * @brief Initializes a new thread-safe SlabAllocator with per-thread caches.
+ *
+ * @param slab_size Size in bytes for each slab (rounded up to a power of two of at least `SLAB_MIN_SIZE`).
+ * @return An `Errable(SlabAllocator)` result containing either a valid allocator or an OOM error.
+ */
+Errable(SlabAllocator) SlabAllocator_init_concurrent(size_t slab_size);
+
+/**
+ * @brief Populates a thread-safe SlabAllocator with per-thread caches.
+ *
+ * The returned handle may be copied freely between threads; all copies share
+ * the same central pool. A thread's cache is created on its first allocation
+ * or free and drained back to the central pool when the thread exits.
+ *
+ * @param sa Pointer to the SlabAllocator to initialize.
+ * @param slab_size Size in bytes for each slab (rounded up to a power of two of at least `SLAB_MIN_SIZE`).
+ * @return `SA_ERR_SUCCESS` on success, `SA_ERR_OOM` if memory or thread resources are unavailable.
+ */
+SlabAllocatorError SlabAllocator_create_concurrent(SlabAllocator *sa, size_t slab_size);
+
 /**
  * @brief Allocates memory from the slab allocator.
  *
- * Finds a slab with enough free space or creates a new slab if necessary.
+ * Pops a freed object of the request's size class, or carves a new one from
+ * the class's newest slab, creating a slab if necessary.
+ * The memory is aligned to `MAX_ALIGN`, like the result of `malloc()`.
  *
  * @param sa Pointer to the SlabAllocator.
  * @param bytes Number of bytes to allocate.
@@ -69,10 +132,54 @@ SlabAllocatorError SlabAllocator_create(SlabAllocator *sa, size_t slab_size);
  */
 void *SlabAllocator_alloc(SlabAllocator *sa, size_t bytes);
 
+/**
+ * @brief Allocates memory from the slab allocator with a specific alignment.
+ *
+ * @param sa Pointer to the SlabAllocator.
+ * @param bytes Number of bytes to allocate.
+ * @param align Required alignment in bytes; must be a power of two smaller than `slab_size`.
+ * @return Pointer to the allocated memory, or NULL if allocation fails or `align` is not smaller than `slab_size`.
+ */
+void *SlabAllocator_alloc_aligned(SlabAllocator *sa, size_t bytes, size_t align);
+
+/**
+ * @brief Allocates a block that occupies whole cache lines.
+ *
+ * See `ArenaAllocator_alloc_cache_line()`; use it for per-thread hot data
+ * to avoid false sharing.
+ *
+ * @param sa Pointer to the SlabAllocator.
+ * @param bytes Number of bytes to allocate.
+ * @return Pointer to the allocated memory, or NULL if allocation fails.
+ */
+void *SlabAllocator_alloc_cache_line(SlabAllocator *sa, size_t bytes);
+
+/**
+ * @brief Returns memory obtained from this allocator for reuse.
+ *
+ * Slab objects go back onto their size class's free list; oversized blocks
+ * are released to the system.
+ *
+ * @param sa Pointer to the SlabAllocator.
+ * @param ptr Pointer returned by one of the allocation functions, or NULL.
+ */
+void SlabAllocator_free(SlabAllocator *sa, void *ptr);
+
+/**
+ * @brief Returns the usable size of the block containing `ptr`.
+ *
+ * @param sa Pointer to the SlabAllocator.
+ * @param ptr Pointer returned by one of the allocation functions.
+ * @return The size class (or oversized block size) backing `ptr`.
+ */
+size_t SlabAllocator_usable_size(SlabAllocator *sa, void *ptr);
+
 /**
  * @brief Releases all resources used by the SlabAllocator.
  *
- * Invalidates all underlying slabs and clears the PriorityQueue.
+ * Frees every slab and oversized block, invalidating all outstanding allocations.
+ * For a concurrent allocator, no other thread may be using it during or after
+ * this call.
  *
  * @param sa Pointer to the SlabAllocator to invalidate.
  */
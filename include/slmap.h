@@ -0,0 +1,207 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "error.h"
+#include "slset.h"
+#include "utility.h"
+
+/**
+ * @brief A lock-free ordered map from generic keys to generic values on the SkipListSet core.
+ *
+ * Each node stores a key immediately followed by its value (padded to the
+ * value's natural alignment). The comparator only looks at keys, so lookups
+ * take a bare key.
+ *
+ * @note
+ * - Every function except create and invalidate may be called from any thread.
+ * - Entries are immutable once inserted. A concurrent reader could see a
+ *   value that is only partly written, so there is no in-place put. To
+ *   replace a value, remove the entry and insert it again.
+ * - SkipListMap_get() copies the value out, because the entry may be freed
+ *   as soon as another thread removes it. Pointers from iterators stay
+ *   valid until the iterator is closed.
+ * - The comparator receives pointers to keys and follows the TreeSet convention.
+ */
+typedef struct SkipListMap {
+	SkipListSet _set;           /**< Underlying skip list of key+value nodes. */
+	const size_t _key_size;     /**< Size (in bytes) of each key. */
+	const size_t _value_size;   /**< Size (in bytes) of each value. */
+	const size_t _value_offset; /**< Offset of the value within a node's data. */
+} SkipListMap;
+
+/** @brief Open position in a SkipListMap; see SkipListSetIterator. */
+typedef SkipListSetIterator SkipListMapIterator;
+
+/**
+ * @brief Error codes for SkipListMap operations; numbered like SkipListSetError.
+ */
+typedef enum {
+	SLM_ERR_SUCCESS = 0,  /**< Operation succeeded. */
+	SLM_ERR_OOM,          /**< Out of memory, or the shared thread-local key could not be created. */
+	SLM_ERR_EXISTS,       /**< The key is already present; nothing was inserted. */
+	SLM_ERR_NOT_FOUND,    /**< The key is not present; nothing was removed. */
+} SkipListMapError;
+
+/** @brief Result type for SkipListMap operations that may fail. */
+Result(SkipListMap, SkipListMapError);
+
+/**
+ * @brief Initializes a new SkipListMap.
+ *
+ * @param key_size Size (in bytes) of each key.
+ * @param value_size Size (in bytes) of each value.
+ * @param comparator Three-way key comparator.
+ * @return An `Errable(SkipListMap)` result containing either a valid map or an OOM error.
+ */
+Errable(SkipListMap) SkipListMap_init(size_t key_size, size_t value_size, int (*comparator)(void *, void *));
+
+/**
+ * @brief Populates an existing SkipListMap structure.
+ *
+ * @param sm Pointer to the SkipListMap to create.
+ * @param key_size Size (in bytes) of each key.
+ * @param value_size Size (in bytes) of each value.
+ * @param comparator Three-way key comparator.
+ * @return `SLM_ERR_SUCCESS` on success, `SLM_ERR_OOM` if allocation or thread-local key creation fails.
+ */
+SkipListMapError SkipListMap_create(SkipListMap *sm, size_t key_size, size_t value_size, int (*comparator)(void *, void *));
+
+/**
+ * @brief Initializes a new SkipListMap whose nodes draw from a custom allocator.
+ *
+ * @param key_size Size (in bytes) of each key.
+ * @param value_size Size (in bytes) of each value.
+ * @param comparator Three-way key comparator.
+ * @param allocator Source of every node; must be thread-safe.
+ * @return An `Errable(SkipListMap)` result containing either a valid map or an OOM error.
+ */
+Errable(SkipListMap) SkipListMap_init_with_allocator(size_t key_size, size_t value_size, int (*comparator)(void *, void *), const Allocator *allocator);
+
+/**
+ * @brief Populates an existing SkipListMap structure whose nodes draw from a custom allocator.
+ *
+ * See SkipListSet_create_with_allocator().
+ *
+ * @param sm Pointer to the SkipListMap to create.
+ * @param key_size Size (in bytes) of each key.
+ * @param value_size Size (in bytes) of each value.
+ * @param comparator Three-way key comparator.
+ * @param allocator Source of every node; must be thread-safe.
+ * @return `SLM_ERR_SUCCESS` on success, `SLM_ERR_OOM` if allocation or thread-local key creation fails.
+ */
+SkipListMapError SkipListMap_create_with_allocator(SkipListMap *sm, size_t key_size, size_t value_size, int (*comparator)(void *, void *), const Allocator *allocator);
+
+/**
+ * @brief Frees all memory associated with the SkipListMap.
+ *
+ * No other thread may be using the map, and no iterator may be open.
+ *
+ * @param sm Pointer to the SkipListMap to invalidate.
+ */
+void SkipListMap_invalidate(SkipListMap *sm);
+
+/**
+ * @brief Returns the number of entries; only exact when no other thread is updating the map.
+ *
+ * @param sm Pointer to the SkipListMap.
+ * @return Number of entries.
+ */
+size_t SkipListMap_size(SkipListMap *sm);
+
+/**
+ * @brief Inserts a key/value pair unless the key is already present.
+ *
+ * @param sm Pointer to the SkipListMap.
+ * @param key Pointer to the key to copy in.
+ * @param value Pointer to the value to copy in.
+ * @return `SLM_ERR_SUCCESS`, `SLM_ERR_EXISTS` if the key exists, or `SLM_ERR_OOM`.
+ */
+SkipListMapError SkipListMap_insert(SkipListMap *sm, void *key, void *value);
+
+/**
+ * @brief Copies the value stored for a key into `out`.
+ *
+ * @param sm Pointer to the SkipListMap.
+ * @param key Pointer to the key.
+ * @param out Destination for the value (`value_size` bytes).
+ * @return true if the key was found, false otherwise.
+ */
+bool SkipListMap_get(SkipListMap *sm, void *key, void *out);
+
+/**
+ * @brief Checks whether a key is stored.
+ *
+ * @param sm Pointer to the SkipListMap.
+ * @param key Pointer to the key.
+ * @return true if present, false otherwise.
+ */
+bool SkipListMap_contains(SkipListMap *sm, void *key);
+
+/**
+ * @brief Removes the entry for a key.
+ *
+ * @param sm Pointer to the SkipListMap.
+ * @param key Pointer to the key.
+ * @return `SLM_ERR_SUCCESS`, `SLM_ERR_NOT_FOUND` if absent, or `SLM_ERR_OOM`.
+ */
+SkipListMapError SkipListMap_remove(SkipListMap *sm, void *key);
+
+/**
+ * @brief Opens `it` at the entry with the smallest key.
+ *
+ * @param sm Pointer to the SkipListMap.
+ * @param it Iterator to open; must be closed with SkipListMap_iterator_close().
+ */
+void SkipListMap_begin(SkipListMap *sm, SkipListMapIterator *it);
+
+/**
+ * @brief Opens `it` at the first entry whose key is not less than `key`.
+ *
+ * @param sm Pointer to the SkipListMap.
+ * @param key Pointer to the key.
+ * @param it Iterator to open; must be closed with SkipListMap_iterator_close().
+ */
+void SkipListMap_lower_bound(SkipListMap *sm, void *key, SkipListMapIterator *it);
+
+/**
+ * @brief Opens `it` at the first entry whose key is greater than `key`.
+ *
+ * @param sm Pointer to the SkipListMap.
+ * @param key Pointer to the key.
+ * @param it Iterator to open; must be closed with SkipListMap_iterator_close().
+ */
+void SkipListMap_upper_bound(SkipListMap *sm, void *key, SkipListMapIterator *it);
+
+/**
+ * @brief Steps `it` to the entry with the next larger key still present.
+ *
+ * @param it Open iterator to an entry.
+ */
+void SkipListMap_next(SkipListMapIterator *it);
+
+/**
+ * @brief Closes `it`, unpinning its thread.
+ *
+ * @param it Open iterator.
+ */
+void SkipListMap_iterator_close(SkipListMapIterator *it);
+
+/**
+ * @brief Returns a pointer to the key of an entry.
+ *
+ * @param sm Pointer to the SkipListMap.
+ * @param it Open iterator.
+ * @return Pointer to the key (must not be modified), or NULL at the end.
+ */
+const void *SkipListMap_entry_key(SkipListMap *sm, SkipListMapIterator *it);
+
+/**
+ * @brief Returns a pointer to the value of an entry.
+ *
+ * @param sm Pointer to the SkipListMap.
+ * @param it Open iterator.
+ * @return Pointer to the value (must not be modified), or NULL at the end.
+ */
+const void *SkipListMap_entry_value(SkipListMap *sm, SkipListMapIterator *it);
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "allocator.h"
+#include "error.h"
+#include "utility.h"
+
+/** @brief Maximum number of levels of a SkipListSet node; each level holds a quarter of the one below. */
+#define SLS_MAX_HEIGHT 32
+
+struct _SkipListNode;
+struct _SkipListThread;
+struct _SkipListReclaim;
+
+/**
+ * @brief A lock-free ordered set on a skip list, for many concurrent writers and readers.
+ *
+ * Insertion links a new node with compare-and-swap, one level at a time, and
+ * never blocks. A removal marks the node's links first, which deletes the
+ * element logically. Any traversal that meets a marked node then unlinks it.
+ * Lookups and scans use no atomic read-modify-write operations at all.
+ *
+ * Unlinked nodes are reclaimed by epochs:
+ * - Every operation pins the calling thread to the current global epoch.
+ * - A removed node is retired into a per-thread list tagged with that epoch.
+ * - The node is freed once every pinned thread has moved two epochs past
+ *   it, so no thread can still be reading it.
+ *
+ * @note
+ * - Every function except create and invalidate may be called from any thread.
+ * - Each thread that uses the set gets a small reclamation record on first
+ *   use. The record goes back to the set when the thread exits and is
+ *   reused by later threads.
+ * - All sets find their records through one thread-local key, so any number
+ *   of sets may exist at once.
+ * - Nodes come from the set's allocator and are freed by whichever thread
+ *   reclaims them, so a custom allocator must be thread-safe. The records
+ *   and the bookkeeping behind them always use libc, since records must
+ *   start on cache lines.
+ * - An open iterator pins its thread. Close iterators promptly: while one
+ *   is open, no node removed anywhere in the set can be freed.
+ * - The comparator follows the TreeSet convention.
+ */
+typedef struct SkipListSet {
+	struct _SkipListNode *_head;          /**< Sentinel with SLS_MAX_HEIGHT links and no element. */
+	struct _SkipListReclaim *_reclaim;    /**< Global epoch and per-thread reclamation records. */
+	int (*_comparator)(void *, void *);   /**< Three-way element comparator. */
+	size_t member_size;                   /**< Size (in bytes) of each element. */
+	size_t _links_offset;                 /**< Offset of a node's links from the start of its element. */
+	size_t _height;                       /**< Number of levels in use; a search hint raised atomically. */
+	const Allocator *_allocator;          /**< Source of every node; must be thread-safe. */
+} SkipListSet;
+
+/**
+ * @brief Error codes returned by SkipListSet operations.
+ */
+typedef enum {
+	SLS_ERR_SUCCESS = 0,  /**< Operation completed successfully. */
+	SLS_ERR_OOM,          /**< Out of memory, or the shared thread-local key could not be created. */
+	SLS_ERR_EXISTS,       /**< The element is already present; nothing was inserted. */
+	SLS_ERR_NOT_FOUND,    /**< The element is not present; nothing was removed. */
+} SkipListSetError;
+
+/** @brief Result type for SkipListSet operations that may fail. */
+Result(SkipListSet, SkipListSetError);
+
+/**
+ * @brief Position in a SkipListSet that keeps its thread pinned until closed.
+ *
+ * Iteration is weakly consistent. It yields elements in ascending order.
+ * Every element present for the whole scan is seen. Elements inserted or
+ * removed during the scan may or may not be seen.
+ */
+typedef struct SkipListSetIterator {
+	SkipListSet *_set;                 /**< Set being scanned. */
+	struct _SkipListNode *_node;       /**< Current node, NULL at the end. */
+	struct _SkipListThread *_thread;   /**< Record holding the pin, NULL for an anonymous pin. */
+} SkipListSetIterator;
+
+/**
+ * @brief Initializes a new SkipListSet.
+ *
+ * @param comparator Three-way element comparator.
+ * @param member_size Size (in bytes) of each element.
+ * @return An `Errable(SkipListSet)` result containing either a valid set or an OOM error.
+ */
+Errable(SkipListSet) SkipListSet_init(int (*comparator)(void *, void *), size_t member_size);
+
+/**
+ * @brief Populates an existing SkipListSet structure.
+ *
+ * @param sls Pointer to the set to initialize.
+ * @param comparator Three-way element comparator.
+ * @param member_size Size (in bytes) of each element.
+ * @return `SLS_ERR_SUCCESS` on success, `SLS_ERR_OOM` if allocation or thread-local key creation fails.
+ */
+SkipListSetError SkipListSet_create(SkipListSet *sls, int (*comparator)(void *, void *), size_t member_size);
+
+/**
+ * @brief Initializes a new SkipListSet whose nodes draw from a custom allocator.
+ *
+ * See SkipListSet_create_with_allocator().
+ *
+ * @param comparator Three-way element comparator.
+ * @param member_size Size (in bytes) of each element.
+ * @param allocator Source of every node; must be thread-safe.
+ * @return An `Errable(SkipListSet)` result containing either a valid set or an OOM error.
+ */
+Errable(SkipListSet) SkipListSet_init_with_allocator(int (*comparator)(void *, void *), size_t member_size, const Allocator *allocator);
+
+/**
+ * @brief Populates an existing SkipListSet structure whose nodes draw from a custom allocator.
+ *
+ * Nodes are allocated by inserting threads and freed by whichever thread
+ * reclaims them, so the allocator must be thread-safe (e.g. a concurrent
+ * SlabAllocator).
+ *
+ * @param sls Pointer to the set to initialize.
+ * @param comparator Three-way element comparator.
+ * @param member_size Size (in bytes) of each element.
+ * @param allocator Source of every node; must be thread-safe.
+ * @return `SLS_ERR_SUCCESS` on success, `SLS_ERR_OOM` if allocation or thread-local key creation fails.
+ */
+SkipListSetError SkipListSet_create_with_allocator(SkipListSet *sls, int (*comparator)(void *, void *), size_t member_size, const Allocator *allocator);
+
+/**
+ * @brief Frees every node and reclamation record.
+ *
+ * No other thread may be using the set, and no iterator may be open.
+ *
+ * @param sls Pointer to the set to invalidate.
+ */
+void SkipListSet_invalidate(SkipListSet *sls);
+
+/**
+ * @brief Returns the number of elements.
+ *
+ * Sums per-thread counters, so the result is only exact when no other
+ * thread is inserting or removing.
+ *
+ * @param sls Pointer to the set.
+ * @return Number of elements.
+ */
+size_t SkipListSet_size(SkipListSet *sls);
+
+/**
+ * @brief Inserts a copy of an element.
+ *
+ * @param sls Pointer to the set.
+ * @param data Pointer to the element to copy in.
+ * @return `SLS_ERR_SUCCESS`, `SLS_ERR_EXISTS` if an equal element is present, or `SLS_ERR_OOM`.
+ */
+SkipListSetError SkipListSet_insert(SkipListSet *sls, void *data);
+
+/**
+ * @brief Removes the element equal to `data`.
+ *
+ * When several threads remove the same element, exactly one succeeds.
+ *
+ * @param sls Pointer to the set.
+ * @param data Pointer to the element to remove.
+ * @return `SLS_ERR_SUCCESS`, `SLS_ERR_NOT_FOUND` if absent, or `SLS_ERR_OOM`.
+ */
+SkipListSetError SkipListSet_remove(SkipListSet *sls, void *data);
+
+/**
+ * @brief Checks whether an element equal to `data` is present.
+ *
+ * @param sls Pointer to the set.
+ * @param data Pointer to the element to look for.
+ * @return true if present, false otherwise.
+ */
+bool SkipListSet_contains(SkipListSet *sls, void *data);
+
+/**
+ * @brief Copies the stored element equal to `data` into `out`.
+ *
+ * Useful when the comparator only looks at part of each element.
+ *
+ * @param sls Pointer to the set.
+ * @param data Pointer to the element to look for.
+ * @param out Destination for the element (`member_size` bytes).
+ * @return true if found and copied, false otherwise.
+ */
+bool SkipListSet_get(SkipListSet *sls, void *data, void *out);
+
+/**
+ * @brief Opens `it` at the smallest element.
+ *
+ * @param sls Pointer to the set.
+ * @param it Iterator to open; must be closed with SkipListSet_iterator_close().
+ */
+void SkipListSet_begin(SkipListSet *sls, SkipListSetIterator *it);
+
+/**
+ * @brief Opens `it` at the first element not less than `data`.
+ *
+ * @code
+ * SkipListSetIterator it;
+ * for (SkipListSet_lower_bound(&ids, &lo, &it); SkipListSet_iterator_get(&it); SkipListSet_next(&it))
+ *     if (cmp(SkipListSet_iterator_get(&it), &hi) >= 0) break;
+ * SkipListSet_iterator_close(&it);
+ * @endcode
+ *
+ * @param sls Pointer to the set.
+ * @param data Pointer to the element to compare against.
+ * @param it Iterator to open; must be closed with SkipListSet_iterator_close().
+ */
+void SkipListSet_lower_bound(SkipListSet *sls, void *data, SkipListSetIterator *it);
+
+/**
+ * @brief Opens `it` at the first element greater than `data`.
+ *
+ * @param sls Pointer to the set.
+ * @param data Pointer to the element to compare against.
+ * @param it Iterator to open; must be closed with SkipListSet_iterator_close().
+ */
+void SkipListSet_upper_bound(SkipListSet *sls, void *data, SkipListSetIterator *it);
+
+/**
+ * @brief Steps `it` to the next larger element still present.
+ *
+ * @param it Open iterator to an element.
+ */
+void SkipListSet_next(SkipListSetIterator *it);
+
+/**
+ * @brief Returns the element at `it`.
+ *
+ * @param it Open iterator.
+ * @return Pointer to the element (must not be modified; valid until the iterator is closed), or NULL at the end.
+ */
+const void *SkipListSet_iterator_get(SkipListSetIterator *it);
+
+/**
+ * @brief Closes `it`, unpinning its thread.
+ *
+ * @param it Open iterator.
+ */
+void SkipListSet_iterator_close(SkipListSetIterator *it);
+
+// Copies the first `key_size` bytes of `key`, and `value_size` bytes of `value` at `value_offset`, into a new node.
+SkipListSetError _SkipListSet_insert_entry(SkipListSet *sls, void *key, size_t key_size, void *value, size_t value_offset, size_t value_size);
+// Copies `size` bytes at `offset` of the element equal to `key` into `out`; false if absent.
+bool _SkipListSet_copy(SkipListSet *sls, void *key, void *out, size_t offset, size_t size);
@@ -1,22 +1,56 @@
 #pragma once
 
+#include "allocator.h"
 #include "error.h"
 #include "view.h"
 #include "slice.h"
+#include <stdarg.h>
 #include <stddef.h>
 #include <stdbool.h>
 
+/**
+ * @brief Number of characters a String stores inline before spilling to the heap.
+ */
+#define STRING_INLINE_CAPACITY 24
+
+/**
+ * @brief Factor by which a String's buffer grows when an append runs out of room.
+ *
+ * Must be greater than 1. Define before including this header (and when
+ * building the library) to override.
+ */
+#ifndef STRING_GROWTH_FACTOR
+#define STRING_GROWTH_FACTOR 2
+#endif
+
+/**
+ * @brief Returned by the String search functions when nothing is found.
+ */
+#define STRING_NPOS ((size_t) -1)
+
 /**
  * @brief A dynamically allocated, mutable string type.
  *
  * Stores character data, current size, and capacity. The internal buffer
  * may not be null-terminated unless explicitly converted to a CString
  * using String_cstring().
+ *
+ * Strings of up to `STRING_INLINE_CAPACITY` characters live in the struct
+ * itself and never touch the allocator; longer strings spill to a heap
+ * buffer. Always go through String_raw_data() rather than the fields.
+ *
+ * @note
+ * - Pointers into a small String's data (raw data, CStrings, views and
+ *   slices) point into the struct and are invalidated if it is moved.
  */
 typedef struct String {
-	char *data;         /**< Pointer to the string's character data. */
-	size_t size;        /**< Number of characters currently in use (excluding null terminator). */
-	size_t _capacity;   /**< Allocated capacity (in bytes). */
+	union {
+		char *heap;                              /**< Heap buffer, used once the string outgrows the inline one. */
+		char small[STRING_INLINE_CAPACITY];      /**< Inline buffer for short strings. */
+	} _data;
+	size_t size;          /**< Number of characters currently in use (excluding null terminator). */
+	size_t _capacity;     /**< Unused capacity (in bytes) past `size`. */
+	const Allocator *_allocator; /**< Source of the character buffer. */
 } String;
 
 /**
@@ -30,6 +64,7 @@ typedef const char *CString;
 typedef enum {
 	STR_ERR_SUCCESS = 0,  /**< Operation succeeded. */
 	STR_ERR_OOM,          /**< Out of memory. */
+	STR_ERR_FORMAT,       /**< Invalid format string or encoding error. */
 } StringError;
 
 /**
@@ -54,23 +89,46 @@ Result(CString, CStringError);
 Errable(String) String_init();
 
 /**
- * @brief Initializes a String structure without preallocating padding.
+ * @brief Creates and initializes an empty String whose buffer comes from `allocator`.
+ *
+ * @param allocator Source of the character buffer.
+ * @return A Result object containing either a valid String or an error code.
+ */
+Errable(String) String_init_with_allocator(const Allocator *allocator);
+
+/**
+ * @brief Initializes an empty String using its inline buffer and the default allocator.
  *
  * @param s Pointer to the String to initialize.
  */
 void String_default(String *s);
 
 /**
- * @brief Allocates and prepares internal memory for a String.
+ * @brief Prepares an empty String.
+ *
+ * Starts out in the inline buffer, so this never allocates.
  *
  * @param s Pointer to the String to initialize.
- * @return STR_ERR_SUCCESS on success, STR_ERR_OOM on allocation failure.
+ * @return STR_ERR_SUCCESS.
  */
 StringError String_create(String *s);
 
+/**
+ * @brief Prepares an empty String whose heap buffer, if any, comes from `allocator`.
+ *
+ * The allocator is kept for every later growth, shrink and invalidation.
+ *
+ * @param s Pointer to the String to initialize.
+ * @param allocator Source of the character buffer.
+ * @return STR_ERR_SUCCESS.
+ */
+StringError String_create_with_allocator(String *s, const Allocator *allocator);
+
 /**
  * @brief Performs a deep copy from one String to another.
  *
+ * Reuses `dest`'s buffer when it is large enough.
+ *
  * @param dest Destination String.
  * @param src Source String.
  * @return STR_ERR_SUCCESS on success, STR_ERR_OOM on failure.
@@ -102,6 +160,8 @@ void String_clear(String *s);
 /**
  * @brief Shrinks the String’s capacity to match its current size.
  *
+ * Strings short enough to fit are moved back into the inline buffer.
+ *
  * @param s Pointer to the String to shrink.
  * @return STR_ERR_SUCCESS on success, STR_ERR_OOM on failure.
  */
@@ -155,6 +215,8 @@ void String_set(String *s, size_t index, char c);
 /**
  * @brief Ensures the String can hold additional capacity without reallocation.
  *
+ * Reserves exactly the requested room; appends grow by STRING_GROWTH_FACTOR.
+ *
  * @param s Pointer to the String.
  * @param capacity Number of additional characters to reserve space for.
  * @return STR_ERR_SUCCESS on success, STR_ERR_OOM on allocation failure.
@@ -188,6 +250,30 @@ StringError String_append_string(String *s, String *a);
  */
 StringError String_append_cstring(String *s, const char *a);
 
+/**
+ * @brief Appends printf-style formatted text to this String.
+ *
+ * Formats directly into the String's spare capacity, growing it (and
+ * formatting a second time) only when the output does not fit.
+ *
+ * @param s Destination String.
+ * @param format printf-style format string.
+ * @return STR_ERR_SUCCESS on success, STR_ERR_OOM on allocation failure,
+ *         STR_ERR_FORMAT if formatting fails.
+ */
+StringError String_append_format(String *s, const char *format, ...);
+
+/**
+ * @brief Appends printf-style formatted text to this String from a va_list.
+ *
+ * @param s Destination String.
+ * @param format printf-style format string.
+ * @param args Arguments for `format`; left indeterminate afterwards, as with vprintf.
+ * @return STR_ERR_SUCCESS on success, STR_ERR_OOM on allocation failure,
+ *         STR_ERR_FORMAT if formatting fails.
+ */
+StringError String_append_vformat(String *s, const char *format, va_list args);
+
 /**
  * @brief Checks if two Strings are equal.
  *
@@ -224,10 +310,53 @@ int String_cmp_string(const String *a, const String *b);
  */
 int String_cmp_cstring(const String *a, const char *b);
 
+/**
+ * @brief Finds the first occurrence of a character.
+ *
+ * Searching, counting, equality and comparison scan 16 or 32 bytes at a time
+ * with SSE2 or AVX2 (picked at runtime), falling back to a byte loop.
+ *
+ * @param s String to search.
+ * @param c Character to find.
+ * @param from Index to start searching at.
+ * @return Index of the first match at or after `from`, or STRING_NPOS.
+ */
+size_t String_find_char(const String *s, char c, size_t from);
+
+/**
+ * @brief Finds the first occurrence of another String.
+ *
+ * @param s String to search.
+ * @param needle String to find; an empty needle matches at `from`.
+ * @param from Index to start searching at.
+ * @return Index of the first match at or after `from`, or STRING_NPOS.
+ */
+size_t String_find_string(const String *s, const String *needle, size_t from);
+
+/**
+ * @brief Finds the first occurrence of a C-style string.
+ *
+ * @param s String to search.
+ * @param needle C-style string to find (must be null-terminated).
+ * @param from Index to start searching at.
+ * @return Index of the first match at or after `from`, or STRING_NPOS.
+ */
+size_t String_find_cstring(const String *s, const char *needle, size_t from);
+
+/**
+ * @brief Counts the occurrences of a character.
+ *
+ * @param s String to scan.
+ * @param c Character to count.
+ * @return Number of positions holding `c`.
+ */
+size_t String_count_char(const String *s, char c);
+
 /**
  * @brief Creates a substring from an existing String.
  *
- * Creates a new String containing the range [from, to).
+ * Creates a new String containing the range [from, to), using the
+ * source String's allocator.
  *
  * @param s Source String.
  * @param from Starting index (inclusive).
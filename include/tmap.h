@@ -0,0 +1,276 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "allocator.h"
+#include "tset.h"
+#include "utility.h"
+
+/**
+ * @brief An ordered map from generic keys to generic values on the TreeSet red-black core.
+ *
+ * Each node stores a key immediately followed by its value (padded to the
+ * value's natural alignment). The comparator only looks at keys, so every
+ * lookup takes a bare key and no key+value temporary is ever built.
+ * Values can be updated in place through the pointers returned by
+ * TreeMap_get(), TreeMap_get_or_insert() and TreeMap_entry_value().
+ *
+ * @note
+ * - The comparator receives pointers to keys and follows the TreeSet convention.
+ * - Nodes never move, so value pointers and iterators stay valid until
+ *   their own entry is removed.
+ */
+typedef struct TreeMap {
+	TreeSet _set;               /**< Underlying red-black tree of key+value nodes. */
+	const size_t _key_size;     /**< Size (in bytes) of each key. */
+	const size_t _value_size;   /**< Size (in bytes) of each value. */
+	const size_t _value_offset; /**< Offset of the value within a node's data. */
+} TreeMap;
+
+/** @brief Position of an entry in a TreeMap; NULL is the end iterator. */
+typedef TreeSetIterator TreeMapIterator;
+
+/**
+ * @brief Error codes for TreeMap operations.
+ */
+typedef enum {
+	TM_ERR_SUCCESS = 0,        /**< Operation succeeded. */
+	TM_ERR_OOM,                /**< Out of memory during allocation. */
+	TM_ERR_EXISTS,             /**< The key is already present; nothing was inserted. */
+	TM_ERR_INVALID_ITERATOR,   /**< The iterator does not refer to an entry. */
+} TreeMapError;
+
+/**
+ * @brief Result of an emplace: the entry's value slot and whether it was newly inserted.
+ *
+ * `value` is NULL only when the insertion failed with an out of memory error.
+ */
+typedef Pair(void *value, bool inserted) TMEmplacePair;
+
+/**
+ * @brief Creates an empty TreeMap using libc memory.
+ *
+ * @param key_size Size (in bytes) of each key.
+ * @param value_size Size (in bytes) of each value.
+ * @param comparator Three-way key comparator.
+ * @return The new map.
+ */
+TreeMap TreeMap_init(size_t key_size, size_t value_size, int (*comparator)(void *, void *));
+
+/**
+ * @brief Populates an existing TreeMap structure.
+ *
+ * @param tm Pointer to the TreeMap to create.
+ * @param key_size Size (in bytes) of each key.
+ * @param value_size Size (in bytes) of each value.
+ * @param comparator Three-way key comparator.
+ */
+void TreeMap_create(TreeMap *tm, size_t key_size, size_t value_size, int (*comparator)(void *, void *));
+
+/**
+ * @brief Creates an empty TreeMap whose nodes come from `allocator`.
+ *
+ * @param key_size Size (in bytes) of each key.
+ * @param value_size Size (in bytes) of each value.
+ * @param comparator Three-way key comparator.
+ * @param allocator Source of the node pool.
+ * @return The new map.
+ */
+TreeMap TreeMap_init_with_allocator(size_t key_size, size_t value_size, int (*comparator)(void *, void *), const Allocator *allocator);
+
+/**
+ * @brief Populates an existing TreeMap structure whose nodes come from `allocator`.
+ *
+ * @param tm Pointer to the TreeMap to create.
+ * @param key_size Size (in bytes) of each key.
+ * @param value_size Size (in bytes) of each value.
+ * @param comparator Three-way key comparator.
+ * @param allocator Source of the node pool.
+ */
+void TreeMap_create_with_allocator(TreeMap *tm, size_t key_size, size_t value_size, int (*comparator)(void *, void *), const Allocator *allocator);
+
+/**
+ * @brief Frees all memory associated with the TreeMap.
+ *
+ * @param tm Pointer to the TreeMap to invalidate.
+ */
+void TreeMap_invalidate(TreeMap *tm);
+
+/**
+ * @brief Frees all memory after calling a destructor on every entry.
+ *
+ * @param tm Pointer to the TreeMap to invalidate.
+ * @param destructor Function called with pointers to each key and its value.
+ */
+void TreeMap_custom_invalidate(TreeMap *tm, void (*destructor)(void *, void *));
+
+/**
+ * @brief Returns the number of entries in the TreeMap.
+ *
+ * @param tm Pointer to the TreeMap.
+ * @return Number of entries currently stored.
+ */
+size_t TreeMap_size(TreeMap *tm);
+
+/**
+ * @brief Inserts a key/value pair unless the key is already present.
+ *
+ * @param tm Pointer to the TreeMap.
+ * @param key Pointer to the key to copy in.
+ * @param value Pointer to the value to copy in.
+ * @return TM_ERR_SUCCESS if inserted, TM_ERR_EXISTS if the key exists, TM_ERR_OOM on failure.
+ */
+TreeMapError TreeMap_insert(TreeMap *tm, void *key, void *value);
+
+/**
+ * @brief Inserts a key/value pair, overwriting the value in place if the key exists.
+ *
+ * @param tm Pointer to the TreeMap.
+ * @param key Pointer to the key to copy in.
+ * @param value Pointer to the value to copy in.
+ * @return TM_ERR_SUCCESS on success, TM_ERR_OOM on failure.
+ */
+TreeMapError TreeMap_put(TreeMap *tm, void *key, void *value);
+
+/**
+ * @brief Inserts a key/value pair unless the key exists, returning the value slot.
+ *
+ * When `value` is NULL a newly inserted value is left uninitialized for the
+ * caller to fill in through the returned pointer.
+ *
+ * @param tm Pointer to the TreeMap.
+ * @param key Pointer to the key to copy in.
+ * @param value Pointer to the value to copy in, or NULL.
+ * @return The stored value and whether it was inserted by this call.
+ */
+TMEmplacePair TreeMap_emplace(TreeMap *tm, void *key, void *value);
+
+/**
+ * @brief Returns the value slot for a key, inserting a zeroed value if the key is absent.
+ *
+ * Takes a single descent of the tree either way.
+ *
+ * @code
+ * ++*(int *) TreeMap_get_or_insert(&counts, &word).value;
+ * @endcode
+ *
+ * @param tm Pointer to the TreeMap.
+ * @param key Pointer to the key.
+ * @return The stored value and whether it was inserted by this call.
+ */
+TMEmplacePair TreeMap_get_or_insert(TreeMap *tm, void *key);
+
+/**
+ * @brief Looks up the value stored for a key.
+ *
+ * @param tm Pointer to the TreeMap.
+ * @param key Pointer to the key.
+ * @return Pointer to the stored value (writable in place), or NULL if the key is absent.
+ */
+void *TreeMap_get(TreeMap *tm, void *key);
+
+/**
+ * @brief Checks whether a key is stored.
+ *
+ * @param tm Pointer to the TreeMap.
+ * @param key Pointer to the key.
+ * @return true if present, false otherwise.
+ */
+bool TreeMap_contains(TreeMap *tm, void *key);
+
+/**
+ * @brief Removes the entry for a key, if any.
+ *
+ * @param tm Pointer to the TreeMap.
+ * @param key Pointer to the key.
+ * @return true if an entry was removed, false otherwise.
+ */
+bool TreeMap_remove(TreeMap *tm, void *key);
+
+/**
+ * @brief Removes the entry at an iterator without comparing keys.
+ *
+ * @param tm Pointer to the TreeMap.
+ * @param it Iterator to a stored entry.
+ * @return TM_ERR_SUCCESS, or TM_ERR_INVALID_ITERATOR for the end iterator.
+ */
+TreeMapError TreeMap_erase(TreeMap *tm, TreeMapIterator it);
+
+/**
+ * @brief Finds the entry for a key.
+ *
+ * @param tm Pointer to the TreeMap.
+ * @param key Pointer to the key.
+ * @return Iterator to the entry, or NULL if absent.
+ */
+TreeMapIterator TreeMap_find(TreeMap *tm, void *key);
+
+/**
+ * @brief Returns the first entry whose key is not less than `key`.
+ *
+ * @param tm Pointer to the TreeMap.
+ * @param key Pointer to the key.
+ * @return Iterator to the entry, or NULL.
+ */
+TreeMapIterator TreeMap_lower_bound(TreeMap *tm, void *key);
+
+/**
+ * @brief Returns the first entry whose key is greater than `key`.
+ *
+ * @param tm Pointer to the TreeMap.
+ * @param key Pointer to the key.
+ * @return Iterator to the entry, or NULL.
+ */
+TreeMapIterator TreeMap_upper_bound(TreeMap *tm, void *key);
+
+/**
+ * @brief Returns an iterator to the entry with the smallest key.
+ *
+ * @param tm Pointer to the TreeMap.
+ * @return Iterator to the first entry, or NULL if empty.
+ */
+TreeMapIterator TreeMap_begin(TreeMap *tm);
+
+/**
+ * @brief Returns the end iterator (NULL).
+ *
+ * @param tm Pointer to the TreeMap.
+ * @return NULL.
+ */
+TreeMapIterator TreeMap_end(TreeMap *tm);
+
+/**
+ * @brief Steps to the entry with the next larger key.
+ *
+ * @param tm Pointer to the TreeMap.
+ * @param it Iterator to a stored entry.
+ * @return Iterator to the following entry, or NULL.
+ */
+TreeMapIterator TreeMap_next(TreeMap *tm, TreeMapIterator it);
+
+/**
+ * @brief Steps to the entry with the next smaller key.
+ *
+ * @param tm Pointer to the TreeMap.
+ * @param it Iterator to a stored entry, or NULL for the largest key.
+ * @return Iterator to the preceding entry, or NULL before the first.
+ */
+TreeMapIterator TreeMap_prev(TreeMap *tm, TreeMapIterator it);
+
+/**
+ * @brief Returns a pointer to the key of an entry.
+ *
+ * @param tm Pointer to the TreeMap.
+ * @param it Iterator to a stored entry.
+ * @return Pointer to the entry's key (must not be modified).
+ */
+void *TreeMap_entry_key(TreeMap *tm, TreeMapIterator it);
+
+/**
+ * @brief Returns a pointer to the value of an entry.
+ *
+ * @param tm Pointer to the TreeMap.
+ * @param it Iterator to a stored entry.
+ * @return Pointer to the entry's value (writable in place).
+ */
+void *TreeMap_entry_value(TreeMap *tm, TreeMapIterator it);
@@ -2,21 +2,22 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
+#include "allocator.h"
 #include "utility.h"
+#include "view.h"
 
 struct _RBTreeNode {
-	char *data;
 	bool black; // false = red
-	struct _RBTreeNode *left, *right;
+	struct _RBTreeNode *parent, *left, *right;
+	char data[]; // _member_size bytes, stored inline
 };
 
-enum _RBTreeNodeError {
-	RBTN_ERR_SUCCESS,
-	RBTN_ERR_OOM,
-};
+void _RBTreeNode_create(struct _RBTreeNode *node, bool black, void *data, size_t size);
 
-enum _RBTreeNodeError _RBTreeNode_create(struct _RBTreeNode *node, bool black, void *data, size_t size);
+struct _RBTreeNode *_RBTreeNode_min(struct _RBTreeNode *node);
+struct _RBTreeNode *_RBTreeNode_max(struct _RBTreeNode *node);
 
 void _RBTreeNode_recursive_invalidate(struct _RBTreeNode *node, void (*deletor)(void *));
 
@@ -24,14 +25,30 @@ bool _RBTreeNode_black(struct _RBTreeNode *node);
 
 void _RBTreeNode_color_black(struct _RBTreeNode *node);
 
+// Iterators stay valid until their own element is erased; NULL is the end iterator.
 typedef struct _RBTreeNode *TreeSetIterator;
 
+// Nodes are carved from geometrically growing chunks obtained from the set's
+// allocator and recycled through a free list threaded through `left`.
+struct _RBTreeNodePool {
+	void *chunks;
+	struct _RBTreeNode *free;
+	size_t chunk_nodes;
+};
+
 typedef struct TreeSet {
 	TreeSetIterator _root;
 	size_t size;
 	int (*_comparator)(void *, void *);
 	void (*_deletor)(void *);
 	const size_t _member_size;
+	size_t _node_size;
+	struct _RBTreeNodePool _pool;
+	const Allocator *_allocator;
+	size_t _count_offset; // offset of each node's subtree size; 0 without order statistics
+	void *(*_key_of)(void *); // NULL: the comparator sees whole elements
+	uint64_t (*_u64_key_of)(void *);
+	size_t _node_prefix; // bytes in front of each node (its cached u64 key); 0 without one
 } TreeSet;
 
 typedef enum {
@@ -40,10 +57,12 @@ typedef enum {
 	TS_ERR_OOM,
 	TS_ERR_INVALID_ITERATOR,
 	TS_ERR_INVALID_PARENT_ITERATOR,
+	TS_ERR_NOT_EMPTY,
 } TreeSetError;
 
 typedef Pair(TreeSetIterator iterator, bool inserted) TSEmplacePair;
 
+// The deletor (NULL by default) destroys an element in place; node memory is owned by the set.
 void TreeSet_invalidate(TreeSet *ts);
 void TreeSet_custom_invalidate(TreeSet *ts, void (*deletor)(void *));
 
@@ -51,13 +70,38 @@ TreeSet TreeSet_init(int (*comparator)(void *, void *), size_t member_size);
 void TreeSet_create(TreeSet *ts, int (*comparator)(void *, void *), size_t member_size);
 TreeSet TreeSet_custom_init(int (*comparator)(void *, void *), void (*deletor)(void *), size_t member_size);
 void TreeSet_custom_create(TreeSet *ts, int (*comparator)(void *, void *), void (*deletor)(void *), size_t member_size);
-
-void _TreeSet_left_rotate(TreeSet *ts, TreeSetIterator b, TreeSetIterator parent);
-void _TreeSet_right_rotate(TreeSet *ts, TreeSetIterator b, TreeSetIterator parent);
-
-bool _TreeSet_bst_insert(TreeSet *ts, void *data, int (*comparator)(void *, void *), TreeSetIterator *stack, unsigned int *size);
-TSEmplacePair _TreeSet_bst_emplace(TreeSet *ts, void *data, int (*comparator)(void *, void *), TreeSetIterator *stack, unsigned int *size);
-void _TreeSet_insert_rebalance(TreeSet *ts, TreeSetIterator *stack, unsigned int size);
+TreeSet TreeSet_init_with_allocator(int (*comparator)(void *, void *), void (*deletor)(void *), size_t member_size, const Allocator *allocator);
+void TreeSet_create_with_allocator(TreeSet *ts, int (*comparator)(void *, void *), void (*deletor)(void *), size_t member_size, const Allocator *allocator);
+
+size_t TreeSet_node_size(TreeSet *ts);
+
+// Orders the set by a key inside each element: `key_of` points at an element's key
+// and `key_comparator` (replacing the comparator given at creation) compares two
+// keys. The *_key lookups below then take a bare key instead of a whole element.
+// Call right after creation, while the set is empty (TS_ERR_NOT_EMPTY otherwise).
+TreeSetError TreeSet_set_key(TreeSet *ts, void *(*key_of)(void *), int (*key_comparator)(void *, void *));
+// Orders the set by an unsigned 64-bit key that each node caches inline, so descents
+// compare integers in the node without calling a comparator or touching the element.
+// The *_key lookups take a pointer to a uint64_t. Same precondition as TreeSet_set_key.
+TreeSetError TreeSet_set_u64_key(TreeSet *ts, uint64_t (*key_of)(void *));
+
+// Opts the set into order statistics: every node also records its subtree size
+// (one size_t), kept up to date by insertion, erasure, both rebalance paths and
+// the rotations, so rank/select/count_range below run in O(log n). Must be
+// called while the set is empty (TS_ERR_NOT_EMPTY otherwise).
+TreeSetError TreeSet_enable_order_statistics(TreeSet *ts);
+TreeSetIterator _TreeSet_node_alloc(TreeSet *ts);
+void _TreeSet_node_free(TreeSet *ts, TreeSetIterator node);
+
+void _TreeSet_left_rotate(TreeSet *ts, TreeSetIterator b);
+void _TreeSet_right_rotate(TreeSet *ts, TreeSetIterator b);
+
+// Copies only the first `size` bytes of `data` into a new node; the rest is left to the caller.
+// A NULL comparator orders `data` as an element under the set's own ordering (key extractors included).
+TSEmplacePair _TreeSet_bst_emplace(TreeSet *ts, void *data, size_t size, int (*comparator)(void *, void *));
+TSEmplacePair _TreeSet_prepare_insert(TreeSet *ts, void *key, size_t key_size, int (*comparator)(void *, void *));
+// Returns true when the root had to be recoloured black, i.e. the black height grew.
+bool _TreeSet_insert_rebalance(TreeSet *ts, TreeSetIterator node);
 
 size_t TreeSet_size(TreeSet *ts);
 bool TreeSet_insert(TreeSet *ts, void *data);
@@ -65,19 +109,61 @@ bool TreeSet_custom_insert(TreeSet *ts, void *data, int (*comparator)(void *, vo
 TSEmplacePair TreeSet_emplace(TreeSet *ts, void *data);
 TSEmplacePair TreeSet_custom_emplace(TreeSet *ts, void *data, int (*comparator)(void *, void *));
 bool TreeSet_remove(TreeSet *ts, void *data);
+bool TreeSet_remove_key(TreeSet *ts, void *key);
 bool TreeSet_custom_remove(TreeSet *ts, void *data, int (*comparator)(void *, void *));
-TreeSetError _TreeSet_bst_erase_parent(TreeSet *ts, TreeSetIterator it, TreeSetIterator parent);
-void _TreeSet_erase_rebalance(TreeSet *ts, TreeSetIterator it, TreeSetIterator parent, TreeSetIterator *stack, unsigned int size);
+void _TreeSet_transplant(TreeSet *ts, TreeSetIterator old, TreeSetIterator node);
+void _TreeSet_erase_rebalance(TreeSet *ts, TreeSetIterator node, TreeSetIterator parent);
+// Unlinks `it` directly, without comparator calls; every other iterator stays valid.
 TreeSetError TreeSet_erase(TreeSet *ts, TreeSetIterator it);
 
+// Adds the elements of an ascending `view` (adjacent duplicates collapse). An empty
+// set is built directly in O(n): one chunk holds every node, the tree is perfectly
+// balanced and only its incomplete bottom level is red, so nothing is rebalanced.
+// A non-empty set is built that way on the side and merged in with TreeSet_union.
+TreeSetError TreeSet_from_sorted(TreeSet *ts, View *view);
+
+// In-place set algebra against `other`, which must share the comparator and member
+// size and is only read. Split/join on black heights costs O(m log(n/m + 1)) for
+// m = |other| <= n = |ts|. Union copies the new elements in, reserving their nodes
+// first so it fails (TS_ERR_OOM) before touching `ts`; like TreeSet_remove,
+// intersection and difference drop elements without calling the deletor.
+TreeSetError TreeSet_union(TreeSet *ts, TreeSet *other);
+void TreeSet_intersection(TreeSet *ts, TreeSet *other);
+void TreeSet_difference(TreeSet *ts, TreeSet *other);
+
+// In-order traversal: begin is the smallest element, end is NULL. Stepping is
+// amortised O(1) through parent links; prev(end) is the largest element.
+TreeSetIterator TreeSet_begin(TreeSet *ts);
+TreeSetIterator TreeSet_end(TreeSet *ts);
+TreeSetIterator TreeSet_next(TreeSet *ts, TreeSetIterator it);
+TreeSetIterator TreeSet_prev(TreeSet *ts, TreeSetIterator it);
+
+// Lookups take an element, or with *_key a bare key (the element itself unless TreeSet_set_key
+// or TreeSet_set_u64_key was used); custom_* variants compare whole elements with `comparator`.
 TreeSetIterator TreeSet_find(TreeSet *ts, void *data);
+TreeSetIterator TreeSet_find_key(TreeSet *ts, void *key);
 TreeSetIterator TreeSet_custom_find(TreeSet *ts, void *data, int (*comparator)(void *, void *));
 
 bool TreeSet_contains(TreeSet *ts, void *data);
+bool TreeSet_contains_key(TreeSet *ts, void *key);
 bool TreeSet_custom_contains(TreeSet *ts, void *data, int (*comparator)(void *, void *));
 
+// upper_bound: first element greater than `data`; lower_bound: first element not less than `data`.
 TreeSetIterator TreeSet_upper_bound(TreeSet *ts, void *data);
+TreeSetIterator TreeSet_upper_bound_key(TreeSet *ts, void *key);
 TreeSetIterator TreeSet_custom_upper_bound(TreeSet *ts, void *data, int (*comparator)(void *, void *));
 
 TreeSetIterator TreeSet_lower_bound(TreeSet *ts, void *data);
+TreeSetIterator TreeSet_lower_bound_key(TreeSet *ts, void *key);
 TreeSetIterator TreeSet_custom_lower_bound(TreeSet *ts, void *data, int (*comparator)(void *, void *));
+
+// Order statistics; without TreeSet_enable_order_statistics these fall back to an in-order walk.
+// rank: number of elements less than `data`.
+size_t TreeSet_rank(TreeSet *ts, void *data);
+size_t TreeSet_rank_key(TreeSet *ts, void *key);
+size_t TreeSet_custom_rank(TreeSet *ts, void *data, int (*comparator)(void *, void *));
+// select: the element with rank `k` (0-based), or NULL if k >= size.
+TreeSetIterator TreeSet_select(TreeSet *ts, size_t k);
+// count_range: number of elements in [lo, hi).
+size_t TreeSet_count_range(TreeSet *ts, void *lo, void *hi);
+size_t TreeSet_count_range_key(TreeSet *ts, void *lo, void *hi);
@@ -1,3 +1,53 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
 #define Pair(A, B) struct { A; B; }
+
+typedef union {
+	long double ld;
+	long long ll;
+	double d;
+	void *p;
+	void (*f)(void);
+} _MaxAlign;
+
+struct _MaxAlignProbe {
+	char c;
+	_MaxAlign m;
+};
+
+/** @brief Strictest fundamental alignment, equivalent to C11 `alignof(max_align_t)`. */
+#define MAX_ALIGN (offsetof(struct _MaxAlignProbe, m))
+
+/** @brief Assumed cache line size, used to keep hot structures from sharing lines. */
+#define CACHE_LINE_SIZE 64
+
+/** @brief Rounds `n` up to a multiple of `align`, which must be a power of two. */
+#define ALIGN_UP(n, align) (((n) + ((size_t) (align) - 1)) & ~((size_t) (align) - 1))
+
+/** @brief Where a map entry's value starts, and how far apart consecutive entries are. */
+typedef Pair(size_t value_offset, size_t stride) EntryLayout;
+
+/** @brief Alignment assumed for an object of `size` bytes: the largest power of two dividing it, capped at MAX_ALIGN. */
+static inline size_t size_alignment(size_t size) {
+	size_t align = 1;
+	while (align < MAX_ALIGN && size && size % (align * 2) == 0)
+		align *= 2;
+	return align;
+}
+
+/**
+ * @brief Lays out a key immediately followed by its value.
+ *
+ * The value is padded to its own alignment, and the stride to the stricter
+ * of the key's and the value's, so keys and values stay aligned when
+ * entries are stored back to back.
+ */
+static inline EntryLayout EntryLayout_of(size_t key_size, size_t value_size) {
+	size_t key_align = size_alignment(key_size), value_align = size_alignment(value_size);
+	size_t value_offset = ALIGN_UP(key_size, value_align);
+	size_t stride = ALIGN_UP(value_offset + value_size, key_align > value_align ? key_align : value_align);
+	return (EntryLayout) { .value_offset = value_offset, .stride = stride };
+}
@@ -1,10 +1,21 @@
 #pragma once
 
 #include <stddef.h>
+#include "allocator.h"
 #include "error.h"
 #include "slice.h"
 #include "view.h"
 
+/**
+ * @brief Factor by which a Vector's buffer grows when an append runs out of room.
+ *
+ * Must be greater than 1. Define before including this header (and when
+ * building the library) to override.
+ */
+#ifndef VECTOR_GROWTH_FACTOR
+#define VECTOR_GROWTH_FACTOR 2
+#endif
+
 /**
  * @brief A dynamically resizing array of generic elements.
  *
@@ -16,7 +27,8 @@ typedef struct Vector {
 	void *data;           /**< Pointer to the underlying data buffer. */
 	const size_t _member_size;  /**< Size (in bytes) of each element. */
 	size_t size;          /**< Number of elements currently in use. */
-	size_t _capacity;     /**< Allocated capacity (in elements). */
+	size_t _capacity;     /**< Total allocated capacity (in elements), never less than `size`. */
+	const Allocator *_allocator; /**< Source of the data buffer. */
 } Vector;
 
 /**
@@ -39,6 +51,15 @@ Result(Vector, VectorError);
  */
 Errable(Vector) Vector_init(size_t member_size);
 
+/**
+ * @brief Creates and initializes a new Vector whose buffer comes from `allocator`.
+ *
+ * @param member_size Size (in bytes) of each element.
+ * @param allocator Source of the data buffer.
+ * @return A Result containing a Vector or an error code.
+ */
+Errable(Vector) Vector_init_with_allocator(size_t member_size, const Allocator *allocator);
+
 /**
  * @brief Initializes an existing Vector to default values.
  *
@@ -47,6 +68,15 @@ Errable(Vector) Vector_init(size_t member_size);
  */
 void Vector_default(Vector *v, size_t member_size);
 
+/**
+ * @brief Initializes an existing Vector to default values, drawing later growth from `allocator`.
+ *
+ * @param v Pointer to the Vector to initialize.
+ * @param member_size Size (in bytes) of each element.
+ * @param allocator Source of the data buffer.
+ */
+void Vector_default_with_allocator(Vector *v, size_t member_size, const Allocator *allocator);
+
 /**
  * @brief Allocates internal memory for a Vector.
  *
@@ -56,9 +86,23 @@ void Vector_default(Vector *v, size_t member_size);
  */
 VectorError Vector_create(Vector *v, size_t member_size);
 
+/**
+ * @brief Allocates internal memory for a Vector from `allocator`.
+ *
+ * The allocator is kept for every later growth, shrink and invalidation.
+ *
+ * @param v Pointer to the Vector to create.
+ * @param member_size Size (in bytes) of each element.
+ * @param allocator Source of the data buffer.
+ * @return VEC_ERR_SUCCESS on success, VEC_ERR_OOM on allocation failure.
+ */
+VectorError Vector_create_with_allocator(Vector *v, size_t member_size, const Allocator *allocator);
+
 /**
  * @brief Performs a deep copy of one Vector into another.
  *
+ * Reuses `dest`'s buffer when it is large enough.
+ *
  * @param dest Destination Vector.
  * @param src Source Vector.
  * @return VEC_ERR_SUCCESS on success, VEC_ERR_OOM on failure.
@@ -155,11 +199,21 @@ void *Vector_offset(Vector *v, size_t offset);
  */
 void Vector_set(Vector *v, size_t index, void *data);
 
+/**
+ * @brief Returns the number of elements the Vector can hold without reallocating.
+ *
+ * @param v Pointer to the Vector.
+ * @return Total allocated capacity in elements.
+ */
+size_t Vector_capacity(Vector *v);
+
 /**
  * @brief Ensures the Vector can hold at least `capacity` elements.
  *
+ * Reserves exactly the requested total; appends grow by VECTOR_GROWTH_FACTOR.
+ *
  * @param v Pointer to the Vector.
- * @param capacity Minimum capacity to reserve.
+ * @param capacity Minimum total capacity, in elements.
  * @return VEC_ERR_SUCCESS on success, VEC_ERR_OOM on failure.
  */
 VectorError Vector_reserve(Vector *v, size_t capacity);
@@ -192,6 +246,19 @@ VectorError Vector_append_members(Vector *v, void *data, size_t n);
  */
 VectorError Vector_append_vector(Vector *v, Vector *a);
 
+/**
+ * @brief Appends `n` uninitialized elements and returns a pointer to the first.
+ *
+ * Lets producers write directly into the Vector instead of staging the
+ * elements in a temporary buffer. The pointer is invalidated by the next
+ * operation that grows the Vector.
+ *
+ * @param v Pointer to the Vector.
+ * @param n Number of elements to append.
+ * @return Pointer to the new elements, or NULL on allocation failure (nothing is appended).
+ */
+void *Vector_append_uninit(Vector *v, size_t n);
+
 /**
  * @brief Swaps two elements within the Vector.
  *
@@ -230,3 +297,96 @@ SliceOf(Vector) Vector_slice(Vector *v, size_t from, size_t to);
 #define VECTOR_CTX(name, type) \
 	for (Errable(Vector) __##name##__err__ = Vector_init(sizeof(type)), *__once__##name__ = (void*)1; !__##name##__err__.fail && __once__##name__;) \
 		for (Vector name = __##name##__err__.success; __once__##name__; __once__##name__ = NULL)
+
+/**
+ * @brief Defines a typed Vector of `T` named `Name` with inlinable accessors.
+ *
+ * The generated functions work on `T` values directly, so pushes and reads
+ * compile to plain loads and stores instead of a library call and a memcpy.
+ * Only growth falls back to the generic Vector functions. `Name` wraps a
+ * Vector with `member_size == sizeof(T)`, so `Name_vector()` can be passed
+ * to any generic Vector function.
+ *
+ * Generated: `Name_create`, `Name_create_with_allocator`, `Name_invalidate`,
+ * `Name_vector`, `Name_size`, `Name_capacity`, `Name_data`, `Name_at`,
+ * `Name_get`, `Name_set`, `Name_back`, `Name_reserve`, `Name_clear`,
+ * `Name_push`, `Name_push_n`, `Name_pop`, `Name_swap`.
+ *
+ * @note
+ * - Use at file scope, once per `Name`.
+ * - No bounds checks are performed; `Name_pop` and `Name_back` require a
+ *   non-empty Vector.
+ *
+ * @code
+ * CSTL_VECTOR_DEFINE(int, IntVec)
+ *
+ * IntVec v;
+ * IntVec_create(&v);
+ * IntVec_push(&v, 42);
+ * int x = IntVec_get(&v, 0);
+ * IntVec_invalidate(&v);
+ * @endcode
+ */
+#define CSTL_VECTOR_DEFINE(T, Name) \
+	typedef struct Name { \
+		Vector vector; \
+	} Name; \
+	\
+	static inline VectorError Name##_create(Name *v) { \
+		return Vector_create(&v->vector, sizeof(T)); \
+	} \
+	static inline VectorError Name##_create_with_allocator(Name *v, const Allocator *allocator) { \
+		return Vector_create_with_allocator(&v->vector, sizeof(T), allocator); \
+	} \
+	static inline void Name##_invalidate(Name *v) { \
+		Vector_invalidate(&v->vector); \
+	} \
+	static inline Vector *Name##_vector(Name *v) { \
+		return &v->vector; \
+	} \
+	static inline size_t Name##_size(const Name *v) { \
+		return v->vector.size; \
+	} \
+	static inline size_t Name##_capacity(const Name *v) { \
+		return v->vector._capacity; \
+	} \
+	static inline T *Name##_data(Name *v) { \
+		return (T *) v->vector.data; \
+	} \
+	static inline T *Name##_at(Name *v, size_t index) { \
+		return ((T *) v->vector.data) + index; \
+	} \
+	static inline T Name##_get(const Name *v, size_t index) { \
+		return ((const T *) v->vector.data)[index]; \
+	} \
+	static inline void Name##_set(Name *v, size_t index, T value) { \
+		((T *) v->vector.data)[index] = value; \
+	} \
+	static inline T Name##_back(const Name *v) { \
+		return ((const T *) v->vector.data)[v->vector.size - 1]; \
+	} \
+	static inline VectorError Name##_reserve(Name *v, size_t capacity) { \
+		return Vector_reserve(&v->vector, capacity); \
+	} \
+	static inline void Name##_clear(Name *v) { \
+		v->vector.size = 0; \
+	} \
+	static inline VectorError Name##_push(Name *v, T value) { \
+		if (v->vector.size < v->vector._capacity) { \
+			((T *) v->vector.data)[v->vector.size++] = value; \
+			return VEC_ERR_SUCCESS; \
+		} \
+		return Vector_append(&v->vector, &value); \
+	} \
+	static inline VectorError Name##_push_n(Name *v, const T *values, size_t n) { \
+		return Vector_append_members(&v->vector, (void *) values, n); \
+	} \
+	static inline T Name##_pop(Name *v) { \
+		return ((T *) v->vector.data)[--v->vector.size]; \
+	} \
+	static inline void Name##_swap(Name *v, size_t index_a, size_t index_b) { \
+		T *data = (T *) v->vector.data; \
+		T tmp = data[index_a]; \
+		data[index_a] = data[index_b]; \
+		data[index_b] = tmp; \
+	}
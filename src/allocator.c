@@ -0,0 +1,96 @@
+#include "allocator.h"
+#include "arena.h"
+#include "slab.h"
+#include <stdlib.h>
+#include <string.h>
+
+const Allocator *Allocator_default(void) {
+	return NULL;
+}
+
+static void *_Allocator_arena_alloc(void *ctx, size_t bytes) {
+	return ArenaAllocator_alloc((ArenaAllocator *) ctx, bytes);
+}
+
+static void *_Allocator_arena_realloc(void *ctx, void *ptr, size_t old_bytes, size_t new_bytes) {
+	ArenaAllocator *arena = (ArenaAllocator *) ctx;
+	// The newest allocation can grow or shrink in place.
+	if (ptr && (char *) ptr + old_bytes == arena->stack + arena->sp) {
+		size_t start = arena->sp - old_bytes;
+		if (new_bytes <= arena->size - start) {
+			arena->sp = start + new_bytes;
+			return ptr;
+		}
+	}
+	void *block = ArenaAllocator_alloc(arena, new_bytes);
+	if (block && ptr)
+		memcpy(block, ptr, old_bytes < new_bytes ? old_bytes : new_bytes);
+	return block;
+}
+
+Allocator Allocator_arena(ArenaAllocator *arena) {
+	return (Allocator) {
+		.alloc = _Allocator_arena_alloc,
+		.realloc = _Allocator_arena_realloc,
+		.free = NULL,
+		.ctx = arena,
+	};
+}
+
+static void *_Allocator_slab_alloc(void *ctx, size_t bytes) {
+	return SlabAllocator_alloc((SlabAllocator *) ctx, bytes);
+}
+
+static void *_Allocator_slab_realloc(void *ctx, void *ptr, size_t old_bytes, size_t new_bytes) {
+	SlabAllocator *sa = (SlabAllocator *) ctx;
+	if (ptr && SlabAllocator_usable_size(sa, ptr) >= new_bytes)
+		return ptr;
+	void *block = SlabAllocator_alloc(sa, new_bytes);
+	if (!block) return NULL;
+	if (ptr) {
+		memcpy(block, ptr, old_bytes < new_bytes ? old_bytes : new_bytes);
+		SlabAllocator_free(sa, ptr);
+	}
+	return block;
+}
+
+static void _Allocator_slab_free(void *ctx, void *ptr, size_t bytes) {
+	(void) bytes;
+	SlabAllocator_free((SlabAllocator *) ctx, ptr);
+}
+
+Allocator Allocator_slab(SlabAllocator *sa) {
+	return (Allocator) {
+		.alloc = _Allocator_slab_alloc,
+		.realloc = _Allocator_slab_realloc,
+		.free = _Allocator_slab_free,
+		.ctx = sa,
+	};
+}
+
+void *Allocator_alloc(const Allocator *a, size_t bytes) {
+	if (!a || !a->alloc) return malloc(bytes);
+	return a->alloc(a->ctx, bytes);
+}
+
+void *Allocator_realloc(const Allocator *a, void *ptr, size_t old_bytes, size_t new_bytes) {
+	if (!a || !a->alloc) return realloc(ptr, new_bytes);
+	if (a->realloc) return a->realloc(a->ctx, ptr, old_bytes, new_bytes);
+
+	void *block = a->alloc(a->ctx, new_bytes);
+	if (!block) return NULL;
+	if (ptr) {
+		memcpy(block, ptr, old_bytes < new_bytes ? old_bytes : new_bytes);
+		Allocator_free(a, ptr, old_bytes);
+	}
+	return block;
+}
+
+void Allocator_free(const Allocator *a, void *ptr, size_t bytes) {
+	if (!a || !a->alloc) {
+		free(ptr);
+		return;
+	}
+	if (a->free && ptr)
+		a->free(a->ctx, ptr, bytes);
+}
@@ -1,20 +1,29 @@
 #include "arena.h"
 #include "error.h"
+#include "utility.h"
 
 #include <stdlib.h>
 #include <string.h>
 
+#define ARENA_MIN_BLOCK_SIZE 1024
+
 void ArenaAllocator_create_stack(ArenaAllocator *arena, char *stack, size_t size) {
 	arena->stack = stack;
 	arena->size = size;
 	arena->sp = 0;
 	arena->external_stack = true;
+	arena->growable = false;
+	arena->_blocks = NULL;
+	arena->_spare = NULL;
 }
 
 ArenaAllocatorError ArenaAllocator_create(ArenaAllocator *arena, size_t size) {
 	arena->size = size;
 	arena->sp = 0;
 	arena->external_stack = false;
+	arena->growable = true;
+	arena->_blocks = NULL;
+	arena->_spare = NULL;
 	arena->stack = (char *) malloc(sizeof(char) * size);
 	if (!arena->stack)
 		return ARENA_ERR_OOM;
@@ -27,6 +36,9 @@ ArenaAllocator ArenaAllocator_init_stack(char *stack, size_t size) {
 		.size = size,
 		.sp = 0,
 		.external_stack = true,
+		.growable = false,
+		._blocks = NULL,
+		._spare = NULL,
 	};
 }
 
@@ -42,24 +54,97 @@ size_t ArenaAllocator_space(ArenaAllocator *arena) {
 	return arena->size - arena->sp;
 }
 
+static ArenaAllocatorError _ArenaAllocator_grow(ArenaAllocator *arena, size_t bytes) {
+	size_t size = arena->size * 2;
+	if (size < ARENA_MIN_BLOCK_SIZE) size = ARENA_MIN_BLOCK_SIZE;
+	if (size < bytes) size = bytes;
+
+	struct _ArenaBlock *block = arena->_spare;
+	if (block && block->size >= bytes) {
+		arena->_spare = NULL;
+	} else {
+		block = (struct _ArenaBlock *) malloc(sizeof(struct _ArenaBlock) + size);
+		if (!block) return ARENA_ERR_OOM;
+		block->size = size;
+	}
+
+	block->prev = arena->_blocks;
+	block->prev_stack = arena->stack;
+	block->prev_size = arena->size;
+	arena->_blocks = block;
+	arena->stack = (char *) (block + 1);
+	arena->size = block->size;
+	arena->sp = 0;
+	return ARENA_ERR_SUCCESS;
+}
+
+static size_t _ArenaAllocator_padding(ArenaAllocator *arena, size_t align) {
+	uintptr_t top = (uintptr_t) (arena->stack + arena->sp);
+	return ALIGN_UP(top, align) - top;
+}
+
 void *ArenaAllocator_alloc(ArenaAllocator *arena, size_t bytes) {
-	if (arena->size - arena->sp < bytes)
-		return NULL;
-	void *ptr = arena->stack + arena->sp;
-	arena->sp += bytes;
-	return ptr;
+	return ArenaAllocator_alloc_aligned(arena, bytes, MAX_ALIGN);
 }
 
 void *ArenaAllocator_calloc(ArenaAllocator *arena, size_t bytes) {
-	if (arena->size - arena->sp < bytes)
+	return ArenaAllocator_calloc_aligned(arena, bytes, MAX_ALIGN);
+}
+
+void *ArenaAllocator_alloc_aligned(ArenaAllocator *arena, size_t bytes, size_t align) {
+	size_t padding = _ArenaAllocator_padding(arena, align);
+	if (arena->size - arena->sp < bytes || arena->size - arena->sp - bytes < padding) {
+		// A fresh block is only MAX_ALIGN aligned, so leave room for the worst case padding.
+		if (!arena->growable || _ArenaAllocator_grow(arena, bytes + align - 1))
+			return NULL;
+		padding = _ArenaAllocator_padding(arena, align);
+	}
+	void *ptr = arena->stack + arena->sp + padding;
+	arena->sp += padding + bytes;
+	return ptr;
+}
+
+void *ArenaAllocator_calloc_aligned(ArenaAllocator *arena, size_t bytes, size_t align) {
+	void *ptr = ArenaAllocator_alloc_aligned(arena, bytes, align);
+	if (!ptr)
 		return NULL;
-	void *ptr = arena->stack + arena->sp;
 	memset(ptr, 0, bytes);
-	arena->sp += bytes;
 	return ptr;
 }
 
+void *ArenaAllocator_alloc_cache_line(ArenaAllocator *arena, size_t bytes) {
+	return ArenaAllocator_alloc_aligned(arena, ALIGN_UP(bytes, CACHE_LINE_SIZE), CACHE_LINE_SIZE);
+}
+
+ArenaAllocatorMark ArenaAllocator_mark(ArenaAllocator *arena) {
+	return (ArenaAllocatorMark) {
+		.block = arena->_blocks,
+		.sp = arena->sp,
+	};
+}
+
+void ArenaAllocator_rewind(ArenaAllocator *arena, ArenaAllocatorMark mark) {
+	while (arena->_blocks != mark.block) {
+		struct _ArenaBlock *block = arena->_blocks;
+		arena->_blocks = block->prev;
+		arena->stack = block->prev_stack;
+		arena->size = block->prev_size;
+
+		// Blocks grow geometrically, so the newest one is the most useful to keep.
+		if (!arena->_spare || arena->_spare->size < block->size) {
+			free(arena->_spare);
+			arena->_spare = block;
+		} else {
+			free(block);
+		}
+	}
+	arena->sp = mark.sp;
+}
+
 void ArenaAllocator_invalidate(ArenaAllocator *arena) {
+	ArenaAllocator_rewind(arena, (ArenaAllocatorMark) { .block = NULL, .sp = 0 });
+	free(arena->_spare);
+	arena->_spare = NULL;
 	if (!arena->external_stack)
 		free(arena->stack);
 }
@@ -4,29 +4,38 @@
 #include <string.h>
 
 Errable(Array) Array_init(size_t member_size, size_t size) {
+	return Array_init_with_allocator(member_size, size, Allocator_default());
+}
+
+Errable(Array) Array_init_with_allocator(size_t member_size, size_t size, const Allocator *allocator) {
 	Array arr = { .size = size };
 	ArrayError result;
-	if ((result = Array_create(&arr, member_size, size)))
+	if ((result = Array_create_with_allocator(&arr, member_size, size, allocator)))
 		return Err(result, Array);
 	return Ok(arr, Array);
 }
 
 ArrayError Array_create(Array *arr, size_t member_size, size_t size) {
+	return Array_create_with_allocator(arr, member_size, size, Allocator_default());
+}
+
+ArrayError Array_create_with_allocator(Array *arr, size_t member_size, size_t size, const Allocator *allocator) {
 	*((size_t *) &arr->size) = size;
 	*((size_t *) &arr->_member_size) = member_size;
-	arr->data = malloc(member_size * size);
+	arr->_allocator = allocator;
+	arr->data = Allocator_alloc(arr->_allocator, member_size * size);
 	if (!arr->data) return ARRAY_ERR_OOM;
 	return ARRAY_ERR_SUCCESS;
 }
 
 ArrayError Array_cpy(Array *dest, const Array *src) {
 	if (dest->_member_size * dest->size != src->_member_size * src->size) {
-		void *data = realloc(dest->data, src->_member_size * src->size);
+		void *data = Allocator_realloc(dest->_allocator, dest->data, dest->_member_size * dest->size, src->_member_size * src->size);
 		if (!data) return ARRAY_ERR_OOM;
 		dest->data = data;
 	}
 	*((size_t *) &dest->size) = src->size;
-	*((size_t *) &src->_member_size) = src->_member_size;
+	*((size_t *) &dest->_member_size) = src->_member_size;
 
 	memcpy(dest->data, src->data, src->size * src->_member_size);
 	return ARRAY_ERR_SUCCESS;
@@ -45,7 +54,7 @@ size_t Array_size(Array *arr) {
 }
 
 void Array_invalidate(Array *arr) {
-	free(arr->data);
+	Allocator_free(arr->_allocator, arr->data, arr->_member_size * arr->size);
 	arr->data = NULL;
 	*((size_t *) &arr->_member_size) = 0;
 	*((size_t *) &arr->size) = 0;
@@ -55,10 +64,11 @@ Errable(Array) Array_sublist(Array *arr, size_t from, size_t to) {
 	Array a = {
 		.size = to - from,
 		._member_size = arr->_member_size,
+		._allocator = arr->_allocator,
 	};
-	a.data = malloc(a.size * a._member_size);
+	a.data = Allocator_alloc(a._allocator, a.size * a._member_size);
 	if (!a.data) return Err(ARRAY_ERR_OOM, Array);
-	memcpy(a.data, arr->data + from, a.size);
+	memcpy(a.data, ((char *) arr->data) + (from * a._member_size), a.size * a._member_size);
 	return Ok(a, Array);
 }
 
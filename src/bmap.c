@@ -0,0 +1,120 @@
+#include "bmap.h"
+#include "bset.h"
+#include "utility.h"
+#include <string.h>
+
+BTreeMap BTreeMap_init(size_t key_size, size_t value_size, int (*comparator)(void *, void *)) {
+	return BTreeMap_init_with_allocator(key_size, value_size, comparator, Allocator_default());
+}
+
+void BTreeMap_create(BTreeMap *bm, size_t key_size, size_t value_size, int (*comparator)(void *, void *)) {
+	BTreeMap_create_with_allocator(bm, key_size, value_size, comparator, Allocator_default());
+}
+
+BTreeMap BTreeMap_init_with_allocator(size_t key_size, size_t value_size, int (*comparator)(void *, void *), const Allocator *allocator) {
+	BTreeMap bm = {
+		._key_size = key_size,
+		._value_size = value_size,
+	};
+	BTreeMap_create_with_allocator(&bm, key_size, value_size, comparator, allocator);
+	return bm;
+}
+
+void BTreeMap_create_with_allocator(BTreeMap *bm, size_t key_size, size_t value_size, int (*comparator)(void *, void *), const Allocator *allocator) {
+	EntryLayout layout = EntryLayout_of(key_size, value_size);
+	*((size_t *) &bm->_key_size) = key_size;
+	*((size_t *) &bm->_value_size) = value_size;
+	*((size_t *) &bm->_value_offset) = layout.value_offset;
+	BTreeSet_create_with_allocator(&bm->_set, comparator, NULL, layout.stride, allocator);
+	_BTreeSet_set_key_size(&bm->_set, key_size);
+}
+
+void BTreeMap_invalidate(BTreeMap *bm) {
+	BTreeSet_invalidate(&bm->_set);
+}
+
+void BTreeMap_custom_invalidate(BTreeMap *bm, void (*destructor)(void *, void *)) {
+	for (BTreeMapIterator it = BTreeMap_begin(bm); it._leaf; it = BTreeMap_next(bm, it))
+		destructor(BTreeMap_entry_key(bm, it), BTreeMap_entry_value(bm, it));
+	BTreeMap_invalidate(bm);
+}
+
+void BTreeMap_clear(BTreeMap *bm) {
+	BTreeSet_clear(&bm->_set);
+}
+
+size_t BTreeMap_size(BTreeMap *bm) {
+	return BTreeSet_size(&bm->_set);
+}
+
+BTreeMapError BTreeMap_insert(BTreeMap *bm, void *key, void *value) {
+	BTMEmplacePair pair = BTreeMap_emplace(bm, key, value);
+	if (!pair.value) return BTM_ERR_OOM;
+	return pair.inserted ? BTM_ERR_SUCCESS : BTM_ERR_EXISTS;
+}
+
+BTreeMapError BTreeMap_put(BTreeMap *bm, void *key, void *value) {
+	BTMEmplacePair pair = BTreeMap_emplace(bm, key, value);
+	if (!pair.value) return BTM_ERR_OOM;
+	if (!pair.inserted)
+		memcpy(pair.value, value, bm->_value_size);
+	return BTM_ERR_SUCCESS;
+}
+
+BTMEmplacePair BTreeMap_emplace(BTreeMap *bm, void *key, void *value) {
+	BTSEmplacePair pair = _BTreeSet_prepare_insert(&bm->_set, key);
+	void *slot = BTreeMap_entry_value(bm, pair.iterator);
+	if (pair.inserted) {
+		if (value) memcpy(slot, value, bm->_value_size);
+		else memset(slot, 0, bm->_value_size);
+	}
+	return (BTMEmplacePair) {
+		.value = slot,
+		.inserted = pair.inserted,
+	};
+}
+
+void *BTreeMap_get(BTreeMap *bm, void *key) {
+	return BTreeMap_entry_value(bm, BTreeSet_find(&bm->_set, key));
+}
+
+bool BTreeMap_contains(BTreeMap *bm, void *key) {
+	return BTreeSet_contains(&bm->_set, key);
+}
+
+bool BTreeMap_remove(BTreeMap *bm, void *key) {
+	return BTreeSet_remove(&bm->_set, key);
+}
+
+BTreeMapIterator BTreeMap_lower_bound(BTreeMap *bm, void *key) {
+	return BTreeSet_lower_bound(&bm->_set, key);
+}
+
+BTreeMapIterator BTreeMap_upper_bound(BTreeMap *bm, void *key) {
+	return BTreeSet_upper_bound(&bm->_set, key);
+}
+
+BTreeMapIterator BTreeMap_begin(BTreeMap *bm) {
+	return BTreeSet_begin(&bm->_set);
+}
+
+BTreeMapIterator BTreeMap_end(BTreeMap *bm) {
+	return BTreeSet_end(&bm->_set);
+}
+
+BTreeMapIterator BTreeMap_next(BTreeMap *bm, BTreeMapIterator it) {
+	return BTreeSet_next(&bm->_set, it);
+}
+
+BTreeMapIterator BTreeMap_prev(BTreeMap *bm, BTreeMapIterator it) {
+	return BTreeSet_prev(&bm->_set, it);
+}
+
+void *BTreeMap_entry_key(BTreeMap *bm, BTreeMapIterator it) {
+	return BTreeSet_iterator_get(&bm->_set, it);
+}
+
+void *BTreeMap_entry_value(BTreeMap *bm, BTreeMapIterator it) {
+	char *entry = BTreeSet_iterator_get(&bm->_set, it);
+	return entry ? entry + bm->_value_offset : NULL;
+}
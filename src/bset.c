@@ -0,0 +1,574 @@
+#include "bset.h"
+#include "allocator.h"
+#include "utility.h"
+#include <string.h>
+
+struct _BTreeNode {
+	size_t count; // elements in a leaf, separator keys in an inner node
+	bool leaf;
+};
+
+// Elements follow the header at BTREE_LEAF_HEADER, `_member_size` bytes apart.
+struct _BTreeLeaf {
+	struct _BTreeNode node;
+	struct _BTreeLeaf *prev, *next;
+};
+
+// children[i] holds keys below separator i; separator keys follow at `_keys_offset`.
+struct _BTreeInner {
+	struct _BTreeNode node;
+	struct _BTreeNode *children[];
+};
+
+#define BTREE_LEAF_HEADER ALIGN_UP(sizeof(struct _BTreeLeaf), MAX_ALIGN)
+
+static char *_BTreeSet_element(BTreeSet *bs, struct _BTreeLeaf *leaf, size_t index) {
+	return (char *) leaf + BTREE_LEAF_HEADER + (index * bs->_member_size);
+}
+
+static char *_BTreeSet_key(BTreeSet *bs, struct _BTreeInner *inner, size_t index) {
+	return (char *) inner + bs->_keys_offset + (index * bs->_key_size);
+}
+
+// Sizes nodes to BTREE_NODE_SIZE, or the smallest multiple of a cache line
+// holding BTREE_MIN_CAPACITY elements or children, then fills that space.
+static void _BTreeSet_layout(BTreeSet *bs) {
+	size_t member = bs->_member_size ? bs->_member_size : 1;
+	size_t key = bs->_key_size ? bs->_key_size : 1;
+
+	size_t leaf_bytes = BTREE_LEAF_HEADER + (BTREE_MIN_CAPACITY * member);
+	bs->_leaf_bytes = ALIGN_UP(leaf_bytes > BTREE_NODE_SIZE ? leaf_bytes : BTREE_NODE_SIZE, CACHE_LINE_SIZE);
+	bs->_leaf_capacity = (bs->_leaf_bytes - BTREE_LEAF_HEADER) / member;
+
+	size_t keys = BTREE_MIN_CAPACITY - 1;
+	size_t offset = ALIGN_UP(sizeof(struct _BTreeInner) + ((keys + 1) * sizeof(struct _BTreeNode *)), MAX_ALIGN);
+	size_t inner_bytes = offset + (keys * key);
+	bs->_inner_bytes = ALIGN_UP(inner_bytes > BTREE_NODE_SIZE ? inner_bytes : BTREE_NODE_SIZE, CACHE_LINE_SIZE);
+	for (;;) {
+		size_t next = ALIGN_UP(sizeof(struct _BTreeInner) + ((keys + 2) * sizeof(struct _BTreeNode *)), MAX_ALIGN);
+		if (next + ((keys + 1) * key) > bs->_inner_bytes) break;
+		offset = next;
+		++keys;
+	}
+	bs->_inner_capacity = keys;
+	bs->_keys_offset = offset;
+}
+
+BTreeSet BTreeSet_init(int (*comparator)(void *, void *), size_t member_size) {
+	return BTreeSet_custom_init(comparator, NULL, member_size);
+}
+void BTreeSet_create(BTreeSet *bs, int (*comparator)(void *, void *), size_t member_size) {
+	BTreeSet_custom_create(bs, comparator, NULL, member_size);
+}
+
+BTreeSet BTreeSet_custom_init(int (*comparator)(void *, void *), void (*deletor)(void *), size_t member_size) {
+	return BTreeSet_init_with_allocator(comparator, deletor, member_size, Allocator_default());
+}
+void BTreeSet_custom_create(BTreeSet *bs, int (*comparator)(void *, void *), void (*deletor)(void *), size_t member_size) {
+	BTreeSet_create_with_allocator(bs, comparator, deletor, member_size, Allocator_default());
+}
+
+BTreeSet BTreeSet_init_with_allocator(int (*comparator)(void *, void *), void (*deletor)(void *), size_t member_size, const Allocator *allocator) {
+	BTreeSet bs = {
+		._member_size = member_size,
+	};
+	BTreeSet_create_with_allocator(&bs, comparator, deletor, member_size, allocator);
+	return bs;
+}
+void BTreeSet_create_with_allocator(BTreeSet *bs, int (*comparator)(void *, void *), void (*deletor)(void *), size_t member_size, const Allocator *allocator) {
+	*((size_t *) &bs->_member_size) = member_size;
+	bs->_key_size = member_size;
+	bs->_comparator = comparator;
+	bs->_deletor = deletor;
+	bs->_root = NULL;
+	bs->_first = bs->_last = NULL;
+	bs->size = 0;
+	bs->_height = 0;
+	bs->_allocator = allocator;
+	_BTreeSet_layout(bs);
+}
+
+void _BTreeSet_set_key_size(BTreeSet *bs, size_t key_size) {
+	bs->_key_size = key_size;
+	_BTreeSet_layout(bs);
+}
+
+static void _BTreeSet_free_node(BTreeSet *bs, struct _BTreeNode *node) {
+	if (node->leaf) {
+		Allocator_free(bs->_allocator, node, bs->_leaf_bytes);
+		return;
+	}
+	struct _BTreeInner *inner = (struct _BTreeInner *) node;
+	for (size_t i = 0; i <= node->count; ++i)
+		_BTreeSet_free_node(bs, inner->children[i]);
+	Allocator_free(bs->_allocator, node, bs->_inner_bytes);
+}
+
+void BTreeSet_invalidate(BTreeSet *bs) {
+	BTreeSet_custom_invalidate(bs, bs->_deletor);
+}
+
+void BTreeSet_custom_invalidate(BTreeSet *bs, void (*deletor)(void *)) {
+	if (deletor)
+		for (struct _BTreeLeaf *leaf = bs->_first; leaf; leaf = leaf->next)
+			for (size_t i = 0; i < leaf->node.count; ++i)
+				deletor(_BTreeSet_element(bs, leaf, i));
+	BTreeSet_clear(bs);
+}
+
+void BTreeSet_clear(BTreeSet *bs) {
+	if (bs->_root)
+		_BTreeSet_free_node(bs, bs->_root);
+	bs->_root = NULL;
+	bs->_first = bs->_last = NULL;
+	bs->size = 0;
+	bs->_height = 0;
+}
+
+size_t BTreeSet_size(BTreeSet *bs) {
+	return bs->size;
+}
+
+static struct _BTreeLeaf *_BTreeSet_leaf_alloc(BTreeSet *bs) {
+	struct _BTreeLeaf *leaf = (struct _BTreeLeaf *) Allocator_alloc(bs->_allocator, bs->_leaf_bytes);
+	if (!leaf) return NULL;
+	leaf->node.count = 0;
+	leaf->node.leaf = true;
+	leaf->prev = leaf->next = NULL;
+	return leaf;
+}
+
+static struct _BTreeInner *_BTreeSet_inner_alloc(BTreeSet *bs) {
+	struct _BTreeInner *inner = (struct _BTreeInner *) Allocator_alloc(bs->_allocator, bs->_inner_bytes);
+	if (!inner) return NULL;
+	inner->node.count = 0;
+	inner->node.leaf = false;
+	return inner;
+}
+
+// Index of the child whose range contains `key`: the first separator greater than it.
+static size_t _BTreeSet_inner_slot(BTreeSet *bs, struct _BTreeInner *inner, void *key) {
+	size_t lo = 0, hi = inner->node.count;
+	while (lo < hi) {
+		size_t mid = lo + ((hi - lo) / 2);
+		if (bs->_comparator(key, _BTreeSet_key(bs, inner, mid)) < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
+// First element not less than `key`; `found` reports an equal element on the way.
+static size_t _BTreeSet_leaf_lower(BTreeSet *bs, struct _BTreeLeaf *leaf, void *key, bool *found) {
+	size_t lo = 0, hi = leaf->node.count;
+	*found = false;
+	while (lo < hi) {
+		size_t mid = lo + ((hi - lo) / 2);
+		int result = bs->_comparator(key, _BTreeSet_element(bs, leaf, mid));
+		if (result > 0) {
+			lo = mid + 1;
+		} else {
+			*found |= result == 0;
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+static size_t _BTreeSet_leaf_upper(BTreeSet *bs, struct _BTreeLeaf *leaf, void *key) {
+	size_t lo = 0, hi = leaf->node.count;
+	while (lo < hi) {
+		size_t mid = lo + ((hi - lo) / 2);
+		if (bs->_comparator(key, _BTreeSet_element(bs, leaf, mid)) < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
+// Descends to the leaf that would hold `key`, recording the inner nodes and child slots taken.
+static struct _BTreeLeaf *_BTreeSet_descend(BTreeSet *bs, void *key, struct _BTreeInner **path, size_t *slots, size_t *depth) {
+	struct _BTreeNode *node = bs->_root;
+	size_t d = 0;
+	while (!node->leaf) {
+		struct _BTreeInner *inner = (struct _BTreeInner *) node;
+		size_t slot = _BTreeSet_inner_slot(bs, inner, key);
+		if (path) {
+			path[d] = inner;
+			slots[d] = slot;
+		}
+		++d;
+		node = inner->children[slot];
+	}
+	if (depth) *depth = d;
+	return (struct _BTreeLeaf *) node;
+}
+
+static void _BTreeSet_leaf_insert_at(BTreeSet *bs, struct _BTreeLeaf *leaf, size_t index, void *key) {
+	char *slot = _BTreeSet_element(bs, leaf, index);
+	memmove(slot + bs->_member_size, slot, (leaf->node.count - index) * bs->_member_size);
+	memcpy(slot, key, bs->_key_size);
+	++leaf->node.count;
+}
+
+static void _BTreeSet_inner_insert_at(BTreeSet *bs, struct _BTreeInner *inner, size_t index, void *key, struct _BTreeNode *child) {
+	size_t count = inner->node.count;
+	char *slot = _BTreeSet_key(bs, inner, index);
+	memmove(slot + bs->_key_size, slot, (count - index) * bs->_key_size);
+	memcpy(slot, key, bs->_key_size);
+	memmove(&inner->children[index + 2], &inner->children[index + 1], (count - index) * sizeof(struct _BTreeNode *));
+	inner->children[index + 1] = child;
+	++inner->node.count;
+}
+
+// Removes separator `index` and the child to its right.
+static void _BTreeSet_inner_remove_at(BTreeSet *bs, struct _BTreeInner *inner, size_t index) {
+	size_t count = inner->node.count;
+	char *slot = _BTreeSet_key(bs, inner, index);
+	memmove(slot, slot + bs->_key_size, (count - index - 1) * bs->_key_size);
+	memmove(&inner->children[index + 1], &inner->children[index + 2], (count - index - 1) * sizeof(struct _BTreeNode *));
+	--inner->node.count;
+}
+
+// Splits a full inner node while inserting (`key`, `child`) at separator `index`.
+// Returns the separator to push up. When it is not `key` itself it is parked
+// in the last key slot of `right`, which the split always leaves unused.
+static void *_BTreeSet_inner_split(BTreeSet *bs, struct _BTreeInner *inner, struct _BTreeInner *right, size_t index, void *key, struct _BTreeNode *child) {
+	size_t cap = bs->_inner_capacity, half = (cap + 1) / 2, ks = bs->_key_size;
+	void *median = key;
+	if (index < half) {
+		right->node.count = cap - half;
+		memcpy(_BTreeSet_key(bs, right, 0), _BTreeSet_key(bs, inner, half), (cap - half) * ks);
+		memcpy(right->children, &inner->children[half], (cap - half + 1) * sizeof(struct _BTreeNode *));
+		median = _BTreeSet_key(bs, right, cap - 1);
+		memcpy(median, _BTreeSet_key(bs, inner, half - 1), ks);
+		inner->node.count = half - 1;
+		_BTreeSet_inner_insert_at(bs, inner, index, key, child);
+	} else if (index == half) {
+		right->node.count = cap - half;
+		memcpy(_BTreeSet_key(bs, right, 0), _BTreeSet_key(bs, inner, half), (cap - half) * ks);
+		right->children[0] = child;
+		memcpy(&right->children[1], &inner->children[half + 1], (cap - half) * sizeof(struct _BTreeNode *));
+		inner->node.count = half;
+	} else {
+		right->node.count = cap - half - 1;
+		memcpy(_BTreeSet_key(bs, right, 0), _BTreeSet_key(bs, inner, half + 1), (cap - half - 1) * ks);
+		memcpy(right->children, &inner->children[half + 1], (cap - half) * sizeof(struct _BTreeNode *));
+		median = _BTreeSet_key(bs, right, cap - 1);
+		memcpy(median, _BTreeSet_key(bs, inner, half), ks);
+		inner->node.count = half;
+		_BTreeSet_inner_insert_at(bs, right, index - half - 1, key, child);
+	}
+	return median;
+}
+
+BTSEmplacePair _BTreeSet_prepare_insert(BTreeSet *bs, void *key) {
+	BTSEmplacePair failed = { .iterator = { NULL, 0 }, .inserted = false };
+	if (!bs->_root) {
+		struct _BTreeLeaf *leaf = _BTreeSet_leaf_alloc(bs);
+		if (!leaf) return failed;
+		bs->_root = &leaf->node;
+		bs->_first = bs->_last = leaf;
+		bs->_height = 1;
+	}
+
+	struct _BTreeInner *path[BTREE_MAX_HEIGHT];
+	size_t slots[BTREE_MAX_HEIGHT], depth;
+	struct _BTreeLeaf *leaf = _BTreeSet_descend(bs, key, path, slots, &depth);
+	bool found;
+	size_t index = _BTreeSet_leaf_lower(bs, leaf, key, &found);
+	if (found)
+		return (BTSEmplacePair) { .iterator = { leaf, index }, .inserted = false };
+
+	if (leaf->node.count < bs->_leaf_capacity) {
+		_BTreeSet_leaf_insert_at(bs, leaf, index, key);
+		++bs->size;
+		return (BTSEmplacePair) { .iterator = { leaf, index }, .inserted = true };
+	}
+
+	// Allocate every node the split cascade needs up front, so OOM leaves the tree untouched.
+	size_t splits = 1;
+	while (splits <= depth && path[depth - splits]->node.count == bs->_inner_capacity)
+		++splits;
+	size_t inners = splits - 1 + (splits > depth);
+	struct _BTreeInner *fresh[BTREE_MAX_HEIGHT + 1];
+	struct _BTreeLeaf *right = _BTreeSet_leaf_alloc(bs);
+	if (!right) return failed;
+	for (size_t i = 0; i < inners; ++i) {
+		if (!(fresh[i] = _BTreeSet_inner_alloc(bs))) {
+			while (i--)
+				Allocator_free(bs->_allocator, fresh[i], bs->_inner_bytes);
+			Allocator_free(bs->_allocator, right, bs->_leaf_bytes);
+			return failed;
+		}
+	}
+
+	// Split the leaf so both halves end up with about (capacity + 1) / 2 elements.
+	size_t cap = bs->_leaf_capacity, half = (cap + 1) / 2;
+	BTreeSetIterator it;
+	if (index < half) {
+		right->node.count = cap - half + 1;
+		memcpy(_BTreeSet_element(bs, right, 0), _BTreeSet_element(bs, leaf, half - 1), right->node.count * bs->_member_size);
+		leaf->node.count = half - 1;
+		_BTreeSet_leaf_insert_at(bs, leaf, index, key);
+		it = (BTreeSetIterator) { leaf, index };
+	} else {
+		right->node.count = cap - half;
+		memcpy(_BTreeSet_element(bs, right, 0), _BTreeSet_element(bs, leaf, half), right->node.count * bs->_member_size);
+		leaf->node.count = half;
+		_BTreeSet_leaf_insert_at(bs, right, index - half, key);
+		it = (BTreeSetIterator) { right, index - half };
+	}
+	right->prev = leaf;
+	right->next = leaf->next;
+	if (leaf->next)
+		leaf->next->prev = right;
+	else
+		bs->_last = right;
+	leaf->next = right;
+	++bs->size;
+
+	// Push separators up until a node has room, growing a new root if none does.
+	void *separator = _BTreeSet_element(bs, right, 0);
+	struct _BTreeNode *child = &right->node;
+	size_t used = 0;
+	for (size_t level = depth; level-- > 0;) {
+		struct _BTreeInner *inner = path[level];
+		if (inner->node.count < bs->_inner_capacity) {
+			_BTreeSet_inner_insert_at(bs, inner, slots[level], separator, child);
+			return (BTSEmplacePair) { .iterator = it, .inserted = true };
+		}
+		struct _BTreeInner *sibling = fresh[used++];
+		separator = _BTreeSet_inner_split(bs, inner, sibling, slots[level], separator, child);
+		child = &sibling->node;
+	}
+
+	struct _BTreeInner *root = fresh[used];
+	root->node.count = 1;
+	root->children[0] = bs->_root;
+	root->children[1] = child;
+	memcpy(_BTreeSet_key(bs, root, 0), separator, bs->_key_size);
+	bs->_root = &root->node;
+	++bs->_height;
+	return (BTSEmplacePair) { .iterator = it, .inserted = true };
+}
+
+bool BTreeSet_insert(BTreeSet *bs, void *data) {
+	return BTreeSet_emplace(bs, data).inserted;
+}
+
+BTSEmplacePair BTreeSet_emplace(BTreeSet *bs, void *data) {
+	BTSEmplacePair pair = _BTreeSet_prepare_insert(bs, data);
+	if (pair.inserted && bs->_key_size < bs->_member_size) {
+		char *element = BTreeSet_iterator_get(bs, pair.iterator);
+		memcpy(element + bs->_key_size, (char *) data + bs->_key_size, bs->_member_size - bs->_key_size);
+	}
+	return pair;
+}
+
+static void _BTreeSet_unlink_leaf(BTreeSet *bs, struct _BTreeLeaf *leaf) {
+	if (leaf->prev)
+		leaf->prev->next = leaf->next;
+	else
+		bs->_first = leaf->next;
+	if (leaf->next)
+		leaf->next->prev = leaf->prev;
+	else
+		bs->_last = leaf->prev;
+	Allocator_free(bs->_allocator, leaf, bs->_leaf_bytes);
+}
+
+// Refills an inner node that fell below half capacity, walking up while merges cascade.
+static void _BTreeSet_rebalance_inner(BTreeSet *bs, struct _BTreeInner **path, size_t *slots, size_t level) {
+	size_t min = bs->_inner_capacity / 2, ks = bs->_key_size, ps = sizeof(struct _BTreeNode *);
+	for (;;) {
+		struct _BTreeInner *inner = path[level];
+		if (level == 0) {
+			if (inner->node.count == 0) {
+				bs->_root = inner->children[0];
+				--bs->_height;
+				Allocator_free(bs->_allocator, inner, bs->_inner_bytes);
+			}
+			return;
+		}
+		if (inner->node.count >= min) return;
+
+		struct _BTreeInner *parent = path[level - 1];
+		size_t slot = slots[level - 1];
+		struct _BTreeInner *left = slot > 0 ? (struct _BTreeInner *) parent->children[slot - 1] : NULL;
+		struct _BTreeInner *right = slot < parent->node.count ? (struct _BTreeInner *) parent->children[slot + 1] : NULL;
+		size_t count = inner->node.count;
+
+		// Rotate one child through the parent's separator.
+		if (left && left->node.count > min) {
+			size_t lc = left->node.count;
+			memmove(_BTreeSet_key(bs, inner, 1), _BTreeSet_key(bs, inner, 0), count * ks);
+			memmove(&inner->children[1], &inner->children[0], (count + 1) * ps);
+			memcpy(_BTreeSet_key(bs, inner, 0), _BTreeSet_key(bs, parent, slot - 1), ks);
+			inner->children[0] = left->children[lc];
+			memcpy(_BTreeSet_key(bs, parent, slot - 1), _BTreeSet_key(bs, left, lc - 1), ks);
+			--left->node.count;
+			++inner->node.count;
+			return;
+		}
+		if (right && right->node.count > min) {
+			size_t rc = right->node.count;
+			memcpy(_BTreeSet_key(bs, inner, count), _BTreeSet_key(bs, parent, slot), ks);
+			inner->children[count + 1] = right->children[0];
+			memcpy(_BTreeSet_key(bs, parent, slot), _BTreeSet_key(bs, right, 0), ks);
+			memmove(_BTreeSet_key(bs, right, 0), _BTreeSet_key(bs, right, 1), (rc - 1) * ks);
+			memmove(&right->children[0], &right->children[1], rc * ps);
+			--right->node.count;
+			++inner->node.count;
+			return;
+		}
+
+		// Merge with a sibling, pulling the separator between them down.
+		size_t separator = left ? slot - 1 : slot;
+		struct _BTreeInner *into = left ? left : inner, *from = left ? inner : right;
+		size_t ic = into->node.count, fc = from->node.count;
+		memcpy(_BTreeSet_key(bs, into, ic), _BTreeSet_key(bs, parent, separator), ks);
+		memcpy(_BTreeSet_key(bs, into, ic + 1), _BTreeSet_key(bs, from, 0), fc * ks);
+		memcpy(&into->children[ic + 1], from->children, (fc + 1) * ps);
+		into->node.count = ic + 1 + fc;
+		Allocator_free(bs->_allocator, from, bs->_inner_bytes);
+		_BTreeSet_inner_remove_at(bs, parent, separator);
+		--level;
+	}
+}
+
+static bool _BTreeSet_remove_key(BTreeSet *bs, void *key) {
+	if (!bs->_root) return false;
+	struct _BTreeInner *path[BTREE_MAX_HEIGHT];
+	size_t slots[BTREE_MAX_HEIGHT], depth;
+	struct _BTreeLeaf *leaf = _BTreeSet_descend(bs, key, path, slots, &depth);
+	bool found;
+	size_t index = _BTreeSet_leaf_lower(bs, leaf, key, &found);
+	if (!found) return false;
+
+	// `key` may point at the element being removed; it is not read past this point.
+	size_t ms = bs->_member_size;
+	char *slot = _BTreeSet_element(bs, leaf, index);
+	memmove(slot, slot + ms, (leaf->node.count - index - 1) * ms);
+	--leaf->node.count;
+	--bs->size;
+
+	if (depth == 0) {
+		if (leaf->node.count == 0) {
+			_BTreeSet_unlink_leaf(bs, leaf);
+			bs->_root = NULL;
+			bs->_height = 0;
+		}
+		return true;
+	}
+
+	size_t min = bs->_leaf_capacity / 2;
+	if (leaf->node.count >= min) return true;
+
+	// Stale separators stay valid bounds; they are only rewritten when elements cross them.
+	struct _BTreeInner *parent = path[depth - 1];
+	size_t pslot = slots[depth - 1], count = leaf->node.count;
+	struct _BTreeLeaf *left = pslot > 0 ? (struct _BTreeLeaf *) parent->children[pslot - 1] : NULL;
+	struct _BTreeLeaf *right = pslot < parent->node.count ? (struct _BTreeLeaf *) parent->children[pslot + 1] : NULL;
+
+	if (left && left->node.count > min) {
+		memmove(_BTreeSet_element(bs, leaf, 1), _BTreeSet_element(bs, leaf, 0), count * ms);
+		memcpy(_BTreeSet_element(bs, leaf, 0), _BTreeSet_element(bs, left, left->node.count - 1), ms);
+		--left->node.count;
+		++leaf->node.count;
+		memcpy(_BTreeSet_key(bs, parent, pslot - 1), _BTreeSet_element(bs, leaf, 0), bs->_key_size);
+		return true;
+	}
+	if (right && right->node.count > min) {
+		memcpy(_BTreeSet_element(bs, leaf, count), _BTreeSet_element(bs, right, 0), ms);
+		memmove(_BTreeSet_element(bs, right, 0), _BTreeSet_element(bs, right, 1), (right->node.count - 1) * ms);
+		--right->node.count;
+		++leaf->node.count;
+		memcpy(_BTreeSet_key(bs, parent, pslot), _BTreeSet_element(bs, right, 0), bs->_key_size);
+		return true;
+	}
+
+	size_t separator = left ? pslot - 1 : pslot;
+	struct _BTreeLeaf *into = left ? left : leaf, *from = left ? leaf : right;
+	memcpy(_BTreeSet_element(bs, into, into->node.count), _BTreeSet_element(bs, from, 0), from->node.count * ms);
+	into->node.count += from->node.count;
+	_BTreeSet_unlink_leaf(bs, from);
+	_BTreeSet_inner_remove_at(bs, parent, separator);
+	_BTreeSet_rebalance_inner(bs, path, slots, depth - 1);
+	return true;
+}
+
+bool BTreeSet_remove(BTreeSet *bs, void *data) {
+	return _BTreeSet_remove_key(bs, data);
+}
+
+BTreeSetError BTreeSet_erase(BTreeSet *bs, BTreeSetIterator it) {
+	if (!it._leaf || it._index >= it._leaf->node.count) return BTS_ERR_INVALID_ITERATOR;
+	return _BTreeSet_remove_key(bs, _BTreeSet_element(bs, it._leaf, it._index)) ? BTS_ERR_SUCCESS : BTS_ERR_INVALID_ITERATOR;
+}
+
+BTreeSetIterator BTreeSet_find(BTreeSet *bs, void *data) {
+	BTreeSetIterator end = { NULL, 0 };
+	if (!bs->_root) return end;
+	struct _BTreeLeaf *leaf = _BTreeSet_descend(bs, data, NULL, NULL, NULL);
+	bool found;
+	size_t index = _BTreeSet_leaf_lower(bs, leaf, data, &found);
+	return found ? (BTreeSetIterator) { leaf, index } : end;
+}
+
+bool BTreeSet_contains(BTreeSet *bs, void *data) {
+	return BTreeSet_find(bs, data)._leaf != NULL;
+}
+
+// Normalises a one-past-the-leaf position to the start of the next leaf.
+static BTreeSetIterator _BTreeSet_position(struct _BTreeLeaf *leaf, size_t index) {
+	if (index < leaf->node.count)
+		return (BTreeSetIterator) { leaf, index };
+	return (BTreeSetIterator) { leaf->next, 0 };
+}
+
+BTreeSetIterator BTreeSet_lower_bound(BTreeSet *bs, void *data) {
+	if (!bs->_root) return BTreeSet_end(bs);
+	struct _BTreeLeaf *leaf = _BTreeSet_descend(bs, data, NULL, NULL, NULL);
+	bool found;
+	return _BTreeSet_position(leaf, _BTreeSet_leaf_lower(bs, leaf, data, &found));
+}
+
+BTreeSetIterator BTreeSet_upper_bound(BTreeSet *bs, void *data) {
+	if (!bs->_root) return BTreeSet_end(bs);
+	struct _BTreeLeaf *leaf = _BTreeSet_descend(bs, data, NULL, NULL, NULL);
+	return _BTreeSet_position(leaf, _BTreeSet_leaf_upper(bs, leaf, data));
+}
+
+BTreeSetIterator BTreeSet_begin(BTreeSet *bs) {
+	return (BTreeSetIterator) { bs->_first, 0 };
+}
+
+BTreeSetIterator BTreeSet_end(BTreeSet *bs) {
+	(void) bs;
+	return (BTreeSetIterator) { NULL, 0 };
+}
+
+BTreeSetIterator BTreeSet_next(BTreeSet *bs, BTreeSetIterator it) {
+	if (!it._leaf) return BTreeSet_end(bs);
+	return _BTreeSet_position(it._leaf, it._index + 1);
+}
+
+BTreeSetIterator BTreeSet_prev(BTreeSet *bs, BTreeSetIterator it) {
+	if (!it._leaf) {
+		if (!bs->_last) return BTreeSet_end(bs);
+		return (BTreeSetIterator) { bs->_last, bs->_last->node.count - 1 };
+	}
+	if (it._index > 0)
+		return (BTreeSetIterator) { it._leaf, it._index - 1 };
+	struct _BTreeLeaf *prev = it._leaf->prev;
+	if (!prev) return BTreeSet_end(bs);
+	return (BTreeSetIterator) { prev, prev->node.count - 1 };
+}
+
+void *BTreeSet_iterator_get(BTreeSet *bs, BTreeSetIterator it) {
+	if (!it._leaf) return NULL;
+	return _BTreeSet_element(bs, it._leaf, it._index);
+}
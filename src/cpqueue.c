@@ -0,0 +1,173 @@
+#include "cpqueue.h"
+#include "error.h"
+#include "pqueue.h"
+#include "utility.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#define CPQ_THREAD_LOCAL _Thread_local
+#elif defined(_MSC_VER)
+#define CPQ_THREAD_LOCAL __declspec(thread)
+#else
+#define CPQ_THREAD_LOCAL __thread
+#endif
+
+struct _CPQShardData {
+	pthread_mutex_t lock;
+	PriorityQueue pq; // guarded by lock
+};
+
+// Padded to whole cache lines, in a line-aligned array, so threads working on neighbouring shards do not share a line.
+union _CPQShard {
+	struct _CPQShardData shard;
+	char _pad[ALIGN_UP(sizeof(struct _CPQShardData), CACHE_LINE_SIZE)];
+};
+
+static CPQ_THREAD_LOCAL uint64_t _cpq_rng;
+
+// xorshift64, seeded from the address of the thread's own state so every thread draws a different sequence.
+static size_t _ConcurrentPriorityQueue_random(size_t bound) {
+	uint64_t x = _cpq_rng;
+	if (!x) {
+		x = (uint64_t) (uintptr_t) &_cpq_rng * 0x9E3779B97F4A7C15ULL;
+		x ^= x >> 31;
+		if (!x) x = 1;
+	}
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	_cpq_rng = x;
+	return (size_t) (x % bound);
+}
+
+static struct _CPQShardData *_ConcurrentPriorityQueue_shard(ConcurrentPriorityQueue *cpq, size_t index) {
+	return &cpq->_shards[index].shard;
+}
+
+Errable(ConcurrentPriorityQueue) ConcurrentPriorityQueue_init(size_t member_size, int (*comparator)(void *, void *), size_t shard_count) {
+	return ConcurrentPriorityQueue_init_with_allocator(member_size, comparator, shard_count, Allocator_default());
+}
+
+Errable(ConcurrentPriorityQueue) ConcurrentPriorityQueue_init_with_allocator(size_t member_size, int (*comparator)(void *, void *), size_t shard_count, const Allocator *allocator) {
+	ConcurrentPriorityQueue cpq;
+	ConcurrentPriorityQueueError result;
+	if ((result = ConcurrentPriorityQueue_create_with_allocator(&cpq, member_size, comparator, shard_count, allocator)))
+		return Err(result, ConcurrentPriorityQueue);
+	return Ok(cpq, ConcurrentPriorityQueue);
+}
+
+ConcurrentPriorityQueueError ConcurrentPriorityQueue_create(ConcurrentPriorityQueue *cpq, size_t member_size, int (*comparator)(void *, void *), size_t shard_count) {
+	return ConcurrentPriorityQueue_create_with_allocator(cpq, member_size, comparator, shard_count, Allocator_default());
+}
+
+ConcurrentPriorityQueueError ConcurrentPriorityQueue_create_with_allocator(ConcurrentPriorityQueue *cpq, size_t member_size, int (*comparator)(void *, void *), size_t shard_count, const Allocator *allocator) {
+	if (!shard_count) shard_count = 1;
+	void *shards;
+	if (posix_memalign(&shards, CACHE_LINE_SIZE, shard_count * sizeof(union _CPQShard)))
+		return CPQ_ERR_OOM;
+	cpq->_shards = (union _CPQShard *) shards;
+	cpq->shard_count = shard_count;
+	cpq->member_size = member_size;
+
+	for (size_t i = 0; i < shard_count; ++i) {
+		struct _CPQShardData *shard = _ConcurrentPriorityQueue_shard(cpq, i);
+		if (pthread_mutex_init(&shard->lock, NULL)) {
+			cpq->shard_count = i;
+			ConcurrentPriorityQueue_invalidate(cpq);
+			return CPQ_ERR_OOM;
+		}
+		if (PriorityQueue_create_with_allocator(&shard->pq, member_size, comparator, allocator)) {
+			pthread_mutex_destroy(&shard->lock);
+			cpq->shard_count = i;
+			ConcurrentPriorityQueue_invalidate(cpq);
+			return CPQ_ERR_OOM;
+		}
+	}
+	return CPQ_ERR_SUCCESS;
+}
+
+void ConcurrentPriorityQueue_invalidate(ConcurrentPriorityQueue *cpq) {
+	for (size_t i = 0; i < cpq->shard_count; ++i) {
+		struct _CPQShardData *shard = _ConcurrentPriorityQueue_shard(cpq, i);
+		PriorityQueue_invalidate(&shard->pq);
+		pthread_mutex_destroy(&shard->lock);
+	}
+	free(cpq->_shards);
+	cpq->_shards = NULL;
+	cpq->shard_count = 0;
+}
+
+size_t ConcurrentPriorityQueue_size(ConcurrentPriorityQueue *cpq) {
+	size_t size = 0;
+	for (size_t i = 0; i < cpq->shard_count; ++i) {
+		struct _CPQShardData *shard = _ConcurrentPriorityQueue_shard(cpq, i);
+		pthread_mutex_lock(&shard->lock);
+		size += PriorityQueue_size(&shard->pq);
+		pthread_mutex_unlock(&shard->lock);
+	}
+	return size;
+}
+
+ConcurrentPriorityQueueError ConcurrentPriorityQueue_push(ConcurrentPriorityQueue *cpq, void *data) {
+	// Prefer any uncontended shard; block only after a full round of busy ones.
+	struct _CPQShardData *shard = NULL;
+	for (size_t attempt = 0; attempt < cpq->shard_count && !shard; ++attempt) {
+		shard = _ConcurrentPriorityQueue_shard(cpq, _ConcurrentPriorityQueue_random(cpq->shard_count));
+		if (pthread_mutex_trylock(&shard->lock))
+			shard = NULL;
+	}
+	if (!shard) {
+		shard = _ConcurrentPriorityQueue_shard(cpq, _ConcurrentPriorityQueue_random(cpq->shard_count));
+		pthread_mutex_lock(&shard->lock);
+	}
+
+	PriorityQueueError result = PriorityQueue_push(&shard->pq, data);
+	pthread_mutex_unlock(&shard->lock);
+	return result ? CPQ_ERR_OOM : CPQ_ERR_SUCCESS;
+}
+
+// Pops from the better of two locked shards. Returns false if both are empty.
+static bool _ConcurrentPriorityQueue_pop_better(struct _CPQShardData *a, struct _CPQShardData *b, void *out) {
+	struct _CPQShardData *best = a;
+	if (!PriorityQueue_size(&a->pq))
+		best = b;
+	else if (PriorityQueue_size(&b->pq) && a->pq.comparator(PriorityQueue_top(&b->pq), PriorityQueue_top(&a->pq)) < 0)
+		best = b;
+	return PriorityQueue_pop_into(&best->pq, out) == PQ_ERR_SUCCESS;
+}
+
+ConcurrentPriorityQueueError ConcurrentPriorityQueue_try_pop(ConcurrentPriorityQueue *cpq, void *out) {
+	size_t n = cpq->shard_count;
+	if (n > 1) {
+		for (size_t attempt = 0; attempt < n; ++attempt) {
+			size_t i = _ConcurrentPriorityQueue_random(n);
+			size_t j = _ConcurrentPriorityQueue_random(n - 1);
+			if (j >= i) ++j;
+			struct _CPQShardData *a = _ConcurrentPriorityQueue_shard(cpq, i);
+			struct _CPQShardData *b = _ConcurrentPriorityQueue_shard(cpq, j);
+			if (pthread_mutex_trylock(&a->lock)) continue;
+			if (pthread_mutex_trylock(&b->lock)) {
+				pthread_mutex_unlock(&a->lock);
+				continue;
+			}
+			bool popped = _ConcurrentPriorityQueue_pop_better(a, b, out);
+			pthread_mutex_unlock(&b->lock);
+			pthread_mutex_unlock(&a->lock);
+			if (popped) return CPQ_ERR_SUCCESS;
+			break; // both samples empty: the queue may be nearly drained
+		}
+	}
+
+	// Sweep every shard once, holding one lock at a time, before declaring the queue empty.
+	size_t start = n > 1 ? _ConcurrentPriorityQueue_random(n) : 0;
+	for (size_t k = 0; k < n; ++k) {
+		struct _CPQShardData *shard = _ConcurrentPriorityQueue_shard(cpq, (start + k) % n);
+		pthread_mutex_lock(&shard->lock);
+		PriorityQueueError result = PriorityQueue_pop_into(&shard->pq, out);
+		pthread_mutex_unlock(&shard->lock);
+		if (!result) return CPQ_ERR_SUCCESS;
+	}
+	return CPQ_ERR_EMPTY_POP_BACK;
+}
@@ -0,0 +1,116 @@
+#include "hmap.h"
+#include "error.h"
+#include "hset.h"
+#include "utility.h"
+#include <stdlib.h>
+#include <string.h>
+
+Errable(HashMap) HashMap_init(size_t key_size, size_t value_size, size_t (*hash)(void *), int (*comparator)(void *, void *)) {
+	return HashMap_init_with_allocator(key_size, value_size, hash, comparator, Allocator_default());
+}
+
+Errable(HashMap) HashMap_init_with_allocator(size_t key_size, size_t value_size, size_t (*hash)(void *), int (*comparator)(void *, void *), const Allocator *allocator) {
+	HashMap hm = {
+		._key_size = key_size,
+		._value_size = value_size,
+	};
+	HashMapError result;
+	if ((result = HashMap_create_with_allocator(&hm, key_size, value_size, hash, comparator, allocator)))
+		return Err(result, HashMap);
+	return Ok(hm, HashMap);
+}
+
+HashMapError HashMap_create(HashMap *hm, size_t key_size, size_t value_size, size_t (*hash)(void *), int (*comparator)(void *, void *)) {
+	return HashMap_create_with_allocator(hm, key_size, value_size, hash, comparator, Allocator_default());
+}
+
+HashMapError HashMap_create_with_allocator(HashMap *hm, size_t key_size, size_t value_size, size_t (*hash)(void *), int (*comparator)(void *, void *), const Allocator *allocator) {
+	EntryLayout layout = EntryLayout_of(key_size, value_size);
+	*((size_t *) &hm->_key_size) = key_size;
+	*((size_t *) &hm->_value_size) = value_size;
+	*((size_t *) &hm->_value_offset) = layout.value_offset;
+	return (HashMapError) HashSet_create_with_allocator(&hm->_set, layout.stride, hash, comparator, allocator);
+}
+
+void HashMap_invalidate(HashMap *hm) {
+	HashSet_invalidate(&hm->_set);
+}
+
+void HashMap_custom_invalidate(HashMap *hm, void (*destructor)(void *, void *)) {
+	for (void *it = HashMap_begin(hm); it; it = HashMap_next(hm, it))
+		destructor(HashMap_entry_key(hm, it), HashMap_entry_value(hm, it));
+	HashMap_invalidate(hm);
+}
+
+void HashMap_clear(HashMap *hm) {
+	HashSet_clear(&hm->_set);
+}
+
+size_t HashMap_size(HashMap *hm) {
+	return HashSet_size(&hm->_set);
+}
+
+HashMapError HashMap_reserve(HashMap *hm, size_t n) {
+	return (HashMapError) HashSet_reserve(&hm->_set, n);
+}
+
+HashMapError HashMap_insert(HashMap *hm, void *key, void *value) {
+	HMEmplacePair pair = HashMap_emplace(hm, key, value);
+	if (!pair.value) return HM_ERR_OOM;
+	return pair.inserted ? HM_ERR_SUCCESS : HM_ERR_EXISTS;
+}
+
+HashMapError HashMap_put(HashMap *hm, void *key, void *value) {
+	HMEmplacePair pair = HashMap_emplace(hm, key, value);
+	if (!pair.value) return HM_ERR_OOM;
+	if (!pair.inserted)
+		memcpy(pair.value, value, hm->_value_size);
+	return HM_ERR_SUCCESS;
+}
+
+HMEmplacePair HashMap_emplace(HashMap *hm, void *key, void *value) {
+	HSEmplacePair pair = _HashSet_prepare_insert(&hm->_set, key);
+	if (!pair.element)
+		return (HMEmplacePair) { .value = NULL, .inserted = false };
+
+	void *slot = HashMap_entry_value(hm, pair.element);
+	if (pair.inserted) {
+		memcpy(pair.element, key, hm->_key_size);
+		if (value) memcpy(slot, value, hm->_value_size);
+	}
+	return (HMEmplacePair) {
+		.value = slot,
+		.inserted = pair.inserted,
+	};
+}
+
+void *HashMap_get(HashMap *hm, void *key) {
+	void *entry = HashSet_find(&hm->_set, key);
+	if (!entry) return NULL;
+	return HashMap_entry_value(hm, entry);
+}
+
+bool HashMap_contains(HashMap *hm, void *key) {
+	return HashSet_contains(&hm->_set, key);
+}
+
+bool HashMap_remove(HashMap *hm, void *key) {
+	return HashSet_remove(&hm->_set, key);
+}
+
+void *HashMap_begin(HashMap *hm) {
+	return HashSet_begin(&hm->_set);
+}
+
+void *HashMap_next(HashMap *hm, void *entry) {
+	return HashSet_next(&hm->_set, entry);
+}
+
+void *HashMap_entry_key(HashMap *hm, void *entry) {
+	(void) hm;
+	return entry;
+}
+
+void *HashMap_entry_value(HashMap *hm, void *entry) {
+	return ((char *) entry) + hm->_value_offset;
+}
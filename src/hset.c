@@ -0,0 +1,344 @@
+#include "hset.h"
+#include "error.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define HS_NPOS ((size_t) -1)
+
+static uint64_t _HashSet_mix(uint64_t x) {
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
+}
+
+static unsigned _HashSet_ctz(unsigned mask) {
+#if defined(__GNUC__)
+	return (unsigned) __builtin_ctz(mask);
+#else
+	unsigned n = 0;
+	while (!(mask & 1u)) {
+		mask >>= 1;
+		++n;
+	}
+	return n;
+#endif
+}
+
+// Bit i of each mask is set when control byte i of the group satisfies the predicate.
+
+static unsigned _HashSet_group_match(const int8_t *group, int8_t h2) {
+#if defined(__SSE2__)
+	__m128i ctrl = _mm_loadu_si128((const __m128i *) group);
+	return (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+#else
+	unsigned mask = 0;
+	for (unsigned i = 0; i < HS_GROUP_WIDTH; ++i)
+		mask |= (unsigned) (group[i] == h2) << i;
+	return mask;
+#endif
+}
+
+static unsigned _HashSet_group_match_empty(const int8_t *group) {
+	return _HashSet_group_match(group, HS_CTRL_EMPTY);
+}
+
+static unsigned _HashSet_group_match_free(const int8_t *group) {
+#if defined(__SSE2__)
+	// EMPTY and DELETED are the only control values with the sign bit set.
+	return (unsigned) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) group));
+#else
+	unsigned mask = 0;
+	for (unsigned i = 0; i < HS_GROUP_WIDTH; ++i)
+		mask |= (unsigned) (group[i] < 0) << i;
+	return mask;
+#endif
+}
+
+static size_t _HashSet_max_load(size_t capacity) {
+	return capacity - capacity / 8;
+}
+
+static void *_HashSet_slot(const HashSet *hs, size_t index) {
+	return hs->_slots + (index * hs->_member_size);
+}
+
+static size_t _HashSet_find_index(HashSet *hs, void *probe, uint64_t hash) {
+	if (hs->_capacity == 0) return HS_NPOS;
+
+	size_t groups_mask = hs->_capacity / HS_GROUP_WIDTH - 1;
+	size_t group = (size_t) (hash >> 7) & groups_mask;
+	int8_t h2 = (int8_t) (hash & 0x7f);
+	for (size_t step = 1;; ++step) {
+		const int8_t *ctrl = hs->_ctrl + (group * HS_GROUP_WIDTH);
+		for (unsigned mask = _HashSet_group_match(ctrl, h2); mask; mask &= mask - 1) {
+			size_t index = (group * HS_GROUP_WIDTH) + _HashSet_ctz(mask);
+			if (hs->_comparator(probe, _HashSet_slot(hs, index)) == 0)
+				return index;
+		}
+		if (_HashSet_group_match_empty(ctrl))
+			return HS_NPOS;
+		// Triangular probing visits every group exactly once for power of two group counts.
+		group = (group + step) & groups_mask;
+	}
+}
+
+static size_t _HashSet_find_free(HashSet *hs, uint64_t hash) {
+	size_t groups_mask = hs->_capacity / HS_GROUP_WIDTH - 1;
+	size_t group = (size_t) (hash >> 7) & groups_mask;
+	for (size_t step = 1;; ++step) {
+		unsigned mask = _HashSet_group_match_free(hs->_ctrl + (group * HS_GROUP_WIDTH));
+		if (mask)
+			return (group * HS_GROUP_WIDTH) + _HashSet_ctz(mask);
+		group = (group + step) & groups_mask;
+	}
+}
+
+static size_t _HashSet_block_bytes(const HashSet *hs, size_t capacity) {
+	return capacity + (capacity * hs->_member_size);
+}
+
+static HashSetError _HashSet_resize(HashSet *hs, size_t capacity) {
+	char *block = (char *) Allocator_alloc(hs->_allocator, _HashSet_block_bytes(hs, capacity));
+	if (!block) return HS_ERR_OOM;
+
+	HashSet old = *hs;
+	hs->_ctrl = (int8_t *) block;
+	hs->_slots = block + capacity;
+	hs->_capacity = capacity;
+	memset(hs->_ctrl, (unsigned char) HS_CTRL_EMPTY, capacity);
+
+	for (size_t i = 0; i < old._capacity; ++i) {
+		if (old._ctrl[i] < 0) continue;
+		void *element = _HashSet_slot(&old, i);
+		uint64_t hash = _HashSet_mix(hs->_hash(element));
+		size_t index = _HashSet_find_free(hs, hash);
+		hs->_ctrl[index] = (int8_t) (hash & 0x7f);
+		memcpy(_HashSet_slot(hs, index), element, hs->_member_size);
+	}
+	hs->_growth_left = _HashSet_max_load(capacity) - hs->size;
+
+	Allocator_free(hs->_allocator, old._ctrl, _HashSet_block_bytes(&old, old._capacity));
+	return HS_ERR_SUCCESS;
+}
+
+static HashSetError _HashSet_grow(HashSet *hs) {
+	if (hs->_capacity == 0)
+		return _HashSet_resize(hs, HS_GROUP_WIDTH);
+	// Mostly tombstones: rehash in place instead of doubling.
+	if (hs->size <= _HashSet_max_load(hs->_capacity) / 2)
+		return _HashSet_resize(hs, hs->_capacity);
+	return _HashSet_resize(hs, hs->_capacity * 2);
+}
+
+Errable(HashSet) HashSet_init(size_t member_size, size_t (*hash)(void *), int (*comparator)(void *, void *)) {
+	return HashSet_init_with_allocator(member_size, hash, comparator, Allocator_default());
+}
+
+Errable(HashSet) HashSet_init_with_allocator(size_t member_size, size_t (*hash)(void *), int (*comparator)(void *, void *), const Allocator *allocator) {
+	HashSet hs = { ._member_size = member_size };
+	HashSetError result;
+	if ((result = HashSet_create_with_allocator(&hs, member_size, hash, comparator, allocator)))
+		return Err(result, HashSet);
+	return Ok(hs, HashSet);
+}
+
+HashSetError HashSet_create(HashSet *hs, size_t member_size, size_t (*hash)(void *), int (*comparator)(void *, void *)) {
+	return HashSet_create_with_allocator(hs, member_size, hash, comparator, Allocator_default());
+}
+
+HashSetError HashSet_create_with_allocator(HashSet *hs, size_t member_size, size_t (*hash)(void *), int (*comparator)(void *, void *), const Allocator *allocator) {
+	*((size_t *) &hs->_member_size) = member_size;
+	hs->_allocator = allocator;
+	hs->_hash = hash;
+	hs->_comparator = comparator;
+	hs->_ctrl = NULL;
+	hs->_slots = NULL;
+	hs->_capacity = 0;
+	hs->_growth_left = 0;
+	hs->size = 0;
+	return _HashSet_resize(hs, HS_GROUP_WIDTH);
+}
+
+HashSetError HashSet_cpy(HashSet *dest, const HashSet *src) {
+	char *block = NULL;
+	if (src->_capacity) {
+		block = (char *) Allocator_alloc(dest->_allocator, _HashSet_block_bytes(src, src->_capacity));
+		if (!block) return HS_ERR_OOM;
+		memcpy(block, src->_ctrl, _HashSet_block_bytes(src, src->_capacity));
+	}
+
+	HashSet_invalidate(dest);
+	dest->_ctrl = (int8_t *) block;
+	dest->_slots = block ? block + src->_capacity : NULL;
+	dest->size = src->size;
+	dest->_capacity = src->_capacity;
+	dest->_growth_left = src->_growth_left;
+	dest->_hash = src->_hash;
+	dest->_comparator = src->_comparator;
+	*((size_t *) &dest->_member_size) = src->_member_size;
+	return HS_ERR_SUCCESS;
+}
+
+void HashSet_mv(HashSet *dest, HashSet *src) {
+	HashSet_invalidate(dest);
+
+	dest->_ctrl = src->_ctrl;
+	dest->_slots = src->_slots;
+	dest->size = src->size;
+	dest->_capacity = src->_capacity;
+	dest->_growth_left = src->_growth_left;
+	dest->_hash = src->_hash;
+	dest->_comparator = src->_comparator;
+	*((size_t *) &dest->_member_size) = src->_member_size;
+	dest->_allocator = src->_allocator;
+
+	src->_ctrl = NULL;
+	src->_slots = NULL;
+	src->size = 0;
+	src->_capacity = 0;
+	src->_growth_left = 0;
+}
+
+void HashSet_invalidate(HashSet *hs) {
+	Allocator_free(hs->_allocator, hs->_ctrl, _HashSet_block_bytes(hs, hs->_capacity));
+	hs->_ctrl = NULL;
+	hs->_slots = NULL;
+	hs->size = 0;
+	hs->_capacity = 0;
+	hs->_growth_left = 0;
+}
+
+void HashSet_custom_invalidate(HashSet *hs, void (*destructor)(void *)) {
+	for (void *it = HashSet_begin(hs); it; it = HashSet_next(hs, it))
+		destructor(it);
+	HashSet_invalidate(hs);
+}
+
+void HashSet_clear(HashSet *hs) {
+	if (hs->_capacity)
+		memset(hs->_ctrl, (unsigned char) HS_CTRL_EMPTY, hs->_capacity);
+	hs->size = 0;
+	hs->_growth_left = _HashSet_max_load(hs->_capacity);
+}
+
+size_t HashSet_size(HashSet *hs) {
+	return hs->size;
+}
+
+HashSetError HashSet_reserve(HashSet *hs, size_t n) {
+	size_t capacity = HS_GROUP_WIDTH;
+	while (_HashSet_max_load(capacity) < n)
+		capacity *= 2;
+	if (capacity <= hs->_capacity) return HS_ERR_SUCCESS;
+	return _HashSet_resize(hs, capacity);
+}
+
+HSEmplacePair _HashSet_prepare_insert(HashSet *hs, void *probe) {
+	uint64_t hash = _HashSet_mix(hs->_hash(probe));
+	size_t index = _HashSet_find_index(hs, probe, hash);
+	if (index != HS_NPOS)
+		return (HSEmplacePair) {
+			.element = _HashSet_slot(hs, index),
+			.inserted = false,
+		};
+
+	if (hs->_capacity == 0 && _HashSet_grow(hs))
+		return (HSEmplacePair) { .element = NULL, .inserted = false };
+	index = _HashSet_find_free(hs, hash);
+	if (hs->_growth_left == 0 && hs->_ctrl[index] == HS_CTRL_EMPTY) {
+		if (_HashSet_grow(hs))
+			return (HSEmplacePair) { .element = NULL, .inserted = false };
+		index = _HashSet_find_free(hs, hash);
+	}
+
+	if (hs->_ctrl[index] == HS_CTRL_EMPTY)
+		--hs->_growth_left;
+	hs->_ctrl[index] = (int8_t) (hash & 0x7f);
+	++hs->size;
+	return (HSEmplacePair) {
+		.element = _HashSet_slot(hs, index),
+		.inserted = true,
+	};
+}
+
+HashSetError HashSet_insert(HashSet *hs, void *data) {
+	HSEmplacePair pair = HashSet_emplace(hs, data);
+	if (!pair.element) return HS_ERR_OOM;
+	return pair.inserted ? HS_ERR_SUCCESS : HS_ERR_EXISTS;
+}
+
+HSEmplacePair HashSet_emplace(HashSet *hs, void *data) {
+	HSEmplacePair pair = _HashSet_prepare_insert(hs, data);
+	if (pair.inserted)
+		memcpy(pair.element, data, hs->_member_size);
+	return pair;
+}
+
+void *HashSet_find(HashSet *hs, void *data) {
+	size_t index = _HashSet_find_index(hs, data, _HashSet_mix(hs->_hash(data)));
+	if (index == HS_NPOS) return NULL;
+	return _HashSet_slot(hs, index);
+}
+
+bool HashSet_contains(HashSet *hs, void *data) {
+	return HashSet_find(hs, data) != NULL;
+}
+
+bool HashSet_remove(HashSet *hs, void *data) {
+	void *element = HashSet_find(hs, data);
+	if (!element) return false;
+	HashSet_erase(hs, element);
+	return true;
+}
+
+void HashSet_erase(HashSet *hs, void *element) {
+	size_t index = (size_t) ((char *) element - hs->_slots) / hs->_member_size;
+	// A probe that reaches this group stops at its EMPTY slot anyway, so no tombstone is needed.
+	const int8_t *group = hs->_ctrl + (index - index % HS_GROUP_WIDTH);
+	if (_HashSet_group_match_empty(group)) {
+		hs->_ctrl[index] = HS_CTRL_EMPTY;
+		++hs->_growth_left;
+	} else {
+		hs->_ctrl[index] = HS_CTRL_DELETED;
+	}
+	--hs->size;
+}
+
+static void *_HashSet_scan(HashSet *hs, size_t index) {
+	for (; index < hs->_capacity; ++index)
+		if (hs->_ctrl[index] >= 0)
+			return _HashSet_slot(hs, index);
+	return NULL;
+}
+
+void *HashSet_begin(HashSet *hs) {
+	return _HashSet_scan(hs, 0);
+}
+
+void *HashSet_next(HashSet *hs, void *element) {
+	size_t index = (size_t) ((char *) element - hs->_slots) / hs->_member_size;
+	return _HashSet_scan(hs, index + 1);
+}
+
+size_t HashSet_hash_bytes(const void *data, size_t len) {
+	const unsigned char *p = (const unsigned char *) data;
+	uint64_t h = 0x9e3779b97f4a7c15ULL ^ (uint64_t) len;
+	uint64_t k;
+	while (len >= 8) {
+		memcpy(&k, p, 8);
+		h = (h ^ _HashSet_mix(k)) * 0x9e3779b97f4a7c15ULL;
+		p += 8;
+		len -= 8;
+	}
+	k = 0;
+	memcpy(&k, p, len);
+	h ^= _HashSet_mix(k);
+	return (size_t) _HashSet_mix(h);
+}
@@ -0,0 +1,200 @@
+#include "ipqueue.h"
+#include "error.h"
+#include "vector.h"
+#include <string.h>
+
+Errable(IndexedPriorityQueue) IndexedPriorityQueue_init(size_t member_size, int (*comparator)(void *, void *)) {
+	return IndexedPriorityQueue_init_with_allocator(member_size, comparator, Allocator_default());
+}
+
+Errable(IndexedPriorityQueue) IndexedPriorityQueue_init_with_allocator(size_t member_size, int (*comparator)(void *, void *), const Allocator *allocator) {
+	IndexedPriorityQueue ipq;
+	IndexedPriorityQueueError result;
+	if ((result = IndexedPriorityQueue_create_with_allocator(&ipq, member_size, comparator, allocator)))
+		return Err(result, IndexedPriorityQueue);
+	return Ok(ipq, IndexedPriorityQueue);
+}
+
+IndexedPriorityQueueError IndexedPriorityQueue_create(IndexedPriorityQueue *ipq, size_t member_size, int (*comparator)(void *, void *)) {
+	return IndexedPriorityQueue_create_with_allocator(ipq, member_size, comparator, Allocator_default());
+}
+
+IndexedPriorityQueueError IndexedPriorityQueue_create_with_allocator(IndexedPriorityQueue *ipq, size_t member_size, int (*comparator)(void *, void *), const Allocator *allocator) {
+	ipq->comparator = comparator;
+	ipq->arity = PQ_DEFAULT_ARITY;
+	Vector_default_with_allocator(&ipq->_heap, sizeof(IPQHandle), allocator);
+	Vector_default_with_allocator(&ipq->_positions, sizeof(size_t), allocator);
+	Vector_default_with_allocator(&ipq->_free, sizeof(IPQHandle), allocator);
+	if (Vector_create_with_allocator(&ipq->_elements, member_size, allocator))
+		return IPQ_ERR_OOM;
+	return IPQ_ERR_SUCCESS;
+}
+
+void IndexedPriorityQueue_invalidate(IndexedPriorityQueue *ipq) {
+	Vector_invalidate(&ipq->_elements);
+	Vector_invalidate(&ipq->_heap);
+	Vector_invalidate(&ipq->_positions);
+	Vector_invalidate(&ipq->_free);
+	ipq->comparator = NULL;
+}
+
+void IndexedPriorityQueue_clear(IndexedPriorityQueue *ipq) {
+	Vector_clear(&ipq->_elements);
+	Vector_clear(&ipq->_heap);
+	Vector_clear(&ipq->_positions);
+	Vector_clear(&ipq->_free);
+}
+
+size_t IndexedPriorityQueue_size(IndexedPriorityQueue *ipq) {
+	return Vector_size(&ipq->_heap);
+}
+
+static IPQHandle *_IndexedPriorityQueue_heap(IndexedPriorityQueue *ipq) {
+	return Vector_data(&ipq->_heap, IPQHandle);
+}
+
+static size_t *_IndexedPriorityQueue_positions(IndexedPriorityQueue *ipq) {
+	return Vector_data(&ipq->_positions, size_t);
+}
+
+// The heap holds handles; compare the elements they refer to.
+static int _IndexedPriorityQueue_compare(void *context, void *a, void *b) {
+	IndexedPriorityQueue *ipq = (IndexedPriorityQueue *) context;
+	return ipq->comparator(Vector_offset(&ipq->_elements, *(IPQHandle *) a), Vector_offset(&ipq->_elements, *(IPQHandle *) b));
+}
+
+static void _IndexedPriorityQueue_placed(void *context, void *slot, size_t index) {
+	_IndexedPriorityQueue_positions((IndexedPriorityQueue *) context)[*(IPQHandle *) slot] = index;
+}
+
+// PriorityQueue's hole-moving sifts over handles, keeping the position map in step.
+static _PriorityQueueSift _IndexedPriorityQueue_sift(IndexedPriorityQueue *ipq) {
+	return (_PriorityQueueSift) {
+		.base = (char *) _IndexedPriorityQueue_heap(ipq),
+		.member_size = sizeof(IPQHandle),
+		.size = IndexedPriorityQueue_size(ipq),
+		.arity = ipq->arity,
+		.compare = _IndexedPriorityQueue_compare,
+		.placed = _IndexedPriorityQueue_placed,
+		.context = ipq,
+	};
+}
+
+void IndexedPriorityQueue_set_arity(IndexedPriorityQueue *ipq, size_t arity) {
+	ipq->arity = arity < 2 ? 2 : arity;
+	size_t size = IndexedPriorityQueue_size(ipq);
+	if (size < 2) return;
+	_PriorityQueueSift sift = _IndexedPriorityQueue_sift(ipq);
+	for (size_t i = (size - 2) / ipq->arity + 1; i-- > 0;)
+		(void) _PriorityQueue_sift_down(&sift, i);
+}
+
+static IndexedPriorityQueueError _IndexedPriorityQueue_new_handle(IndexedPriorityQueue *ipq, IPQHandle *handle) {
+	if (Vector_size(&ipq->_free)) {
+		*handle = Vector_get(&ipq->_free, Vector_size(&ipq->_free) - 1, IPQHandle);
+		(void) Vector_pop_back(&ipq->_free);
+		return IPQ_ERR_SUCCESS;
+	}
+
+	size_t npos = IPQ_NPOS;
+	*handle = Vector_size(&ipq->_elements);
+	if (!Vector_append_uninit(&ipq->_elements, 1))
+		return IPQ_ERR_OOM;
+	if (Vector_append(&ipq->_positions, &npos)) {
+		(void) Vector_pop_back(&ipq->_elements);
+		return IPQ_ERR_OOM;
+	}
+	// Keep room to free every handle, so removal can never fail.
+	if (Vector_reserve(&ipq->_free, Vector_capacity(&ipq->_elements))) {
+		(void) Vector_pop_back(&ipq->_positions);
+		(void) Vector_pop_back(&ipq->_elements);
+		return IPQ_ERR_OOM;
+	}
+	return IPQ_ERR_SUCCESS;
+}
+
+IndexedPriorityQueueError IndexedPriorityQueue_push(IndexedPriorityQueue *ipq, void *data, IPQHandle *handle) {
+	// Grow the heap first: a claimed handle can always be given back, a heap slot cannot fail later.
+	if (!Vector_append_uninit(&ipq->_heap, 1))
+		return IPQ_ERR_OOM;
+
+	IPQHandle h;
+	if (_IndexedPriorityQueue_new_handle(ipq, &h)) {
+		(void) Vector_pop_back(&ipq->_heap);
+		return IPQ_ERR_OOM;
+	}
+
+	memcpy(Vector_offset(&ipq->_elements, h), data, Vector_member_size(&ipq->_elements));
+	size_t index = IndexedPriorityQueue_size(ipq) - 1;
+	_IndexedPriorityQueue_heap(ipq)[index] = h;
+	_PriorityQueueSift sift = _IndexedPriorityQueue_sift(ipq);
+	(void) _PriorityQueue_sift_up(&sift, index);
+	if (handle) *handle = h;
+	return IPQ_ERR_SUCCESS;
+}
+
+bool IndexedPriorityQueue_contains(IndexedPriorityQueue *ipq, IPQHandle handle) {
+	return handle < Vector_size(&ipq->_positions) && _IndexedPriorityQueue_positions(ipq)[handle] != IPQ_NPOS;
+}
+
+void *IndexedPriorityQueue_get(IndexedPriorityQueue *ipq, IPQHandle handle) {
+	if (!IndexedPriorityQueue_contains(ipq, handle)) return NULL;
+	return Vector_offset(&ipq->_elements, handle);
+}
+
+IndexedPriorityQueueError IndexedPriorityQueue_update(IndexedPriorityQueue *ipq, IPQHandle handle, void *data) {
+	if (!IndexedPriorityQueue_contains(ipq, handle)) return IPQ_ERR_INVALID_HANDLE;
+	memcpy(Vector_offset(&ipq->_elements, handle), data, Vector_member_size(&ipq->_elements));
+	return IndexedPriorityQueue_update_priority(ipq, handle);
+}
+
+IndexedPriorityQueueError IndexedPriorityQueue_update_priority(IndexedPriorityQueue *ipq, IPQHandle handle) {
+	if (!IndexedPriorityQueue_contains(ipq, handle)) return IPQ_ERR_INVALID_HANDLE;
+	_PriorityQueueSift sift = _IndexedPriorityQueue_sift(ipq);
+	size_t index = _PriorityQueue_sift_up(&sift, _IndexedPriorityQueue_positions(ipq)[handle]);
+	(void) _PriorityQueue_sift_down(&sift, index);
+	return IPQ_ERR_SUCCESS;
+}
+
+IndexedPriorityQueueError IndexedPriorityQueue_remove(IndexedPriorityQueue *ipq, IPQHandle handle) {
+	if (!IndexedPriorityQueue_contains(ipq, handle)) return IPQ_ERR_INVALID_HANDLE;
+	IPQHandle *heap = _IndexedPriorityQueue_heap(ipq);
+	size_t *positions = _IndexedPriorityQueue_positions(ipq);
+	size_t index = positions[handle];
+	size_t last = IndexedPriorityQueue_size(ipq) - 1;
+
+	positions[handle] = IPQ_NPOS;
+	(void) Vector_append(&ipq->_free, &handle); // capacity reserved when the handle was created
+	(void) Vector_pop_back(&ipq->_heap);
+	if (index == last) return IPQ_ERR_SUCCESS;
+
+	// The last element fills the hole and may need to move either way.
+	IPQHandle moved = heap[last];
+	heap[index] = moved;
+	positions[moved] = index;
+	_PriorityQueueSift sift = _IndexedPriorityQueue_sift(ipq);
+	(void) _PriorityQueue_sift_down(&sift, _PriorityQueue_sift_up(&sift, index));
+	return IPQ_ERR_SUCCESS;
+}
+
+IPQHandle IndexedPriorityQueue_top_handle(IndexedPriorityQueue *ipq) {
+	if (IndexedPriorityQueue_size(ipq) == 0) return IPQ_NPOS;
+	return _IndexedPriorityQueue_heap(ipq)[0];
+}
+
+void *IndexedPriorityQueue_top(IndexedPriorityQueue *ipq) {
+	if (IndexedPriorityQueue_size(ipq) == 0) return NULL;
+	return Vector_offset(&ipq->_elements, _IndexedPriorityQueue_heap(ipq)[0]);
+}
+
+void IndexedPriorityQueue_pop(IndexedPriorityQueue *ipq) {
+	if (IndexedPriorityQueue_size(ipq) == 0) return;
+	(void) IndexedPriorityQueue_remove(ipq, _IndexedPriorityQueue_heap(ipq)[0]);
+}
+
+IndexedPriorityQueueError IndexedPriorityQueue_pop_into(IndexedPriorityQueue *ipq, void *out) {
+	if (IndexedPriorityQueue_size(ipq) == 0) return IPQ_ERR_EMPTY_POP_BACK;
+	memcpy(out, IndexedPriorityQueue_top(ipq), Vector_member_size(&ipq->_elements));
+	IndexedPriorityQueue_pop(ipq);
+	return IPQ_ERR_SUCCESS;
+}
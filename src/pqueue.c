@@ -4,28 +4,68 @@
 #include <string.h>
 
 Errable(PriorityQueue) PriorityQueue_init(size_t member_size, int (*comparator)(void *, void *)) {
+	return PriorityQueue_init_with_allocator(member_size, comparator, Allocator_default());
+}
+
+Errable(PriorityQueue) PriorityQueue_init_with_allocator(size_t member_size, int (*comparator)(void *, void *), const Allocator *allocator) {
 	PriorityQueue pq;
 	PriorityQueueError result;
-	if ((result = PriorityQueue_create(&pq, member_size, comparator)))
+	if ((result = PriorityQueue_create_with_allocator(&pq, member_size, comparator, allocator)))
 		return Err(result, PriorityQueue);
 	return Ok(pq, PriorityQueue);
 }
 
 PriorityQueueError PriorityQueue_create(PriorityQueue *pq, size_t member_size, int (*comparator)(void *, void *)) {
+	return PriorityQueue_create_with_allocator(pq, member_size, comparator, Allocator_default());
+}
+
+PriorityQueueError PriorityQueue_create_with_allocator(PriorityQueue *pq, size_t member_size, int (*comparator)(void *, void *), const Allocator *allocator) {
+	pq->comparator = comparator;
+	pq->arity = PQ_DEFAULT_ARITY;
+	return (PriorityQueueError) Vector_create_with_allocator(&pq->vec, member_size, allocator);
+}
+
+Errable(PriorityQueue) PriorityQueue_init_with_arity(size_t member_size, int (*comparator)(void *, void *), size_t arity) {
+	PriorityQueue pq;
+	PriorityQueueError result;
+	if ((result = PriorityQueue_create_with_arity(&pq, member_size, comparator, arity)))
+		return Err(result, PriorityQueue);
+	return Ok(pq, PriorityQueue);
+}
+
+PriorityQueueError PriorityQueue_create_with_arity(PriorityQueue *pq, size_t member_size, int (*comparator)(void *, void *), size_t arity) {
+	PriorityQueueError result;
+	if ((result = PriorityQueue_create(pq, member_size, comparator)))
+		return result;
+	PriorityQueue_set_arity(pq, arity);
+	return PQ_ERR_SUCCESS;
+}
+
+void PriorityQueue_from_vector(PriorityQueue *pq, Vector *v, int (*comparator)(void *, void *)) {
 	pq->comparator = comparator;
-	return (PriorityQueueError) Vector_create(&pq->vec, member_size);
+	pq->arity = PQ_DEFAULT_ARITY;
+	Vector_default(&pq->vec, Vector_member_size(v));
+	Vector_mv(&pq->vec, v);
+	_PriorityQueue_heapify(pq);
 }
 
 PriorityQueueError PriorityQueue_cpy(PriorityQueue *dest, const PriorityQueue *src) {
 	dest->comparator = src->comparator;
+	dest->arity = src->arity;
 	return (PriorityQueueError) Vector_cpy(&dest->vec, &src->vec);
 }
 
 void PriorityQueue_mv(PriorityQueue *dest, PriorityQueue *src) {
 	dest->comparator = src->comparator;
+	dest->arity = src->arity;
 	Vector_mv(&dest->vec, &src->vec); // invalidates src implicitly
 }
 
+void PriorityQueue_set_arity(PriorityQueue *pq, size_t arity) {
+	pq->arity = arity < 2 ? 2 : arity;
+	_PriorityQueue_heapify(pq);
+}
+
 void PriorityQueue_invalidate(PriorityQueue *pq) {
 	Vector_invalidate(&pq->vec);
 	pq->comparator = NULL;
@@ -58,29 +98,91 @@ int _PriorityQueue_compare(PriorityQueue *pq, size_t index_a, size_t index_b) {
 	return pq->comparator(a, b);
 }
 
-void _PriorityQueue_heapify_up(PriorityQueue *pq, size_t index) {
-	if (index == 0) return;
-	size_t parent = (index - 1) / 2;
-	if (_PriorityQueue_compare(pq, index, parent) < 0) {
-		Vector_swap(&pq->vec, index, parent);
-		_PriorityQueue_heapify_up(pq, parent);
+// Both sifts move a hole instead of swapping: the sifted element is held aside
+// and written once, so each level costs one element copy rather than three.
+
+static void _PriorityQueue_sift_place(const _PriorityQueueSift *sift, size_t index, const void *from) {
+	char *slot = sift->base + (index * sift->member_size);
+	memcpy(slot, from, sift->member_size);
+	if (sift->placed) sift->placed(sift->context, slot, index);
+}
+
+size_t _PriorityQueue_sift_up(const _PriorityQueueSift *sift, size_t index) {
+	size_t m_size = sift->member_size;
+	char value[m_size];
+	memcpy(value, sift->base + (index * m_size), m_size);
+
+	while (index > 0) {
+		size_t parent = (index - 1) / sift->arity;
+		char *slot = sift->base + (parent * m_size);
+		if (sift->compare(sift->context, value, slot) >= 0) break;
+		_PriorityQueue_sift_place(sift, index, slot);
+		index = parent;
+	}
+	_PriorityQueue_sift_place(sift, index, value);
+	return index;
+}
+
+size_t _PriorityQueue_sift_down(const _PriorityQueueSift *sift, size_t index) {
+	size_t m_size = sift->member_size;
+	char value[m_size];
+	memcpy(value, sift->base + (index * m_size), m_size);
+
+	for (;;) {
+		size_t first = (sift->arity * index) + 1;
+		if (first >= sift->size) break;
+		size_t last = first + sift->arity < sift->size ? first + sift->arity : sift->size;
+		char *best = sift->base + (first * m_size);
+		size_t best_index = first;
+		for (size_t child = first + 1; child < last; ++child) {
+			char *slot = sift->base + (child * m_size);
+			if (sift->compare(sift->context, slot, best) < 0) {
+				best = slot;
+				best_index = child;
+			}
+		}
+
+		if (sift->compare(sift->context, best, value) >= 0) break;
+		_PriorityQueue_sift_place(sift, index, best);
+		index = best_index;
 	}
+	_PriorityQueue_sift_place(sift, index, value);
+	return index;
+}
+
+static int _PriorityQueue_sift_compare(void *context, void *a, void *b) {
+	return ((PriorityQueue *) context)->comparator(a, b);
+}
+
+static _PriorityQueueSift _PriorityQueue_sift(PriorityQueue *pq) {
+	return (_PriorityQueueSift) {
+		.base = Vector_data(&pq->vec, char),
+		.member_size = Vector_member_size(&pq->vec),
+		.size = PriorityQueue_size(pq),
+		.arity = pq->arity,
+		.compare = _PriorityQueue_sift_compare,
+		.placed = NULL,
+		.context = pq,
+	};
+}
+
+void _PriorityQueue_heapify_up(PriorityQueue *pq, size_t index) {
+	_PriorityQueueSift sift = _PriorityQueue_sift(pq);
+	(void) _PriorityQueue_sift_up(&sift, index);
 }
 
 void _PriorityQueue_heapify_down(PriorityQueue *pq, size_t index) {
-	size_t left = 2 * index + 1;
-	size_t right = 2 * index + 2;
-	size_t largest = index;
-
-	if (left < PriorityQueue_size(pq) && _PriorityQueue_compare(pq, left, largest) < 0)
-		largest = left;
-	if (right < PriorityQueue_size(pq) && _PriorityQueue_compare(pq, right, largest) < 0)
-		largest = right;
-
-	if (largest != index) {
-		Vector_swap(&pq->vec, index, largest);
-		_PriorityQueue_heapify_down(pq, largest);
-	}
+	_PriorityQueueSift sift = _PriorityQueue_sift(pq);
+	(void) _PriorityQueue_sift_down(&sift, index);
+}
+
+void _PriorityQueue_heapify(PriorityQueue *pq) {
+	size_t size = PriorityQueue_size(pq);
+	if (size < 2) return;
+	// Floyd's method: sift down every internal node, deepest first, in O(n) total.
+	_PriorityQueueSift sift = _PriorityQueue_sift(pq);
+	for (size_t i = (size - 2) / pq->arity + 1; i-- > 0;)
+		(void) _PriorityQueue_sift_down(&sift, i);
 }
 
 PriorityQueueError PriorityQueue_push(PriorityQueue *pq, void *data) {
@@ -90,11 +192,36 @@ PriorityQueueError PriorityQueue_push(PriorityQueue *pq, void *data) {
 	return PQ_ERR_SUCCESS;
 }
 
+PriorityQueueError PriorityQueue_push_bulk(PriorityQueue *pq, void *data, size_t n) {
+	size_t old_size = PriorityQueue_size(pq);
+	PriorityQueueError result = (PriorityQueueError) Vector_append_members(&pq->vec, data, n);
+	if (result) return result;
+
+	// n sift-ups cost about n * depth; rebuilding costs about the whole size.
+	size_t size = PriorityQueue_size(pq), depth = 1;
+	for (size_t level = size; level >= pq->arity; level /= pq->arity)
+		++depth;
+	if (n * depth >= size) {
+		_PriorityQueue_heapify(pq);
+	} else {
+		for (size_t i = old_size; i < size; ++i)
+			_PriorityQueue_heapify_up(pq, i);
+	}
+	return PQ_ERR_SUCCESS;
+}
+
 void PriorityQueue_pop(PriorityQueue *pq) {
 	if (PriorityQueue_size(pq) == 0) return;
 	Vector_set(&pq->vec, 0, Vector_offset(&pq->vec, Vector_size(&pq->vec) - 1));
 	(void) Vector_pop_back(&pq->vec); // ignore return since empty case checked
-	_PriorityQueue_heapify_down(pq, 0);
+	if (PriorityQueue_size(pq)) _PriorityQueue_heapify_down(pq, 0);
+}
+
+PriorityQueueError PriorityQueue_pop_into(PriorityQueue *pq, void *out) {
+	if (PriorityQueue_size(pq) == 0) return PQ_ERR_EMPTY_POP_BACK;
+	memcpy(out, Vector_offset(&pq->vec, 0), Vector_member_size(&pq->vec));
+	PriorityQueue_pop(pq);
+	return PQ_ERR_SUCCESS;
 }
 
 void *PriorityQueue_top(PriorityQueue *pq) {
@@ -0,0 +1,318 @@
+#include "ptset.h"
+#include <string.h>
+
+// Reference counts use the GCC/Clang atomic builtins so that versions sharing
+// nodes can be released on different threads. Dropping a reference is
+// acquire-release so the thread that frees a node sees every earlier read of it.
+#define PTS_INCREF(node) __atomic_add_fetch(&(node)->refs, 1, __ATOMIC_RELAXED)
+#define PTS_DECREF(node) __atomic_sub_fetch(&(node)->refs, 1, __ATOMIC_ACQ_REL)
+#define PTS_REFS(node) __atomic_load_n(&(node)->refs, __ATOMIC_ACQUIRE)
+
+PersistentTreeSet PersistentTreeSet_init(int (*comparator)(void *, void *), size_t member_size) {
+	return PersistentTreeSet_init_with_allocator(comparator, member_size, Allocator_default());
+}
+
+void PersistentTreeSet_create(PersistentTreeSet *pts, int (*comparator)(void *, void *), size_t member_size) {
+	PersistentTreeSet_create_with_allocator(pts, comparator, member_size, Allocator_default());
+}
+
+PersistentTreeSet PersistentTreeSet_init_with_allocator(int (*comparator)(void *, void *), size_t member_size, const Allocator *allocator) {
+	PersistentTreeSet pts;
+	PersistentTreeSet_create_with_allocator(&pts, comparator, member_size, allocator);
+	return pts;
+}
+
+void PersistentTreeSet_create_with_allocator(PersistentTreeSet *pts, int (*comparator)(void *, void *), size_t member_size, const Allocator *allocator) {
+	pts->_member_size = member_size;
+	pts->_root = NULL;
+	pts->size = 0;
+	pts->_comparator = comparator;
+	pts->_spare = NULL;
+	pts->_spare_count = 0;
+	pts->_allocator = allocator;
+}
+
+static size_t _PersistentTreeSet_node_bytes(PersistentTreeSet *pts) {
+	return sizeof(struct _PTreeNode) + pts->_member_size;
+}
+
+static bool _PTreeNode_red(struct _PTreeNode *node) {
+	return node && !node->black;
+}
+
+// Drops one reference to `node`, freeing it and releasing its children if it was the last.
+static void _PersistentTreeSet_release(PersistentTreeSet *pts, struct _PTreeNode *node) {
+	while (node && PTS_DECREF(node) == 0) {
+		struct _PTreeNode *right = node->right;
+		_PersistentTreeSet_release(pts, node->left);
+		Allocator_free(pts->_allocator, node, _PersistentTreeSet_node_bytes(pts));
+		node = right;
+	}
+}
+
+void PersistentTreeSet_invalidate(PersistentTreeSet *pts) {
+	_PersistentTreeSet_release(pts, pts->_root);
+	while (pts->_spare) {
+		struct _PTreeNode *next = pts->_spare->left;
+		Allocator_free(pts->_allocator, pts->_spare, _PersistentTreeSet_node_bytes(pts));
+		pts->_spare = next;
+	}
+	pts->_spare_count = 0;
+	pts->_root = NULL;
+	pts->size = 0;
+}
+
+size_t PersistentTreeSet_size(PersistentTreeSet *pts) {
+	return pts->size;
+}
+
+PersistentTreeSet PersistentTreeSet_snapshot(PersistentTreeSet *pts) {
+	if (pts->_root)
+		PTS_INCREF(pts->_root);
+	return (PersistentTreeSet) {
+		._root = pts->_root,
+		.size = pts->size,
+		._comparator = pts->_comparator,
+		._member_size = pts->_member_size,
+		._spare = NULL,
+		._spare_count = 0,
+		._allocator = pts->_allocator,
+	};
+}
+
+// Tops up the spare nodes to cover the worst case of one update, so that an
+// update either fails before touching the tree or runs to completion. The
+// height is at most 2 log2(n + 1); each level copies at most its own node,
+// both children and one grandchild on the way down and again on the way up.
+static bool _PersistentTreeSet_reserve(PersistentTreeSet *pts) {
+	size_t levels = 1;
+	for (size_t n = pts->size + 1; n; n >>= 1)
+		levels += 2;
+	while (pts->_spare_count < 8 * levels) {
+		struct _PTreeNode *node = (struct _PTreeNode *) Allocator_alloc(pts->_allocator, _PersistentTreeSet_node_bytes(pts));
+		if (!node) return false;
+		node->left = pts->_spare;
+		pts->_spare = node;
+		++pts->_spare_count;
+	}
+	return true;
+}
+
+static struct _PTreeNode *_PersistentTreeSet_take(PersistentTreeSet *pts) {
+	struct _PTreeNode *node = pts->_spare;
+	pts->_spare = node->left;
+	--pts->_spare_count;
+	node->refs = 1;
+	return node;
+}
+
+// Makes `*link` exclusive to this version, copying it if anything else refers to it.
+// The node holding `link` must already be exclusive, so a count of one means only
+// this version can reach the node and it can be modified in place.
+static struct _PTreeNode *_PersistentTreeSet_own(PersistentTreeSet *pts, struct _PTreeNode **link) {
+	struct _PTreeNode *node = *link;
+	if (!node || PTS_REFS(node) == 1) return node;
+
+	struct _PTreeNode *copy = _PersistentTreeSet_take(pts);
+	copy->black = node->black;
+	copy->left = node->left;
+	copy->right = node->right;
+	if (copy->left) PTS_INCREF(copy->left);
+	if (copy->right) PTS_INCREF(copy->right);
+	memcpy(copy->data, node->data, pts->_member_size);
+	// Another version may have let go in the meantime, making this the last reference.
+	_PersistentTreeSet_release(pts, node);
+	return *link = copy;
+}
+
+// The balancing steps below follow Sedgewick's left-leaning red-black tree and
+// take an exclusive `h`; they take ownership of each child before changing it.
+static struct _PTreeNode *_PersistentTreeSet_rotate_left(PersistentTreeSet *pts, struct _PTreeNode *h) {
+	struct _PTreeNode *x = _PersistentTreeSet_own(pts, &h->right);
+	h->right = x->left;
+	x->left = h;
+	x->black = h->black;
+	h->black = false;
+	return x;
+}
+
+static struct _PTreeNode *_PersistentTreeSet_rotate_right(PersistentTreeSet *pts, struct _PTreeNode *h) {
+	struct _PTreeNode *x = _PersistentTreeSet_own(pts, &h->left);
+	h->left = x->right;
+	x->right = h;
+	x->black = h->black;
+	h->black = false;
+	return x;
+}
+
+static void _PersistentTreeSet_flip(PersistentTreeSet *pts, struct _PTreeNode *h) {
+	h->black = !h->black;
+	struct _PTreeNode *left = _PersistentTreeSet_own(pts, &h->left), *right = _PersistentTreeSet_own(pts, &h->right);
+	left->black = !left->black;
+	right->black = !right->black;
+}
+
+static struct _PTreeNode *_PersistentTreeSet_balance(PersistentTreeSet *pts, struct _PTreeNode *h) {
+	if (_PTreeNode_red(h->right) && !_PTreeNode_red(h->left))
+		h = _PersistentTreeSet_rotate_left(pts, h);
+	if (_PTreeNode_red(h->left) && _PTreeNode_red(h->left->left))
+		h = _PersistentTreeSet_rotate_right(pts, h);
+	if (_PTreeNode_red(h->left) && _PTreeNode_red(h->right))
+		_PersistentTreeSet_flip(pts, h);
+	return h;
+}
+
+// Makes h->left or one of its children red before descending left.
+static struct _PTreeNode *_PersistentTreeSet_move_red_left(PersistentTreeSet *pts, struct _PTreeNode *h) {
+	_PersistentTreeSet_flip(pts, h);
+	if (_PTreeNode_red(h->right->left)) {
+		h->right = _PersistentTreeSet_rotate_right(pts, h->right);
+		h = _PersistentTreeSet_rotate_left(pts, h);
+		_PersistentTreeSet_flip(pts, h);
+	}
+	return h;
+}
+
+// Makes h->right or one of its children red before descending right.
+static struct _PTreeNode *_PersistentTreeSet_move_red_right(PersistentTreeSet *pts, struct _PTreeNode *h) {
+	_PersistentTreeSet_flip(pts, h);
+	if (_PTreeNode_red(h->left->left)) {
+		h = _PersistentTreeSet_rotate_right(pts, h);
+		_PersistentTreeSet_flip(pts, h);
+	}
+	return h;
+}
+
+static struct _PTreeNode *_PersistentTreeSet_insert(PersistentTreeSet *pts, struct _PTreeNode *h, void *data) {
+	if (!h) {
+		struct _PTreeNode *node = _PersistentTreeSet_take(pts);
+		node->black = false;
+		node->left = node->right = NULL;
+		memcpy(node->data, data, pts->_member_size);
+		return node;
+	}
+
+	if (pts->_comparator(data, h->data) < 0)
+		h->left = _PersistentTreeSet_insert(pts, _PersistentTreeSet_own(pts, &h->left), data);
+	else
+		h->right = _PersistentTreeSet_insert(pts, _PersistentTreeSet_own(pts, &h->right), data);
+	return _PersistentTreeSet_balance(pts, h);
+}
+
+PersistentTreeSetError PersistentTreeSet_insert(PersistentTreeSet *pts, void *data) {
+	// Look first so that inserting a present element copies nothing.
+	if (PersistentTreeSet_contains(pts, data)) return PTS_ERR_EXISTS;
+	if (!_PersistentTreeSet_reserve(pts)) return PTS_ERR_OOM;
+
+	struct _PTreeNode *root = _PersistentTreeSet_insert(pts, _PersistentTreeSet_own(pts, &pts->_root), data);
+	root->black = true;
+	pts->_root = root;
+	++pts->size;
+	return PTS_ERR_SUCCESS;
+}
+
+static struct _PTreeNode *_PersistentTreeSet_remove_min(PersistentTreeSet *pts, struct _PTreeNode *h) {
+	if (!h->left) {
+		_PersistentTreeSet_release(pts, h);
+		return NULL;
+	}
+	if (!_PTreeNode_red(h->left) && !_PTreeNode_red(h->left->left))
+		h = _PersistentTreeSet_move_red_left(pts, h);
+	h->left = _PersistentTreeSet_remove_min(pts, _PersistentTreeSet_own(pts, &h->left));
+	return _PersistentTreeSet_balance(pts, h);
+}
+
+// `data` must be present below `h`.
+static struct _PTreeNode *_PersistentTreeSet_remove(PersistentTreeSet *pts, struct _PTreeNode *h, void *data) {
+	if (pts->_comparator(data, h->data) < 0) {
+		if (!_PTreeNode_red(h->left) && !_PTreeNode_red(h->left->left))
+			h = _PersistentTreeSet_move_red_left(pts, h);
+		h->left = _PersistentTreeSet_remove(pts, _PersistentTreeSet_own(pts, &h->left), data);
+		return _PersistentTreeSet_balance(pts, h);
+	}
+
+	if (_PTreeNode_red(h->left))
+		h = _PersistentTreeSet_rotate_right(pts, h);
+	if (!h->right && pts->_comparator(data, h->data) == 0) {
+		_PersistentTreeSet_release(pts, h);
+		return NULL;
+	}
+	if (!_PTreeNode_red(h->right) && !_PTreeNode_red(h->right->left))
+		h = _PersistentTreeSet_move_red_right(pts, h);
+	if (pts->_comparator(data, h->data) == 0) {
+		// Take over the successor's element, then remove the successor's node.
+		struct _PTreeNode *successor = h->right;
+		while (successor->left)
+			successor = successor->left;
+		memcpy(h->data, successor->data, pts->_member_size);
+		h->right = _PersistentTreeSet_remove_min(pts, _PersistentTreeSet_own(pts, &h->right));
+	} else {
+		h->right = _PersistentTreeSet_remove(pts, _PersistentTreeSet_own(pts, &h->right), data);
+	}
+	return _PersistentTreeSet_balance(pts, h);
+}
+
+PersistentTreeSetError PersistentTreeSet_remove(PersistentTreeSet *pts, void *data) {
+	if (!PersistentTreeSet_contains(pts, data)) return PTS_ERR_NOT_FOUND;
+	if (!_PersistentTreeSet_reserve(pts)) return PTS_ERR_OOM;
+
+	struct _PTreeNode *root = _PersistentTreeSet_own(pts, &pts->_root);
+	if (!_PTreeNode_red(root->left) && !_PTreeNode_red(root->right))
+		root->black = false;
+	root = _PersistentTreeSet_remove(pts, root, data);
+	if (root)
+		root->black = true;
+	pts->_root = root;
+	--pts->size;
+	return PTS_ERR_SUCCESS;
+}
+
+const void *PersistentTreeSet_find(PersistentTreeSet *pts, void *data) {
+	struct _PTreeNode *node = pts->_root;
+	while (node) {
+		int result = pts->_comparator(data, node->data);
+		if (result == 0)
+			return node->data;
+		node = result < 0 ? node->left : node->right;
+	}
+	return NULL;
+}
+
+bool PersistentTreeSet_contains(PersistentTreeSet *pts, void *data) {
+	return PersistentTreeSet_find(pts, data) != NULL;
+}
+
+// Pushes `node` and its chain of left children; the smallest ends up on top.
+static void _PersistentTreeSetIterator_descend(PersistentTreeSetIterator *it, struct _PTreeNode *node) {
+	for (; node; node = node->left)
+		it->_path[it->_depth++] = node;
+}
+
+void PersistentTreeSet_begin(PersistentTreeSet *pts, PersistentTreeSetIterator *it) {
+	it->_depth = 0;
+	_PersistentTreeSetIterator_descend(it, pts->_root);
+}
+
+void PersistentTreeSet_lower_bound(PersistentTreeSet *pts, void *data, PersistentTreeSetIterator *it) {
+	// Keep exactly the ancestors where the search turned left: they follow in order.
+	it->_depth = 0;
+	struct _PTreeNode *node = pts->_root;
+	while (node) {
+		if (pts->_comparator(data, node->data) <= 0) {
+			it->_path[it->_depth++] = node;
+			node = node->left;
+		} else {
+			node = node->right;
+		}
+	}
+}
+
+void PersistentTreeSet_next(PersistentTreeSetIterator *it) {
+	if (it->_depth == 0) return;
+	struct _PTreeNode *node = it->_path[--it->_depth];
+	_PersistentTreeSetIterator_descend(it, node->right);
+}
+
+const void *PersistentTreeSet_iterator_get(PersistentTreeSetIterator *it) {
+	return it->_depth ? it->_path[it->_depth - 1]->data : NULL;
+}
@@ -0,0 +1,187 @@
+#include "rheap.h"
+#include "error.h"
+#include "utility.h"
+#include "vector.h"
+#include <string.h>
+
+static unsigned _RadixHeap_clz(uint64_t x) {
+#if defined(__GNUC__)
+	return (unsigned) __builtin_clzll(x);
+#else
+	unsigned n = 0;
+	while (!(x & (1ULL << 63))) {
+		x <<= 1;
+		++n;
+	}
+	return n;
+#endif
+}
+
+// Bucket 0 holds keys equal to `last`; bucket i > 0 holds keys whose highest bit differing from it is bit i - 1.
+static size_t _RadixHeap_bucket(uint64_t key, uint64_t last) {
+	if (key == last) return 0;
+	return 64 - _RadixHeap_clz(key ^ last);
+}
+
+static uint64_t _RadixHeap_key(const void *entry) {
+	return *(const uint64_t *) entry;
+}
+
+Errable(RadixHeap) RadixHeap_init(size_t value_size) {
+	return RadixHeap_init_with_allocator(value_size, Allocator_default());
+}
+
+Errable(RadixHeap) RadixHeap_init_with_allocator(size_t value_size, const Allocator *allocator) {
+	RadixHeap rh = { ._value_size = value_size };
+	RadixHeapError result;
+	if ((result = RadixHeap_create_with_allocator(&rh, value_size, allocator)))
+		return Err(result, RadixHeap);
+	return Ok(rh, RadixHeap);
+}
+
+RadixHeapError RadixHeap_create(RadixHeap *rh, size_t value_size) {
+	return RadixHeap_create_with_allocator(rh, value_size, Allocator_default());
+}
+
+RadixHeapError RadixHeap_create_with_allocator(RadixHeap *rh, size_t value_size, const Allocator *allocator) {
+	EntryLayout layout = EntryLayout_of(sizeof(uint64_t), value_size);
+	*((size_t *) &rh->_value_size) = value_size;
+	*((size_t *) &rh->_value_offset) = layout.value_offset;
+	for (size_t i = 0; i < RADIX_HEAP_BUCKETS; ++i)
+		Vector_default_with_allocator(&rh->_buckets[i], layout.stride, allocator);
+	rh->_last = 0;
+	rh->_popped = 0;
+	rh->size = 0;
+	return RH_ERR_SUCCESS;
+}
+
+void RadixHeap_invalidate(RadixHeap *rh) {
+	for (size_t i = 0; i < RADIX_HEAP_BUCKETS; ++i)
+		Vector_invalidate(&rh->_buckets[i]);
+	rh->_last = 0;
+	rh->_popped = 0;
+	rh->size = 0;
+}
+
+void RadixHeap_clear(RadixHeap *rh) {
+	for (size_t i = 0; i < RADIX_HEAP_BUCKETS; ++i)
+		Vector_clear(&rh->_buckets[i]);
+	rh->_last = 0;
+	rh->_popped = 0;
+	rh->size = 0;
+}
+
+size_t RadixHeap_size(RadixHeap *rh) {
+	return rh->size;
+}
+
+static RadixHeapError _RadixHeap_make_room(Vector *v, size_t n) {
+	if (Vector_capacity(v) - Vector_size(v) >= n) return RH_ERR_SUCCESS;
+	size_t capacity = Vector_capacity(v) * 2;
+	if (capacity < Vector_size(v) + n) capacity = Vector_size(v) + n;
+	return Vector_reserve(v, capacity) ? RH_ERR_OOM : RH_ERR_SUCCESS;
+}
+
+// Lowers the bucketing base to `key` after top() moved it past `key`. With b the bucket of `key`
+// under the old base, buckets above b keep their entries, since `key` agrees with the old base
+// above bit b - 1. Every entry below b differs from `key` first at bit b - 1, so it moves to b,
+// which is empty: its keys would be smaller than the old base.
+static RadixHeapError _RadixHeap_rebase(RadixHeap *rh, uint64_t key) {
+	size_t b = _RadixHeap_bucket(key, rh->_last);
+	Vector *target = &rh->_buckets[b];
+	size_t count = 0;
+	for (size_t i = 0; i < b; ++i)
+		count += Vector_size(&rh->_buckets[i]);
+	if (count && _RadixHeap_make_room(target, count))
+		return RH_ERR_OOM;
+	for (size_t i = 0; i < b; ++i) {
+		Vector *bucket = &rh->_buckets[i];
+		if (!Vector_size(bucket)) continue;
+		memcpy(Vector_offset(target, Vector_size(target)), Vector_raw_data(bucket), Vector_size(bucket) * Vector_member_size(bucket));
+		target->size += Vector_size(bucket);
+		Vector_clear(bucket);
+	}
+	rh->_last = key;
+	return RH_ERR_SUCCESS;
+}
+
+RadixHeapError RadixHeap_push(RadixHeap *rh, uint64_t key, void *value) {
+	if (key < rh->_popped) return RH_ERR_NOT_MONOTONE;
+	if (key < rh->_last && _RadixHeap_rebase(rh, key)) return RH_ERR_OOM;
+	char *entry = Vector_append_uninit(&rh->_buckets[_RadixHeap_bucket(key, rh->_last)], 1);
+	if (!entry) return RH_ERR_OOM;
+	memcpy(entry, &key, sizeof(key));
+	if (rh->_value_size) memcpy(entry + rh->_value_offset, value, rh->_value_size);
+	++rh->size;
+	return RH_ERR_SUCCESS;
+}
+
+// Ensures bucket 0 is non-empty by redistributing the first non-empty bucket around its minimum.
+static RadixHeapError _RadixHeap_refill(RadixHeap *rh) {
+	if (Vector_size(&rh->_buckets[0])) return RH_ERR_SUCCESS;
+	if (rh->size == 0) return RH_ERR_EMPTY_POP_BACK;
+
+	size_t i = 1;
+	while (!Vector_size(&rh->_buckets[i]))
+		++i;
+	Vector *bucket = &rh->_buckets[i];
+	size_t entry_size = Vector_member_size(bucket);
+	const char *begin = Vector_raw_data(bucket);
+	const char *end = begin + (Vector_size(bucket) * entry_size);
+
+	uint64_t last = UINT64_MAX;
+	for (const char *entry = begin; entry < end; entry += entry_size)
+		if (_RadixHeap_key(entry) < last) last = _RadixHeap_key(entry);
+
+	// Reserve every destination first so an allocation failure leaves the heap untouched.
+	size_t counts[RADIX_HEAP_BUCKETS] = { 0 };
+	for (const char *entry = begin; entry < end; entry += entry_size)
+		++counts[_RadixHeap_bucket(_RadixHeap_key(entry), last)];
+	for (size_t b = 0; b < i; ++b)
+		if (counts[b] && _RadixHeap_make_room(&rh->_buckets[b], counts[b]))
+			return RH_ERR_OOM;
+
+	// Every entry lands in a strictly lower bucket, so the source range stays intact while copying.
+	char *tails[RADIX_HEAP_BUCKETS];
+	for (size_t b = 0; b < i; ++b)
+		tails[b] = Vector_offset(&rh->_buckets[b], Vector_size(&rh->_buckets[b]));
+	for (const char *entry = begin; entry < end; entry += entry_size) {
+		size_t b = _RadixHeap_bucket(_RadixHeap_key(entry), last);
+		memcpy(tails[b], entry, entry_size);
+		tails[b] += entry_size;
+	}
+	for (size_t b = 0; b < i; ++b)
+		rh->_buckets[b].size += counts[b];
+	Vector_clear(bucket);
+	rh->_last = last;
+	return RH_ERR_SUCCESS;
+}
+
+void *RadixHeap_top(RadixHeap *rh, uint64_t *key) {
+	if (_RadixHeap_refill(rh)) return NULL;
+	Vector *bucket = &rh->_buckets[0];
+	char *entry = Vector_offset(bucket, Vector_size(bucket) - 1);
+	if (key) *key = _RadixHeap_key(entry);
+	return entry + rh->_value_offset;
+}
+
+void RadixHeap_pop(RadixHeap *rh) {
+	if (_RadixHeap_refill(rh)) return;
+	(void) Vector_pop_back(&rh->_buckets[0]);
+	rh->_popped = rh->_last;
+	--rh->size;
+}
+
+RadixHeapError RadixHeap_pop_into(RadixHeap *rh, uint64_t *key, void *value) {
+	RadixHeapError result;
+	if ((result = _RadixHeap_refill(rh)))
+		return result;
+	Vector *bucket = &rh->_buckets[0];
+	char *entry = Vector_offset(bucket, Vector_size(bucket) - 1);
+	if (key) *key = _RadixHeap_key(entry);
+	if (value && rh->_value_size) memcpy(value, entry + rh->_value_offset, rh->_value_size);
+	(void) Vector_pop_back(bucket);
+	rh->_popped = rh->_last;
+	--rh->size;
+	return RH_ERR_SUCCESS;
+}
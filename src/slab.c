@@ -1,14 +1,67 @@
 #include "slab.h"
-#include "arena.h"
 #include "error.h"
-#include "pqueue.h"
+#include "utility.h"
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-int _SlabAllocator_slab_comparator(ArenaAllocator *a, ArenaAllocator *b) {
-	return ArenaAllocator_space(a) - ArenaAllocator_space(b);
+// Objects start on a cache line so classes that are multiples of the line stay line aligned.
+#define SLAB_HEADER_SIZE ALIGN_UP(sizeof(struct _Slab), CACHE_LINE_SIZE)
+
+static size_t _SlabAllocator_log2(size_t n) {
+	size_t log = 0;
+	while (n >>= 1)
+		++log;
+	return log;
+}
+
+// Classes: 16, 32, ..., 128, then four evenly spaced classes per power of two.
+static size_t _SlabAllocator_class_index(size_t bytes) {
+	if (bytes <= 128)
+		return bytes ? (bytes + 15) / 16 - 1 : 0;
+	size_t shift = _SlabAllocator_log2(bytes - 1);
+	size_t quarter = (bytes - 1 - ((size_t) 1 << shift)) >> (shift - 2);
+	return 8 + ((shift - 7) * 4) + quarter;
 }
 
+static size_t _SlabAllocator_class_size(size_t index) {
+	if (index < 8)
+		return 16 * (index + 1);
+	size_t shift = 7 + (index - 8) / 4;
+	size_t quarter = (index - 8) % 4;
+	return ((size_t) 1 << shift) + ((quarter + 1) << (shift - 2));
+}
+
+static struct _Slab *_SlabAllocator_header(SlabAllocator *sa, void *ptr) {
+	return (struct _Slab *) ((uintptr_t) ptr & ~((uintptr_t) sa->slab_size - 1));
+}
+
+// Rounds interior pointers from over-aligned allocations back to the object start.
+static void *_SlabAllocator_object(struct _Slab *header, void *ptr) {
+	char *base = (char *) header + SLAB_HEADER_SIZE;
+	return base + (((char *) ptr - base) / header->size * header->size);
+}
+
+struct _SlabMagazine {
+	void *head;
+	size_t count;
+};
+
+// One per thread per concurrent allocator, registered in _SlabShared::caches.
+struct _SlabCache {
+	struct _SlabShared *shared;
+	struct _SlabCache *prev, *next;
+	struct _SlabMagazine magazines[];
+};
+
+struct _SlabShared {
+	SlabAllocator central; // guarded by lock
+	pthread_mutex_t lock;
+	pthread_key_t key;
+	struct _SlabCache *caches; // guarded by lock
+};
+
 Errable(SlabAllocator) SlabAllocator_init(size_t slab_size) {
 	SlabAllocator ha;
 	SlabAllocatorError result;
@@ -18,28 +71,327 @@ Errable(SlabAllocator) SlabAllocator_init(size_t slab_size) {
 }
 
 SlabAllocatorError SlabAllocator_create(SlabAllocator *sa, size_t slab_size) {
-	sa->slab_size = slab_size;
-	return (SlabAllocatorError) PriorityQueue_create(&sa->slabs, sizeof(ArenaAllocator), (int (*)(void *, void *)) _SlabAllocator_slab_comparator);
+	size_t size = SLAB_MIN_SIZE;
+	while (size < slab_size)
+		size *= 2;
+	sa->slab_size = size;
+	sa->_slabs = NULL;
+	sa->_large = NULL;
+	sa->_shared = NULL;
+
+	// Keep at least eight objects per slab; anything bigger gets its own block.
+	sa->_class_count = _SlabAllocator_class_index((size - SLAB_HEADER_SIZE) / 8);
+	if (_SlabAllocator_class_size(sa->_class_count) <= (size - SLAB_HEADER_SIZE) / 8)
+		++sa->_class_count;
+	sa->_classes = (struct _SlabClass *) calloc(sa->_class_count, sizeof(struct _SlabClass));
+	if (!sa->_classes)
+		return SA_ERR_OOM;
+	return SA_ERR_SUCCESS;
 }
 
-void *SlabAllocator_alloc(SlabAllocator *sa, size_t bytes) {
-	while (true) {
-		ArenaAllocator *top = PriorityQueue_top(&sa->slabs);
-		if (!top || ArenaAllocator_space(top) < bytes) {
-			ArenaAllocator a;
-			ArenaAllocator_create(&a, bytes > sa->slab_size ? bytes : sa->slab_size);
-			PriorityQueue_push(&sa->slabs, &a);
-			continue;
+static void *_SlabAllocator_alloc_large(SlabAllocator *sa, size_t bytes, size_t align) {
+	size_t offset = ALIGN_UP(SLAB_HEADER_SIZE, align);
+	void *block;
+	if (bytes > SIZE_MAX - offset || posix_memalign(&block, sa->slab_size, offset + bytes))
+		return NULL;
+
+	struct _Slab *header = (struct _Slab *) block;
+	header->class_index = SLAB_LARGE;
+	header->size = bytes;
+	header->prev = NULL;
+	header->next = sa->_large;
+	if (sa->_large)
+		sa->_large->prev = header;
+	sa->_large = header;
+	return (char *) block + offset;
+}
+
+static void *_SlabAllocator_alloc_class(SlabAllocator *sa, size_t index) {
+	struct _SlabClass *class = &sa->_classes[index];
+	if (class->free) {
+		void *obj = class->free;
+		class->free = *((void **) obj);
+		return obj;
+	}
+
+	size_t size = _SlabAllocator_class_size(index);
+	if ((size_t) (class->end - class->bump) < size) {
+		void *block;
+		if (posix_memalign(&block, sa->slab_size, sa->slab_size))
+			return NULL;
+		struct _Slab *slab = (struct _Slab *) block;
+		slab->class_index = index;
+		slab->size = size;
+		slab->prev = NULL;
+		slab->next = sa->_slabs;
+		sa->_slabs = slab;
+		class->bump = (char *) block + SLAB_HEADER_SIZE;
+		class->end = (char *) block + sa->slab_size;
+	}
+
+	void *obj = class->bump;
+	class->bump += size;
+	return obj;
+}
+
+static void _SlabAllocator_free_large(SlabAllocator *sa, struct _Slab *header) {
+	if (header->prev)
+		header->prev->next = header->next;
+	else
+		sa->_large = header->next;
+	if (header->next)
+		header->next->prev = header->prev;
+	free(header);
+}
+
+// Returns the class serving `bytes` at `align`, or SLAB_LARGE for a dedicated block.
+static size_t _SlabAllocator_aligned_class(SlabAllocator *sa, size_t bytes, size_t align) {
+	if (align <= MAX_ALIGN) {
+		if (bytes > _SlabAllocator_class_size(sa->_class_count - 1))
+			return SLAB_LARGE;
+		return _SlabAllocator_class_index(bytes);
+	}
+
+	// Objects of a class whose size is a multiple of `align` are naturally aligned
+	// up to a cache line; past that, over-allocate and round up (free rounds back down).
+	if (align > CACHE_LINE_SIZE) {
+		if (bytes + align - 1 > _SlabAllocator_class_size(sa->_class_count - 1))
+			return SLAB_LARGE;
+		return _SlabAllocator_class_index(bytes + align - 1);
+	}
+	size_t index = _SlabAllocator_class_index(ALIGN_UP(bytes, align));
+	while (index < sa->_class_count && _SlabAllocator_class_size(index) % align)
+		++index;
+	return index < sa->_class_count ? index : SLAB_LARGE;
+}
+
+static struct _SlabCache *_SlabAllocator_cache(struct _SlabShared *shared) {
+	struct _SlabCache *cache = (struct _SlabCache *) pthread_getspecific(shared->key);
+	if (cache) return cache;
+
+	cache = (struct _SlabCache *) calloc(1, sizeof(struct _SlabCache) + (shared->central._class_count * sizeof(struct _SlabMagazine)));
+	if (!cache) return NULL;
+	if (pthread_setspecific(shared->key, cache)) {
+		free(cache);
+		return NULL;
+	}
+	cache->shared = shared;
+	pthread_mutex_lock(&shared->lock);
+	cache->next = shared->caches;
+	if (shared->caches)
+		shared->caches->prev = cache;
+	shared->caches = cache;
+	pthread_mutex_unlock(&shared->lock);
+	return cache;
+}
+
+// Moves up to `n` objects from a magazine onto the central free list. Caller holds the lock.
+static void _SlabAllocator_drain(struct _SlabShared *shared, size_t index, struct _SlabMagazine *mag, size_t n) {
+	struct _SlabClass *class = &shared->central._classes[index];
+	while (n-- && mag->head) {
+		void *obj = mag->head;
+		mag->head = *((void **) obj);
+		--mag->count;
+		*((void **) obj) = class->free;
+		class->free = obj;
+	}
+}
+
+static void _SlabAllocator_cache_release(void *ptr) {
+	struct _SlabCache *cache = (struct _SlabCache *) ptr;
+	struct _SlabShared *shared = cache->shared;
+	pthread_mutex_lock(&shared->lock);
+	for (size_t i = 0; i < shared->central._class_count; ++i)
+		_SlabAllocator_drain(shared, i, &cache->magazines[i], SIZE_MAX);
+	if (cache->prev)
+		cache->prev->next = cache->next;
+	else
+		shared->caches = cache->next;
+	if (cache->next)
+		cache->next->prev = cache->prev;
+	pthread_mutex_unlock(&shared->lock);
+	free(cache);
+}
+
+Errable(SlabAllocator) SlabAllocator_init_concurrent(size_t slab_size) {
+	SlabAllocator ha;
+	SlabAllocatorError result;
+	if ((result = SlabAllocator_create_concurrent(&ha, slab_size)))
+		return Err(result, SlabAllocator);
+	return Ok(ha, SlabAllocator);
+}
+
+SlabAllocatorError SlabAllocator_create_concurrent(SlabAllocator *sa, size_t slab_size) {
+	struct _SlabShared *shared = (struct _SlabShared *) malloc(sizeof(struct _SlabShared));
+	if (!shared) return SA_ERR_OOM;
+	if (SlabAllocator_create(&shared->central, slab_size)) {
+		free(shared);
+		return SA_ERR_OOM;
+	}
+	if (pthread_mutex_init(&shared->lock, NULL)) {
+		SlabAllocator_invalidate(&shared->central);
+		free(shared);
+		return SA_ERR_OOM;
+	}
+	if (pthread_key_create(&shared->key, _SlabAllocator_cache_release)) {
+		pthread_mutex_destroy(&shared->lock);
+		SlabAllocator_invalidate(&shared->central);
+		free(shared);
+		return SA_ERR_OOM;
+	}
+	shared->caches = NULL;
+
+	// The handle only routes to the shared state, so copies of it stay valid.
+	sa->_classes = NULL;
+	sa->_class_count = 0;
+	sa->_slabs = NULL;
+	sa->_large = NULL;
+	sa->slab_size = shared->central.slab_size;
+	sa->_shared = shared;
+	return SA_ERR_SUCCESS;
+}
+
+static void *_SlabAllocator_concurrent_alloc(struct _SlabShared *shared, size_t bytes, size_t align) {
+	SlabAllocator *central = &shared->central;
+	size_t index = _SlabAllocator_aligned_class(central, bytes, align);
+	if (index == SLAB_LARGE) {
+		pthread_mutex_lock(&shared->lock);
+		void *block = _SlabAllocator_alloc_large(central, bytes, align);
+		pthread_mutex_unlock(&shared->lock);
+		return block;
+	}
+
+	struct _SlabCache *cache = _SlabAllocator_cache(shared);
+	if (!cache) return NULL;
+	struct _SlabMagazine *mag = &cache->magazines[index];
+	if (!mag->head) {
+		pthread_mutex_lock(&shared->lock);
+		for (size_t i = 0; i < SLAB_MAGAZINE_BATCH; ++i) {
+			void *obj = _SlabAllocator_alloc_class(central, index);
+			if (!obj) break;
+			*((void **) obj) = mag->head;
+			mag->head = obj;
+			++mag->count;
 		}
+		pthread_mutex_unlock(&shared->lock);
+		if (!mag->head) return NULL;
+	}
+
+	void *obj = mag->head;
+	mag->head = *((void **) obj);
+	--mag->count;
+	return (void *) ALIGN_UP((uintptr_t) obj, align);
+}
+
+static void _SlabAllocator_concurrent_free(struct _SlabShared *shared, void *ptr) {
+	struct _Slab *header = _SlabAllocator_header(&shared->central, ptr);
+	if (header->class_index == SLAB_LARGE) {
+		pthread_mutex_lock(&shared->lock);
+		_SlabAllocator_free_large(&shared->central, header);
+		pthread_mutex_unlock(&shared->lock);
+		return;
+	}
+
+	void *obj = _SlabAllocator_object(header, ptr);
+	struct _SlabCache *cache = _SlabAllocator_cache(shared);
+	if (!cache) {
+		pthread_mutex_lock(&shared->lock);
+		struct _SlabClass *class = &shared->central._classes[header->class_index];
+		*((void **) obj) = class->free;
+		class->free = obj;
+		pthread_mutex_unlock(&shared->lock);
+		return;
+	}
+
+	struct _SlabMagazine *mag = &cache->magazines[header->class_index];
+	*((void **) obj) = mag->head;
+	mag->head = obj;
+	if (++mag->count >= 2 * SLAB_MAGAZINE_BATCH) {
+		pthread_mutex_lock(&shared->lock);
+		_SlabAllocator_drain(shared, header->class_index, mag, SLAB_MAGAZINE_BATCH);
+		pthread_mutex_unlock(&shared->lock);
+	}
+}
+
+void *SlabAllocator_alloc(SlabAllocator *sa, size_t bytes) {
+	return SlabAllocator_alloc_aligned(sa, bytes, MAX_ALIGN);
+}
+
+void *SlabAllocator_alloc_aligned(SlabAllocator *sa, size_t bytes, size_t align) {
+	// The header sits at the slab-aligned start, so the object must begin inside the first slab_size bytes.
+	if (align >= sa->slab_size)
+		return NULL;
+	if (sa->_shared)
+		return _SlabAllocator_concurrent_alloc(sa->_shared, bytes, align);
+
+	size_t index = _SlabAllocator_aligned_class(sa, bytes, align);
+	if (index == SLAB_LARGE)
+		return _SlabAllocator_alloc_large(sa, bytes, align);
+	char *obj = (char *) _SlabAllocator_alloc_class(sa, index);
+	if (!obj) return NULL;
+	return (void *) ALIGN_UP((uintptr_t) obj, align);
+}
+
+void *SlabAllocator_alloc_cache_line(SlabAllocator *sa, size_t bytes) {
+	return SlabAllocator_alloc_aligned(sa, ALIGN_UP(bytes, CACHE_LINE_SIZE), CACHE_LINE_SIZE);
+}
 
-		PriorityQueue_pop(&sa->slabs);
-		void *alloc = ArenaAllocator_alloc(top, bytes);
-		PriorityQueue_push(&sa->slabs, top);
-		return alloc;
+void SlabAllocator_free(SlabAllocator *sa, void *ptr) {
+	if (!ptr) return;
+	if (sa->_shared) {
+		_SlabAllocator_concurrent_free(sa->_shared, ptr);
+		return;
 	}
+
+	struct _Slab *header = _SlabAllocator_header(sa, ptr);
+	if (header->class_index == SLAB_LARGE) {
+		_SlabAllocator_free_large(sa, header);
+		return;
+	}
+
+	void *obj = _SlabAllocator_object(header, ptr);
+	struct _SlabClass *class = &sa->_classes[header->class_index];
+	*((void **) obj) = class->free;
+	class->free = obj;
+}
+
+size_t SlabAllocator_usable_size(SlabAllocator *sa, void *ptr) {
+	struct _Slab *header = _SlabAllocator_header(sa, ptr);
+	if (header->class_index == SLAB_LARGE)
+		return header->size;
+	return header->size - (size_t) ((char *) ptr - (char *) _SlabAllocator_object(header, ptr));
 }
 
 void SlabAllocator_invalidate(SlabAllocator *sa) {
-	PriorityQueue_custom_invalidate(&sa->slabs, (void (*)(void *)) ArenaAllocator_invalidate);
+	if (sa->_shared) {
+		struct _SlabShared *shared = sa->_shared;
+		pthread_key_delete(shared->key);
+		while (shared->caches) {
+			struct _SlabCache *next = shared->caches->next;
+			free(shared->caches);
+			shared->caches = next;
+		}
+		pthread_mutex_destroy(&shared->lock);
+		SlabAllocator_invalidate(&shared->central);
+		free(shared);
+		sa->_shared = NULL;
+		sa->slab_size = 0;
+		return;
+	}
+
+	struct _Slab *lists[2] = { sa->_slabs, sa->_large };
+	for (int i = 0; i < 2; ++i) {
+		struct _Slab *slab = lists[i];
+		while (slab) {
+			struct _Slab *next = slab->next;
+			free(slab);
+			slab = next;
+		}
+	}
+	free(sa->_classes);
+	sa->_classes = NULL;
+	sa->_class_count = 0;
+	sa->_slabs = NULL;
+	sa->_large = NULL;
 	sa->slab_size = 0;
 }
@@ -0,0 +1,84 @@
+#include "slmap.h"
+#include "slset.h"
+#include "utility.h"
+
+Errable(SkipListMap) SkipListMap_init(size_t key_size, size_t value_size, int (*comparator)(void *, void *)) {
+	return SkipListMap_init_with_allocator(key_size, value_size, comparator, Allocator_default());
+}
+
+Errable(SkipListMap) SkipListMap_init_with_allocator(size_t key_size, size_t value_size, int (*comparator)(void *, void *), const Allocator *allocator) {
+	SkipListMap sm = {
+		._key_size = key_size,
+		._value_size = value_size,
+	};
+	SkipListMapError result;
+	if ((result = SkipListMap_create_with_allocator(&sm, key_size, value_size, comparator, allocator)))
+		return Err(result, SkipListMap);
+	return Ok(sm, SkipListMap);
+}
+
+SkipListMapError SkipListMap_create(SkipListMap *sm, size_t key_size, size_t value_size, int (*comparator)(void *, void *)) {
+	return SkipListMap_create_with_allocator(sm, key_size, value_size, comparator, Allocator_default());
+}
+
+SkipListMapError SkipListMap_create_with_allocator(SkipListMap *sm, size_t key_size, size_t value_size, int (*comparator)(void *, void *), const Allocator *allocator) {
+	EntryLayout layout = EntryLayout_of(key_size, value_size);
+	*((size_t *) &sm->_key_size) = key_size;
+	*((size_t *) &sm->_value_size) = value_size;
+	*((size_t *) &sm->_value_offset) = layout.value_offset;
+	return (SkipListMapError) SkipListSet_create_with_allocator(&sm->_set, comparator, layout.stride, allocator);
+}
+
+void SkipListMap_invalidate(SkipListMap *sm) {
+	SkipListSet_invalidate(&sm->_set);
+}
+
+size_t SkipListMap_size(SkipListMap *sm) {
+	return SkipListSet_size(&sm->_set);
+}
+
+SkipListMapError SkipListMap_insert(SkipListMap *sm, void *key, void *value) {
+	return (SkipListMapError) _SkipListSet_insert_entry(&sm->_set, key, sm->_key_size, value, sm->_value_offset, sm->_value_size);
+}
+
+bool SkipListMap_get(SkipListMap *sm, void *key, void *out) {
+	return _SkipListSet_copy(&sm->_set, key, out, sm->_value_offset, sm->_value_size);
+}
+
+bool SkipListMap_contains(SkipListMap *sm, void *key) {
+	return SkipListSet_contains(&sm->_set, key);
+}
+
+SkipListMapError SkipListMap_remove(SkipListMap *sm, void *key) {
+	return (SkipListMapError) SkipListSet_remove(&sm->_set, key);
+}
+
+void SkipListMap_begin(SkipListMap *sm, SkipListMapIterator *it) {
+	SkipListSet_begin(&sm->_set, it);
+}
+
+void SkipListMap_lower_bound(SkipListMap *sm, void *key, SkipListMapIterator *it) {
+	SkipListSet_lower_bound(&sm->_set, key, it);
+}
+
+void SkipListMap_upper_bound(SkipListMap *sm, void *key, SkipListMapIterator *it) {
+	SkipListSet_upper_bound(&sm->_set, key, it);
+}
+
+void SkipListMap_next(SkipListMapIterator *it) {
+	SkipListSet_next(it);
+}
+
+void SkipListMap_iterator_close(SkipListMapIterator *it) {
+	SkipListSet_iterator_close(it);
+}
+
+const void *SkipListMap_entry_key(SkipListMap *sm, SkipListMapIterator *it) {
+	(void) sm;
+	return SkipListSet_iterator_get(it);
+}
+
+const void *SkipListMap_entry_value(SkipListMap *sm, SkipListMapIterator *it) {
+	const char *entry = (const char *) SkipListSet_iterator_get(it);
+	return entry ? entry + sm->_value_offset : NULL;
+}
@@ -0,0 +1,534 @@
+#include "slset.h"
+#include "error.h"
+#include "utility.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Low bit of a link: the node owning the link has been removed at that level.
+#define SLS_MARK ((uintptr_t) 1)
+#define SLS_NODE(link) ((struct _SkipListNode *) ((link) & ~SLS_MARK))
+#define SLS_LOAD(link) __atomic_load_n(&(link), __ATOMIC_ACQUIRE)
+
+// Node states: whichever of the inserter and the remover finishes second unlinks and retires the node.
+#define SLS_LINKED 1u
+#define SLS_UNLINKED 2u
+
+// Retirements between attempts to advance the global epoch.
+#define SLS_RECLAIM_INTERVAL 64
+
+struct _SkipListNode {
+	uint32_t height;                 // number of links
+	uint32_t state;                  // SLS_LINKED | SLS_UNLINKED, set atomically
+	struct _SkipListNode *retired;   // next node in a limbo list, once unreachable
+	char data[];                     // element, then `height` links at _links_offset
+};
+
+// Record states: whichever of the owning thread and SkipListSet_invalidate lets go second frees it.
+#define SLS_RECORD_CLAIMED 1u
+#define SLS_RECORD_ORPHANED 2u
+
+// One per thread using the set; padded to whole cache lines so pins do not share a line.
+struct _SkipListThread {
+	size_t epoch;                        // (announced epoch << 1) | 1 while pinned, 0 otherwise
+	size_t pins;                         // nesting depth, owner only
+	size_t count;                        // inserts minus removes through this record, written by the owner only
+	uint64_t rng;                        // level generator, owner only
+	size_t retires;                      // owner only
+	struct _SkipListNode *limbo[3];      // retired nodes by epoch % 3, owner only
+	size_t limbo_epoch[3];               // epoch each limbo list was started in
+	uint32_t owners;                     // SLS_RECORD_CLAIMED | SLS_RECORD_ORPHANED, set atomically
+	struct _SkipListThread *next;        // registry link, fixed once published
+};
+
+struct _SkipListReclaim {
+	size_t epoch;                        // global epoch
+	size_t anonymous_pins;               // pins by threads that could not get a record; block advancing
+	struct _SkipListThread *threads;     // registry, only ever pushed onto
+	uint64_t id;                         // never reused, unlike the address of an invalidated set's reclaim
+};
+
+// The calling thread's record in every set it has used, under one process-wide key.
+struct _SkipListBindings {
+	size_t count;
+	size_t capacity;
+	struct _SkipListBinding {
+		uint64_t id;                     // _SkipListReclaim::id of the set
+		struct _SkipListThread *thread;
+	} entries[];
+};
+
+static pthread_key_t _sls_key;
+static pthread_once_t _sls_key_once = PTHREAD_ONCE_INIT;
+static bool _sls_key_ready;
+static uint64_t _sls_next_id;
+
+static uintptr_t *_SkipListSet_links(SkipListSet *sls, struct _SkipListNode *node) {
+	return (uintptr_t *) (node->data + sls->_links_offset);
+}
+
+static bool _SkipListSet_cas(uintptr_t *link, uintptr_t expected, uintptr_t desired) {
+	return __atomic_compare_exchange_n(link, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static size_t _SkipListSet_node_bytes(SkipListSet *sls, size_t height) {
+	return sizeof(struct _SkipListNode) + sls->_links_offset + height * sizeof(uintptr_t);
+}
+
+static struct _SkipListNode *_SkipListSet_node_new(SkipListSet *sls, size_t height) {
+	struct _SkipListNode *node = (struct _SkipListNode *) Allocator_alloc(sls->_allocator, _SkipListSet_node_bytes(sls, height));
+	if (!node) return NULL;
+	node->height = (uint32_t) height;
+	node->state = 0;
+	node->retired = NULL;
+	return node;
+}
+
+static void _SkipListSet_node_free(SkipListSet *sls, struct _SkipListNode *node) {
+	Allocator_free(sls->_allocator, node, _SkipListSet_node_bytes(sls, node->height));
+}
+
+static void _SkipListSet_free_list(SkipListSet *sls, struct _SkipListNode *node) {
+	while (node) {
+		struct _SkipListNode *next = node->retired;
+		_SkipListSet_node_free(sls, node);
+		node = next;
+	}
+}
+
+static void _SkipListSet_thread_release(struct _SkipListThread *thread) {
+	if (__atomic_fetch_and(&thread->owners, ~SLS_RECORD_CLAIMED, __ATOMIC_ACQ_REL) & SLS_RECORD_ORPHANED)
+		free(thread);
+}
+
+// Gives every record back when the thread exits.
+static void _SkipListSet_bindings_release(void *bindings) {
+	struct _SkipListBindings *b = (struct _SkipListBindings *) bindings;
+	for (size_t i = 0; i < b->count; ++i)
+		_SkipListSet_thread_release(b->entries[i].thread);
+	free(b);
+}
+
+static void _SkipListSet_key_create(void) {
+	_sls_key_ready = !pthread_key_create(&_sls_key, _SkipListSet_bindings_release);
+}
+
+// Makes room for one more binding, first dropping those to invalidated sets; NULL on OOM.
+static struct _SkipListBindings *_SkipListSet_bindings_reserve(struct _SkipListBindings *bindings) {
+	if (bindings) {
+		size_t kept = 0;
+		for (size_t i = 0; i < bindings->count; ++i) {
+			if (__atomic_load_n(&bindings->entries[i].thread->owners, __ATOMIC_ACQUIRE) & SLS_RECORD_ORPHANED)
+				_SkipListSet_thread_release(bindings->entries[i].thread);
+			else
+				bindings->entries[kept++] = bindings->entries[i];
+		}
+		bindings->count = kept;
+		if (kept < bindings->capacity) return bindings;
+	}
+	// Not realloc: the old table must stay valid until the key holds the new one.
+	size_t capacity = bindings ? bindings->capacity * 2 : 4;
+	struct _SkipListBindings *grown = (struct _SkipListBindings *) malloc(sizeof(struct _SkipListBindings) + capacity * sizeof(struct _SkipListBinding));
+	if (!grown) return NULL;
+	grown->count = bindings ? bindings->count : 0;
+	grown->capacity = capacity;
+	if (bindings)
+		memcpy(grown->entries, bindings->entries, bindings->count * sizeof(struct _SkipListBinding));
+	if (pthread_setspecific(_sls_key, grown)) {
+		free(grown);
+		return NULL;
+	}
+	free(bindings);
+	return grown;
+}
+
+// Returns the calling thread's record, claiming an idle one or registering a new one; NULL on OOM.
+static struct _SkipListThread *_SkipListSet_thread(SkipListSet *sls) {
+	struct _SkipListReclaim *reclaim = sls->_reclaim;
+	struct _SkipListBindings *bindings = (struct _SkipListBindings *) pthread_getspecific(_sls_key);
+	for (size_t i = 0; bindings && i < bindings->count; ++i) {
+		if (bindings->entries[i].id == reclaim->id) {
+			// Move it to the front: a thread tends to stay on one set.
+			struct _SkipListBinding found = bindings->entries[i];
+			bindings->entries[i] = bindings->entries[0];
+			bindings->entries[0] = found;
+			return found.thread;
+		}
+	}
+	if (!(bindings = _SkipListSet_bindings_reserve(bindings)))
+		return NULL;
+
+	struct _SkipListThread *thread;
+	for (thread = __atomic_load_n(&reclaim->threads, __ATOMIC_ACQUIRE); thread; thread = thread->next) {
+		uint32_t idle = 0;
+		if (!__atomic_load_n(&thread->owners, __ATOMIC_RELAXED)
+			&& __atomic_compare_exchange_n(&thread->owners, &idle, SLS_RECORD_CLAIMED, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			break;
+	}
+	if (!thread) {
+		void *block;
+		if (posix_memalign(&block, CACHE_LINE_SIZE, ALIGN_UP(sizeof(struct _SkipListThread), CACHE_LINE_SIZE)))
+			return NULL;
+		thread = (struct _SkipListThread *) memset(block, 0, sizeof(struct _SkipListThread));
+		thread->owners = SLS_RECORD_CLAIMED;
+		// Seeded from the record's address so every thread draws a different sequence.
+		thread->rng = (uint64_t) (uintptr_t) thread * 0x9E3779B97F4A7C15ULL | 1;
+		thread->next = __atomic_load_n(&reclaim->threads, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(&reclaim->threads, &thread->next, thread, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			;
+	}
+	bindings->entries[bindings->count++] = (struct _SkipListBinding) { reclaim->id, thread };
+	return thread;
+}
+
+// Announces the current epoch; nodes retired from now on stay allocated until the matching unpin.
+static void _SkipListSet_pin(SkipListSet *sls, struct _SkipListThread *thread) {
+	if (!thread) {
+		__atomic_add_fetch(&sls->_reclaim->anonymous_pins, 1, __ATOMIC_SEQ_CST);
+		return;
+	}
+	if (thread->pins++) return;
+	size_t epoch = __atomic_load_n(&sls->_reclaim->epoch, __ATOMIC_RELAXED);
+	__atomic_store_n(&thread->epoch, epoch << 1 | 1, __ATOMIC_RELEASE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static void _SkipListSet_unpin(SkipListSet *sls, struct _SkipListThread *thread) {
+	if (!thread)
+		__atomic_sub_fetch(&sls->_reclaim->anonymous_pins, 1, __ATOMIC_RELEASE);
+	else if (!--thread->pins)
+		__atomic_store_n(&thread->epoch, 0, __ATOMIC_RELEASE);
+}
+
+// Advances the global epoch if every pinned thread has announced it, then frees this thread's
+// limbo lists that are two epochs old: no thread pinned before their nodes were unlinked remains.
+static void _SkipListSet_collect(SkipListSet *sls, struct _SkipListThread *thread) {
+	struct _SkipListReclaim *reclaim = sls->_reclaim;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	size_t epoch = __atomic_load_n(&reclaim->epoch, __ATOMIC_RELAXED);
+	// Acquire pairs with the release in pin and unpin: reads made under older pins happen before any free.
+	bool advance = !__atomic_load_n(&reclaim->anonymous_pins, __ATOMIC_ACQUIRE);
+	for (struct _SkipListThread *other = __atomic_load_n(&reclaim->threads, __ATOMIC_ACQUIRE); other && advance; other = other->next) {
+		size_t announced = __atomic_load_n(&other->epoch, __ATOMIC_ACQUIRE);
+		advance = !(announced & 1) || announced >> 1 == epoch;
+	}
+	if (advance)
+		__atomic_compare_exchange_n(&reclaim->epoch, &epoch, epoch + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+
+	epoch = __atomic_load_n(&reclaim->epoch, __ATOMIC_ACQUIRE);
+	for (size_t i = 0; i < 3; ++i) {
+		if (thread->limbo[i] && thread->limbo_epoch[i] + 2 <= epoch) {
+			_SkipListSet_free_list(sls, thread->limbo[i]);
+			thread->limbo[i] = NULL;
+		}
+	}
+}
+
+// Queues an unreachable node to be freed once no pinned thread can still hold it.
+static void _SkipListSet_retire(SkipListSet *sls, struct _SkipListThread *thread, struct _SkipListNode *node) {
+	__atomic_thread_fence(__ATOMIC_SEQ_CST); // read the epoch only after the node was unlinked
+	size_t epoch = __atomic_load_n(&sls->_reclaim->epoch, __ATOMIC_ACQUIRE);
+	size_t i = epoch % 3;
+	if (thread->limbo_epoch[i] != epoch) {
+		// Same slot, older epoch: at least three epochs old, so nobody can reach these nodes.
+		_SkipListSet_free_list(sls, thread->limbo[i]);
+		thread->limbo[i] = NULL;
+		thread->limbo_epoch[i] = epoch;
+	}
+	node->retired = thread->limbo[i];
+	thread->limbo[i] = node;
+	if (++thread->retires % SLS_RECLAIM_INTERVAL == 0)
+		_SkipListSet_collect(sls, thread);
+}
+
+static void _SkipListSet_count(struct _SkipListThread *thread, size_t delta) {
+	__atomic_store_n(&thread->count, thread->count + delta, __ATOMIC_RELAXED);
+}
+
+// Each level holds a quarter of the nodes of the level below it.
+static size_t _SkipListSet_random_height(struct _SkipListThread *thread) {
+	uint64_t x = thread->rng;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	thread->rng = x;
+	return 1 + (size_t) __builtin_ctzll(x | 1ULL << (2 * (SLS_MAX_HEIGHT - 1))) / 2;
+}
+
+static size_t _SkipListSet_top(SkipListSet *sls) {
+	return __atomic_load_n(&sls->_height, __ATOMIC_RELAXED);
+}
+
+static void _SkipListSet_raise(SkipListSet *sls, size_t height) {
+	size_t top = _SkipListSet_top(sls);
+	while (top < height && !__atomic_compare_exchange_n(&sls->_height, &top, height, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+// Fills preds/succs with the neighbours of `key` on every level below max(top, height in use),
+// unlinking marked nodes on the way. Returns the node holding `key`, or NULL.
+static struct _SkipListNode *_SkipListSet_find(SkipListSet *sls, void *key, size_t top, struct _SkipListNode **preds, struct _SkipListNode **succs) {
+	size_t height = _SkipListSet_top(sls);
+	if (height < top) height = top;
+retry:;
+	struct _SkipListNode *pred = sls->_head;
+	int order = 1;
+	for (size_t level = height; level-- > 0;) {
+		struct _SkipListNode *curr = SLS_NODE(SLS_LOAD(_SkipListSet_links(sls, pred)[level]));
+		order = 1;
+		while (curr) {
+			uintptr_t succ = SLS_LOAD(_SkipListSet_links(sls, curr)[level]);
+			if (succ & SLS_MARK) {
+				if (!_SkipListSet_cas(&_SkipListSet_links(sls, pred)[level], (uintptr_t) curr, succ & ~SLS_MARK))
+					goto retry;
+				curr = SLS_NODE(succ);
+				continue;
+			}
+			if ((order = sls->_comparator(key, curr->data)) <= 0)
+				break;
+			pred = curr;
+			curr = SLS_NODE(succ);
+		}
+		preds[level] = pred;
+		succs[level] = curr;
+	}
+	return order ? NULL : succs[0];
+}
+
+// Returns the first live node not less than `key` (greater than it when `strict`). Never writes.
+static struct _SkipListNode *_SkipListSet_seek(SkipListSet *sls, void *key, bool strict) {
+	struct _SkipListNode *pred = sls->_head, *curr = NULL;
+	for (size_t level = _SkipListSet_top(sls); level-- > 0;) {
+		curr = SLS_NODE(SLS_LOAD(_SkipListSet_links(sls, pred)[level]));
+		while (curr) {
+			uintptr_t succ = SLS_LOAD(_SkipListSet_links(sls, curr)[level]);
+			if (!(succ & SLS_MARK)) {
+				int order = sls->_comparator(key, curr->data);
+				if (order < 0 || (order == 0 && !strict))
+					break;
+				pred = curr;
+			}
+			curr = SLS_NODE(succ);
+		}
+	}
+	return curr;
+}
+
+// Skips nodes removed since they were reached.
+static struct _SkipListNode *_SkipListSet_live(SkipListSet *sls, struct _SkipListNode *node) {
+	while (node) {
+		uintptr_t succ = SLS_LOAD(_SkipListSet_links(sls, node)[0]);
+		if (!(succ & SLS_MARK)) break;
+		node = SLS_NODE(succ);
+	}
+	return node;
+}
+
+// Unlinks a removed node from every level and retires it. Only called once both the inserter
+// and the remover are done with it, so no level can be linked again afterwards.
+static void _SkipListSet_unlink(SkipListSet *sls, struct _SkipListThread *thread, struct _SkipListNode *node) {
+	struct _SkipListNode *preds[SLS_MAX_HEIGHT], *succs[SLS_MAX_HEIGHT];
+	_SkipListSet_find(sls, node->data, node->height, preds, succs);
+	_SkipListSet_retire(sls, thread, node);
+}
+
+Errable(SkipListSet) SkipListSet_init(int (*comparator)(void *, void *), size_t member_size) {
+	return SkipListSet_init_with_allocator(comparator, member_size, Allocator_default());
+}
+
+Errable(SkipListSet) SkipListSet_init_with_allocator(int (*comparator)(void *, void *), size_t member_size, const Allocator *allocator) {
+	SkipListSet sls;
+	SkipListSetError result;
+	if ((result = SkipListSet_create_with_allocator(&sls, comparator, member_size, allocator)))
+		return Err(result, SkipListSet);
+	return Ok(sls, SkipListSet);
+}
+
+SkipListSetError SkipListSet_create(SkipListSet *sls, int (*comparator)(void *, void *), size_t member_size) {
+	return SkipListSet_create_with_allocator(sls, comparator, member_size, Allocator_default());
+}
+
+SkipListSetError SkipListSet_create_with_allocator(SkipListSet *sls, int (*comparator)(void *, void *), size_t member_size, const Allocator *allocator) {
+	sls->_allocator = allocator;
+	sls->_comparator = comparator;
+	sls->member_size = member_size;
+	sls->_links_offset = ALIGN_UP(member_size, sizeof(uintptr_t));
+	sls->_height = 0;
+	sls->_reclaim = (struct _SkipListReclaim *) calloc(1, sizeof(struct _SkipListReclaim));
+	if (!sls->_reclaim) return SLS_ERR_OOM;
+	// One key serves every set, so there is no limit on how many can exist at once.
+	if (pthread_once(&_sls_key_once, _SkipListSet_key_create) || !_sls_key_ready) {
+		free(sls->_reclaim);
+		return SLS_ERR_OOM;
+	}
+	sls->_reclaim->id = __atomic_fetch_add(&_sls_next_id, 1, __ATOMIC_RELAXED);
+	sls->_head = _SkipListSet_node_new(sls, SLS_MAX_HEIGHT);
+	if (!sls->_head) {
+		free(sls->_reclaim);
+		return SLS_ERR_OOM;
+	}
+	memset(_SkipListSet_links(sls, sls->_head), 0, SLS_MAX_HEIGHT * sizeof(uintptr_t));
+	return SLS_ERR_SUCCESS;
+}
+
+void SkipListSet_invalidate(SkipListSet *sls) {
+	// Every removed node has been unlinked by now and sits in a limbo list.
+	struct _SkipListNode *node = sls->_head;
+	while (node) {
+		struct _SkipListNode *next = SLS_NODE(_SkipListSet_links(sls, node)[0]);
+		_SkipListSet_node_free(sls, node);
+		node = next;
+	}
+	struct _SkipListThread *thread = sls->_reclaim->threads;
+	while (thread) {
+		struct _SkipListThread *next = thread->next;
+		for (size_t i = 0; i < 3; ++i)
+			_SkipListSet_free_list(sls, thread->limbo[i]);
+		// A thread still holding the record frees it on exit, or when it next binds another set.
+		if (!(__atomic_fetch_or(&thread->owners, SLS_RECORD_ORPHANED, __ATOMIC_ACQ_REL) & SLS_RECORD_CLAIMED))
+			free(thread);
+		thread = next;
+	}
+	free(sls->_reclaim);
+	sls->_head = NULL;
+	sls->_reclaim = NULL;
+	sls->_height = 0;
+}
+
+size_t SkipListSet_size(SkipListSet *sls) {
+	size_t size = 0;
+	for (struct _SkipListThread *thread = __atomic_load_n(&sls->_reclaim->threads, __ATOMIC_ACQUIRE); thread; thread = thread->next)
+		size += __atomic_load_n(&thread->count, __ATOMIC_RELAXED);
+	return size;
+}
+
+SkipListSetError _SkipListSet_insert_entry(SkipListSet *sls, void *key, size_t key_size, void *value, size_t value_offset, size_t value_size) {
+	struct _SkipListThread *thread = _SkipListSet_thread(sls);
+	if (!thread) return SLS_ERR_OOM;
+	size_t height = _SkipListSet_random_height(thread);
+	struct _SkipListNode *node = _SkipListSet_node_new(sls, height);
+	if (!node) return SLS_ERR_OOM;
+	memcpy(node->data, key, key_size);
+	if (value_size)
+		memcpy(node->data + value_offset, value, value_size);
+	_SkipListSet_raise(sls, height);
+
+	uintptr_t *links = _SkipListSet_links(sls, node);
+	struct _SkipListNode *preds[SLS_MAX_HEIGHT], *succs[SLS_MAX_HEIGHT];
+	_SkipListSet_pin(sls, thread);
+	for (;;) {
+		if (_SkipListSet_find(sls, node->data, height, preds, succs)) {
+			_SkipListSet_unpin(sls, thread);
+			_SkipListSet_node_free(sls, node);
+			return SLS_ERR_EXISTS;
+		}
+		for (size_t level = 0; level < height; ++level)
+			links[level] = (uintptr_t) succs[level];
+		// Linking level 0 publishes the element.
+		if (_SkipListSet_cas(&_SkipListSet_links(sls, preds[0])[0], (uintptr_t) succs[0], (uintptr_t) node))
+			break;
+	}
+	_SkipListSet_count(thread, 1);
+
+	// The upper levels are shortcuts only. Stop as soon as a remover has marked the node.
+	for (size_t level = 1; level < height; ++level) {
+		for (;;) {
+			uintptr_t next = SLS_LOAD(links[level]);
+			if (next & SLS_MARK) goto linked;
+			if (next != (uintptr_t) succs[level] && !_SkipListSet_cas(&links[level], next, (uintptr_t) succs[level]))
+				goto linked;
+			if (_SkipListSet_cas(&_SkipListSet_links(sls, preds[level])[level], (uintptr_t) succs[level], (uintptr_t) node))
+				break;
+			if (_SkipListSet_find(sls, node->data, height, preds, succs) != node)
+				goto linked;
+		}
+	}
+linked:
+	if (__atomic_fetch_or(&node->state, SLS_LINKED, __ATOMIC_ACQ_REL) & SLS_UNLINKED)
+		_SkipListSet_unlink(sls, thread, node);
+	_SkipListSet_unpin(sls, thread);
+	return SLS_ERR_SUCCESS;
+}
+
+SkipListSetError SkipListSet_insert(SkipListSet *sls, void *data) {
+	return _SkipListSet_insert_entry(sls, data, sls->member_size, NULL, 0, 0);
+}
+
+SkipListSetError SkipListSet_remove(SkipListSet *sls, void *data) {
+	struct _SkipListThread *thread = _SkipListSet_thread(sls);
+	if (!thread) return SLS_ERR_OOM;
+	struct _SkipListNode *preds[SLS_MAX_HEIGHT], *succs[SLS_MAX_HEIGHT];
+	SkipListSetError result = SLS_ERR_NOT_FOUND;
+	_SkipListSet_pin(sls, thread);
+	struct _SkipListNode *node = _SkipListSet_find(sls, data, 0, preds, succs);
+	if (node) {
+		// Mark top-down so no level can be linked past a node that is already gone below it;
+		// marking level 0 removes the element, and only one thread can do that.
+		uintptr_t *links = _SkipListSet_links(sls, node);
+		for (size_t level = node->height; level-- > 1;)
+			__atomic_fetch_or(&links[level], SLS_MARK, __ATOMIC_ACQ_REL);
+		if (!(__atomic_fetch_or(&links[0], SLS_MARK, __ATOMIC_ACQ_REL) & SLS_MARK)) {
+			_SkipListSet_count(thread, (size_t) -1);
+			if (__atomic_fetch_or(&node->state, SLS_UNLINKED, __ATOMIC_ACQ_REL) & SLS_LINKED)
+				_SkipListSet_unlink(sls, thread, node);
+			result = SLS_ERR_SUCCESS;
+		}
+	}
+	_SkipListSet_unpin(sls, thread);
+	return result;
+}
+
+bool _SkipListSet_copy(SkipListSet *sls, void *key, void *out, size_t offset, size_t size) {
+	struct _SkipListThread *thread = _SkipListSet_thread(sls);
+	_SkipListSet_pin(sls, thread);
+	struct _SkipListNode *node = _SkipListSet_seek(sls, key, false);
+	bool found = node && !sls->_comparator(key, node->data);
+	if (found && size)
+		memcpy(out, node->data + offset, size);
+	_SkipListSet_unpin(sls, thread);
+	return found;
+}
+
+bool SkipListSet_contains(SkipListSet *sls, void *data) {
+	return _SkipListSet_copy(sls, data, NULL, 0, 0);
+}
+
+bool SkipListSet_get(SkipListSet *sls, void *data, void *out) {
+	return _SkipListSet_copy(sls, data, out, 0, sls->member_size);
+}
+
+static void _SkipListSet_open(SkipListSet *sls, SkipListSetIterator *it) {
+	it->_set = sls;
+	it->_thread = _SkipListSet_thread(sls);
+	_SkipListSet_pin(sls, it->_thread);
+}
+
+void SkipListSet_begin(SkipListSet *sls, SkipListSetIterator *it) {
+	_SkipListSet_open(sls, it);
+	it->_node = _SkipListSet_live(sls, SLS_NODE(SLS_LOAD(_SkipListSet_links(sls, sls->_head)[0])));
+}
+
+void SkipListSet_lower_bound(SkipListSet *sls, void *data, SkipListSetIterator *it) {
+	_SkipListSet_open(sls, it);
+	it->_node = _SkipListSet_seek(sls, data, false);
+}
+
+void SkipListSet_upper_bound(SkipListSet *sls, void *data, SkipListSetIterator *it) {
+	_SkipListSet_open(sls, it);
+	it->_node = _SkipListSet_seek(sls, data, true);
+}
+
+void SkipListSet_next(SkipListSetIterator *it) {
+	SkipListSet *sls = it->_set;
+	it->_node = _SkipListSet_live(sls, SLS_NODE(SLS_LOAD(_SkipListSet_links(sls, it->_node)[0])));
+}
+
+const void *SkipListSet_iterator_get(SkipListSetIterator *it) {
+	return it->_node ? it->_node->data : NULL;
+}
+
+void SkipListSet_iterator_close(SkipListSetIterator *it) {
+	_SkipListSet_unpin(it->_set, it->_thread);
+	it->_node = NULL;
+}
@@ -1,60 +1,145 @@
 #include "strings.h"
 #include "error.h"
 #include "view.h"
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// AVX2 kernels are compiled with a target attribute and only used when the CPU reports support.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STRING_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+
 Errable(String) String_init() {
+	return String_init_with_allocator(Allocator_default());
+}
+
+Errable(String) String_init_with_allocator(const Allocator *allocator) {
 	String s;
 	StringError result;
-	if ((result = String_create(&s)))
+	if ((result = String_create_with_allocator(&s, allocator)))
 		return Err(result, String);
 	return Ok(s, String);
 }
 
 void String_default(String *s) {
-	s->data = NULL;
 	s->size = 0;
-	s->_capacity = 0;
+	s->_capacity = STRING_INLINE_CAPACITY;
+	s->_allocator = Allocator_default();
 }
 
 StringError String_create(String *s) {
-	void *data = (char *) malloc(sizeof(char) * 32);
-	if (!data) return STR_ERR_OOM;
-	s->data = data;
+	return String_create_with_allocator(s, Allocator_default());
+}
+
+StringError String_create_with_allocator(String *s, const Allocator *allocator) {
 	s->size = 0;
-	s->_capacity = 32;
+	s->_capacity = STRING_INLINE_CAPACITY;
+	s->_allocator = allocator;
 	return STR_ERR_SUCCESS;
 }
 
-StringError String_cpy(String *dest, const String *src) {
-	if (!src || src->size == 0) {
-		String_default(dest);
+static size_t _String_allocated_bytes(const String *s) {
+	return s->size + s->_capacity;
+}
+
+// Heap buffers are always larger than the inline one, so the total capacity tells them apart.
+static bool _String_is_small(const String *s) {
+	return _String_allocated_bytes(s) <= STRING_INLINE_CAPACITY;
+}
+
+static char *_String_data(String *s) {
+	return _String_is_small(s) ? s->_data.small : s->_data.heap;
+}
+
+static void _String_free(String *s) {
+	if (!_String_is_small(s))
+		Allocator_free(s->_allocator, s->_data.heap, _String_allocated_bytes(s));
+}
+
+// Sets the total capacity to `bytes` (at least `size`), moving between the inline and heap buffers as needed.
+static StringError _String_resize(String *s, size_t bytes) {
+	if (bytes <= STRING_INLINE_CAPACITY) {
+		if (!_String_is_small(s)) {
+			char *heap = s->_data.heap;
+			size_t allocated = _String_allocated_bytes(s);
+			memcpy(s->_data.small, heap, s->size);
+			Allocator_free(s->_allocator, heap, allocated);
+		}
+		s->_capacity = STRING_INLINE_CAPACITY - s->size;
 		return STR_ERR_SUCCESS;
 	}
 
-	void *data = realloc(dest->data, src->size);
-	if (!data) return STR_ERR_OOM;
-	dest->data = data;
-	memcpy(dest->data, src->data, src->size);
+	char *data;
+	if (_String_is_small(s)) {
+		data = (char *) Allocator_alloc(s->_allocator, bytes);
+		if (!data) return STR_ERR_OOM;
+		memcpy(data, s->_data.small, s->size);
+	} else {
+		data = (char *) Allocator_realloc(s->_allocator, s->_data.heap, _String_allocated_bytes(s), bytes);
+		if (!data) return STR_ERR_OOM;
+	}
+	s->_data.heap = data;
+	s->_capacity = bytes - s->size;
+	return STR_ERR_SUCCESS;
+}
+
+// Grows geometrically so that a run of appends costs amortised O(1) per byte.
+static StringError _String_grow(String *s, size_t additional) {
+	size_t needed = s->size + additional;
+	size_t bytes = (size_t) ((double) _String_allocated_bytes(s) * STRING_GROWTH_FACTOR);
+	if (bytes < needed) bytes = needed;
+	return _String_resize(s, bytes);
+}
+
+static StringError _String_append_bytes(String *s, const char *a, size_t len) {
+	StringError result;
+	if (s->_capacity < len && (result = _String_grow(s, len)))
+		return result;
+	memcpy(_String_data(s) + s->size, a, len);
+	s->size += len;
+	s->_capacity -= len;
+	return STR_ERR_SUCCESS;
+}
+
+StringError String_cpy(String *dest, const String *src) {
+	// dest keeps its allocator; only the contents are replaced.
+	String_clear(dest);
+	if (!src || src->size == 0)
+		return String_shrink(dest);
+
+	StringError result;
+	if (dest->_capacity < src->size && (result = _String_resize(dest, src->size)))
+		return result;
+	memcpy(_String_data(dest), String_raw_data(src), src->size);
 	dest->size = src->size;
-	dest->_capacity = 0;
+	dest->_capacity -= src->size;
 	return STR_ERR_SUCCESS;
 }
 
 void String_mv(String *dest, String *src) {
 	String_invalidate(dest);
 
-	dest->data = src->data;
+	dest->_data = src->_data;
 	dest->size = src->size;
 	dest->_capacity = src->_capacity;
+	dest->_allocator = src->_allocator;
 
-	String_default(src);
+	src->size = 0;
+	src->_capacity = STRING_INLINE_CAPACITY;
 }
 
 void String_invalidate(String *s) {
-	free(s->data);
-	String_default(s);
+	_String_free(s);
+	s->size = 0;
+	s->_capacity = STRING_INLINE_CAPACITY;
 }
 
 void String_clear(String *s) {
@@ -63,12 +148,8 @@ void String_clear(String *s) {
 }
 
 StringError String_shrink(String *s) {
-	if (s->_capacity == 0) return STR_ERR_SUCCESS;
-	char *data = realloc(s->data, s->size * sizeof(char));
-	if (!data) return STR_ERR_OOM;
-	s->data = data;
-	s->_capacity = 0;
-	return STR_ERR_SUCCESS;
+	if (_String_is_small(s) || s->_capacity == 0) return STR_ERR_SUCCESS;
+	return _String_resize(s, s->size);
 }
 
 size_t String_size(const String *s) {
@@ -76,7 +157,7 @@ size_t String_size(const String *s) {
 }
 
 const char *String_raw_data(const String *s) {
-	return s->data;
+	return _String_is_small(s) ? s->_data.small : s->_data.heap;
 }
 
 Errable(CString) String_cstring(String *s) {
@@ -89,145 +170,335 @@ Errable(CString) String_cstring(String *s) {
 		if (String_get(s, String_size(s) - 1) != '\0')
 			return Err(CSTR_ERR_MISSING_NULL_TERMINATOR, CString);
 	}
-	return Ok(s->data, CString);
+	return Ok(_String_data(s), CString);
 }
 
 char String_get(const String *s, size_t index) {
-	return s->data[index];
+	return String_raw_data(s)[index];
 }
 
 void String_set(String *s, size_t index, char c) {
-	s->data[index] = c;
+	_String_data(s)[index] = c;
 }
 
 StringError String_reserve(String *s, size_t capacity) {
 	if (s->_capacity >= capacity) return STR_ERR_SUCCESS;
-	void *data = realloc(s->data, s->size + capacity);
-	if (!data) return STR_ERR_OOM;
-	s->data = data;
-	s->_capacity += (capacity - s->_capacity);
-	return STR_ERR_SUCCESS;
+	return _String_resize(s, s->size + capacity);
 }
 
 StringError String_append_char(String *s, char c) {
-	if (s->_capacity > 0) {
-		s->data[s->size++] = c;
-		--s->_capacity;
-		return STR_ERR_SUCCESS;
+	if (s->_capacity == 0) {
+		StringError result;
+		if ((result = _String_grow(s, 1)))
+			return result;
 	}
-
-	size_t nlen = (s->size * 2) + 1;
-	void *data = realloc(s->data, nlen);
-	if (!data) return STR_ERR_OOM;
-	s->data = data;
-	s->_capacity = nlen - (s->size + 1);
-	s->data[s->size++] = c;
+	_String_data(s)[s->size++] = c;
+	--s->_capacity;
 	return STR_ERR_SUCCESS;
 }
 
 StringError String_append_string(String *s, String *a) {
-	if (a->size == 0) return STR_ERR_SUCCESS; // implies a->data == NULL or full of air
+	if (a->size == 0) return STR_ERR_SUCCESS;
+	return _String_append_bytes(s, String_raw_data(a), a->size);
+}
 
-	if (s->_capacity >= a->size) {
-		memcpy(s->data + s->size, a->data, a->size);
-		s->size += a->size;
-		s->_capacity -= a->size;
-		return STR_ERR_SUCCESS;
+StringError String_append_cstring(String *s, const char *a) {
+	if (!a) return STR_ERR_SUCCESS;
+	return _String_append_bytes(s, a, strlen(a));
+}
+
+StringError String_append_format(String *s, const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	StringError result = String_append_vformat(s, format, args);
+	va_end(args);
+	return result;
+}
+
+StringError String_append_vformat(String *s, const char *format, va_list args) {
+	va_list retry;
+	va_copy(retry, args);
+	// Format straight into the spare capacity; vsnprintf needs one extra byte for its terminator.
+	int len = vsnprintf(_String_data(s) + s->size, s->_capacity, format, args);
+	if (len < 0) {
+		va_end(retry);
+		return STR_ERR_FORMAT;
 	}
 
-	void *data = realloc(s->data, s->size + a->size);
-	if (!data) return STR_ERR_OOM;
-	s->data = data;
-	memcpy(s->data + s->size, a->data, a->size);
-	s->size += a->size;
-	s->_capacity = 0;
+	if ((size_t) len >= s->_capacity) {
+		StringError result;
+		if ((result = _String_grow(s, (size_t) len + 1))) {
+			va_end(retry);
+			return result;
+		}
+		vsnprintf(_String_data(s) + s->size, s->_capacity, format, retry);
+	}
+	va_end(retry);
+	s->size += (size_t) len;
+	s->_capacity -= (size_t) len;
 	return STR_ERR_SUCCESS;
 }
 
-StringError String_append_cstring(String *s, const char *a) {
-	if (!a) return STR_ERR_SUCCESS;
+#if defined(__SSE2__) || defined(STRING_AVX2_DISPATCH)
+static unsigned _String_ctz(uint32_t mask) {
+#if defined(__GNUC__)
+	return (unsigned) __builtin_ctz(mask);
+#else
+	unsigned n = 0;
+	while (!(mask & 1u)) {
+		mask >>= 1;
+		++n;
+	}
+	return n;
+#endif
+}
+
+static unsigned _String_popcount(uint32_t mask) {
+#if defined(__GNUC__)
+	return (unsigned) __builtin_popcount(mask);
+#else
+	unsigned n = 0;
+	for (; mask; mask &= mask - 1)
+		++n;
+	return n;
+#endif
+}
+#endif
+
+// Every kernel below works on raw byte ranges and returns `n` when nothing is found.
+
+static size_t _String_find_byte_scalar(const char *p, size_t n, char c) {
+	size_t i = 0;
+	while (i < n && p[i] != c)
+		++i;
+	return i;
+}
+
+static size_t _String_count_byte_scalar(const char *p, size_t n, char c) {
+	size_t count = 0;
+	for (size_t i = 0; i < n; ++i)
+		count += p[i] == c;
+	return count;
+}
+
+static size_t _String_mismatch_scalar(const char *a, const char *b, size_t n) {
+	size_t i = 0;
+	while (i < n && a[i] == b[i])
+		++i;
+	return i;
+}
+
+static size_t _String_find_bytes_scalar(const char *h, size_t n, const char *needle, size_t m) {
+	for (size_t i = 0; i + m <= n; ++i)
+		if (h[i] == needle[0] && memcmp(h + i + 1, needle + 1, m - 1) == 0)
+			return i;
+	return n;
+}
 
-	while (*a && s->_capacity) {
-		s->data[s->size++] = *a;
-		--s->_capacity;
-		++a;
+#if defined(__SSE2__)
+static size_t _String_find_byte_sse2(const char *p, size_t n, char c) {
+	__m128i needle = _mm_set1_epi8(c);
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		uint32_t mask = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (p + i)), needle));
+		if (mask) return i + _String_ctz(mask);
 	}
+	return i + _String_find_byte_scalar(p + i, n - i, c);
+}
 
-	if (!*a) return STR_ERR_SUCCESS;
+static size_t _String_count_byte_sse2(const char *p, size_t n, char c) {
+	__m128i needle = _mm_set1_epi8(c);
+	size_t count = 0, i = 0;
+	for (; i + 16 <= n; i += 16)
+		count += _String_popcount((uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (p + i)), needle)));
+	return count + _String_count_byte_scalar(p + i, n - i, c);
+}
 
-	size_t len = strlen(a);
-	void *data = realloc(s->data, s->size + len);
-	if (!data) return STR_ERR_OOM;
-	s->data = data;
-	memcpy(s->data + s->size, a, len);
-	s->size += len;
-	s->_capacity = 0;
-	return STR_ERR_SUCCESS;
+static size_t _String_mismatch_sse2(const char *a, const char *b, size_t n) {
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *) (a + i));
+		__m128i y = _mm_loadu_si128((const __m128i *) (b + i));
+		uint32_t mask = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) ^ 0xffffu;
+		if (mask) return i + _String_ctz(mask);
+	}
+	return i + _String_mismatch_scalar(a + i, b + i, n - i);
+}
+
+// Candidate positions must match both the needle's first and last byte before the middle is compared.
+static size_t _String_find_bytes_sse2(const char *h, size_t n, const char *needle, size_t m) {
+	__m128i first = _mm_set1_epi8(needle[0]);
+	__m128i last = _mm_set1_epi8(needle[m - 1]);
+	size_t i = 0;
+	for (; i + m - 1 + 16 <= n; i += 16) {
+		__m128i head = _mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i *) (h + i)));
+		__m128i tail = _mm_cmpeq_epi8(last, _mm_loadu_si128((const __m128i *) (h + i + m - 1)));
+		for (uint32_t mask = (uint32_t) _mm_movemask_epi8(_mm_and_si128(head, tail)); mask; mask &= mask - 1) {
+			size_t at = i + _String_ctz(mask);
+			if (memcmp(h + at + 1, needle + 1, m - 2) == 0)
+				return at;
+		}
+	}
+	return i + _String_find_bytes_scalar(h + i, n - i, needle, m);
+}
+#endif
+
+#if defined(STRING_AVX2_DISPATCH)
+__attribute__((target("avx2")))
+static size_t _String_find_byte_avx2(const char *p, size_t n, char c) {
+	__m256i needle = _mm256_set1_epi8(c);
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32) {
+		uint32_t mask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (p + i)), needle));
+		if (mask) return i + _String_ctz(mask);
+	}
+	return i + _String_find_byte_scalar(p + i, n - i, c);
+}
+
+__attribute__((target("avx2")))
+static size_t _String_count_byte_avx2(const char *p, size_t n, char c) {
+	__m256i needle = _mm256_set1_epi8(c);
+	size_t count = 0, i = 0;
+	for (; i + 32 <= n; i += 32)
+		count += _String_popcount((uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (p + i)), needle)));
+	return count + _String_count_byte_scalar(p + i, n - i, c);
+}
+
+__attribute__((target("avx2")))
+static size_t _String_mismatch_avx2(const char *a, const char *b, size_t n) {
+	size_t i = 0;
+	for (; i + 32 <= n; i += 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+		__m256i y = _mm256_loadu_si256((const __m256i *) (b + i));
+		uint32_t mask = ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+		if (mask) return i + _String_ctz(mask);
+	}
+	return i + _String_mismatch_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t _String_find_bytes_avx2(const char *h, size_t n, const char *needle, size_t m) {
+	__m256i first = _mm256_set1_epi8(needle[0]);
+	__m256i last = _mm256_set1_epi8(needle[m - 1]);
+	size_t i = 0;
+	for (; i + m - 1 + 32 <= n; i += 32) {
+		__m256i head = _mm256_cmpeq_epi8(first, _mm256_loadu_si256((const __m256i *) (h + i)));
+		__m256i tail = _mm256_cmpeq_epi8(last, _mm256_loadu_si256((const __m256i *) (h + i + m - 1)));
+		for (uint32_t mask = (uint32_t) _mm256_movemask_epi8(_mm256_and_si256(head, tail)); mask; mask &= mask - 1) {
+			size_t at = i + _String_ctz(mask);
+			if (memcmp(h + at + 1, needle + 1, m - 2) == 0)
+				return at;
+		}
+	}
+	return i + _String_find_bytes_scalar(h + i, n - i, needle, m);
+}
+
+static bool _String_has_avx2(void) {
+	return __builtin_cpu_supports("avx2");
+}
+#endif
+
+#if defined(STRING_AVX2_DISPATCH) && defined(__SSE2__)
+#define STRING_DISPATCH(kernel, n, ...) \
+	((n) >= 32 && _String_has_avx2() ? kernel##_avx2(__VA_ARGS__) : kernel##_sse2(__VA_ARGS__))
+#elif defined(STRING_AVX2_DISPATCH)
+#define STRING_DISPATCH(kernel, n, ...) \
+	((n) >= 32 && _String_has_avx2() ? kernel##_avx2(__VA_ARGS__) : kernel##_scalar(__VA_ARGS__))
+#elif defined(__SSE2__)
+#define STRING_DISPATCH(kernel, n, ...) kernel##_sse2(__VA_ARGS__)
+#else
+#define STRING_DISPATCH(kernel, n, ...) kernel##_scalar(__VA_ARGS__)
+#endif
+
+static size_t _String_find_byte(const char *p, size_t n, char c) {
+	return STRING_DISPATCH(_String_find_byte, n, p, n, c);
+}
+
+static size_t _String_count_byte(const char *p, size_t n, char c) {
+	return STRING_DISPATCH(_String_count_byte, n, p, n, c);
+}
+
+static size_t _String_mismatch(const char *a, const char *b, size_t n) {
+	return STRING_DISPATCH(_String_mismatch, n, a, b, n);
+}
+
+static size_t _String_find_bytes(const char *h, size_t n, const char *needle, size_t m) {
+	if (m == 1) return _String_find_byte(h, n, needle[0]);
+	return STRING_DISPATCH(_String_find_bytes, n, h, n, needle, m);
+}
+
+static int _String_cmp_bytes(const char *a, size_t a_size, const char *b, size_t b_size) {
+	size_t len = a_size > b_size ? b_size : a_size;
+	size_t i = _String_mismatch(a, b, len);
+	if (i < len) return a[i] - b[i];
+	if (a_size == b_size) return 0;
+	if (a_size > b_size) return 1;
+	return -1;
 }
 
 bool String_eq_string(const String *a, const String *b) {
 	if (a->size != b->size) return false;
-	for (size_t i = 0; i < a->size; ++i)
-		if (String_get(a, i) != String_get(b, i))
-			return false;
-	return true;
+	return _String_mismatch(String_raw_data(a), String_raw_data(b), a->size) == a->size;
 }
 
 bool String_eq_cstring(const String *a, const char *b) {
-	for (size_t i = 0; i < a->size; ++i, ++b) {
-		if (!*b) return false;
-		if (String_get(a, i) != *b)
-			return false;
-	}
-	if (*b) return false;
-	return true;
+	if (strlen(b) != a->size) return false;
+	return _String_mismatch(String_raw_data(a), b, a->size) == a->size;
 }
 
 int String_cmp_string(const String *a, const String *b) {
-	size_t len = a->size > b->size ? b->size : a->size;
-	for (size_t i = 0; i < len; ++i)
-		if (String_get(a, i) != String_get(b, i))
-			return String_get(a, i) - String_get(b, i);
-	if (a->size == b->size) return 0;
-	if (a->size > b->size) return 1;
-	return -1;
+	return _String_cmp_bytes(String_raw_data(a), a->size, String_raw_data(b), b->size);
 }
 
 int String_cmp_cstring(const String *a, const char *b) {
-	for (size_t i = 0; i < a->size; ++i, ++b)
-		if (String_get(a, i) != *b)
-			return String_get(a, i) - *b;
-	if (!*b) return 0;
-	return -*b;
+	return _String_cmp_bytes(String_raw_data(a), a->size, b, strlen(b));
+}
+
+size_t String_find_char(const String *s, char c, size_t from) {
+	if (from >= s->size) return STRING_NPOS;
+	size_t i = from + _String_find_byte(String_raw_data(s) + from, s->size - from, c);
+	return i < s->size ? i : STRING_NPOS;
+}
+
+static size_t _String_find(const String *s, const char *needle, size_t m, size_t from) {
+	if (from > s->size || m > s->size - from) return STRING_NPOS;
+	if (m == 0) return from;
+	size_t i = from + _String_find_bytes(String_raw_data(s) + from, s->size - from, needle, m);
+	return i < s->size ? i : STRING_NPOS;
+}
+
+size_t String_find_string(const String *s, const String *needle, size_t from) {
+	return _String_find(s, String_raw_data(needle), needle->size, from);
+}
+
+size_t String_find_cstring(const String *s, const char *needle, size_t from) {
+	return _String_find(s, needle, strlen(needle), from);
+}
+
+size_t String_count_char(const String *s, char c) {
+	return _String_count_byte(String_raw_data(s), s->size, c);
 }
 
 Errable(String) String_substring(String *s, size_t from, size_t to) {
-	String str = {
-		.size = to - from,
-		._capacity = 0,
-	};
-	str.data = malloc(str.size * sizeof(char));
-	if (!str.data) return Err(STR_ERR_OOM, String);
-	memcpy(str.data, s->data + from, to - from);
+	String str;
+	String_create_with_allocator(&str, s->_allocator);
+	if (_String_append_bytes(&str, String_raw_data(s) + from, to - from))
+		return Err(STR_ERR_OOM, String);
 	return Ok(str, String);
 }
 
 Errable(String) String_from_cstring(const char *s) {
-	size_t len = strlen(s);
 	String str;
-	str.size = len;
-	str._capacity = 0;
-	str.data = (char *) malloc(len * sizeof(char));
-	if (!str.data)
+	String_create(&str);
+	if (String_append_cstring(&str, s))
 		return Err(STR_ERR_OOM, String);
-	memcpy(str.data, s, len);
 	return Ok(str, String);
 }
 
 ViewOf(String) String_view(String *s, size_t from, size_t to) {
-	return View(s->data + from, to - from, sizeof(char));
+	return View(_String_data(s) + from, to - from, sizeof(char));
 }
 
 SliceOf(String) String_slice(String *s, size_t from, size_t to) {
-	return Slice(s->data + from, to - from, sizeof(char));
+	return Slice(_String_data(s) + from, to - from, sizeof(char));
 }
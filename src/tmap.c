@@ -0,0 +1,132 @@
+#include "tmap.h"
+#include "tset.h"
+#include "utility.h"
+#include <string.h>
+
+TreeMap TreeMap_init(size_t key_size, size_t value_size, int (*comparator)(void *, void *)) {
+	return TreeMap_init_with_allocator(key_size, value_size, comparator, Allocator_default());
+}
+
+void TreeMap_create(TreeMap *tm, size_t key_size, size_t value_size, int (*comparator)(void *, void *)) {
+	TreeMap_create_with_allocator(tm, key_size, value_size, comparator, Allocator_default());
+}
+
+TreeMap TreeMap_init_with_allocator(size_t key_size, size_t value_size, int (*comparator)(void *, void *), const Allocator *allocator) {
+	TreeMap tm = {
+		._key_size = key_size,
+		._value_size = value_size,
+	};
+	TreeMap_create_with_allocator(&tm, key_size, value_size, comparator, allocator);
+	return tm;
+}
+
+void TreeMap_create_with_allocator(TreeMap *tm, size_t key_size, size_t value_size, int (*comparator)(void *, void *), const Allocator *allocator) {
+	EntryLayout layout = EntryLayout_of(key_size, value_size);
+	*((size_t *) &tm->_key_size) = key_size;
+	*((size_t *) &tm->_value_size) = value_size;
+	*((size_t *) &tm->_value_offset) = layout.value_offset;
+	TreeSet_create_with_allocator(&tm->_set, comparator, NULL, layout.stride, allocator);
+}
+
+void TreeMap_invalidate(TreeMap *tm) {
+	TreeSet_invalidate(&tm->_set);
+}
+
+void TreeMap_custom_invalidate(TreeMap *tm, void (*destructor)(void *, void *)) {
+	for (TreeMapIterator it = TreeMap_begin(tm); it; it = TreeMap_next(tm, it))
+		destructor(TreeMap_entry_key(tm, it), TreeMap_entry_value(tm, it));
+	TreeMap_invalidate(tm);
+}
+
+size_t TreeMap_size(TreeMap *tm) {
+	return TreeSet_size(&tm->_set);
+}
+
+TreeMapError TreeMap_insert(TreeMap *tm, void *key, void *value) {
+	TMEmplacePair pair = TreeMap_emplace(tm, key, value);
+	if (!pair.value) return TM_ERR_OOM;
+	return pair.inserted ? TM_ERR_SUCCESS : TM_ERR_EXISTS;
+}
+
+TreeMapError TreeMap_put(TreeMap *tm, void *key, void *value) {
+	TMEmplacePair pair = TreeMap_emplace(tm, key, value);
+	if (!pair.value) return TM_ERR_OOM;
+	if (!pair.inserted)
+		memcpy(pair.value, value, tm->_value_size);
+	return TM_ERR_SUCCESS;
+}
+
+TMEmplacePair TreeMap_emplace(TreeMap *tm, void *key, void *value) {
+	TSEmplacePair pair = _TreeSet_prepare_insert(&tm->_set, key, tm->_key_size, tm->_set._comparator);
+	if (!pair.iterator)
+		return (TMEmplacePair) { .value = NULL, .inserted = false };
+
+	void *slot = TreeMap_entry_value(tm, pair.iterator);
+	if (pair.inserted && value)
+		memcpy(slot, value, tm->_value_size);
+	return (TMEmplacePair) {
+		.value = slot,
+		.inserted = pair.inserted,
+	};
+}
+
+TMEmplacePair TreeMap_get_or_insert(TreeMap *tm, void *key) {
+	TMEmplacePair pair = TreeMap_emplace(tm, key, NULL);
+	if (pair.inserted)
+		memset(pair.value, 0, tm->_value_size);
+	return pair;
+}
+
+void *TreeMap_get(TreeMap *tm, void *key) {
+	TreeMapIterator it = TreeSet_find(&tm->_set, key);
+	return it ? TreeMap_entry_value(tm, it) : NULL;
+}
+
+bool TreeMap_contains(TreeMap *tm, void *key) {
+	return TreeSet_contains(&tm->_set, key);
+}
+
+bool TreeMap_remove(TreeMap *tm, void *key) {
+	return TreeSet_remove(&tm->_set, key);
+}
+
+TreeMapError TreeMap_erase(TreeMap *tm, TreeMapIterator it) {
+	return TreeSet_erase(&tm->_set, it) == TS_ERR_SUCCESS ? TM_ERR_SUCCESS : TM_ERR_INVALID_ITERATOR;
+}
+
+TreeMapIterator TreeMap_find(TreeMap *tm, void *key) {
+	return TreeSet_find(&tm->_set, key);
+}
+
+TreeMapIterator TreeMap_lower_bound(TreeMap *tm, void *key) {
+	return TreeSet_lower_bound(&tm->_set, key);
+}
+
+TreeMapIterator TreeMap_upper_bound(TreeMap *tm, void *key) {
+	return TreeSet_upper_bound(&tm->_set, key);
+}
+
+TreeMapIterator TreeMap_begin(TreeMap *tm) {
+	return TreeSet_begin(&tm->_set);
+}
+
+TreeMapIterator TreeMap_end(TreeMap *tm) {
+	return TreeSet_end(&tm->_set);
+}
+
+TreeMapIterator TreeMap_next(TreeMap *tm, TreeMapIterator it) {
+	return TreeSet_next(&tm->_set, it);
+}
+
+TreeMapIterator TreeMap_prev(TreeMap *tm, TreeMapIterator it) {
+	return TreeSet_prev(&tm->_set, it);
+}
+
+void *TreeMap_entry_key(TreeMap *tm, TreeMapIterator it) {
+	(void) tm;
+	return it->data;
+}
+
+void *TreeMap_entry_value(TreeMap *tm, TreeMapIterator it) {
+	return it->data + tm->_value_offset;
+}
@@ -1,25 +1,33 @@
 #include "tset.h"
 
-#include <bits/types/struct_itimerspec.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-enum _RBTreeNodeError _RBTreeNode_create(struct _RBTreeNode *node, bool black, void *data, size_t size) {
+void _RBTreeNode_create(struct _RBTreeNode *node, bool black, void *data, size_t size) {
 	node->black = black;
-	node->left = node->right = NULL;
-	node->data = (char *) malloc(size);
-	if (!node->data)
-		return RBTN_ERR_OOM;
+	node->parent = node->left = node->right = NULL;
 	memcpy(node->data, data, size);
-	return RBTN_ERR_SUCCESS;
+}
+
+struct _RBTreeNode *_RBTreeNode_min(struct _RBTreeNode *node) {
+	while (node->left)
+		node = node->left;
+	return node;
+}
+
+struct _RBTreeNode *_RBTreeNode_max(struct _RBTreeNode *node) {
+	while (node->right)
+		node = node->right;
+	return node;
 }
 
 void _RBTreeNode_recursive_invalidate(struct _RBTreeNode *node, void (*deletor)(void *)) {
+	if (!node) return;
+	_RBTreeNode_recursive_invalidate(node->left, deletor);
+	_RBTreeNode_recursive_invalidate(node->right, deletor);
 	deletor(node->data);
-	free(node);
-	if (node->left) _RBTreeNode_recursive_invalidate(node->left, deletor);
-	if (node->right) _RBTreeNode_recursive_invalidate(node->right, deletor);
 }
 
 bool _RBTreeNode_black(struct _RBTreeNode *node) {
@@ -31,18 +39,44 @@ void _RBTreeNode_color_black(struct _RBTreeNode *node) {
 }
 
 TreeSet TreeSet_init(int (*comparator)(void *, void *), size_t member_size) {
-	return TreeSet_custom_init(comparator, free, member_size);
+	return TreeSet_custom_init(comparator, NULL, member_size);
 }
 void TreeSet_create(TreeSet *ts, int (*comparator)(void *, void *), size_t member_size) {
-	TreeSet_custom_create(ts, comparator, free, member_size);
+	TreeSet_custom_create(ts, comparator, NULL, member_size);
 }
 
+// Chunks start with a link to the previous chunk and their own size in bytes.
+struct _RBTreeNodeChunk {
+	struct _RBTreeNodeChunk *next;
+	size_t bytes;
+	_MaxAlign nodes[]; // node slots follow, max aligned
+};
+
+// Node data is stored inline, so it is only max aligned if the chunk header and node
+// header both keep slots on MAX_ALIGN boundaries.
+typedef char _TreeSet_chunk_aligned[sizeof(struct _RBTreeNodeChunk) % MAX_ALIGN == 0 ? 1 : -1];
+typedef char _TreeSet_data_aligned[offsetof(struct _RBTreeNode, data) % MAX_ALIGN == 0 ? 1 : -1];
+
 void TreeSet_invalidate(TreeSet *ts) {
 	TreeSet_custom_invalidate(ts, ts->_deletor);
 }
 
 void TreeSet_custom_invalidate(TreeSet *ts, void (*deletor)(void *)) {
-	_RBTreeNode_recursive_invalidate(ts->_root, deletor);
+	if (deletor)
+		_RBTreeNode_recursive_invalidate(ts->_root, deletor);
+
+	// Every node lives in a pool chunk, so releasing the chunks releases the tree.
+	struct _RBTreeNodeChunk *chunk = (struct _RBTreeNodeChunk *) ts->_pool.chunks;
+	while (chunk) {
+		struct _RBTreeNodeChunk *next = chunk->next;
+		Allocator_free(ts->_allocator, chunk, chunk->bytes);
+		chunk = next;
+	}
+	ts->_pool.chunks = NULL;
+	ts->_pool.free = NULL;
+
+	ts->_root = NULL;
+	ts->size = 0;
 }
 
 TreeSet TreeSet_custom_init(int (*comparator)(void *, void *), void (*deletor)(void *), size_t member_size) {
@@ -53,383 +87,752 @@ TreeSet TreeSet_custom_init(int (*comparator)(void *, void *), void (*deletor)(v
 	return ts;
 }
 void TreeSet_custom_create(TreeSet *ts, int (*comparator)(void *, void *), void (*deletor)(void *), size_t member_size) {
+	TreeSet_create_with_allocator(ts, comparator, deletor, member_size, Allocator_default());
+}
+
+TreeSet TreeSet_init_with_allocator(int (*comparator)(void *, void *), void (*deletor)(void *), size_t member_size, const Allocator *allocator) {
+	TreeSet ts = {
+		._member_size = member_size,
+	};
+	TreeSet_create_with_allocator(&ts, comparator, deletor, member_size, allocator);
+	return ts;
+}
+void TreeSet_create_with_allocator(TreeSet *ts, int (*comparator)(void *, void *), void (*deletor)(void *), size_t member_size, const Allocator *allocator) {
 	*((size_t *) &ts->_member_size) = member_size;
 	ts->size = 0;
 	ts->_comparator = comparator;
 	ts->_deletor = deletor;
 	ts->_root = NULL;
+
+	// Round up so nodes carved back to back from a chunk keep their data max aligned, like malloc's.
+	ts->_node_size = ALIGN_UP(sizeof(struct _RBTreeNode) + member_size, MAX_ALIGN);
+	ts->_pool.chunks = NULL;
+	ts->_pool.free = NULL;
+	ts->_pool.chunk_nodes = 16;
+	ts->_allocator = allocator;
+	ts->_count_offset = 0;
+	ts->_key_of = NULL;
+	ts->_u64_key_of = NULL;
+	ts->_node_prefix = 0;
 }
 
-void _TreeSet_left_rotate(TreeSet *ts, TreeSetIterator b, TreeSetIterator parent) {
-	if (!b || !b->right) return;
+size_t TreeSet_node_size(TreeSet *ts) {
+	return ts->_node_size;
+}
 
-	TreeSetIterator c = b->right;
-	if (!parent)
-		ts->_root = c;
-	else if (b == parent->right)
-		parent->right = c;
-	else
-		parent->left = c;
+TreeSetError TreeSet_enable_order_statistics(TreeSet *ts) {
+	if (ts->_count_offset) return TS_ERR_SUCCESS;
+	if (ts->size) return TS_ERR_NOT_EMPTY;
 
-	b->right = c->left;
-	c->left = b;
+	// Pooled nodes were carved at the old size, so give them back first.
+	TreeSet_custom_invalidate(ts, NULL);
+	// The count goes right after the element, often into padding, and the stride stays max aligned.
+	ts->_count_offset = ALIGN_UP(sizeof(struct _RBTreeNode) + ts->_member_size, sizeof(size_t));
+	ts->_node_size = ALIGN_UP(ts->_node_prefix + ts->_count_offset + sizeof(size_t), MAX_ALIGN);
+	return TS_ERR_SUCCESS;
 }
-void _TreeSet_right_rotate(TreeSet *ts, TreeSetIterator b, TreeSetIterator parent) {
-	if (!b || !b->left) return;
 
-	TreeSetIterator c = b->left;
-	if (!parent)
-		ts->_root = c;
-	else if (b == parent->right)
-		parent->right = c;
-	else
-		parent->left = c;
+TreeSetError TreeSet_set_key(TreeSet *ts, void *(*key_of)(void *), int (*key_comparator)(void *, void *)) {
+	if (ts->size) return TS_ERR_NOT_EMPTY;
+	ts->_key_of = key_of;
+	ts->_comparator = key_comparator;
+	return TS_ERR_SUCCESS;
+}
 
-	b->left = c->right;
-	c->right = b;
+TreeSetError TreeSet_set_u64_key(TreeSet *ts, uint64_t (*key_of)(void *)) {
+	if (ts->size) return TS_ERR_NOT_EMPTY;
+	if (!ts->_node_prefix) {
+		// Pooled nodes were carved at the old size, so give them back first.
+		TreeSet_custom_invalidate(ts, NULL);
+		// Padded to MAX_ALIGN so the node header, and the data after it, stay max aligned.
+		ts->_node_prefix = ALIGN_UP(sizeof(uint64_t), MAX_ALIGN);
+		ts->_node_size += ts->_node_prefix;
+	}
+	ts->_u64_key_of = key_of;
+	return TS_ERR_SUCCESS;
 }
 
-bool _TreeSet_bst_insert(TreeSet *ts, void *data, int (*comparator)(void *, void *), TreeSetIterator *stack, unsigned int *size) {
-	TreeSetIterator ptr = ts->_root;
-	stack[(*size)++] = ptr;
-	if (!ptr) {
-		ts->_root = (TreeSetIterator) malloc(sizeof(*ptr));
-		_RBTreeNode_create(ptr, true, data, ts->_member_size);
-		return true;
+// The cached key sits right in front of the node header, on the cache line a descent reads anyway.
+static uint64_t *_TreeSet_u64_key(TreeSet *ts, TreeSetIterator node) {
+	(void) ts;
+	return (uint64_t *) node - 1;
+}
+
+// Fills in the cached u64 key of a node whose element has just been written.
+static void _TreeSet_node_set_key(TreeSet *ts, TreeSetIterator node) {
+	if (ts->_u64_key_of)
+		*_TreeSet_u64_key(ts, node) = ts->_u64_key_of(node->data);
+}
+
+// Returns the ordering key of an element; u64 keys are written to `*scratch`.
+static void *_TreeSet_key_of(TreeSet *ts, void *data, uint64_t *scratch) {
+	if (ts->_u64_key_of) {
+		*scratch = ts->_u64_key_of(data);
+		return scratch;
 	}
+	return ts->_key_of ? ts->_key_of(data) : data;
+}
 
-	while (ptr) {
-		int result = comparator(ptr->data, data);
-		if (result == 0)
-			return false;
+// Three-way comparison of a bare key against a node's element under the set's ordering.
+static int _TreeSet_compare(TreeSet *ts, void *key, TreeSetIterator node) {
+	if (ts->_u64_key_of) {
+		uint64_t a = *(uint64_t *) key, b = *_TreeSet_u64_key(ts, node);
+		return (a > b) - (a < b);
+	}
+	return ts->_comparator(key, ts->_key_of ? ts->_key_of(node->data) : node->data);
+}
 
-		// data > ptr->data
-		if (result < 0) {
-			stack[(*size)++] = ptr->right;
-			if (!ptr->right) {
-				ptr->right = (TreeSetIterator) malloc(sizeof(*(ptr->right)));
-				_RBTreeNode_create(ptr->right, false, data, ts->_member_size);
-				return true;
-			}
-			ptr = ptr->right;
-		}
+// Subtree sizes live in a trailing slot of each node, present only when order statistics are enabled.
+static size_t *_TreeSet_count(TreeSet *ts, TreeSetIterator node) {
+	return (size_t *) ((char *) node + ts->_count_offset);
+}
+static size_t _TreeSet_subtree_size(TreeSet *ts, TreeSetIterator node) {
+	return node ? *_TreeSet_count(ts, node) : 0;
+}
+static void _TreeSet_recount(TreeSet *ts, TreeSetIterator node) {
+	if (ts->_count_offset)
+		*_TreeSet_count(ts, node) = 1 + _TreeSet_subtree_size(ts, node->left) + _TreeSet_subtree_size(ts, node->right);
+}
+// Adds `delta` (wrapping, so (size_t) -1 decrements) to the sizes of `node` and all its ancestors.
+static void _TreeSet_count_path(TreeSet *ts, TreeSetIterator node, size_t delta) {
+	if (!ts->_count_offset) return;
+	for (; node; node = node->parent)
+		*_TreeSet_count(ts, node) += delta;
+}
 
-		// data < ptr->data
-		else {
-			stack[(*size)++] = ptr->left;
-			if (!ptr->left) {
-				ptr->left = (TreeSetIterator) malloc(sizeof(*(ptr->left)));
-				_RBTreeNode_create(ptr->left, false, data, ts->_member_size);
-				return true;
-			}
-			ptr = ptr->left;
-		}
+// Obtains one chunk of `count` contiguous nodes from the allocator and records it in the pool.
+static char *_TreeSet_chunk_alloc(TreeSet *ts, size_t count) {
+	size_t bytes = sizeof(struct _RBTreeNodeChunk) + (count * ts->_node_size);
+	struct _RBTreeNodeChunk *chunk = (struct _RBTreeNodeChunk *) Allocator_alloc(ts->_allocator, bytes);
+	if (!chunk) return NULL;
+	chunk->next = (struct _RBTreeNodeChunk *) ts->_pool.chunks;
+	chunk->bytes = bytes;
+	ts->_pool.chunks = chunk;
+	return (char *) chunk->nodes;
+}
+
+// Returns the `index`-th node of a run of contiguous node slots.
+static TreeSetIterator _TreeSet_slot(TreeSet *ts, char *nodes, size_t index) {
+	return (TreeSetIterator) (nodes + (index * ts->_node_size) + ts->_node_prefix);
+}
+
+// Pushes `count` contiguous nodes onto the free list, lowest address first out.
+static void _TreeSet_nodes_free(TreeSet *ts, char *nodes, size_t count) {
+	for (size_t i = count; i > 0; --i) {
+		TreeSetIterator node = _TreeSet_slot(ts, nodes, i - 1);
+		node->left = ts->_pool.free;
+		ts->_pool.free = node;
 	}
-	return false;
 }
-TSEmplacePair _TreeSet_bst_emplace(TreeSet *ts, void *data, int (*comparator)(void *, void *), TreeSetIterator *stack, unsigned int *size) {
-	TreeSetIterator ptr = ts->_root;
-	stack[(*size)++] = ptr;
-	if (!ptr) {
-		ts->_root = (TreeSetIterator) malloc(sizeof(*ptr));
-		_RBTreeNode_create(ptr, true, data, ts->_member_size);
-		return (TSEmplacePair) {
-			.iterator = ptr,
-			.inserted = true,
-		};
+
+TreeSetIterator _TreeSet_node_alloc(TreeSet *ts) {
+	if (!ts->_pool.free) {
+		char *nodes = _TreeSet_chunk_alloc(ts, ts->_pool.chunk_nodes);
+		if (!nodes) return NULL;
+		_TreeSet_nodes_free(ts, nodes, ts->_pool.chunk_nodes);
+		if (ts->_pool.chunk_nodes < 4096)
+			ts->_pool.chunk_nodes *= 2;
 	}
 
+	TreeSetIterator node = ts->_pool.free;
+	ts->_pool.free = node->left;
+	return node;
+}
+
+// Tops the free list up to at least `count` nodes with a single chunk.
+static bool _TreeSet_node_reserve(TreeSet *ts, size_t count) {
+	for (TreeSetIterator node = ts->_pool.free; node && count > 0; node = node->left)
+		--count;
+	if (count == 0) return true;
+	char *nodes = _TreeSet_chunk_alloc(ts, count);
+	if (!nodes) return false;
+	_TreeSet_nodes_free(ts, nodes, count);
+	return true;
+}
+
+void _TreeSet_node_free(TreeSet *ts, TreeSetIterator node) {
+	node->left = ts->_pool.free;
+	ts->_pool.free = node;
+}
+
+// Points the link to `old` from its parent (or the root) at `node` instead.
+void _TreeSet_transplant(TreeSet *ts, TreeSetIterator old, TreeSetIterator node) {
+	TreeSetIterator parent = old->parent;
+	if (!parent)
+		ts->_root = node;
+	else if (old == parent->left)
+		parent->left = node;
+	else
+		parent->right = node;
+	if (node) node->parent = parent;
+}
+
+void _TreeSet_left_rotate(TreeSet *ts, TreeSetIterator b) {
+	if (!b || !b->right) return;
+
+	TreeSetIterator c = b->right;
+	_TreeSet_transplant(ts, b, c);
+	b->right = c->left;
+	if (b->right) b->right->parent = b;
+	c->left = b;
+	b->parent = c;
+	if (ts->_count_offset) {
+		*_TreeSet_count(ts, c) = *_TreeSet_count(ts, b);
+		_TreeSet_recount(ts, b);
+	}
+}
+void _TreeSet_right_rotate(TreeSet *ts, TreeSetIterator b) {
+	if (!b || !b->left) return;
+
+	TreeSetIterator c = b->left;
+	_TreeSet_transplant(ts, b, c);
+	b->left = c->right;
+	if (b->left) b->left->parent = b;
+	c->right = b;
+	b->parent = c;
+	if (ts->_count_offset) {
+		*_TreeSet_count(ts, c) = *_TreeSet_count(ts, b);
+		_TreeSet_recount(ts, b);
+	}
+}
+
+TSEmplacePair _TreeSet_bst_emplace(TreeSet *ts, void *data, size_t size, int (*comparator)(void *, void *)) {
+	TreeSetIterator ptr = ts->_root, parent = NULL;
+	TreeSetIterator *link = &ts->_root;
+	uint64_t scratch;
+	void *key = comparator ? NULL : _TreeSet_key_of(ts, data, &scratch);
 	while (ptr) {
-		int result = comparator(ptr->data, data);
+		int result = comparator ? comparator(data, ptr->data) : _TreeSet_compare(ts, key, ptr);
 		if (result == 0)
 			return (TSEmplacePair) {
 				.iterator = ptr,
 				.inserted = false,
 			};
 
+		parent = ptr;
 		// data > ptr->data
-		if (result < 0) {
-			stack[(*size)++] = ptr->right;
-			if (!ptr->right) {
-				ptr->right = (TreeSetIterator) malloc(sizeof(*(ptr->right)));
-				_RBTreeNode_create(ptr->right, false, data, ts->_member_size);
-				return (TSEmplacePair) {
-					.iterator = ptr->right,
-					.inserted = true,
-				};
-			}
-			ptr = ptr->right;
-		}
-
+		if (result > 0)
+			link = &ptr->right;
 		// data < ptr->data
-		else {
-			stack[(*size)++] = ptr->left;
-			if (!ptr->left) {
-				ptr->left = (TreeSetIterator) malloc(sizeof(*(ptr->left)));
-				_RBTreeNode_create(ptr->left, false, data, ts->_member_size);
-				return (TSEmplacePair) {
-					.iterator = ptr->left,
-					.inserted = true,
-				};
-			}
-			ptr = ptr->left;
-		}
+		else
+			link = &ptr->left;
+		ptr = *link;
 	}
 
+	TreeSetIterator node = _TreeSet_node_alloc(ts);
+	if (!node)
+		return (TSEmplacePair) {
+			.iterator = NULL,
+			.inserted = false,
+		};
+	_RBTreeNode_create(node, ts->_root == NULL, data, size);
+	_TreeSet_node_set_key(ts, node);
+	node->parent = parent;
+	*link = node;
+	_TreeSet_recount(ts, node);
+	_TreeSet_count_path(ts, parent, 1);
 	return (TSEmplacePair) {
-		.iterator = NULL,
-		.inserted = false,
+		.iterator = node,
+		.inserted = true,
 	};
 }
-void _TreeSet_insert_rebalance(TreeSet *ts, TreeSetIterator *stack, unsigned int size) {
-	for (unsigned int i = size - 1; i > 1; --i) {
-		TreeSetIterator node = stack[i], parent = stack[i - 1], gp = stack[i - 2];
-		if (_RBTreeNode_black(parent)) break;
-
+bool _TreeSet_insert_rebalance(TreeSet *ts, TreeSetIterator node) {
+	while (!_RBTreeNode_black(node->parent)) {
+		// A red parent is never the root, so the grandparent exists.
+		TreeSetIterator parent = node->parent, gp = parent->parent;
 		TreeSetIterator uncle = parent == gp->left ? gp->right : gp->left;
 
 		// Red uncle = recolor
 		if (!_RBTreeNode_black(uncle)) {
-			_RBTreeNode_color_black(parent);
-			_RBTreeNode_color_black(uncle);
+			parent->black = true;
+			uncle->black = true;
 			gp->black = false;
+			node = gp; // resume at the grandparent
 			continue;
 		}
 
 		// Black uncle = rotations
-		TreeSetIterator ggp = (i > 2) ? stack[i - 3] : NULL;
-		bool gp_color = gp->black;
 		if (parent == gp->left) {
 			if (node == parent->right) {
-				_TreeSet_left_rotate(ts, parent, gp);
+				_TreeSet_left_rotate(ts, parent);
 				parent = node;
 			}
-			_TreeSet_right_rotate(ts, gp, ggp);
+			_TreeSet_right_rotate(ts, gp);
 		}
 		else {
 			if (node == parent->left) {
-				_TreeSet_right_rotate(ts, parent, gp);
+				_TreeSet_right_rotate(ts, parent);
 				parent = node;
 			}
-			_TreeSet_left_rotate(ts, gp, ggp);
+			_TreeSet_left_rotate(ts, gp);
 		}
 
-		gp->black = parent->black;
-		parent->black = gp_color;
+		parent->black = true;
+		gp->black = false;
 		break;
 	}
 
+	bool grew = !ts->_root->black;
 	ts->_root->black = true;
+	return grew;
 }
 
 size_t TreeSet_size(TreeSet *ts) {
 	return ts->size;
 }
 bool TreeSet_insert(TreeSet *ts, void *data) {
-	return TreeSet_custom_insert(ts, data, ts->_comparator);
+	return TreeSet_emplace(ts, data).inserted;
 }
 bool TreeSet_custom_insert(TreeSet *ts, void *data, int (*comparator)(void *, void *)) {
-	TreeSetIterator stack[65];
-	unsigned int size = 0;
-	bool inserted = _TreeSet_bst_insert(ts, data, comparator, stack, &size);
-	if (inserted) {
-		_TreeSet_insert_rebalance(ts, stack, size);
-		++ts->size;
-	}
-	return inserted;
+	return TreeSet_custom_emplace(ts, data, comparator).inserted;
 }
 TSEmplacePair TreeSet_emplace(TreeSet *ts, void *data) {
-	return TreeSet_custom_emplace(ts, data, ts->_comparator);
+	return _TreeSet_prepare_insert(ts, data, ts->_member_size, NULL);
 }
 TSEmplacePair TreeSet_custom_emplace(TreeSet *ts, void *data, int (*comparator)(void *, void *)) {
-	TreeSetIterator stack[65];
-	unsigned int size = 0;
-	TSEmplacePair pair = _TreeSet_bst_emplace(ts, data, comparator, stack, &size);
+	return _TreeSet_prepare_insert(ts, data, ts->_member_size, comparator);
+}
+TSEmplacePair _TreeSet_prepare_insert(TreeSet *ts, void *key, size_t key_size, int (*comparator)(void *, void *)) {
+	TSEmplacePair pair = _TreeSet_bst_emplace(ts, key, key_size, comparator);
 	if (pair.inserted) {
-		_TreeSet_insert_rebalance(ts, stack, size);
+		_TreeSet_insert_rebalance(ts, pair.iterator);
 		++ts->size;
 	}
 	return pair;
 }
 bool TreeSet_remove(TreeSet *ts, void *data) {
-	return TreeSet_custom_remove(ts, data, ts->_comparator);
+	uint64_t scratch;
+	return TreeSet_remove_key(ts, _TreeSet_key_of(ts, data, &scratch));
 }
-bool TreeSet_custom_remove(TreeSet *ts, void *data, int (*comparator)(void *, void *)) {
-	TreeSetIterator stack[65];
-	unsigned int size = 0;
-	TreeSetIterator ptr = ts->_root, parent = NULL;
-	while (ptr) {
-		stack[size++] = ptr;
-
-		int result = comparator(data, ptr->data);
-		if (result == 0) {
-			TreeSetError result = _TreeSet_bst_erase_parent(ts, ptr, parent);
-			if (result != TS_ERR_SUCCESS) return false;
-			_TreeSet_erase_rebalance(ts, ptr, parent, stack, size);
-			free(ptr);
-			return true;
-		}
-
-		parent = ptr;
-		if (result < 0)
-			ptr = ptr->left;
-		else
-			ptr = ptr->right;
-	}
-	return false;
-}
-TreeSetError _TreeSet_bst_erase_parent(TreeSet *ts, TreeSetIterator it, TreeSetIterator parent) {
-	if (!it)
-		return TS_ERR_SUCCESS;
-
-	if (!it->left && !it->right) {
-		if (!parent)
-			ts->_root = NULL;
-		else if (parent->left == it)
-			parent->left = NULL;
-		else if (parent->right == it)
-			parent->right = NULL;
-		else
-			return TS_ERR_INVALID_PARENT_ITERATOR;
-		return TS_ERR_SUCCESS;
-	}
-
-	if (!it->left) {
-		// right is valid
-		if (!parent)
-			ts->_root = it->right;
-		else if (parent->left == it)
-			parent->left = it->right;
-		else if (parent->right == it)
-			parent->right = it->right;
-		else
-			return TS_ERR_INVALID_PARENT_ITERATOR;
-		return TS_ERR_SUCCESS;
-	}
-
-	if (!it->right) {
-		// left is valid
-		if (!parent)
-			ts->_root = it->left;
-		else if (parent->left == it)
-			parent->left = it->left;
-		else if (parent->right == it)
-			parent->right = it->left;
-		else
-			return TS_ERR_INVALID_PARENT_ITERATOR;
-		return TS_ERR_SUCCESS;
-	}
-
-	TreeSetIterator successor = it->right, successor_parent = it;
-	while (successor->left) {
-		successor_parent = successor;
-		successor = successor->left;
-	}
-
-	if (successor_parent == it)
-		successor_parent->right = successor->right;
-	else
-		successor_parent->left = successor->right;
-
-	successor->left = it->left;
-	successor->right = it->right;
-
-	if (!parent)
-		ts->_root = successor;
-	if (parent->left == it)
-		parent->left = successor;
-	else if (parent->right == it)
-		parent->right = successor;
-	else
-		return TS_ERR_INVALID_PARENT_ITERATOR;
-	return TS_ERR_SUCCESS;
+bool TreeSet_remove_key(TreeSet *ts, void *key) {
+	TreeSetIterator it = TreeSet_find_key(ts, key);
+	return it && TreeSet_erase(ts, it) == TS_ERR_SUCCESS;
 }
-void _TreeSet_erase_rebalance(TreeSet *ts, TreeSetIterator it, TreeSetIterator parent, TreeSetIterator *stack, unsigned int size) {
-	if (!_RBTreeNode_black(it) && !it->left && !it->right)
-		return;
-
-	while (size > 2) {
-		TreeSetIterator ptr = stack[size - 1], parent = stack[size - 2], gp = stack[size - 3];
-		TreeSetIterator sibling = (parent->left == ptr) ? parent->right : parent->left;
-
-		// Case 1: sibling is red
-		if (!_RBTreeNode_black(sibling)) {
-			sibling->black = true;
-			parent->black = false;
-			if (parent->left == ptr)
-				_TreeSet_left_rotate(ts, parent, gp);
-			else
-				_TreeSet_right_rotate(ts, parent, gp);
-			sibling = (parent->left == ptr) ? parent->right : parent->left;
-		}
+bool TreeSet_custom_remove(TreeSet *ts, void *data, int (*comparator)(void *, void *)) {
+	TreeSetIterator it = TreeSet_custom_find(ts, data, comparator);
+	return it && TreeSet_erase(ts, it) == TS_ERR_SUCCESS;
+}
+// `node` (possibly NULL) carries an extra black; `parent` is its parent.
+void _TreeSet_erase_rebalance(TreeSet *ts, TreeSetIterator node, TreeSetIterator parent) {
+	while (node != ts->_root && _RBTreeNode_black(node)) {
+		// The extra black means the sibling subtree holds a black node, so it is not NULL.
+		if (node == parent->left) {
+			TreeSetIterator sibling = parent->right;
+
+			// Case 1: sibling is red
+			if (!sibling->black) {
+				sibling->black = true;
+				parent->black = false;
+				_TreeSet_left_rotate(ts, parent);
+				sibling = parent->right;
+			}
 
-		// Case 2: sibling is black and both children are black
-		if (!sibling || (_RBTreeNode_black(sibling) && _RBTreeNode_black(sibling->left) && _RBTreeNode_black(sibling->right))) {
-			if (sibling) sibling->black = true;
-			ptr = parent;
-			--size;
-			continue;
-		}
+			// Case 2: sibling is black and both children are black
+			if (_RBTreeNode_black(sibling->left) && _RBTreeNode_black(sibling->right)) {
+				sibling->black = false;
+				node = parent;
+				parent = node->parent;
+				continue;
+			}
 
-		// Case 3 + 4: at least 1 red child
-		if (parent->left == ptr) {
+			// Case 3 + 4: at least 1 red child
 			if (_RBTreeNode_black(sibling->right)) {
 				_RBTreeNode_color_black(sibling->left);
 				sibling->black = false;
-				_TreeSet_right_rotate(ts, sibling, parent);
+				_TreeSet_right_rotate(ts, sibling);
 				sibling = parent->right;
 			}
-
 			sibling->black = parent->black;
 			parent->black = true;
 			_RBTreeNode_color_black(sibling->right);
-			_TreeSet_left_rotate(ts, parent, gp);
+			_TreeSet_left_rotate(ts, parent);
 		} else {
+			TreeSetIterator sibling = parent->left;
+
+			if (!sibling->black) {
+				sibling->black = true;
+				parent->black = false;
+				_TreeSet_right_rotate(ts, parent);
+				sibling = parent->left;
+			}
+
+			if (_RBTreeNode_black(sibling->left) && _RBTreeNode_black(sibling->right)) {
+				sibling->black = false;
+				node = parent;
+				parent = node->parent;
+				continue;
+			}
+
 			if (_RBTreeNode_black(sibling->left)) {
 				_RBTreeNode_color_black(sibling->right);
 				sibling->black = false;
-				_TreeSet_left_rotate(ts, sibling, parent);
+				_TreeSet_left_rotate(ts, sibling);
 				sibling = parent->left;
 			}
-
 			sibling->black = parent->black;
 			parent->black = true;
 			_RBTreeNode_color_black(sibling->left);
-			_TreeSet_right_rotate(ts, parent, gp);
+			_TreeSet_right_rotate(ts, parent);
 		}
-
-		break;
+		node = ts->_root;
 	}
 
-	if (ts->_root) ts->_root->black = true;
+	_RBTreeNode_color_black(node);
 }
 TreeSetError TreeSet_erase(TreeSet *ts, TreeSetIterator it) {
-	TreeSetIterator stack[65];
-	unsigned int size = 0;
-	TreeSetIterator ptr = ts->_root, parent = NULL;
-	while (ptr) {
-		stack[size++] = ptr;
-
-		int result = ts->_comparator(it->data, ptr->data);
-		if (result == 0) {
-			TreeSetError result = _TreeSet_bst_erase_parent(ts, ptr, parent);
-			if (result != TS_ERR_SUCCESS) return result;
-			_TreeSet_erase_rebalance(ts, ptr, parent, stack, size);
-			free(ptr);
-			return TS_ERR_SUCCESS;
+	if (!it) return TS_ERR_INVALID_ITERATOR;
+
+	// `node` takes the place of the unlinked node; relinking (not copying) the
+	// successor keeps every other iterator pointing at its own element.
+	TreeSetIterator node, parent;
+	bool removed_black = it->black;
+	if (!it->left || !it->right)
+		_TreeSet_count_path(ts, it->parent, (size_t) -1);
+	if (!it->left) {
+		node = it->right;
+		parent = it->parent;
+		_TreeSet_transplant(ts, it, node);
+	} else if (!it->right) {
+		node = it->left;
+		parent = it->parent;
+		_TreeSet_transplant(ts, it, node);
+	} else {
+		TreeSetIterator successor = _RBTreeNode_min(it->right);
+		removed_black = successor->black;
+		_TreeSet_count_path(ts, successor->parent, (size_t) -1);
+		node = successor->right;
+		if (successor->parent == it) {
+			parent = successor;
+		} else {
+			parent = successor->parent;
+			_TreeSet_transplant(ts, successor, node);
+			successor->right = it->right;
+			successor->right->parent = successor;
 		}
+		_TreeSet_transplant(ts, it, successor);
+		successor->left = it->left;
+		successor->left->parent = successor;
+		successor->black = it->black;
+		if (ts->_count_offset)
+			*_TreeSet_count(ts, successor) = *_TreeSet_count(ts, it);
+	}
 
-		parent = ptr;
+	if (removed_black)
+		_TreeSet_erase_rebalance(ts, node, parent);
+	_TreeSet_node_free(ts, it);
+	--ts->size;
+	return TS_ERR_SUCCESS;
+}
+
+// Links nodes[lo, hi) into a balanced subtree. Midpoint splits leave every NULL
+// child at depth floor(log2(n + 1)) or one below it, so colouring exactly the
+// nodes at that depth red gives every path the same number of black nodes.
+static TreeSetIterator _TreeSet_build(TreeSet *ts, char *nodes, size_t lo, size_t hi, size_t depth, size_t red_depth, TreeSetIterator parent) {
+	if (lo == hi) return NULL;
+	size_t mid = lo + (hi - lo) / 2;
+	TreeSetIterator node = _TreeSet_slot(ts, nodes, mid);
+	node->black = depth != red_depth;
+	node->parent = parent;
+	node->left = _TreeSet_build(ts, nodes, lo, mid, depth + 1, red_depth, node);
+	node->right = _TreeSet_build(ts, nodes, mid + 1, hi, depth + 1, red_depth, node);
+	_TreeSet_recount(ts, node);
+	return node;
+}
+TreeSetError TreeSet_from_sorted(TreeSet *ts, View *view) {
+	if (ts->_root) {
+		TreeSet sorted = TreeSet_init_with_allocator(ts->_comparator, NULL, ts->_member_size, ts->_allocator);
+		if (ts->_u64_key_of)
+			TreeSet_set_u64_key(&sorted, ts->_u64_key_of);
+		else if (ts->_key_of)
+			TreeSet_set_key(&sorted, ts->_key_of, ts->_comparator);
+		TreeSetError error = TreeSet_from_sorted(&sorted, view);
+		if (error == TS_ERR_SUCCESS)
+			error = TreeSet_union(ts, &sorted);
+		TreeSet_invalidate(&sorted);
+		return error;
+	}
+	if (view->size == 0) return TS_ERR_SUCCESS;
+
+	char *nodes = _TreeSet_chunk_alloc(ts, view->size);
+	if (!nodes) return TS_ERR_OOM;
+
+	size_t count = 0;
+	for (size_t i = 0; i < view->size; ++i) {
+		void *data = View_offset(view, i);
+		uint64_t scratch;
+		if (count > 0 && _TreeSet_compare(ts, _TreeSet_key_of(ts, data, &scratch), _TreeSet_slot(ts, nodes, count - 1)) == 0)
+			continue;
+		TreeSetIterator node = _TreeSet_slot(ts, nodes, count);
+		memcpy(node->data, data, ts->_member_size);
+		_TreeSet_node_set_key(ts, node);
+		++count;
+	}
+	// Slots left over by duplicates serve later insertions.
+	_TreeSet_nodes_free(ts, nodes + (count * ts->_node_size), view->size - count);
+
+	size_t red_depth = 0;
+	while ((count + 1) >> (red_depth + 1))
+		++red_depth;
+	ts->_root = _TreeSet_build(ts, nodes, 0, count, 0, red_depth, NULL);
+	ts->size = count;
+	return TS_ERR_SUCCESS;
+}
+
+// A detached subtree with a black (or NULL) root, and its black height counting the root.
+struct _RBTreePart {
+	TreeSetIterator root;
+	size_t height;
+};
+
+static size_t _RBTreeNode_black_height(TreeSetIterator node) {
+	size_t height = 0;
+	for (; node; node = node->left)
+		height += node->black;
+	return height;
+}
+
+// Cuts `node` (a child of height `height`) loose as a tree of its own, blackening a red root.
+static struct _RBTreePart _TreeSet_detach(TreeSetIterator node, size_t height) {
+	if (!node) return (struct _RBTreePart) { NULL, 0 };
+	node->parent = NULL;
+	if (!node->black) {
+		node->black = true;
+		++height;
+	}
+	return (struct _RBTreePart) { node, height };
+}
+
+// Joins left < middle < right in O(|left.height - right.height| + 1). `middle` hangs
+// in red off the taller tree's inner spine, beside the black subtree as tall as the
+// shorter tree, and is fixed up like an insertion. `ts->_root` is used as scratch.
+static struct _RBTreePart _TreeSet_join(TreeSet *ts, struct _RBTreePart left, TreeSetIterator middle, struct _RBTreePart right) {
+	middle->parent = NULL;
+	if (left.height == right.height) {
+		middle->black = true;
+		middle->left = left.root;
+		middle->right = right.root;
+		if (left.root) left.root->parent = middle;
+		if (right.root) right.root->parent = middle;
+		_TreeSet_recount(ts, middle);
+		return (struct _RBTreePart) { middle, left.height + 1 };
+	}
+
+	bool left_taller = left.height > right.height;
+	struct _RBTreePart taller = left_taller ? left : right;
+	size_t target = left_taller ? right.height : left.height, height = taller.height;
+	TreeSetIterator parent = NULL, node = taller.root;
+	while (!_RBTreeNode_black(node) || height != target) {
+		height -= node->black;
+		parent = node;
+		node = left_taller ? node->right : node->left;
+	}
+
+	middle->black = false;
+	middle->parent = parent;
+	if (left_taller) {
+		middle->left = node;
+		middle->right = right.root;
+		if (right.root) right.root->parent = middle;
+		parent->right = middle;
+	} else {
+		middle->left = left.root;
+		middle->right = node;
+		if (left.root) left.root->parent = middle;
+		parent->left = middle;
+	}
+	if (node) node->parent = middle;
+	_TreeSet_recount(ts, middle);
+	_TreeSet_count_path(ts, parent, 1 + _TreeSet_subtree_size(ts, left_taller ? right.root : left.root));
+
+	ts->_root = taller.root;
+	bool grew = _TreeSet_insert_rebalance(ts, middle);
+	return (struct _RBTreePart) { ts->_root, taller.height + grew };
+}
+
+// Splits `tree` into the elements below and above `key`, returning the detached node equal to it, if any.
+static TreeSetIterator _TreeSet_split(TreeSet *ts, struct _RBTreePart tree, void *key, struct _RBTreePart *less, struct _RBTreePart *greater) {
+	if (!tree.root) {
+		*less = *greater = tree;
+		return NULL;
+	}
+	TreeSetIterator node = tree.root, found;
+	size_t height = tree.height - node->black;
+	struct _RBTreePart left = _TreeSet_detach(node->left, height), right = _TreeSet_detach(node->right, height);
+
+	int result = _TreeSet_compare(ts, key, node);
+	if (result == 0) {
+		*less = left;
+		*greater = right;
+		return node;
+	}
+	if (result < 0) {
+		found = _TreeSet_split(ts, left, key, less, &left);
+		*greater = _TreeSet_join(ts, left, node, right);
+	} else {
+		found = _TreeSet_split(ts, right, key, &right, greater);
+		*less = _TreeSet_join(ts, left, node, right);
+	}
+	return found;
+}
+
+// Splits `tree` around the element of `other`, a node of another set with the same ordering.
+static TreeSetIterator _TreeSet_split_at(TreeSet *ts, struct _RBTreePart tree, TreeSetIterator other, struct _RBTreePart *less, struct _RBTreePart *greater) {
+	uint64_t scratch;
+	return _TreeSet_split(ts, tree, _TreeSet_key_of(ts, other->data, &scratch), less, greater);
+}
+
+// Detaches the largest node of a non-empty `tree` into `*last` and returns the rest.
+static struct _RBTreePart _TreeSet_split_last(TreeSet *ts, struct _RBTreePart tree, TreeSetIterator *last) {
+	TreeSetIterator node = tree.root;
+	size_t height = tree.height - node->black;
+	struct _RBTreePart left = _TreeSet_detach(node->left, height), right = _TreeSet_detach(node->right, height);
+	if (!right.root) {
+		*last = node;
+		return left;
+	}
+	right = _TreeSet_split_last(ts, right, last);
+	return _TreeSet_join(ts, left, node, right);
+}
+
+// Joins left < right without a middle element.
+static struct _RBTreePart _TreeSet_concat(TreeSet *ts, struct _RBTreePart left, struct _RBTreePart right) {
+	if (!left.root) return right;
+	if (!right.root) return left;
+	TreeSetIterator last;
+	left = _TreeSet_split_last(ts, left, &last);
+	return _TreeSet_join(ts, left, last, right);
+}
+
+static void _TreeSet_drop(TreeSet *ts, TreeSetIterator node) {
+	if (!node) return;
+	_TreeSet_drop(ts, node->left);
+	_TreeSet_drop(ts, node->right);
+	_TreeSet_node_free(ts, node);
+	--ts->size;
+}
+
+// Copies a subtree of another set into reserved nodes, keeping its shape and colours.
+static TreeSetIterator _TreeSet_clone(TreeSet *ts, TreeSetIterator node, TreeSetIterator parent) {
+	if (!node) return NULL;
+	TreeSetIterator copy = _TreeSet_node_alloc(ts);
+	_RBTreeNode_create(copy, node->black, node->data, ts->_member_size);
+	_TreeSet_node_set_key(ts, copy);
+	copy->parent = parent;
+	copy->left = _TreeSet_clone(ts, node->left, copy);
+	copy->right = _TreeSet_clone(ts, node->right, copy);
+	_TreeSet_recount(ts, copy);
+	++ts->size;
+	return copy;
+}
+
+// The recursions below split `tree` (owned by `ts`) around the root of `other`, a
+// read-only subtree of the other set, recurse on both halves and join the results.
+static struct _RBTreePart _TreeSet_union(TreeSet *ts, struct _RBTreePart tree, TreeSetIterator other, size_t other_height) {
+	if (!other) return tree;
+	if (!tree.root) return _TreeSet_detach(_TreeSet_clone(ts, other, NULL), other_height);
+
+	struct _RBTreePart less, greater;
+	TreeSetIterator node = _TreeSet_split_at(ts, tree, other, &less, &greater);
+	other_height -= other->black;
+	less = _TreeSet_union(ts, less, other->left, other_height);
+	greater = _TreeSet_union(ts, greater, other->right, other_height);
+	if (!node) {
+		node = _TreeSet_node_alloc(ts);
+		_RBTreeNode_create(node, false, other->data, ts->_member_size);
+		_TreeSet_node_set_key(ts, node);
+		++ts->size;
+	}
+	return _TreeSet_join(ts, less, node, greater);
+}
+static struct _RBTreePart _TreeSet_intersection(TreeSet *ts, struct _RBTreePart tree, TreeSetIterator other) {
+	if (!tree.root) return tree;
+	if (!other) {
+		_TreeSet_drop(ts, tree.root);
+		return (struct _RBTreePart) { NULL, 0 };
+	}
+
+	struct _RBTreePart less, greater;
+	TreeSetIterator node = _TreeSet_split_at(ts, tree, other, &less, &greater);
+	less = _TreeSet_intersection(ts, less, other->left);
+	greater = _TreeSet_intersection(ts, greater, other->right);
+	return node ? _TreeSet_join(ts, less, node, greater) : _TreeSet_concat(ts, less, greater);
+}
+static struct _RBTreePart _TreeSet_difference(TreeSet *ts, struct _RBTreePart tree, TreeSetIterator other) {
+	if (!tree.root || !other) return tree;
+
+	struct _RBTreePart less, greater;
+	TreeSetIterator node = _TreeSet_split_at(ts, tree, other, &less, &greater);
+	less = _TreeSet_difference(ts, less, other->left);
+	greater = _TreeSet_difference(ts, greater, other->right);
+	if (node) {
+		_TreeSet_node_free(ts, node);
+		--ts->size;
+	}
+	return _TreeSet_concat(ts, less, greater);
+}
+
+TreeSetError TreeSet_union(TreeSet *ts, TreeSet *other) {
+	if (ts == other || !other->_root) return TS_ERR_SUCCESS;
+	if (!_TreeSet_node_reserve(ts, other->size)) return TS_ERR_OOM;
+	struct _RBTreePart tree = { ts->_root, _RBTreeNode_black_height(ts->_root) };
+	ts->_root = _TreeSet_union(ts, tree, other->_root, _RBTreeNode_black_height(other->_root)).root;
+	return TS_ERR_SUCCESS;
+}
+void TreeSet_intersection(TreeSet *ts, TreeSet *other) {
+	if (ts == other) return;
+	struct _RBTreePart tree = { ts->_root, _RBTreeNode_black_height(ts->_root) };
+	ts->_root = _TreeSet_intersection(ts, tree, other->_root).root;
+}
+void TreeSet_difference(TreeSet *ts, TreeSet *other) {
+	if (ts == other) {
+		_TreeSet_drop(ts, ts->_root);
+		ts->_root = NULL;
+		return;
+	}
+	struct _RBTreePart tree = { ts->_root, _RBTreeNode_black_height(ts->_root) };
+	ts->_root = _TreeSet_difference(ts, tree, other->_root).root;
+}
+
+TreeSetIterator TreeSet_begin(TreeSet *ts) {
+	return ts->_root ? _RBTreeNode_min(ts->_root) : NULL;
+}
+TreeSetIterator TreeSet_end(TreeSet *ts) {
+	(void) ts;
+	return NULL;
+}
+TreeSetIterator TreeSet_next(TreeSet *ts, TreeSetIterator it) {
+	(void) ts;
+	if (!it) return NULL;
+	if (it->right) return _RBTreeNode_min(it->right);
+	while (it->parent && it == it->parent->right)
+		it = it->parent;
+	return it->parent;
+}
+TreeSetIterator TreeSet_prev(TreeSet *ts, TreeSetIterator it) {
+	if (!it) return ts->_root ? _RBTreeNode_max(ts->_root) : NULL;
+	if (it->left) return _RBTreeNode_max(it->left);
+	while (it->parent && it == it->parent->left)
+		it = it->parent;
+	return it->parent;
+}
+
+// The element-probe lookups reduce the probe to its key and share the bare-key descents.
+TreeSetIterator TreeSet_find(TreeSet *ts, void *data) {
+	uint64_t scratch;
+	return TreeSet_find_key(ts, _TreeSet_key_of(ts, data, &scratch));
+}
+TreeSetIterator TreeSet_find_key(TreeSet *ts, void *key) {
+	TreeSetIterator ptr = ts->_root;
+	while (ptr) {
+		int result = _TreeSet_compare(ts, key, ptr);
+		if (result == 0)
+			return ptr;
 		if (result < 0)
 			ptr = ptr->left;
 		else
 			ptr = ptr->right;
 	}
-	return TS_ERR_INVALID_ITERATOR;
-}
-
-TreeSetIterator TreeSet_find(TreeSet *ts, void *data) {
-	return TreeSet_custom_find(ts, data, ts->_comparator);
+	return NULL;
 }
 TreeSetIterator TreeSet_custom_find(TreeSet *ts, void *data, int (*comparator)(void *, void *)) {
 	TreeSetIterator ptr = ts->_root;
@@ -448,37 +851,66 @@ TreeSetIterator TreeSet_custom_find(TreeSet *ts, void *data, int (*comparator)(v
 bool TreeSet_contains(TreeSet *ts, void *data) {
 	return TreeSet_find(ts, data) != NULL;
 }
+bool TreeSet_contains_key(TreeSet *ts, void *key) {
+	return TreeSet_find_key(ts, key) != NULL;
+}
 bool TreeSet_custom_contains(TreeSet *ts, void *data, int (*comparator)(void *, void *)) {
 	return TreeSet_custom_find(ts, data, comparator) != NULL;
 }
 
 TreeSetIterator TreeSet_upper_bound(TreeSet *ts, void *data) {
-	return TreeSet_custom_upper_bound(ts, data, ts->_comparator);
+	uint64_t scratch;
+	return TreeSet_upper_bound_key(ts, _TreeSet_key_of(ts, data, &scratch));
 }
-TreeSetIterator TreeSet_custom_upper_bound(TreeSet *ts, void *data, int (*comparator)(void *, void *)) {
+TreeSetIterator TreeSet_upper_bound_key(TreeSet *ts, void *key) {
 	TreeSetIterator ptr = ts->_root;
 	TreeSetIterator candidate = NULL;
 	while (ptr) {
-		int result = comparator(data, ptr->data);
-		if (result < 0) {
+		if (_TreeSet_compare(ts, key, ptr) < 0) {
 			candidate = ptr;
-			ptr = ptr->right;
+			ptr = ptr->left;
 		} else {
+			ptr = ptr->right;
+		}
+	}
+	return candidate;
+}
+TreeSetIterator TreeSet_custom_upper_bound(TreeSet *ts, void *data, int (*comparator)(void *, void *)) {
+	TreeSetIterator ptr = ts->_root;
+	TreeSetIterator candidate = NULL;
+	while (ptr) {
+		if (comparator(data, ptr->data) < 0) {
+			candidate = ptr;
 			ptr = ptr->left;
+		} else {
+			ptr = ptr->right;
 		}
 	}
 	return candidate;
 }
 
 TreeSetIterator TreeSet_lower_bound(TreeSet *ts, void *data) {
-	return TreeSet_custom_lower_bound(ts, data, ts->_comparator);
+	uint64_t scratch;
+	return TreeSet_lower_bound_key(ts, _TreeSet_key_of(ts, data, &scratch));
+}
+TreeSetIterator TreeSet_lower_bound_key(TreeSet *ts, void *key) {
+	TreeSetIterator ptr = ts->_root;
+	TreeSetIterator candidate = NULL;
+	while (ptr) {
+		if (_TreeSet_compare(ts, key, ptr) <= 0) {
+			candidate = ptr;
+			ptr = ptr->left;
+		} else {
+			ptr = ptr->right;
+		}
+	}
+	return candidate;
 }
 TreeSetIterator TreeSet_custom_lower_bound(TreeSet *ts, void *data, int (*comparator)(void *, void *)) {
 	TreeSetIterator ptr = ts->_root;
 	TreeSetIterator candidate = NULL;
 	while (ptr) {
-		int result = comparator(data, ptr->data);
-		if (result < 0) {
+		if (comparator(data, ptr->data) <= 0) {
 			candidate = ptr;
 			ptr = ptr->left;
 		} else {
@@ -487,3 +919,78 @@ TreeSetIterator TreeSet_custom_lower_bound(TreeSet *ts, void *data, int (*compar
 	}
 	return candidate;
 }
+
+size_t TreeSet_rank(TreeSet *ts, void *data) {
+	uint64_t scratch;
+	return TreeSet_rank_key(ts, _TreeSet_key_of(ts, data, &scratch));
+}
+size_t TreeSet_rank_key(TreeSet *ts, void *key) {
+	size_t rank = 0;
+	if (!ts->_count_offset) {
+		for (TreeSetIterator it = TreeSet_begin(ts); it && _TreeSet_compare(ts, key, it) > 0; it = TreeSet_next(ts, it))
+			++rank;
+		return rank;
+	}
+
+	TreeSetIterator ptr = ts->_root;
+	while (ptr) {
+		if (_TreeSet_compare(ts, key, ptr) <= 0) {
+			ptr = ptr->left;
+		} else {
+			rank += 1 + _TreeSet_subtree_size(ts, ptr->left);
+			ptr = ptr->right;
+		}
+	}
+	return rank;
+}
+size_t TreeSet_custom_rank(TreeSet *ts, void *data, int (*comparator)(void *, void *)) {
+	size_t rank = 0;
+	if (!ts->_count_offset) {
+		for (TreeSetIterator it = TreeSet_begin(ts); it && comparator(data, it->data) > 0; it = TreeSet_next(ts, it))
+			++rank;
+		return rank;
+	}
+
+	TreeSetIterator ptr = ts->_root;
+	while (ptr) {
+		if (comparator(data, ptr->data) <= 0) {
+			ptr = ptr->left;
+		} else {
+			rank += 1 + _TreeSet_subtree_size(ts, ptr->left);
+			ptr = ptr->right;
+		}
+	}
+	return rank;
+}
+
+TreeSetIterator TreeSet_select(TreeSet *ts, size_t k) {
+	if (k >= ts->size) return NULL;
+	if (!ts->_count_offset) {
+		TreeSetIterator it = TreeSet_begin(ts);
+		while (k--)
+			it = TreeSet_next(ts, it);
+		return it;
+	}
+
+	TreeSetIterator ptr = ts->_root;
+	for (;;) {
+		size_t left = _TreeSet_subtree_size(ts, ptr->left);
+		if (k == left)
+			return ptr;
+		if (k < left) {
+			ptr = ptr->left;
+		} else {
+			k -= left + 1;
+			ptr = ptr->right;
+		}
+	}
+}
+
+size_t TreeSet_count_range(TreeSet *ts, void *lo, void *hi) {
+	size_t below_lo = TreeSet_rank(ts, lo), below_hi = TreeSet_rank(ts, hi);
+	return below_hi > below_lo ? below_hi - below_lo : 0;
+}
+size_t TreeSet_count_range_key(TreeSet *ts, void *lo, void *hi) {
+	size_t below_lo = TreeSet_rank_key(ts, lo), below_hi = TreeSet_rank_key(ts, hi);
+	return below_hi > below_lo ? below_hi - below_lo : 0;
+}
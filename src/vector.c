@@ -1,53 +1,86 @@
 #include "vector.h"
 #include "error.h"
 #include "slice.h"
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 
 Errable(Vector) Vector_init(size_t member_size) {
+	return Vector_init_with_allocator(member_size, Allocator_default());
+}
+
+Errable(Vector) Vector_init_with_allocator(size_t member_size, const Allocator *allocator) {
 	Vector v;
 	VectorError result;
-	if ((result = Vector_create(&v, member_size)))
+	if ((result = Vector_create_with_allocator(&v, member_size, allocator)))
 		return Err(result, Vector);
 	return Ok(v, Vector);
 }
 
 void Vector_default(Vector *v, size_t member_size) {
+	Vector_default_with_allocator(v, member_size, Allocator_default());
+}
+
+void Vector_default_with_allocator(Vector *v, size_t member_size, const Allocator *allocator) {
 	v->data = NULL;
 	*((size_t *) &v->_member_size) = member_size;
 	v->size = 0;
 	v->_capacity = 0;
+	v->_allocator = allocator;
 }
 
 VectorError Vector_create(Vector *v, size_t member_size) {
-	void *data = malloc(32 * member_size);
+	return Vector_create_with_allocator(v, member_size, Allocator_default());
+}
+
+VectorError Vector_create_with_allocator(Vector *v, size_t member_size, const Allocator *allocator) {
+	void *data = Allocator_alloc(allocator, 32 * member_size);
 	if (!data) return VEC_ERR_OOM;
 
 	v->data = data;
 	*((size_t *) &v->_member_size) = member_size;
 	v->_capacity = 32;
 	v->size = 0;
+	v->_allocator = allocator;
 	return VEC_ERR_SUCCESS;
 }
 
-VectorError Vector_cpy(Vector *dest, const Vector *src) {
-	if (!src) {
-		Vector_default(dest, 0);
-		return VEC_ERR_SUCCESS;
-	}
+static size_t _Vector_allocated_bytes(const Vector *v) {
+	return v->_capacity * v->_member_size;
+}
 
-	if (src->size == 0) {
-		Vector_default(dest, src->_member_size);
-		return VEC_ERR_SUCCESS;
+static VectorError _Vector_resize(Vector *v, size_t capacity) {
+	void *data = Allocator_realloc(v->_allocator, v->data, _Vector_allocated_bytes(v), capacity * v->_member_size);
+	if (!data) return VEC_ERR_OOM;
+	v->data = data;
+	v->_capacity = capacity;
+	return VEC_ERR_SUCCESS;
+}
+
+// Grows geometrically so that any mix of appends costs amortised O(1) per element.
+static VectorError _Vector_grow(Vector *v, size_t additional) {
+	size_t needed = v->size + additional;
+	if (needed <= v->_capacity) return VEC_ERR_SUCCESS;
+	size_t capacity = (size_t) ((double) v->_capacity * VECTOR_GROWTH_FACTOR);
+	if (capacity < needed) capacity = needed;
+	return _Vector_resize(v, capacity);
+}
+
+VectorError Vector_cpy(Vector *dest, const Vector *src) {
+	// dest keeps its allocator, and its buffer when the element size matches.
+	size_t member_size = src ? src->_member_size : dest->_member_size;
+	if (dest->_member_size != member_size) {
+		Vector_invalidate(dest);
+		*((size_t *) &dest->_member_size) = member_size;
 	}
+	dest->size = 0;
+	if (!src || src->size == 0) return VEC_ERR_SUCCESS;
 
-	void *data = realloc(dest->data, src->_member_size * src->size);
-	if (!data) return VEC_ERR_OOM;
-	dest->data = data;
-	memcpy(dest->data, src->data, src->_member_size * src->size);
+	VectorError result;
+	if ((result = Vector_reserve(dest, src->size)))
+		return result;
+	memcpy(dest->data, src->data, src->size * member_size);
 	dest->size = src->size;
-	*((size_t *) &dest->_member_size) = src->_member_size;
-	dest->_capacity = 0;
 	return VEC_ERR_SUCCESS;
 }
 
@@ -59,12 +92,15 @@ void Vector_mv(Vector *dest, Vector *src) {
 	dest->size = src->size;
 	*((size_t *) &dest->_member_size) = src->_member_size;
 	dest->_capacity = src->_capacity;
+	dest->_allocator = src->_allocator;
 
-	Vector_default(src, src->_member_size);
+	src->data = NULL;
+	src->size = 0;
+	src->_capacity = 0;
 }
 
 void Vector_invalidate(Vector *v) {
-	free(v->data);
+	Allocator_free(v->_allocator, v->data, _Vector_allocated_bytes(v));
 	v->data = NULL;
 	v->size = 0;
 	v->_capacity = 0;
@@ -77,17 +113,16 @@ void Vector_custom_invalidate(Vector *v, void (*destructor)(void *)) {
 }
 
 void Vector_clear(Vector *v) {
-	v->_capacity += v->size;
 	v->size = 0;
 }
 
 VectorError Vector_shrink(Vector *v) {
-	if (v->_capacity == 0) return VEC_ERR_SUCCESS;
-	void *data = realloc(v->data, v->size * v->_member_size);
-	if (!data) return VEC_ERR_OOM;
-	v->data = data;
-	v->_capacity = 0;
-	return VEC_ERR_SUCCESS;
+	if (v->_capacity == v->size) return VEC_ERR_SUCCESS;
+	if (v->size == 0) {
+		Vector_invalidate(v);
+		return VEC_ERR_SUCCESS;
+	}
+	return _Vector_resize(v, v->size);
 }
 
 size_t Vector_size(Vector *v) {
@@ -111,44 +146,47 @@ void Vector_set(Vector *v, size_t index, void *data) {
 	memcpy(ptr, data, v->_member_size);
 }
 
+size_t Vector_capacity(Vector *v) {
+	return v->_capacity;
+}
+
 VectorError Vector_reserve(Vector *v, size_t capacity) {
 	if (v->_capacity >= capacity) return VEC_ERR_SUCCESS;
-	void *data = realloc(v->data, v->_member_size * (v->size + capacity));
-	if (!data) return VEC_ERR_OOM;
-	v->data = data;
-	v->_capacity = capacity;
-	return VEC_ERR_SUCCESS;
+	return _Vector_resize(v, capacity);
 }
 
 VectorError Vector_append(Vector *v, void *data) {
-	if (v->_capacity == 0) {
-		VectorError result;
-		if ((result = Vector_reserve(v, (v->size * 2) + 1)))
-			return result;
-	}
+	if (v->size == v->_capacity)
+		return Vector_append_members(v, data, 1);
 	memcpy(((char *) v->data) + (v->size++ * v->_member_size), data, v->_member_size);
-	--v->_capacity;
 	return VEC_ERR_SUCCESS;
 }
 
 VectorError Vector_append_members(Vector *v, void *data, size_t n) {
-	size_t min = n > v->_capacity ? v->_capacity : n;
-	memcpy(((char *) v->data) + (v->size * v->_member_size), data, min * v->_member_size);
-	n -= min;
-	v->_capacity -= min;
-	v->size += min;
-	data = ((char *) data) + (min * v->_member_size);
-
-	if (!n) return VEC_ERR_SUCCESS;
+	if (n == 0) return VEC_ERR_SUCCESS;
+	// Elements taken from this Vector's own buffer must be found again after it moves.
+	char *base = (char *) v->data;
+	bool aliased = base && (char *) data >= base && (char *) data < base + _Vector_allocated_bytes(v);
+	size_t offset = aliased ? (size_t) ((char *) data - base) : 0;
+
 	VectorError result;
-	if ((result = Vector_reserve(v, n)))
+	if ((result = _Vector_grow(v, n)))
 		return result;
+	if (aliased)
+		data = ((char *) v->data) + offset;
 	memcpy(((char *) v->data) + (v->size * v->_member_size), data, v->_member_size * n);
 	v->size += n;
-	v->_capacity -= n;
 	return VEC_ERR_SUCCESS;
 }
 
+void *Vector_append_uninit(Vector *v, size_t n) {
+	if (_Vector_grow(v, n))
+		return NULL;
+	void *slots = Vector_offset(v, v->size);
+	v->size += n;
+	return slots;
+}
+
 VectorError Vector_append_vector(Vector *v, Vector *a) {
 	VectorError result;
 	if ((result = Vector_append_members(v, a->data, a->size)))
@@ -169,7 +207,6 @@ void Vector_swap(Vector *v, size_t index_a, size_t index_b) {
 
 VectorError Vector_pop_back(Vector *v) {
 	if (v->size == 0) return VEC_ERR_EMPTY_POP_BACK;
-	++v->_capacity;
 	--v->size;
 	return VEC_ERR_SUCCESS;
 }
@@ -177,12 +214,13 @@ VectorError Vector_pop_back(Vector *v) {
 Errable(Vector) Vector_sublist(Vector *v, size_t from , size_t to) {
 	Vector vec = {
 		.size = to - from,
-		._capacity = 0,
+		._capacity = to - from,
 		._member_size = v->_member_size,
+		._allocator = v->_allocator,
 	};
-	vec.data = malloc(vec.size * vec._member_size);
+	vec.data = Allocator_alloc(vec._allocator, vec.size * vec._member_size);
 	if (!vec.data) return Err(VEC_ERR_OOM, Vector);
-	memcpy(vec.data, v->data + from, vec.size);
+	memcpy(vec.data, Vector_offset(v, from), vec.size * vec._member_size);
 	return Ok(vec, Vector);
 }
 
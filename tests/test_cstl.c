@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <stdint.h>
+#include <pthread.h>
 
 #include "vector.h"
 #include "array.h"
@@ -13,6 +15,31 @@
 #include "pqueue.h"
 #include "slab.h"
 #include "error.h"
+#include "hset.h"
+#include "hmap.h"
+#include "tset.h"
+#include "ipqueue.h"
+#include "rheap.h"
+#include "cpqueue.h"
+#include "bset.h"
+#include "bmap.h"
+#include "tmap.h"
+#include "ptset.h"
+#include "slset.h"
+#include "slmap.h"
+
+CSTL_VECTOR_DEFINE(int, IntVec)
+
+typedef struct Timer {
+    long deadline;
+    int id;
+} Timer;
+
+static inline int timer_less(const Timer *a, const Timer *b) {
+    return a->deadline < b->deadline;
+}
+
+CSTL_PQUEUE_DEFINE(Timer, TimerHeap, timer_less)
 
 int int_comparator(void *a, void *b) {
     int x = *(int*)a;
@@ -20,6 +47,325 @@ int int_comparator(void *a, void *b) {
     return y - x; // max-heap
 }
 
+size_t int_hash(void *a) {
+    return (size_t) *(int*)a;
+}
+
+int int_eq(void *a, void *b) {
+    return *(int*)a != *(int*)b;
+}
+
+int int_cmp(void *a, void *b) {
+    int x = *(int*)a;
+    int y = *(int*)b;
+    return (x > y) - (x < y);
+}
+
+// A wide record looked up by its id, for the TreeSet key extractor tests.
+typedef struct {
+    char payload[56];
+    uint64_t id;
+} Record;
+
+void *record_id(void *record) {
+    return &((Record *) record)->id;
+}
+
+uint64_t record_u64_id(void *record) {
+    return ((Record *) record)->id;
+}
+
+// An element that needs the strictest alignment; UBSan flags every access to a misplaced one.
+typedef struct {
+    long double weight;
+} Weight;
+
+int weight_cmp(void *a, void *b) {
+    long double x = ((Weight *) a)->weight, y = ((Weight *) b)->weight;
+    return (x > y) - (x < y);
+}
+
+uint64_t weight_u64(void *a) {
+    return (uint64_t) ((Weight *) a)->weight;
+}
+
+size_t u64_hash(void *a) {
+    return (size_t) (*(uint64_t *) a * 0x9E3779B97F4A7C15ULL);
+}
+
+int u64_cmp(void *a, void *b) {
+    uint64_t x = *(uint64_t *) a, y = *(uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+// Checks the left-leaning red-black invariants of a PersistentTreeSet; returns the black height.
+int ptree_check(struct _PTreeNode *node) {
+    if (!node) return 1;
+    assert(node->refs >= 1 && !(node->right && !node->right->black));
+    if (!node->black) assert(!(node->left && !node->left->black));
+    int left = ptree_check(node->left), right = ptree_check(node->right);
+    assert(left == right);
+    return left + node->black;
+}
+
+// Gives out `*ctx` allocations, then fails.
+void *budget_alloc(void *ctx, size_t bytes) {
+    size_t *budget = ctx;
+    if (*budget == 0) return NULL;
+    --*budget;
+    return malloc(bytes);
+}
+
+void budget_free(void *ctx, void *ptr, size_t bytes) {
+    (void) ctx;
+    (void) bytes;
+    free(ptr);
+}
+
+// A writer publishes versions holding exactly PTS_WINDOW consecutive keys.
+#define PTS_WINDOW 64
+#define PTS_STEPS 2000
+
+typedef struct PTSPublisher {
+    pthread_mutex_t lock;
+    PersistentTreeSet published; // guarded by lock
+    bool done;                   // guarded by lock
+} PTSPublisher;
+
+void *pts_reader(void *arg) {
+    PTSPublisher *p = arg;
+    for (;;) {
+        pthread_mutex_lock(&p->lock);
+        bool done = p->done;
+        PersistentTreeSet view = PersistentTreeSet_snapshot(&p->published);
+        pthread_mutex_unlock(&p->lock);
+
+        PersistentTreeSetIterator it;
+        PersistentTreeSet_begin(&view, &it);
+        int first = *(const int *) PersistentTreeSet_iterator_get(&it), count = 0;
+        for (; PersistentTreeSet_iterator_get(&it); PersistentTreeSet_next(&it))
+            assert(*(const int *) PersistentTreeSet_iterator_get(&it) == first + count++);
+        assert(count == PTS_WINDOW && PersistentTreeSet_size(&view) == PTS_WINDOW);
+        PersistentTreeSet_invalidate(&view);
+        if (done) return NULL;
+    }
+}
+
+// Every writer inserts all of [0, SLS_KEYS) and then removes the odd keys; each key must be
+// taken by exactly one of them. Afterwards they churn a small window of keys above that range.
+#define SLS_THREADS 4
+#define SLS_KEYS 20000
+#define SLS_CHURN 20000
+#define SLS_WINDOW 64
+
+typedef struct SLSWorker {
+    SkipListSet *sls;
+    int offset;
+    int won;     // successful inserts minus successful removes
+    int *stop;   // set once the scanner should exit
+} SLSWorker;
+
+void *sls_inserter(void *arg) {
+    SLSWorker *w = arg;
+    for (int i = 0; i < SLS_KEYS; ++i) {
+        int key = (i + w->offset) % SLS_KEYS;
+        SkipListSetError result = SkipListSet_insert(w->sls, &key);
+        assert(result == SLS_ERR_SUCCESS || result == SLS_ERR_EXISTS);
+        w->won += result == SLS_ERR_SUCCESS;
+    }
+    return NULL;
+}
+
+void *sls_remover(void *arg) {
+    SLSWorker *w = arg;
+    for (int i = 0; i < SLS_KEYS; ++i) {
+        int key = (i + w->offset) % SLS_KEYS | 1;
+        SkipListSetError result = SkipListSet_remove(w->sls, &key);
+        assert(result == SLS_ERR_SUCCESS || result == SLS_ERR_NOT_FOUND);
+        w->won -= result == SLS_ERR_SUCCESS;
+    }
+    return NULL;
+}
+
+void *sls_churner(void *arg) {
+    SLSWorker *w = arg;
+    uint64_t rng = 88172645463325252ULL + (uint64_t) w->offset;
+    for (int i = 0; i < SLS_CHURN; ++i) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        int key = SLS_KEYS + (int) (rng % SLS_WINDOW);
+        if (rng >> 63)
+            w->won += SkipListSet_insert(w->sls, &key) == SLS_ERR_SUCCESS;
+        else
+            w->won -= SkipListSet_remove(w->sls, &key) == SLS_ERR_SUCCESS;
+    }
+    return NULL;
+}
+
+// Range-scans while the writers run; keys must always come out strictly ascending.
+void *sls_scanner(void *arg) {
+    SLSWorker *w = arg;
+    while (!__atomic_load_n(w->stop, __ATOMIC_ACQUIRE)) {
+        int lo = w->offset++ % SLS_KEYS, prev = lo - 1;
+        SkipListSetIterator it;
+        for (SkipListSet_lower_bound(w->sls, &lo, &it); SkipListSet_iterator_get(&it); SkipListSet_next(&it)) {
+            int key = *(const int *) SkipListSet_iterator_get(&it);
+            assert(key > prev);
+            prev = key;
+        }
+        SkipListSet_iterator_close(&it);
+    }
+    return NULL;
+}
+
+void sls_run(void *(*worker)(void *), SLSWorker *workers) {
+    pthread_t threads[SLS_THREADS];
+    for (int i = 0; i < SLS_THREADS; ++i)
+        assert(pthread_create(&threads[i], NULL, worker, &workers[i]) == 0);
+    for (int i = 0; i < SLS_THREADS; ++i)
+        pthread_join(threads[i], NULL);
+}
+
+// Uses a set, then stays alive across its invalidation; the record must be freed when it exits.
+typedef struct SLSOutliver {
+    SkipListSet *sls;
+    pthread_barrier_t *barrier;
+} SLSOutliver;
+
+void *sls_outliver(void *arg) {
+    SLSOutliver *o = arg;
+    assert(SkipListSet_insert(o->sls, &(int){ 1 }) == SLS_ERR_SUCCESS);
+    pthread_barrier_wait(o->barrier);
+    pthread_barrier_wait(o->barrier);
+    return NULL;
+}
+
+#define SLAB_THREADS 4
+#define SLAB_OBJECTS 1000
+
+void *slab_worker(void *arg) {
+    SlabAllocator *sa = arg;
+    void *objs[SLAB_OBJECTS];
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < SLAB_OBJECTS; ++i) {
+            objs[i] = SlabAllocator_alloc(sa, 24 + (i % 4) * 40);
+            assert(objs[i]);
+            memset(objs[i], i, 24);
+        }
+        for (int i = 0; i < SLAB_OBJECTS; ++i)
+            SlabAllocator_free(sa, objs[i]);
+    }
+    // Hand objects to the main thread to exercise cross-thread frees.
+    void **handoff = SlabAllocator_alloc(sa, sizeof(void *) * 64);
+    for (int i = 0; i < 64; ++i)
+        handoff[i] = SlabAllocator_alloc(sa, 48);
+    return handoff;
+}
+
+// Checks parent links and red-black invariants; returns the subtree's black height.
+int rbtree_check(struct _RBTreeNode *node, struct _RBTreeNode *parent) {
+    if (!node) return 1;
+    assert(node->parent == parent);
+    if (!node->black) assert(_RBTreeNode_black(node->left) && _RBTreeNode_black(node->right));
+    int left = rbtree_check(node->left, node), right = rbtree_check(node->right, node);
+    assert(left == right);
+    return left + node->black;
+}
+
+// Checks the order statistics subtree sizes; returns the subtree's size.
+size_t rbtree_count_check(TreeSet *ts, struct _RBTreeNode *node) {
+    if (!node) return 0;
+    size_t count = 1 + rbtree_count_check(ts, node->left) + rbtree_count_check(ts, node->right);
+    assert(*(size_t *) ((char *) node + ts->_count_offset) == count);
+    return count;
+}
+
+// Fills an empty set of Weights and checks that every node keeps its data max aligned.
+void tset_alignment_check(TreeSet *ts) {
+    for (int i = 0; i < 8; ++i)
+        assert(TreeSet_insert(ts, &(Weight){ .weight = i }));
+    long double expected = 0;
+    for (TreeSetIterator it = TreeSet_begin(ts); it; it = TreeSet_next(ts, it)) {
+        assert((uintptr_t) it->data % MAX_ALIGN == 0);
+        assert(((Weight *) it->data)->weight == expected++);
+    }
+    assert(expected == 8);
+}
+
+// Random inserts and removals against a presence table, checking order and bounds throughout.
+void btree_churn(BTreeSet *bs, size_t element_size, int range, int rounds) {
+    bool *present = calloc((size_t) range, sizeof(bool));
+    char element[128] = { 0 };
+    size_t count = 0;
+    unsigned rng = 2463534242u;
+    for (int round = 0; round < rounds; ++round) {
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+        int k = (int) (rng % (unsigned) range);
+        memcpy(element, &k, sizeof(int));
+        memset(element + sizeof(int), k & 0xff, element_size - sizeof(int));
+        if (rng & 0x100000) {
+            assert(BTreeSet_insert(bs, element) == !present[k]);
+            count += !present[k];
+            present[k] = true;
+        } else {
+            assert(BTreeSet_remove(bs, element) == present[k]);
+            count -= present[k];
+            present[k] = false;
+        }
+    }
+    assert(BTreeSet_size(bs) == count);
+    int previous = -1;
+    size_t seen = 0;
+    for (BTreeSetIterator it = BTreeSet_begin(bs); BTreeSet_iterator_get(bs, it); it = BTreeSet_next(bs, it)) {
+        char *stored = BTreeSet_iterator_get(bs, it);
+        int k = *(int *) stored;
+        assert(k > previous && present[k]);
+        assert(element_size == sizeof(int) || (unsigned char) stored[element_size - 1] == (k & 0xff));
+        previous = k;
+        ++seen;
+    }
+    assert(seen == count);
+    for (int k = 0, next = range; k < range; ++k) {
+        int expect = present[k] ? k : -1;
+        if (!present[k]) {
+            for (next = k + 1; next < range && !present[next]; ++next);
+            expect = next < range ? next : -1;
+        }
+        int *lower = BTreeSet_iterator_get(bs, BTreeSet_lower_bound(bs, &k));
+        assert(expect < 0 ? lower == NULL : *lower == expect);
+        assert(BTreeSet_contains(bs, &k) == present[k]);
+    }
+    free(present);
+}
+
+#define CPQ_THREADS 4
+#define CPQ_ITEMS 20000
+
+typedef struct CPQWorker {
+    ConcurrentPriorityQueue *cpq;
+    int first;
+    long long popped_sum;
+    int popped;
+} CPQWorker;
+
+void *cpq_worker(void *arg) {
+    CPQWorker *w = arg;
+    // Interleave pushes and pops so shards are contended from both sides.
+    for (int i = 0; i < CPQ_ITEMS; ++i) {
+        int value = w->first + i;
+        assert(ConcurrentPriorityQueue_push(w->cpq, &value) == CPQ_ERR_SUCCESS);
+        if (i % 2) {
+            int out;
+            if (ConcurrentPriorityQueue_try_pop(w->cpq, &out) == CPQ_ERR_SUCCESS) {
+                w->popped_sum += out;
+                ++w->popped;
+            }
+        }
+    }
+    return NULL;
+}
+
 int main() {
     printf("==== CSTL Test Suite ====\n");
 
@@ -32,7 +378,46 @@ int main() {
         assert(Vector_append(&v, &x) == VEC_ERR_SUCCESS);
         assert(Vector_size(&v) == 1);
         assert(Vector_get(&v, 0, int) == 42);
+
+        // Capacity is a total that only grows geometrically.
+        size_t reallocs = 0, capacity = Vector_capacity(&v);
+        for (int i = 0; i < 100000; ++i) {
+            if (i % 3 == 0) assert(Vector_append(&v, &i) == VEC_ERR_SUCCESS);
+            else assert(Vector_append_members(&v, (int[]){ i, i }, 2) == VEC_ERR_SUCCESS);
+            if (Vector_capacity(&v) != capacity) ++reallocs;
+            capacity = Vector_capacity(&v);
+            assert(capacity >= Vector_size(&v));
+        }
+        assert(reallocs < 20);
+        int *slots = Vector_append_uninit(&v, 3);
+        assert(slots);
+        slots[0] = 1; slots[1] = 2; slots[2] = 3;
+        assert(Vector_get(&v, Vector_size(&v) - 1, int) == 3);
+        assert(Vector_append_vector(&v, &v) == VEC_ERR_SUCCESS);
+        assert(Vector_get(&v, Vector_size(&v) / 2, int) == 42);
+        Vector w;
+        Vector_create(&w, sizeof(int));
+        assert(Vector_cpy(&w, &v) == VEC_ERR_SUCCESS);
+        assert(Vector_size(&w) == Vector_size(&v));
+        assert(memcmp(Vector_raw_data(&w), Vector_raw_data(&v), Vector_size(&v) * sizeof(int)) == 0);
+        Vector_clear(&w);
+        assert(Vector_shrink(&w) == VEC_ERR_SUCCESS && Vector_capacity(&w) == 0);
+        Vector_invalidate(&w);
         Vector_invalidate(&v);
+
+        // Typed vectors share the generic layout.
+        IntVec iv;
+        assert(IntVec_create(&iv) == VEC_ERR_SUCCESS);
+        for (int i = 0; i < 1000; ++i)
+            assert(IntVec_push(&iv, i) == VEC_ERR_SUCCESS);
+        assert(IntVec_size(&iv) == 1000 && IntVec_get(&iv, 999) == 999);
+        IntVec_swap(&iv, 0, 999);
+        assert(IntVec_get(&iv, 0) == 999 && IntVec_back(&iv) == 0);
+        assert(IntVec_pop(&iv) == 0 && IntVec_size(&iv) == 999);
+        assert(Vector_get(IntVec_vector(&iv), 1, int) == 1);
+        assert(IntVec_push_n(&iv, (int[]){ 7, 8 }, 2) == VEC_ERR_SUCCESS);
+        assert(*IntVec_at(&iv, 1000) == 8);
+        IntVec_invalidate(&iv);
         printf("[Vector] Passed\n");
     }
 
@@ -56,6 +441,72 @@ int main() {
             assert(!cstr.fail);
             assert(strcmp(cstr.success, "hello") == 0);
         }
+        // Short strings stay inline; longer ones spill and can shrink back.
+        Errable(String) sres = String_from_cstring("identifier");
+        assert(!sres.fail);
+        String small = sres.success;
+        assert(String_raw_data(&small) == (const char *) &small);
+        assert(String_append_cstring(&small, "_that_outgrows_the_buffer") == STR_ERR_SUCCESS);
+        assert(String_raw_data(&small) != (const char *) &small);
+        assert(String_eq_cstring(&small, "identifier_that_outgrows_the_buffer"));
+        Errable(String) sub = String_substring(&small, 0, 10);
+        assert(!sub.fail && String_eq_cstring(&sub.success, "identifier"));
+        String copy;
+        String_create(&copy);
+        assert(String_cpy(&copy, &small) == STR_ERR_SUCCESS);
+        assert(String_cmp_string(&copy, &small) == 0);
+        assert(String_cpy(&small, &sub.success) == STR_ERR_SUCCESS);
+        assert(String_shrink(&small) == STR_ERR_SUCCESS);
+        assert(String_raw_data(&small) == (const char *) &small);
+        assert(String_eq_cstring(&small, "identifier"));
+        String_mv(&copy, &small);
+        assert(String_eq_cstring(&copy, "identifier") && String_size(&small) == 0);
+        String_invalidate(&copy);
+        String_invalidate(&small);
+
+        // Vectorised search and compare agree with a byte loop on long lines.
+        String line;
+        String_create(&line);
+        for (int i = 0; i < 5000; ++i)
+            String_append_char(&line, "abcab"[(i * 7) % 5]);
+        String_append_cstring(&line, "needle!");
+        size_t count = 0, first_c = STRING_NPOS;
+        for (size_t i = 0; i < String_size(&line); ++i) {
+            if (String_get(&line, i) != 'c') continue;
+            if (first_c == STRING_NPOS) first_c = i;
+            ++count;
+        }
+        assert(String_count_char(&line, 'c') == count);
+        assert(String_find_char(&line, 'c', 0) == first_c);
+        assert(String_find_char(&line, 'c', first_c + 1) > first_c);
+        assert(String_find_char(&line, 'z', 0) == STRING_NPOS);
+        assert(String_find_cstring(&line, "needle!", 0) == 5000);
+        assert(String_find_cstring(&line, "needle?", 0) == STRING_NPOS);
+        assert(String_find_cstring(&line, "", 7) == 7);
+        String other;
+        String_create(&other);
+        String_cpy(&other, &line);
+        assert(String_eq_string(&line, &other));
+        String_set(&other, 4000, 'z');
+        assert(!String_eq_string(&line, &other));
+        assert(String_cmp_string(&line, &other) < 0 && String_cmp_string(&other, &line) > 0);
+        assert(String_cmp_cstring(&sub.success, "identifier") == 0);
+        assert(String_cmp_cstring(&sub.success, "identifierz") < 0);
+        assert(String_cmp_cstring(&sub.success, "ident") > 0);
+        String_invalidate(&other);
+        String_invalidate(&line);
+        String_invalidate(&sub.success);
+
+        // Appends grow geometrically and formatted output lands in place.
+        String payload;
+        String_create(&payload);
+        for (int i = 0; i < 100000; ++i)
+            assert(String_append_format(&payload, "%05d,", i % 100000) == STR_ERR_SUCCESS);
+        assert(String_size(&payload) == 600000);
+        assert(String_find_cstring(&payload, "99999,", 0) == 599994);
+        assert(String_append_format(&payload, "%s-%d", "end", 7) == STR_ERR_SUCCESS);
+        assert(String_find_cstring(&payload, "end-7", 0) == 600000);
+        String_invalidate(&payload);
         printf("[String] Passed\n");
     }
 
@@ -88,7 +539,30 @@ int main() {
         ArenaAllocator_create(&arena, 1024);
         void *ptr = ArenaAllocator_alloc(&arena, 64);
         assert(ptr != NULL);
+
+        ArenaAllocatorMark mark = ArenaAllocator_mark(&arena);
+        for (int i = 0; i < 100; ++i)
+            assert(ArenaAllocator_alloc(&arena, 512) != NULL); // chains new blocks
+        ArenaAllocator_rewind(&arena, mark);
+        assert(ArenaAllocator_space(&arena) == 1024 - 64);
+        assert(ArenaAllocator_alloc(&arena, 16) == (char *) ptr + 64);
         ArenaAllocator_invalidate(&arena);
+
+        ArenaAllocator_create(&arena, 256);
+        char *c = ArenaAllocator_alloc(&arena, 3);
+        double *d = ArenaAllocator_alloc(&arena, sizeof(double));
+        void *simd = ArenaAllocator_alloc_aligned(&arena, 32, 32);
+        void *line = ArenaAllocator_alloc_cache_line(&arena, 8);
+        assert(c && d && simd && line);
+        assert((uintptr_t) d % MAX_ALIGN == 0);
+        assert((uintptr_t) simd % 32 == 0);
+        assert((uintptr_t) line % CACHE_LINE_SIZE == 0);
+        ArenaAllocator_invalidate(&arena);
+
+        char buf[32];
+        ArenaAllocator fixed = ArenaAllocator_init_stack(buf, sizeof(buf));
+        assert(ArenaAllocator_alloc(&fixed, 64) == NULL);
+        ArenaAllocator_invalidate(&fixed);
         printf("[ArenaAllocator] Passed\n");
     }
 
@@ -109,9 +583,217 @@ int main() {
         assert(*top == 10);
 
         PriorityQueue_invalidate(&pq);
+
+        // d-ary heaps, bulk loading and pop_into agree on the order.
+        for (size_t arity = 2; arity <= 8; arity *= 2) {
+            PriorityQueue dq;
+            assert(PriorityQueue_create_with_arity(&dq, sizeof(int), int_comparator, arity) == PQ_ERR_SUCCESS);
+            int batch[1000];
+            for (int i = 0; i < 1000; ++i)
+                batch[i] = (i * 7919) % 1000;
+            assert(PriorityQueue_push_bulk(&dq, batch, 1000) == PQ_ERR_SUCCESS);
+            assert(PriorityQueue_push_bulk(&dq, (int[]){ 2000, -1 }, 2) == PQ_ERR_SUCCESS);
+            int out;
+            assert(PriorityQueue_pop_into(&dq, &out) == PQ_ERR_SUCCESS && out == 2000);
+            for (int i = 999; i >= 0; --i) {
+                assert(PriorityQueue_pop_into(&dq, &out) == PQ_ERR_SUCCESS);
+                assert(out == i);
+            }
+            assert(PriorityQueue_pop_into(&dq, &out) == PQ_ERR_SUCCESS && out == -1);
+            assert(PriorityQueue_pop_into(&dq, &out) == PQ_ERR_EMPTY_POP_BACK);
+            PriorityQueue_invalidate(&dq);
+        }
+        Vector heap_src;
+        Vector_create(&heap_src, sizeof(int));
+        for (int i = 0; i < 500; ++i)
+            Vector_append(&heap_src, &i);
+        PriorityQueue fv;
+        PriorityQueue_from_vector(&fv, &heap_src, int_comparator);
+        assert(Vector_size(&heap_src) == 0 && PriorityQueue_size(&fv) == 500);
+        PriorityQueue_set_arity(&fv, 4);
+        for (int i = 499; i >= 0; --i) {
+            assert(*(int *) PriorityQueue_top(&fv) == i);
+            PriorityQueue_pop(&fv);
+        }
+        PriorityQueue_invalidate(&fv);
+        Vector_invalidate(&heap_src);
+
+        // Typed heap pops in deadline order.
+        TimerHeap heap;
+        assert(TimerHeap_create(&heap) == PQ_ERR_SUCCESS);
+        for (int i = 0; i < 1000; ++i)
+            assert(TimerHeap_push(&heap, (Timer){ .deadline = (i * 7919) % 1000, .id = i }) == PQ_ERR_SUCCESS);
+        assert(TimerHeap_size(&heap) == 1000);
+        for (long d = 0; d < 1000; ++d) {
+            assert(TimerHeap_top(&heap)->deadline == d);
+            TimerHeap_pop(&heap);
+        }
+        assert(TimerHeap_top(&heap) == NULL);
+        TimerHeap_invalidate(&heap);
         printf("[PriorityQueue] Passed\n");
     }
 
+    // ---- IndexedPriorityQueue test ----
+    {
+        IndexedPriorityQueue ipq;
+        assert(IndexedPriorityQueue_create(&ipq, sizeof(int), int_cmp) == IPQ_ERR_SUCCESS);
+        IPQHandle handles[200];
+        int dist[200];
+        for (int i = 0; i < 200; ++i) {
+            dist[i] = 1000 + (i * 7919) % 200;
+            assert(IndexedPriorityQueue_push(&ipq, &dist[i], &handles[i]) == IPQ_ERR_SUCCESS);
+        }
+        // Decrease every third key, remove every seventh element.
+        for (int i = 0; i < 200; i += 3) {
+            dist[i] -= 500;
+            assert(IndexedPriorityQueue_update(&ipq, handles[i], &dist[i]) == IPQ_ERR_SUCCESS);
+        }
+        for (int i = 0; i < 200; i += 7) {
+            assert(IndexedPriorityQueue_remove(&ipq, handles[i]) == IPQ_ERR_SUCCESS);
+            assert(!IndexedPriorityQueue_contains(&ipq, handles[i]));
+            assert(IndexedPriorityQueue_remove(&ipq, handles[i]) == IPQ_ERR_INVALID_HANDLE);
+            dist[i] = -1;
+        }
+        *(int *) IndexedPriorityQueue_get(&ipq, handles[1]) = 0;
+        assert(IndexedPriorityQueue_update_priority(&ipq, handles[1]) == IPQ_ERR_SUCCESS);
+        dist[1] = 0;
+        assert(IndexedPriorityQueue_top_handle(&ipq) == handles[1]);
+
+        int prev = -1, popped = 0, out;
+        while (IndexedPriorityQueue_pop_into(&ipq, &out) == IPQ_ERR_SUCCESS) {
+            assert(out >= prev);
+            prev = out;
+            ++popped;
+        }
+        int expected = 0;
+        for (int i = 0; i < 200; ++i)
+            expected += dist[i] >= 0;
+        assert(popped == expected && IndexedPriorityQueue_size(&ipq) == 0);
+        IndexedPriorityQueue_invalidate(&ipq);
+
+        // Every array, including the lazily grown ones, comes from the given allocator.
+        size_t budget = 0;
+        Allocator budgeted = { .alloc = budget_alloc, .free = budget_free, .ctx = &budget };
+        assert(IndexedPriorityQueue_create_with_allocator(&ipq, sizeof(int), int_cmp, &budgeted) == IPQ_ERR_OOM);
+        budget = 100;
+        assert(IndexedPriorityQueue_create_with_allocator(&ipq, sizeof(int), int_cmp, &budgeted) == IPQ_ERR_SUCCESS);
+        assert(budget == 99);
+        for (int i = 0; i < 50; ++i)
+            assert(IndexedPriorityQueue_push(&ipq, &i, NULL) == IPQ_ERR_SUCCESS);
+        assert(budget < 99 && *(int *) IndexedPriorityQueue_top(&ipq) == 0);
+        IndexedPriorityQueue_invalidate(&ipq);
+        printf("[IndexedPriorityQueue] Passed\n");
+    }
+
+    // ---- RadixHeap test ----
+    {
+        RadixHeap rh;
+        assert(RadixHeap_create(&rh, sizeof(int)) == RH_ERR_SUCCESS);
+        uint64_t now = 0, key;
+        int id, pushed = 0;
+        for (int i = 0; i < 1000; ++i, ++pushed)
+            assert(RadixHeap_push(&rh, (uint64_t) ((i * 7919) % 1000) << 20, &i) == RH_ERR_SUCCESS);
+        for (int i = 0; i < 5000; ++i) {
+            assert(RadixHeap_pop_into(&rh, &key, &id) == RH_ERR_SUCCESS);
+            assert(key >= now);
+            now = key;
+            if (i < 4000) {
+                assert(RadixHeap_push(&rh, now + (uint64_t) (i % 97), &i) == RH_ERR_SUCCESS);
+                ++pushed;
+            }
+        }
+        assert(RadixHeap_size(&rh) == (size_t) (pushed - 5000));
+        assert(now > 0 && RadixHeap_push(&rh, now - 1, &id) == RH_ERR_NOT_MONOTONE);
+        assert(RadixHeap_top(&rh, &key) == NULL && RadixHeap_pop_into(&rh, &key, &id) == RH_ERR_EMPTY_POP_BACK);
+
+        // Peeking does not raise the bound: a timer loop may schedule before the next deadline.
+        RadixHeap_clear(&rh);
+        assert(RadixHeap_push(&rh, 5, &id) == RH_ERR_SUCCESS);
+        assert(RadixHeap_pop_into(&rh, &key, &id) == RH_ERR_SUCCESS && key == 5);
+        assert(RadixHeap_push(&rh, 100, &id) == RH_ERR_SUCCESS);
+        assert(RadixHeap_top(&rh, &key) && key == 100);
+        assert(RadixHeap_push(&rh, 50, &id) == RH_ERR_SUCCESS);
+        assert(RadixHeap_push(&rh, 4, &id) == RH_ERR_NOT_MONOTONE);
+        for (int i = 0; i < 2000; ++i) {
+            uint64_t next;
+            assert(RadixHeap_top(&rh, &next));
+            uint64_t earlier = next - (uint64_t) ((i * 7919) % 41) % (next - 5 + 1);
+            assert(RadixHeap_push(&rh, earlier, &i) == RH_ERR_SUCCESS);
+            assert(RadixHeap_top(&rh, &key) && key == earlier);
+            assert(RadixHeap_push(&rh, next + (uint64_t) (i % 1000), &i) == RH_ERR_SUCCESS);
+        }
+        for (now = 5; RadixHeap_pop_into(&rh, &key, &id) == RH_ERR_SUCCESS; now = key)
+            assert(key >= now);
+        RadixHeap_invalidate(&rh);
+
+        // Buckets grow through the given allocator.
+        size_t budget = 0;
+        Allocator budgeted = { .alloc = budget_alloc, .free = budget_free, .ctx = &budget };
+        assert(RadixHeap_create_with_allocator(&rh, sizeof(int), &budgeted) == RH_ERR_SUCCESS);
+        assert(RadixHeap_push(&rh, 1, &(int){ 1 }) == RH_ERR_OOM && RadixHeap_size(&rh) == 0);
+        budget = 10;
+        assert(RadixHeap_push(&rh, 1, &(int){ 1 }) == RH_ERR_SUCCESS && budget == 9);
+        RadixHeap_invalidate(&rh);
+        printf("[RadixHeap] Passed\n");
+    }
+
+    // ---- ConcurrentPriorityQueue test ----
+    {
+        // A single shard keeps strict min-heap order.
+        ConcurrentPriorityQueue strict;
+        assert(ConcurrentPriorityQueue_create(&strict, sizeof(int), int_cmp, 1) == CPQ_ERR_SUCCESS);
+        int values[] = { 5, 1, 9, 3, 7, 3 };
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+            assert(ConcurrentPriorityQueue_push(&strict, &values[i]) == CPQ_ERR_SUCCESS);
+        assert(ConcurrentPriorityQueue_size(&strict) == 6);
+        int expected[] = { 1, 3, 3, 5, 7, 9 }, out;
+        for (size_t i = 0; i < 6; ++i) {
+            assert(ConcurrentPriorityQueue_try_pop(&strict, &out) == CPQ_ERR_SUCCESS);
+            assert(out == expected[i]);
+        }
+        assert(ConcurrentPriorityQueue_try_pop(&strict, &out) == CPQ_ERR_EMPTY_POP_BACK);
+        ConcurrentPriorityQueue_invalidate(&strict);
+
+        // Many shards: every element comes out exactly once, and draining finds them all.
+        Errable(ConcurrentPriorityQueue) cres = ConcurrentPriorityQueue_init(sizeof(int), int_cmp, CPQ_THREADS * CPQ_SHARDS_PER_THREAD);
+        assert(!cres.fail);
+        ConcurrentPriorityQueue cpq = cres.success;
+        assert((uintptr_t) cpq._shards % CACHE_LINE_SIZE == 0);
+        pthread_t threads[CPQ_THREADS];
+        CPQWorker workers[CPQ_THREADS];
+        for (int i = 0; i < CPQ_THREADS; ++i) {
+            workers[i] = (CPQWorker) { &cpq, i * CPQ_ITEMS, 0, 0 };
+            assert(pthread_create(&threads[i], NULL, cpq_worker, &workers[i]) == 0);
+        }
+        long long sum = 0;
+        int popped = 0;
+        for (int i = 0; i < CPQ_THREADS; ++i) {
+            assert(pthread_join(threads[i], NULL) == 0);
+            sum += workers[i].popped_sum;
+            popped += workers[i].popped;
+        }
+        assert(ConcurrentPriorityQueue_size(&cpq) == (size_t) (CPQ_THREADS * CPQ_ITEMS - popped));
+        while (ConcurrentPriorityQueue_try_pop(&cpq, &out) == CPQ_ERR_SUCCESS) {
+            sum += out;
+            ++popped;
+        }
+        long long total = (long long) CPQ_THREADS * CPQ_ITEMS;
+        assert(popped == total && sum == total * (total - 1) / 2);
+        assert(ConcurrentPriorityQueue_size(&cpq) == 0);
+        ConcurrentPriorityQueue_invalidate(&cpq);
+
+        // Each shard's heap comes from the given allocator.
+        size_t budget = 3;
+        Allocator budgeted = { .alloc = budget_alloc, .free = budget_free, .ctx = &budget };
+        assert(ConcurrentPriorityQueue_create_with_allocator(&cpq, sizeof(int), int_cmp, 4, &budgeted) == CPQ_ERR_OOM);
+        budget = 4;
+        assert(ConcurrentPriorityQueue_create_with_allocator(&cpq, sizeof(int), int_cmp, 4, &budgeted) == CPQ_ERR_SUCCESS);
+        assert(budget == 0 && ConcurrentPriorityQueue_push(&cpq, &(int){ 7 }) == CPQ_ERR_SUCCESS);
+        assert(ConcurrentPriorityQueue_try_pop(&cpq, &out) == CPQ_ERR_SUCCESS && out == 7);
+        ConcurrentPriorityQueue_invalidate(&cpq);
+        printf("[ConcurrentPriorityQueue] Passed\n");
+    }
+
     // ---- SlabAllocator test ----
     {
         Errable(SlabAllocator) sares = SlabAllocator_init(128);
@@ -121,11 +803,909 @@ int main() {
         void *p1 = SlabAllocator_alloc(&sa, 64);
         void *p2 = SlabAllocator_alloc(&sa, 32);
         assert(p1 && p2);
+        void *p3 = SlabAllocator_alloc_aligned(&sa, 16, 64);
+        assert(p3 && (uintptr_t) p3 % 64 == 0);
+        assert(!SlabAllocator_alloc_aligned(&sa, 16, sa.slab_size));
+        void *half = SlabAllocator_alloc_aligned(&sa, sa.slab_size, sa.slab_size / 2);
+        assert(half && (uintptr_t) half % (sa.slab_size / 2) == 0);
+        assert(SlabAllocator_usable_size(&sa, half) == sa.slab_size);
+        SlabAllocator_free(&sa, half);
+
+        SlabAllocator_free(&sa, p2);
+        void *p4 = SlabAllocator_alloc(&sa, 20); // same size class as p2
+        assert(p4 == p2);
+        assert(SlabAllocator_usable_size(&sa, p4) >= 20);
+
+        void *big = SlabAllocator_alloc(&sa, 1 << 20);
+        assert(big && SlabAllocator_usable_size(&sa, big) == 1 << 20);
+        SlabAllocator_free(&sa, big);
+        SlabAllocator_free(&sa, p3);
 
         SlabAllocator_invalidate(&sa);
+
+        Errable(SlabAllocator) cres = SlabAllocator_init_concurrent(4096);
+        assert(!cres.fail);
+        SlabAllocator csa = cres.success;
+        pthread_t threads[SLAB_THREADS];
+        for (int i = 0; i < SLAB_THREADS; ++i)
+            assert(pthread_create(&threads[i], NULL, slab_worker, &csa) == 0);
+        for (int i = 0; i < SLAB_THREADS; ++i) {
+            void **handoff;
+            assert(pthread_join(threads[i], (void **) &handoff) == 0);
+            for (int j = 0; j < 64; ++j)
+                SlabAllocator_free(&csa, handoff[j]);
+            SlabAllocator_free(&csa, handoff);
+        }
+        SlabAllocator_invalidate(&csa);
         printf("[SlabAllocator] Passed\n");
     }
 
+    // ---- HashSet test ----
+    {
+        Errable(HashSet) hsres = HashSet_init(sizeof(int), int_hash, int_eq);
+        assert(!hsres.fail);
+        HashSet hs = hsres.success;
+
+        for (int i = 0; i < 1000; ++i)
+            assert(HashSet_insert(&hs, &i) == HS_ERR_SUCCESS);
+        int dup = 10;
+        assert(HashSet_insert(&hs, &dup) == HS_ERR_EXISTS);
+        assert(HashSet_size(&hs) == 1000);
+
+        for (int i = 0; i < 1000; i += 2)
+            assert(HashSet_remove(&hs, &i));
+        for (int i = 0; i < 1000; ++i)
+            assert(HashSet_contains(&hs, &i) == (i % 2 == 1));
+
+        size_t seen = 0;
+        for (void *it = HashSet_begin(&hs); it; it = HashSet_next(&hs, it))
+            ++seen;
+        assert(seen == 500);
+
+        HashSet_invalidate(&hs);
+        printf("[HashSet] Passed\n");
+    }
+
+    // ---- HashMap test ----
+    {
+        Errable(HashMap) hmres = HashMap_init(sizeof(int), sizeof(double), int_hash, int_eq);
+        assert(!hmres.fail);
+        HashMap hm = hmres.success;
+
+        for (int i = 0; i < 100; ++i) {
+            double d = i * 0.5;
+            assert(HashMap_insert(&hm, &i, &d) == HM_ERR_SUCCESS);
+        }
+        int k = 42;
+        assert(*(double*)HashMap_get(&hm, &k) == 21.0);
+        double d = -1.0;
+        assert(HashMap_put(&hm, &k, &d) == HM_ERR_SUCCESS);
+        assert(*(double*)HashMap_get(&hm, &k) == -1.0);
+        assert(HashMap_remove(&hm, &k));
+        assert(HashMap_get(&hm, &k) == NULL);
+        assert(HashMap_size(&hm) == 99);
+
+        HashMap_invalidate(&hm);
+
+        // A 12-byte key+value pair: entries are padded so every key stays 8-byte aligned.
+        HashMap wide;
+        assert(HashMap_create(&wide, sizeof(uint64_t), sizeof(uint32_t), u64_hash, u64_cmp) == HM_ERR_SUCCESS);
+        for (uint64_t key = 0; key < 1000; ++key) {
+            uint32_t value = (uint32_t) key * 3;
+            assert(HashMap_insert(&wide, &key, &value) == HM_ERR_SUCCESS);
+        }
+        for (void *it = HashMap_begin(&wide); it; it = HashMap_next(&wide, it)) {
+            assert((uintptr_t) HashMap_entry_key(&wide, it) % sizeof(uint64_t) == 0);
+            assert(*(uint32_t *) HashMap_entry_value(&wide, it) == (uint32_t) *(uint64_t *) HashMap_entry_key(&wide, it) * 3);
+        }
+        assert(*(uint32_t *) HashMap_get(&wide, &(uint64_t){ 999 }) == 2997);
+        HashMap_invalidate(&wide);
+        printf("[HashMap] Passed\n");
+    }
+
+    // ---- TreeSet test ----
+    {
+        TreeSet ts = TreeSet_init(int_cmp, sizeof(int));
+        for (int i = 0; i < 1000; ++i) {
+            int k = (i * 7919) % 1000;
+            assert(TreeSet_insert(&ts, &k));
+        }
+        int dup = 5;
+        assert(!TreeSet_insert(&ts, &dup));
+        assert(TreeSet_size(&ts) == 1000);
+        for (int i = 0; i < 1000; ++i)
+            assert(*(int*)TreeSet_find(&ts, &i)->data == i);
+        int missing = 1000;
+        assert(!TreeSet_contains(&ts, &missing));
+        assert(rbtree_check(ts._root, NULL) > 0);
+
+        // In-order stepping both ways.
+        int expected = 0;
+        for (TreeSetIterator it = TreeSet_begin(&ts); it != TreeSet_end(&ts); it = TreeSet_next(&ts, it))
+            assert(*(int*)it->data == expected++);
+        assert(expected == 1000);
+        for (TreeSetIterator it = TreeSet_prev(&ts, TreeSet_end(&ts)); it; it = TreeSet_prev(&ts, it))
+            assert(*(int*)it->data == --expected);
+        assert(expected == 0);
+
+        // Erase every odd element while scanning, then delete by value.
+        for (TreeSetIterator it = TreeSet_begin(&ts); it;) {
+            TreeSetIterator next = TreeSet_next(&ts, it);
+            if (*(int*)it->data % 2) assert(TreeSet_erase(&ts, it) == TS_ERR_SUCCESS);
+            it = next;
+        }
+        assert(TreeSet_size(&ts) == 500 && rbtree_check(ts._root, NULL) > 0);
+        for (int i = 0; i < 1000; i += 4)
+            assert(TreeSet_remove(&ts, &i));
+        assert(TreeSet_size(&ts) == 250 && rbtree_check(ts._root, NULL) > 0);
+        assert(TreeSet_erase(&ts, TreeSet_end(&ts)) == TS_ERR_INVALID_ITERATOR);
+
+        // Bounds: remaining elements are 2, 6, 10, ...
+        int key = 6;
+        assert(*(int*)TreeSet_lower_bound(&ts, &key)->data == 6);
+        assert(*(int*)TreeSet_upper_bound(&ts, &key)->data == 10);
+        key = 7;
+        assert(*(int*)TreeSet_lower_bound(&ts, &key)->data == 10);
+        key = 998;
+        assert(TreeSet_upper_bound(&ts, &key) == NULL && *(int*)TreeSet_lower_bound(&ts, &key)->data == 998);
+
+        // Random churn keeps the invariants.
+        unsigned rng = 12345;
+        for (int i = 0; i < 20000; ++i) {
+            rng = rng * 1103515245 + 12345;
+            int k = (int) ((rng >> 8) % 2000);
+            if (rng & 1) TreeSet_insert(&ts, &k);
+            else TreeSet_remove(&ts, &k);
+        }
+        size_t count = 0;
+        for (TreeSetIterator it = TreeSet_begin(&ts); it; it = TreeSet_next(&ts, it))
+            ++count;
+        assert(count == TreeSet_size(&ts) && rbtree_check(ts._root, NULL) > 0);
+        TreeSet_invalidate(&ts);
+
+        TreeSet weights = TreeSet_init(weight_cmp, sizeof(Weight));
+        tset_alignment_check(&weights);
+        TreeSet_invalidate(&weights);
+        printf("[TreeSet] Passed\n");
+    }
+
+    // ---- TreeSet bulk construction and set algebra test ----
+    {
+        int sorted[300];
+        for (int n = 0; n <= 300; ++n) {
+            for (int i = 0; i < n; ++i) sorted[i] = 3 * i;
+            TreeSet ts = TreeSet_init(int_cmp, sizeof(int));
+            View view = View(sorted, (size_t) n, sizeof(int));
+            assert(TreeSet_from_sorted(&ts, &view) == TS_ERR_SUCCESS);
+            assert(TreeSet_size(&ts) == (size_t) n && rbtree_check(ts._root, NULL) > 0);
+            int expected = 0;
+            for (TreeSetIterator it = TreeSet_begin(&ts); it; it = TreeSet_next(&ts, it), expected += 3)
+                assert(*(int*)it->data == expected);
+            assert(expected == 3 * n);
+            TreeSet_invalidate(&ts);
+        }
+
+        // Duplicates collapse; a non-empty set merges the input in.
+        int dups[] = { 1, 1, 2, 3, 3, 3, 5 };
+        TreeSet ts = TreeSet_init(int_cmp, sizeof(int));
+        int four = 4, five = 5;
+        TreeSet_insert(&ts, &four);
+        TreeSet_insert(&ts, &five);
+        View view = View(dups, 7, sizeof(int));
+        assert(TreeSet_from_sorted(&ts, &view) == TS_ERR_SUCCESS);
+        assert(TreeSet_size(&ts) == 5 && rbtree_check(ts._root, NULL) > 0);
+        int expected = 1;
+        for (TreeSetIterator it = TreeSet_begin(&ts); it; it = TreeSet_next(&ts, it))
+            assert(*(int*)it->data == expected++);
+        TreeSet_invalidate(&ts);
+
+        // Union, intersection and difference of random sets of skewed sizes against presence tables.
+        enum { RANGE = 4000 };
+        unsigned rng = 777;
+        int sizes[][2] = { { 2000, 2000 }, { 3000, 20 }, { 20, 3000 }, { 0, 500 }, { 500, 0 } };
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+            for (int op = 0; op < 3; ++op) {
+                bool in_a[RANGE] = { false }, in_b[RANGE] = { false };
+                TreeSet a = TreeSet_init(int_cmp, sizeof(int)), b = TreeSet_init(int_cmp, sizeof(int));
+                for (int i = 0; i < sizes[s][0]; ++i) {
+                    rng = rng * 1103515245 + 12345;
+                    int k = (int) ((rng >> 8) % RANGE);
+                    in_a[k] = true;
+                    TreeSet_insert(&a, &k);
+                }
+                for (int i = 0; i < sizes[s][1]; ++i) {
+                    rng = rng * 1103515245 + 12345;
+                    int k = (int) ((rng >> 8) % RANGE);
+                    in_b[k] = true;
+                    TreeSet_insert(&b, &k);
+                }
+                size_t b_size = TreeSet_size(&b);
+                if (op == 0) assert(TreeSet_union(&a, &b) == TS_ERR_SUCCESS);
+                else if (op == 1) TreeSet_intersection(&a, &b);
+                else TreeSet_difference(&a, &b);
+
+                size_t count = 0;
+                for (int k = 0; k < RANGE; ++k) {
+                    bool want = op == 0 ? in_a[k] || in_b[k] : op == 1 ? in_a[k] && in_b[k] : in_a[k] && !in_b[k];
+                    assert(TreeSet_contains(&a, &k) == want);
+                    count += want;
+                }
+                assert(TreeSet_size(&a) == count && rbtree_check(a._root, NULL) > 0);
+                assert(TreeSet_size(&b) == b_size && rbtree_check(b._root, NULL) > 0);
+                int previous = -1;
+                for (TreeSetIterator it = TreeSet_begin(&a); it; it = TreeSet_next(&a, it)) {
+                    assert(*(int*)it->data > previous);
+                    previous = *(int*)it->data;
+                }
+
+                // The result keeps working as an ordinary set.
+                for (int k = 0; k < RANGE; k += 3) {
+                    if (k % 2) TreeSet_insert(&a, &k);
+                    else TreeSet_remove(&a, &k);
+                }
+                assert(rbtree_check(a._root, NULL) > 0);
+                TreeSet_invalidate(&a);
+                TreeSet_invalidate(&b);
+            }
+        }
+
+        TreeSet self = TreeSet_init(int_cmp, sizeof(int));
+        for (int i = 0; i < 100; ++i) TreeSet_insert(&self, &i);
+        assert(TreeSet_union(&self, &self) == TS_ERR_SUCCESS && TreeSet_size(&self) == 100);
+        TreeSet_intersection(&self, &self);
+        assert(TreeSet_size(&self) == 100);
+        TreeSet_difference(&self, &self);
+        assert(TreeSet_size(&self) == 0 && self._root == NULL);
+        TreeSet_invalidate(&self);
+        printf("[TreeSet algebra] Passed\n");
+    }
+
+    // ---- TreeSet order statistics test ----
+    {
+        enum { RANGE = 3000 };
+        TreeSet ts = TreeSet_init(int_cmp, sizeof(int));
+        int seed = 1;
+        TreeSet_insert(&ts, &seed);
+        assert(TreeSet_enable_order_statistics(&ts) == TS_ERR_NOT_EMPTY);
+        TreeSet_remove(&ts, &seed);
+        assert(TreeSet_enable_order_statistics(&ts) == TS_ERR_SUCCESS);
+
+        // Churn through inserts, key removals and iterator erasures.
+        bool present[RANGE] = { false };
+        unsigned rng = 4242;
+        for (int i = 0; i < 30000; ++i) {
+            rng = rng * 1103515245 + 12345;
+            int k = (int) ((rng >> 8) % RANGE);
+            if (rng & 0x10000) {
+                TreeSet_insert(&ts, &k);
+                present[k] = true;
+            } else if (rng & 0x20000) {
+                TreeSet_remove(&ts, &k);
+                present[k] = false;
+            } else {
+                TreeSetIterator it = TreeSet_lower_bound(&ts, &k);
+                if (it) {
+                    present[*(int*)it->data] = false;
+                    TreeSet_erase(&ts, it);
+                }
+            }
+        }
+        assert(rbtree_count_check(&ts, ts._root) == TreeSet_size(&ts) && rbtree_check(ts._root, NULL) > 0);
+
+        size_t below = 0;
+        for (int k = 0; k < RANGE; ++k) {
+            assert(TreeSet_rank(&ts, &k) == below);
+            if (present[k]) {
+                assert(*(int*)TreeSet_select(&ts, below)->data == k);
+                ++below;
+            }
+        }
+        assert(below == TreeSet_size(&ts) && TreeSet_select(&ts, below) == NULL);
+        int lo = 100, hi = 2100;
+        size_t in_range = 0;
+        for (int k = lo; k < hi; ++k) in_range += present[k];
+        assert(TreeSet_count_range(&ts, &lo, &hi) == in_range && TreeSet_count_range(&ts, &hi, &lo) == 0);
+
+        // Bulk construction and set algebra keep the sizes too.
+        int sorted[1000];
+        for (int i = 0; i < 1000; ++i) sorted[i] = 2 * i;
+        View view = View(sorted, 1000, sizeof(int));
+        TreeSet evens = TreeSet_init(int_cmp, sizeof(int));
+        assert(TreeSet_enable_order_statistics(&evens) == TS_ERR_SUCCESS);
+        assert(TreeSet_from_sorted(&evens, &view) == TS_ERR_SUCCESS);
+        assert(rbtree_count_check(&evens, evens._root) == 1000);
+        int k = 500;
+        assert(TreeSet_rank(&evens, &k) == 250 && *(int*)TreeSet_select(&evens, 999)->data == 1998);
+
+        TreeSet_difference(&ts, &evens);
+        assert(rbtree_count_check(&ts, ts._root) == TreeSet_size(&ts));
+        assert(TreeSet_union(&ts, &evens) == TS_ERR_SUCCESS);
+        assert(rbtree_count_check(&ts, ts._root) == TreeSet_size(&ts));
+        TreeSet_intersection(&evens, &ts);
+        assert(rbtree_count_check(&evens, evens._root) == 1000);
+        for (size_t i = 0; i < TreeSet_size(&ts); ++i)
+            assert(TreeSet_rank(&ts, TreeSet_select(&ts, i)->data) == i);
+
+        // Without the augmentation the queries still answer, by walking.
+        TreeSet plain = TreeSet_init(int_cmp, sizeof(int));
+        assert(TreeSet_from_sorted(&plain, &view) == TS_ERR_SUCCESS);
+        assert(TreeSet_rank(&plain, &k) == 250 && *(int*)TreeSet_select(&plain, 10)->data == 20);
+        assert(TreeSet_count_range(&plain, &lo, &hi) == 950);
+        TreeSet_invalidate(&plain);
+        TreeSet_invalidate(&evens);
+        TreeSet_invalidate(&ts);
+
+        TreeSet weights = TreeSet_init(weight_cmp, sizeof(Weight));
+        assert(TreeSet_enable_order_statistics(&weights) == TS_ERR_SUCCESS);
+        tset_alignment_check(&weights);
+        assert(rbtree_count_check(&weights, weights._root) == 8);
+        TreeSet_invalidate(&weights);
+        printf("[TreeSet order statistics] Passed\n");
+    }
+
+    // ---- TreeSet key extractor test ----
+    {
+        for (int mode = 0; mode < 2; ++mode) {
+            TreeSet ts = TreeSet_init(NULL, sizeof(Record));
+            if (mode == 0) assert(TreeSet_set_key(&ts, record_id, u64_cmp) == TS_ERR_SUCCESS);
+            else assert(TreeSet_set_u64_key(&ts, record_u64_id) == TS_ERR_SUCCESS);
+            assert(TreeSet_enable_order_statistics(&ts) == TS_ERR_SUCCESS);
+
+            Record record = { .payload = "x" };
+            for (uint64_t i = 0; i < 500; ++i) {
+                record.id = (i * 7919) % 500 * 10;
+                record.payload[1] = (char) i;
+                assert(TreeSet_insert(&ts, &record));
+            }
+            record.id = 40;
+            assert(!TreeSet_insert(&ts, &record));
+            assert(TreeSet_set_key(&ts, record_id, u64_cmp) == TS_ERR_NOT_EMPTY);
+            assert(rbtree_check(ts._root, NULL) > 0);
+
+            // Bare keys, no record-shaped probe.
+            uint64_t key = 1230;
+            TreeSetIterator it = TreeSet_find_key(&ts, &key);
+            assert(it && ((Record *) it->data)->id == 1230 && ((Record *) it->data)->payload[0] == 'x');
+            assert(TreeSet_find(&ts, it->data) == it);
+            key = 1231;
+            assert(!TreeSet_contains_key(&ts, &key));
+            assert(((Record *) TreeSet_lower_bound_key(&ts, &key)->data)->id == 1240);
+            key = 1240;
+            assert(((Record *) TreeSet_lower_bound_key(&ts, &key)->data)->id == 1240);
+            assert(((Record *) TreeSet_upper_bound_key(&ts, &key)->data)->id == 1250);
+            assert(TreeSet_rank_key(&ts, &key) == 124);
+            uint64_t lo = 100, hi = 200;
+            assert(TreeSet_count_range_key(&ts, &lo, &hi) == 10);
+            for (key = 0; key < 5000; key += 20)
+                assert(TreeSet_remove_key(&ts, &key));
+            assert(!TreeSet_remove_key(&ts, &lo));
+            assert(TreeSet_size(&ts) == 250 && rbtree_check(ts._root, NULL) > 0);
+            uint64_t previous = 0;
+            for (it = TreeSet_begin(&ts); it; it = TreeSet_next(&ts, it)) {
+                assert(((Record *) it->data)->id % 20 == 10 && ((Record *) it->data)->id >= previous);
+                previous = ((Record *) it->data)->id;
+            }
+
+            // Bulk construction and set algebra use the same ordering.
+            Record sorted[100];
+            for (int i = 0; i < 100; ++i) sorted[i] = (Record) { .id = (uint64_t) i * 5 };
+            View view = View(sorted, 100, sizeof(Record));
+            assert(TreeSet_from_sorted(&ts, &view) == TS_ERR_SUCCESS);
+            assert(rbtree_check(ts._root, NULL) > 0 && rbtree_count_check(&ts, ts._root) == TreeSet_size(&ts));
+            key = 15;
+            assert(TreeSet_contains_key(&ts, &key));
+            TreeSet fives = TreeSet_init(NULL, sizeof(Record));
+            if (mode == 0) TreeSet_set_key(&fives, record_id, u64_cmp);
+            else TreeSet_set_u64_key(&fives, record_u64_id);
+            assert(TreeSet_from_sorted(&fives, &view) == TS_ERR_SUCCESS);
+            TreeSet_difference(&ts, &fives);
+            assert(!TreeSet_contains_key(&ts, &key) && rbtree_count_check(&ts, ts._root) == TreeSet_size(&ts));
+            key = 30;
+            assert(TreeSet_contains_key(&ts, &key) == false);
+            key = 10;
+            assert(TreeSet_contains_key(&fives, &key));
+            TreeSet_invalidate(&fives);
+            TreeSet_invalidate(&ts);
+        }
+
+        // The cached u64 key in front of each node must not shift the data off MAX_ALIGN,
+        // with or without order statistics.
+        for (int counted = 0; counted < 2; ++counted) {
+            TreeSet weights = TreeSet_init(weight_cmp, sizeof(Weight));
+            assert(TreeSet_set_u64_key(&weights, weight_u64) == TS_ERR_SUCCESS);
+            if (counted) assert(TreeSet_enable_order_statistics(&weights) == TS_ERR_SUCCESS);
+            tset_alignment_check(&weights);
+            for (TreeSetIterator it = TreeSet_begin(&weights); it; it = TreeSet_next(&weights, it))
+                assert(TreeSet_find(&weights, it->data) == it);
+            TreeSet_invalidate(&weights);
+        }
+        printf("[TreeSet keys] Passed\n");
+    }
+
+    // ---- PersistentTreeSet test ----
+    {
+        enum { RANGE = 2000, VERSIONS = 8 };
+        PersistentTreeSet pts = PersistentTreeSet_init(int_cmp, sizeof(int));
+        static bool present[VERSIONS + 1][RANGE];
+        memset(present, 0, sizeof(present));
+        PersistentTreeSet versions[VERSIONS];
+        size_t sizes[VERSIONS];
+
+        // Churn the live version, snapshotting along the way; every snapshot must keep its contents.
+        unsigned rng = 99;
+        for (int v = 0; v < VERSIONS; ++v) {
+            for (int i = 0; i < 3000; ++i) {
+                rng = rng * 1103515245 + 12345;
+                int k = (int) ((rng >> 8) % RANGE);
+                if (rng & 0x10000) {
+                    assert(PersistentTreeSet_insert(&pts, &k) == (present[VERSIONS][k] ? PTS_ERR_EXISTS : PTS_ERR_SUCCESS));
+                    present[VERSIONS][k] = true;
+                } else {
+                    assert(PersistentTreeSet_remove(&pts, &k) == (present[VERSIONS][k] ? PTS_ERR_SUCCESS : PTS_ERR_NOT_FOUND));
+                    present[VERSIONS][k] = false;
+                }
+            }
+            assert(ptree_check(pts._root) > 0);
+            versions[v] = PersistentTreeSet_snapshot(&pts);
+            memcpy(present[v], present[VERSIONS], sizeof(present[v]));
+            sizes[v] = PersistentTreeSet_size(&pts);
+        }
+        // A snapshot is a version of its own and can diverge too.
+        int k = RANGE + 1;
+        assert(PersistentTreeSet_insert(&versions[3], &k) == PTS_ERR_SUCCESS);
+        assert(!PersistentTreeSet_contains(&pts, &k) && !PersistentTreeSet_contains(&versions[4], &k));
+        assert(PersistentTreeSet_remove(&versions[3], &k) == PTS_ERR_SUCCESS);
+
+        for (int v = 0; v < VERSIONS; ++v) {
+            assert(ptree_check(versions[v]._root) > 0 && PersistentTreeSet_size(&versions[v]) == sizes[v]);
+            size_t count = 0;
+            for (k = 0; k < RANGE; ++k) {
+                assert(PersistentTreeSet_contains(&versions[v], &k) == present[v][k]);
+                count += present[v][k];
+            }
+            assert(count == sizes[v]);
+            int previous = -1;
+            PersistentTreeSetIterator it;
+            for (PersistentTreeSet_begin(&versions[v], &it); PersistentTreeSet_iterator_get(&it); PersistentTreeSet_next(&it)) {
+                int current = *(const int *) PersistentTreeSet_iterator_get(&it);
+                assert(current > previous && present[v][current]);
+                previous = current;
+            }
+            k = 1000;
+            PersistentTreeSet_lower_bound(&versions[v], &k, &it);
+            while (k < RANGE && !present[v][k]) ++k;
+            assert(k == RANGE ? !PersistentTreeSet_iterator_get(&it) : *(const int *) PersistentTreeSet_iterator_get(&it) == k);
+        }
+        // Releasing versions in any order frees exactly what they alone held (checked by ASan).
+        for (int v = 0; v < VERSIONS; v += 2)
+            PersistentTreeSet_invalidate(&versions[v]);
+        for (k = 0; k < RANGE; ++k)
+            PersistentTreeSet_remove(&pts, &k);
+        assert(PersistentTreeSet_size(&pts) == 0 && pts._root == NULL);
+        for (int v = 1; v < VERSIONS; v += 2)
+            PersistentTreeSet_invalidate(&versions[v]);
+        PersistentTreeSet_invalidate(&pts);
+
+        // Running out of memory leaves the version untouched.
+        size_t budget = 100;
+        Allocator budgeted = { .alloc = budget_alloc, .free = budget_free, .ctx = &budget };
+        PersistentTreeSet small = PersistentTreeSet_init_with_allocator(int_cmp, sizeof(int), &budgeted);
+        k = 0;
+        while (PersistentTreeSet_insert(&small, &k) == PTS_ERR_SUCCESS) ++k;
+        assert(k > 0 && PersistentTreeSet_size(&small) == (size_t) k && ptree_check(small._root) > 0);
+        PersistentTreeSet frozen = PersistentTreeSet_snapshot(&small);
+        int target = k / 2;
+        assert(PersistentTreeSet_remove(&small, &target) == PTS_ERR_OOM);
+        assert(PersistentTreeSet_size(&small) == (size_t) k && PersistentTreeSet_contains(&small, &target));
+        PersistentTreeSet_invalidate(&frozen);
+        PersistentTreeSet_invalidate(&small);
+
+        // Readers iterate snapshots on other threads while the writer keeps updating.
+        PTSPublisher publisher = { .done = false };
+        pthread_mutex_init(&publisher.lock, NULL);
+        PersistentTreeSet writer = PersistentTreeSet_init(int_cmp, sizeof(int));
+        for (k = 0; k < PTS_WINDOW; ++k)
+            PersistentTreeSet_insert(&writer, &k);
+        publisher.published = PersistentTreeSet_snapshot(&writer);
+        pthread_t readers[2];
+        for (int i = 0; i < 2; ++i)
+            assert(pthread_create(&readers[i], NULL, pts_reader, &publisher) == 0);
+        for (int step = 0; step < PTS_STEPS; ++step) {
+            int oldest = step, newest = step + PTS_WINDOW;
+            assert(PersistentTreeSet_remove(&writer, &oldest) == PTS_ERR_SUCCESS);
+            assert(PersistentTreeSet_insert(&writer, &newest) == PTS_ERR_SUCCESS);
+            PersistentTreeSet next = PersistentTreeSet_snapshot(&writer);
+            pthread_mutex_lock(&publisher.lock);
+            PersistentTreeSet previous = publisher.published;
+            publisher.published = next;
+            publisher.done = step == PTS_STEPS - 1;
+            pthread_mutex_unlock(&publisher.lock);
+            PersistentTreeSet_invalidate(&previous);
+        }
+        for (int i = 0; i < 2; ++i)
+            pthread_join(readers[i], NULL);
+        PersistentTreeSet_invalidate(&publisher.published);
+        PersistentTreeSet_invalidate(&writer);
+        pthread_mutex_destroy(&publisher.lock);
+        printf("[PersistentTreeSet] Passed\n");
+    }
+
+    // ---- SkipListSet / SkipListMap test ----
+    {
+        Errable(SkipListSet) sres = SkipListSet_init(int_cmp, sizeof(int));
+        assert(!sres.fail);
+        SkipListSet sls = sres.success;
+        for (int i = 0; i < 1000; ++i) {
+            int k = (int) (((long) i * 7919) % 1000) * 2;
+            assert(SkipListSet_insert(&sls, &k) == SLS_ERR_SUCCESS);
+        }
+        assert(SkipListSet_insert(&sls, &(int){ 42 }) == SLS_ERR_EXISTS);
+        assert(SkipListSet_size(&sls) == 1000);
+        assert(SkipListSet_contains(&sls, &(int){ 1998 }) && !SkipListSet_contains(&sls, &(int){ 7 }));
+        int out = -1;
+        assert(SkipListSet_get(&sls, &(int){ 64 }, &out) && out == 64);
+        assert(!SkipListSet_get(&sls, &(int){ 65 }, &out));
+
+        // Bounds follow TreeSet: lower is the first >= key, upper the first > key.
+        SkipListSetIterator it;
+        SkipListSet_lower_bound(&sls, &(int){ 5 }, &it);
+        assert(*(const int *) SkipListSet_iterator_get(&it) == 6);
+        SkipListSet_iterator_close(&it);
+        SkipListSet_lower_bound(&sls, &(int){ 6 }, &it);
+        assert(*(const int *) SkipListSet_iterator_get(&it) == 6);
+        SkipListSet_iterator_close(&it);
+        SkipListSet_upper_bound(&sls, &(int){ 6 }, &it);
+        assert(*(const int *) SkipListSet_iterator_get(&it) == 8);
+        SkipListSet_iterator_close(&it);
+        SkipListSet_upper_bound(&sls, &(int){ 1998 }, &it);
+        assert(!SkipListSet_iterator_get(&it));
+        SkipListSet_iterator_close(&it);
+        SkipListSet_lower_bound(&sls, &(int){ -1 }, &it);
+        assert(*(const int *) SkipListSet_iterator_get(&it) == 0);
+        SkipListSet_iterator_close(&it);
+
+        // Removing behind and ahead of an open iterator: it skips what is gone.
+        int expected = 0;
+        for (SkipListSet_begin(&sls, &it); SkipListSet_iterator_get(&it); SkipListSet_next(&it)) {
+            int key = *(const int *) SkipListSet_iterator_get(&it);
+            assert(key == expected);
+            if (key % 8 == 0) {
+                assert(SkipListSet_remove(&sls, &key) == SLS_ERR_SUCCESS);
+                int ahead = key + 2;
+                assert(SkipListSet_remove(&sls, &ahead) == SLS_ERR_SUCCESS);
+                expected += 2;
+            }
+            expected += 2;
+        }
+        SkipListSet_iterator_close(&it);
+        assert(expected == 2000 && SkipListSet_size(&sls) == 500);
+        assert(SkipListSet_remove(&sls, &(int){ 0 }) == SLS_ERR_NOT_FOUND);
+        assert(SkipListSet_insert(&sls, &(int){ 0 }) == SLS_ERR_SUCCESS);
+
+        // Enough churn to cycle the epochs and free removed nodes along the way.
+        for (int i = 0; i < 100000; ++i) {
+            int k = 5000 + i % 300;
+            assert(SkipListSet_insert(&sls, &k) == SLS_ERR_SUCCESS);
+            assert(SkipListSet_remove(&sls, &k) == SLS_ERR_SUCCESS);
+        }
+        assert(SkipListSet_size(&sls) == 501);
+        SkipListSet_invalidate(&sls);
+
+        // Nodes come from the allocator: the head first, then one per insert.
+        size_t budget = 0;
+        Allocator budgeted = { .alloc = budget_alloc, .free = budget_free, .ctx = &budget };
+        assert(SkipListSet_create_with_allocator(&sls, int_cmp, sizeof(int), &budgeted) == SLS_ERR_OOM);
+        budget = 3;
+        assert(SkipListSet_create_with_allocator(&sls, int_cmp, sizeof(int), &budgeted) == SLS_ERR_SUCCESS);
+        assert(SkipListSet_insert(&sls, &(int){ 1 }) == SLS_ERR_SUCCESS);
+        assert(SkipListSet_insert(&sls, &(int){ 2 }) == SLS_ERR_SUCCESS);
+        assert(budget == 0 && SkipListSet_insert(&sls, &(int){ 3 }) == SLS_ERR_OOM);
+        assert(SkipListSet_size(&sls) == 2);
+        SkipListSet_invalidate(&sls);
+
+        // Concurrent writers racing on the same keys, with a scanner running throughout. Nodes
+        // are allocated and freed on every thread, so they come from a concurrent slab.
+        SlabAllocator sa;
+        assert(SlabAllocator_create_concurrent(&sa, 0) == SA_ERR_SUCCESS);
+        Allocator slab = Allocator_slab(&sa);
+        assert(SkipListSet_create_with_allocator(&sls, int_cmp, sizeof(int), &slab) == SLS_ERR_SUCCESS);
+        SLSWorker workers[SLS_THREADS];
+        int stop = 0;
+        for (int i = 0; i < SLS_THREADS; ++i)
+            workers[i] = (SLSWorker) { .sls = &sls, .offset = i * (SLS_KEYS / SLS_THREADS), .won = 0, .stop = &stop };
+        SLSWorker scan = { .sls = &sls, .offset = 0, .won = 0, .stop = &stop };
+        pthread_t scanner;
+        assert(pthread_create(&scanner, NULL, sls_scanner, &scan) == 0);
+        int won = 0;
+        sls_run(sls_inserter, workers);
+        for (int i = 0; i < SLS_THREADS; ++i)
+            won += workers[i].won;
+        assert(won == SLS_KEYS && SkipListSet_size(&sls) == SLS_KEYS);
+        for (int i = 0; i < SLS_THREADS; ++i)
+            workers[i].won = 0;
+        sls_run(sls_remover, workers);
+        for (int i = 0; i < SLS_THREADS; ++i)
+            won += workers[i].won;
+        assert(won == SLS_KEYS / 2 && SkipListSet_size(&sls) == SLS_KEYS / 2);
+        for (int i = 0; i < SLS_THREADS; ++i)
+            workers[i].won = 0;
+        sls_run(sls_churner, workers);
+        __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+        pthread_join(scanner, NULL);
+
+        int churned = 0, present = 0;
+        for (int i = 0; i < SLS_THREADS; ++i)
+            churned += workers[i].won;
+        for (SkipListSet_begin(&sls, &it); SkipListSet_iterator_get(&it); SkipListSet_next(&it)) {
+            int key = *(const int *) SkipListSet_iterator_get(&it);
+            assert(key >= SLS_KEYS || (key % 2 == 0 && key == 2 * present));
+            ++present;
+        }
+        SkipListSet_iterator_close(&it);
+        assert(present == SLS_KEYS / 2 + churned && SkipListSet_size(&sls) == (size_t) present);
+        SkipListSet_invalidate(&sls);
+        SlabAllocator_invalidate(&sa);
+
+        Errable(SkipListMap) mres = SkipListMap_init(sizeof(uint64_t), sizeof(Record), u64_cmp);
+        assert(!mres.fail);
+        SkipListMap sm = mres.success;
+        for (uint64_t id = 0; id < 100; ++id) {
+            Record r = { .id = id * id };
+            snprintf(r.payload, sizeof r.payload, "record %llu", (unsigned long long) id);
+            assert(SkipListMap_insert(&sm, &id, &r) == SLM_ERR_SUCCESS);
+        }
+        assert(SkipListMap_insert(&sm, &(uint64_t){ 7 }, &(Record){ .id = 0 }) == SLM_ERR_EXISTS);
+        Record r;
+        assert(SkipListMap_get(&sm, &(uint64_t){ 9 }, &r) && r.id == 81 && strcmp(r.payload, "record 9") == 0);
+        assert(SkipListMap_remove(&sm, &(uint64_t){ 9 }) == SLM_ERR_SUCCESS);
+        assert(SkipListMap_remove(&sm, &(uint64_t){ 9 }) == SLM_ERR_NOT_FOUND);
+        assert(!SkipListMap_get(&sm, &(uint64_t){ 9 }, &r) && !SkipListMap_contains(&sm, &(uint64_t){ 9 }));
+        uint64_t next = 10;
+        for (SkipListMap_upper_bound(&sm, &(uint64_t){ 8 }, &it); SkipListMap_entry_key(&sm, &it); SkipListMap_next(&it), ++next) {
+            assert(*(const uint64_t *) SkipListMap_entry_key(&sm, &it) == next);
+            assert(((const Record *) SkipListMap_entry_value(&sm, &it))->id == next * next);
+        }
+        SkipListMap_iterator_close(&it);
+        assert(next == 100 && SkipListMap_size(&sm) == 99);
+        SkipListMap_invalidate(&sm);
+
+        // u64 keys with u32 values: each entry is padded so every key stays 8-byte aligned.
+        assert(SkipListMap_create(&sm, sizeof(uint64_t), sizeof(uint32_t), u64_cmp) == SLM_ERR_SUCCESS);
+        for (uint64_t id = 0; id < 1000; ++id)
+            assert(SkipListMap_insert(&sm, &id, &(uint32_t){ (uint32_t) id * 3 }) == SLM_ERR_SUCCESS);
+        next = 0;
+        for (SkipListMap_begin(&sm, &it); SkipListMap_entry_key(&sm, &it); SkipListMap_next(&it), ++next) {
+            const uint64_t *key = SkipListMap_entry_key(&sm, &it);
+            assert((uintptr_t) key % sizeof(uint64_t) == 0 && *key == next);
+            assert(*(const uint32_t *) SkipListMap_entry_value(&sm, &it) == (uint32_t) next * 3);
+        }
+        SkipListMap_iterator_close(&it);
+        assert(next == 1000);
+        SkipListMap_invalidate(&sm);
+
+        budget = 1;
+        assert(SkipListMap_create_with_allocator(&sm, sizeof(uint64_t), sizeof(uint32_t), u64_cmp, &budgeted) == SLM_ERR_SUCCESS);
+        assert(SkipListMap_insert(&sm, &(uint64_t){ 1 }, &(uint32_t){ 1 }) == SLM_ERR_OOM);
+        SkipListMap_invalidate(&sm);
+
+        // More sets alive at once than PTHREAD_KEYS_MAX, and more created in turn, each
+        // possibly at an address an invalidated one had.
+        enum { SLS_MANY = 2000 };
+        SkipListSet *many = malloc(SLS_MANY * sizeof(SkipListSet));
+        assert(many);
+        for (int i = 0; i < SLS_MANY; ++i) {
+            assert(SkipListSet_create(&many[i], int_cmp, sizeof(int)) == SLS_ERR_SUCCESS);
+            assert(SkipListSet_insert(&many[i], &i) == SLS_ERR_SUCCESS);
+        }
+        for (int i = 0; i < SLS_MANY; ++i) {
+            assert(SkipListSet_size(&many[i]) == 1 && SkipListSet_contains(&many[i], &i));
+            SkipListSet_invalidate(&many[i]);
+        }
+        free(many);
+        for (int i = 0; i < SLS_MANY; ++i) {
+            assert(SkipListSet_create(&sls, int_cmp, sizeof(int)) == SLS_ERR_SUCCESS);
+            assert(SkipListSet_insert(&sls, &i) == SLS_ERR_SUCCESS);
+            assert(SkipListSet_size(&sls) == 1);
+            SkipListSet_invalidate(&sls);
+        }
+
+        pthread_barrier_t barrier;
+        pthread_barrier_init(&barrier, NULL, 2);
+        assert(SkipListSet_create(&sls, int_cmp, sizeof(int)) == SLS_ERR_SUCCESS);
+        SLSOutliver outliver = { &sls, &barrier };
+        pthread_t outliver_thread;
+        assert(pthread_create(&outliver_thread, NULL, sls_outliver, &outliver) == 0);
+        pthread_barrier_wait(&barrier);
+        SkipListSet_invalidate(&sls);
+        pthread_barrier_wait(&barrier);
+        pthread_join(outliver_thread, NULL);
+        pthread_barrier_destroy(&barrier);
+        printf("[SkipListSet] Passed\n");
+    }
+
+    // ---- BTreeSet / BTreeMap test ----
+    {
+        BTreeSet bs = BTreeSet_init(int_cmp, sizeof(int));
+        for (int i = 0; i < 50000; ++i) {
+            int k = (int) (((long) i * 7919) % 50000);
+            assert(BTreeSet_insert(&bs, &k));
+        }
+        int dup = 77;
+        assert(!BTreeSet_insert(&bs, &dup) && BTreeSet_size(&bs) == 50000);
+        assert(bs._height >= 3);
+        int expected = 0;
+        for (BTreeSetIterator it = BTreeSet_begin(&bs); BTreeSet_iterator_get(&bs, it); it = BTreeSet_next(&bs, it))
+            assert(*(int*)BTreeSet_iterator_get(&bs, it) == expected++);
+        assert(expected == 50000);
+        for (BTreeSetIterator it = BTreeSet_prev(&bs, BTreeSet_end(&bs)); BTreeSet_iterator_get(&bs, it); it = BTreeSet_prev(&bs, it))
+            assert(*(int*)BTreeSet_iterator_get(&bs, it) == --expected);
+
+        // Drop the odd elements, then check bounds on the gaps.
+        for (int i = 1; i < 50000; i += 2)
+            assert(BTreeSet_erase(&bs, BTreeSet_find(&bs, &i)) == BTS_ERR_SUCCESS);
+        assert(BTreeSet_size(&bs) == 25000);
+        assert(BTreeSet_erase(&bs, BTreeSet_end(&bs)) == BTS_ERR_INVALID_ITERATOR);
+        int key = 101;
+        assert(*(int*)BTreeSet_iterator_get(&bs, BTreeSet_lower_bound(&bs, &key)) == 102);
+        key = 102;
+        assert(*(int*)BTreeSet_iterator_get(&bs, BTreeSet_lower_bound(&bs, &key)) == 102);
+        assert(*(int*)BTreeSet_iterator_get(&bs, BTreeSet_upper_bound(&bs, &key)) == 104);
+        key = 49998;
+        assert(BTreeSet_iterator_get(&bs, BTreeSet_upper_bound(&bs, &key)) == NULL);
+        for (int i = 0; i < 50000; i += 2)
+            assert(BTreeSet_remove(&bs, &i));
+        assert(BTreeSet_size(&bs) == 0 && BTreeSet_iterator_get(&bs, BTreeSet_begin(&bs)) == NULL);
+        btree_churn(&bs, sizeof(int), 5000, 200000);
+        BTreeSet_invalidate(&bs);
+
+        // Large elements force minimum-capacity nodes and deep trees.
+        BTreeSet wide = BTreeSet_init(int_cmp, 100);
+        btree_churn(&wide, 100, 3000, 100000);
+        BTreeSet_invalidate(&wide);
+
+        BTreeMap bm = BTreeMap_init(sizeof(int), sizeof(double), int_cmp);
+        for (int i = 0; i < 10000; ++i) {
+            double v = i * 0.5;
+            assert(BTreeMap_insert(&bm, &i, &v) == BTM_ERR_SUCCESS);
+        }
+        double v = -1;
+        int k = 42;
+        assert(BTreeMap_insert(&bm, &k, &v) == BTM_ERR_EXISTS);
+        assert(BTreeMap_put(&bm, &k, &v) == BTM_ERR_SUCCESS && *(double*)BTreeMap_get(&bm, &k) == -1);
+        assert(BTreeMap_remove(&bm, &k) && !BTreeMap_contains(&bm, &k) && BTreeMap_get(&bm, &k) == NULL);
+        double sum = 0;
+        int lo = 100, hi = 200;
+        for (BTreeMapIterator it = BTreeMap_lower_bound(&bm, &lo); it._leaf && *(int*)BTreeMap_entry_key(&bm, it) < hi; it = BTreeMap_next(&bm, it))
+            sum += *(double*)BTreeMap_entry_value(&bm, it);
+        assert(sum == 7475.0); // 0.5 * (100 + ... + 199)
+        assert(BTreeMap_size(&bm) == 9999);
+        k = 20000;
+        BTMEmplacePair slot = BTreeMap_emplace(&bm, &k, NULL);
+        assert(slot.inserted && *(double*)slot.value == 0);
+        *(double*)slot.value = 2.5;
+        slot = BTreeMap_emplace(&bm, &k, NULL);
+        assert(!slot.inserted && *(double*)slot.value == 2.5);
+        BTreeMap_invalidate(&bm);
+
+        // uint64_t keys with uint32_t values: leaf entries are padded so keys stay aligned.
+        BTreeMap packed = BTreeMap_init(sizeof(uint64_t), sizeof(uint32_t), u64_cmp);
+        for (uint64_t key = 0; key < 1000; ++key) {
+            uint32_t value = (uint32_t) key + 7;
+            assert(BTreeMap_insert(&packed, &key, &value) == BTM_ERR_SUCCESS);
+        }
+        uint64_t expected_key = 0;
+        for (BTreeMapIterator it = BTreeMap_begin(&packed); it._leaf; it = BTreeMap_next(&packed, it), ++expected_key) {
+            assert((uintptr_t) BTreeMap_entry_key(&packed, it) % sizeof(uint64_t) == 0);
+            assert(*(uint64_t *) BTreeMap_entry_key(&packed, it) == expected_key);
+            assert(*(uint32_t *) BTreeMap_entry_value(&packed, it) == (uint32_t) expected_key + 7);
+        }
+        assert(expected_key == 1000);
+        BTreeMap_invalidate(&packed);
+        printf("[BTreeSet] Passed\n");
+    }
+
+    // ---- TreeMap test ----
+    {
+        typedef struct { double score; char name[20]; } Record;
+        TreeMap tm = TreeMap_init(sizeof(int), sizeof(Record), int_cmp);
+        for (int i = 0; i < 1000; ++i) {
+            int k = (i * 7919) % 1000;
+            Record r = { k * 1.5, "" };
+            snprintf(r.name, sizeof(r.name), "rec-%d", k);
+            assert(TreeMap_insert(&tm, &k, &r) == TM_ERR_SUCCESS);
+        }
+        int k = 10;
+        Record other = { -1, "other" };
+        assert(TreeMap_insert(&tm, &k, &other) == TM_ERR_EXISTS);
+        Record *r = TreeMap_get(&tm, &k);
+        assert(r && r->score == 15.0 && strcmp(r->name, "rec-10") == 0);
+        r->score = 99; // in-place update through the lookup
+        assert(((Record*)TreeMap_get(&tm, &k))->score == 99);
+        assert(TreeMap_put(&tm, &k, &other) == TM_ERR_SUCCESS && TreeMap_size(&tm) == 1000);
+        assert(strcmp(((Record*)TreeMap_get(&tm, &k))->name, "other") == 0);
+
+        // get_or_insert: existing keys return their slot, new keys get a zeroed one.
+        TMEmplacePair got = TreeMap_get_or_insert(&tm, &k);
+        assert(!got.inserted && got.value == TreeMap_get(&tm, &k));
+        k = 5000;
+        got = TreeMap_get_or_insert(&tm, &k);
+        assert(got.inserted && ((Record*)got.value)->score == 0 && ((Record*)got.value)->name[0] == 0);
+        assert(TreeMap_size(&tm) == 1001);
+
+        int expected = 0;
+        for (TreeMapIterator it = TreeMap_begin(&tm); it != TreeMap_end(&tm); it = TreeMap_next(&tm, it), ++expected)
+            assert(*(int*)TreeMap_entry_key(&tm, it) == (expected == 1000 ? 5000 : expected));
+        int lo = 500;
+        assert(*(int*)TreeMap_entry_key(&tm, TreeMap_upper_bound(&tm, &lo)) == 501);
+        assert(TreeMap_erase(&tm, TreeMap_find(&tm, &lo)) == TM_ERR_SUCCESS && !TreeMap_contains(&tm, &lo));
+        assert(TreeMap_remove(&tm, &k) && TreeMap_get(&tm, &k) == NULL && TreeMap_size(&tm) == 999);
+        TreeMap_invalidate(&tm);
+
+        TreeMap counts = TreeMap_init(sizeof(int), sizeof(int), int_cmp);
+        for (int i = 0; i < 300; ++i) {
+            int bucket = i % 7;
+            ++*(int*)TreeMap_get_or_insert(&counts, &bucket).value;
+        }
+        k = 3;
+        assert(TreeMap_size(&counts) == 7 && *(int*)TreeMap_get(&counts, &k) == 43);
+        TreeMap_invalidate(&counts);
+
+        // u64 keys with u32 values: each node's entry is padded so every key stays 8-byte aligned.
+        TreeMap packed = TreeMap_init(sizeof(uint64_t), sizeof(uint32_t), u64_cmp);
+        for (uint64_t key = 0; key < 1000; ++key) {
+            uint32_t value = (uint32_t) key + 7;
+            assert(TreeMap_insert(&packed, &key, &value) == TM_ERR_SUCCESS);
+        }
+        uint64_t expected_key = 0;
+        for (TreeMapIterator it = TreeMap_begin(&packed); it != TreeMap_end(&packed); it = TreeMap_next(&packed, it), ++expected_key) {
+            assert((uintptr_t) TreeMap_entry_key(&packed, it) % sizeof(uint64_t) == 0);
+            assert(*(uint64_t *) TreeMap_entry_key(&packed, it) == expected_key);
+            assert(*(uint32_t *) TreeMap_entry_value(&packed, it) == (uint32_t) expected_key + 7);
+        }
+        assert(expected_key == 1000);
+        TreeMap_invalidate(&packed);
+        printf("[TreeMap] Passed\n");
+    }
+
+    // ---- Allocator test ----
+    {
+        ArenaAllocator arena;
+        assert(ArenaAllocator_create(&arena, 256) == ARENA_ERR_SUCCESS);
+        Allocator aa = Allocator_arena(&arena);
+        Vector v;
+        assert(Vector_create_with_allocator(&v, sizeof(int), &aa) == VEC_ERR_SUCCESS);
+        for (int i = 0; i < 500; ++i)
+            assert(Vector_append(&v, &i) == VEC_ERR_SUCCESS);
+        for (int i = 0; i < 500; ++i)
+            assert(Vector_get(&v, i, int) == i);
+        String s;
+        assert(String_create_with_allocator(&s, &aa) == STR_ERR_SUCCESS);
+        for (int i = 0; i < 50; ++i)
+            assert(String_append_cstring(&s, "arena") == STR_ERR_SUCCESS);
+        assert(String_size(&s) == 250);
+        HashSet hs;
+        assert(HashSet_create_with_allocator(&hs, sizeof(int), int_hash, int_eq, &aa) == HS_ERR_SUCCESS);
+        for (int i = 0; i < 200; ++i)
+            assert(HashSet_insert(&hs, &i) == HS_ERR_SUCCESS);
+        assert(HashSet_contains(&hs, &(int){ 199 }));
+        // Everything above is released at once.
+        ArenaAllocator_invalidate(&arena);
+
+        SlabAllocator sa;
+        assert(SlabAllocator_create(&sa, 0) == SA_ERR_SUCCESS);
+        Allocator slab = Allocator_slab(&sa);
+        TreeSet ts = TreeSet_init_with_allocator(int_cmp, NULL, sizeof(int), &slab);
+        for (int i = 0; i < 100; ++i)
+            assert(TreeSet_insert(&ts, &i));
+        assert(TreeSet_contains(&ts, &(int){ 42 }));
+        TreeSet_invalidate(&ts);
+        SlabAllocator_invalidate(&sa);
+
+        // Containers keep a pointer to their allocator, not a copy of it.
+        assert(sizeof(String) == sizeof(((String *) 0)->_data) + (2 * sizeof(size_t)) + sizeof(const Allocator *));
+        printf("[Allocator] Passed\n");
+    }
+
     printf("==== All tests passed ====\n");
     return 0;
 }